@@ -9,8 +9,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <locale.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/time.h>
 #endif
 #include <cjson/cJSON.h>
 #include "webview/webview.h"
@@ -26,6 +31,15 @@
 #include "src/ui_cli.h"
 #include "src/ui_loader.h"
 #include "src/grafo.h"
+#include "src/http_utils.h"
+#include "src/http_multi.h"
+#include "src/config.h"
+#include "src/tarefas.h"
+#include "src/str_builder.h"
+#include "src/cache_distancias.h"
+#include "src/cache_coordenadas.h"
+#include "src/normalizacao.h"
+#include "src/singleflight.h"
 
 // Estrutura de contexto da aplicação (substitui variáveis globais)
 typedef struct {
@@ -33,13 +47,324 @@ typedef struct {
     HistoricoChat* historico;
     char cidade[100];
     Grafo* grafo;
+    pthread_mutex_t trava;          // Protege historico e cidade (o grafo tem trava própria)
 } AppContext;
 
-// Callback quando JavaScript chama funções C
-void handle_rpc(const char *seq, const char *req, void *arg) {
-    AppContext* ctx = (AppContext*)arg;
-    webview_t w = ctx->webview;
+// Relógio em milissegundos para as medições de latência
+static double obter_tempo_ms(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER agora;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&agora);
+    return (double)agora.QuadPart / (double)frequency.QuadPart * 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)(tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0);
+#endif
+}
+
+// Pré-aquecimento ligado em config.h e não desativado no .env (GENIEC_PREAQUECER=0)
+static int preaquecimento_ativo(void) {
+    const char* valor = obter_env("GENIEC_PREAQUECER");
+    return HTTP_PREAQUECER && !(valor && strcmp(valor, "0") == 0);
+}
+
+// ===== PONTE ENTRE THREADS DE TRABALHO E A THREAD DA INTERFACE =====
+
+// Chamada pendente para a thread da interface
+typedef struct {
+    char* js;                       // Código a avaliar (ou NULL)
+    char* seq;                      // Sequência do RPC a responder (ou NULL)
+    int status;
+    char* resultado;
+} DespachoUI;
+
+// Executado na thread da interface via webview_dispatch
+static void executar_despacho_ui(webview_t w, void* arg) {
+    DespachoUI* despacho = (DespachoUI*)arg;
+    if (despacho->js) {
+        webview_eval(w, despacho->js);
+    }
+    if (despacho->seq) {
+        webview_return(w, despacho->seq, despacho->status, despacho->resultado);
+    }
+    free(despacho->js);
+    free(despacho->seq);
+    free(despacho->resultado);
+    free(despacho);
+}
+
+// Agenda a avaliação de JavaScript na thread da interface (seguro em qualquer thread)
+static void ui_eval(AppContext* ctx, const char* js) {
+    DespachoUI* despacho = (DespachoUI*)calloc(1, sizeof(DespachoUI));
+    if (!despacho) return;
+    despacho->js = strdup(js);
+    webview_dispatch(ctx->webview, executar_despacho_ui, despacho);
+}
+
+// Agenda a resposta de um RPC (resolve a Promise do lado JavaScript)
+static void ui_return(AppContext* ctx, const char* seq, int status, const char* resultado) {
+    DespachoUI* despacho = (DespachoUI*)calloc(1, sizeof(DespachoUI));
+    if (!despacho) return;
+    despacho->seq = strdup(seq);
+    despacho->status = status;
+    despacho->resultado = strdup(resultado);
+    webview_dispatch(ctx->webview, executar_despacho_ui, despacho);
+}
+
+// Mostra uma mensagem HTML no chat (o HTML vai dentro de uma template string do JS)
+static void ui_mensagem_html(AppContext* ctx, const char* remetente, const char* html) {
+    StrBuilder js;
+    sb_iniciar(&js, strlen(html) + 64);
+    sb_formatar(&js, "adicionarMensagemHTML('%s', `", remetente);
+    sb_anexar(&js, html);
+    sb_anexar(&js, "`, false);");
+
+    char* js_code = sb_finalizar(&js);
+    if (js_code) {
+        ui_eval(ctx, js_code);
+        free(js_code);
+    }
+}
+
+// Atualiza o clima mostrado no cabeçalho (clima-info)
+static void ui_widget_clima(AppContext* ctx, const DataClima* clima) {
+    const char* icone = obter_icone_clima(clima->description);
+    char js_clima[512];
+    snprintf(js_clima, sizeof(js_clima),
+        "document.getElementById('clima-info').innerHTML = "
+        "'%s <b>%s:</b> %.1f°C - %s';",
+        icone, clima->cidade, clima->temperatura, clima->description);
+    ui_eval(ctx, js_clima);
+}
+
+// Envia as estatísticas do grafo (JSON) para o painel, se estiver aberto
+static void ui_estatisticas_grafo(AppContext* ctx, const char* stats) {
+    StrBuilder js;
+    sb_iniciar(&js, strlen(stats) + 96);
+    sb_anexar(&js, "if(typeof onEstatisticasGrafo === 'function') onEstatisticasGrafo(");
+    sb_anexar(&js, stats);
+    sb_anexar(&js, ");");
+
+    char* js_code = sb_finalizar(&js);
+    if (js_code) {
+        ui_eval(ctx, js_code);
+        free(js_code);
+    }
+}
+
+// Planeja e calcula uma rota: se o grafo já liga as duas cidades, usa só o
+// grafo local; senão consulta a IA para a região que falta. Retorna o JSON
+// da rota (ou NULL se não foi possível montar a malha)
+static char* planejar_rota(AppContext* ctx, const char* origem, const char* destino) {
+    char* rota_json = NULL;
+
+    grafo_travar(ctx->grafo);
+    int conectadas = grafo_cidades_conectadas(ctx->grafo, origem, destino);
+    if (conectadas) {
+        fprintf(stderr, "[PLANEJAMENTO] %s e %s já conectadas no grafo; IA não consultada\n",
+                origem, destino);
+        ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
+            "'♻️ <b>Rota já coberta pelo grafo local</b><br>"
+            "🔍 Calculando menor caminho sem consultar a IA...', false);");
+        rota_json = calcular_rota_json(ctx->grafo, origem, destino);
+    }
+    grafo_destravar(ctx->grafo);
+    if (conectadas) return rota_json;
+
+    fprintf(stderr, "[PLANEJAMENTO] %s e %s sem ligação no grafo; consultando IA\n", origem, destino);
+    fflush(stderr);
+
+    // Mostra mensagem de processamento
+    ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
+        "'🔄 <b>Consultando IA para obter distâncias...</b><br>"
+        "⏳ Isso pode levar alguns minutos...', false);");
+
+    // Consulta a IA para preencher o grafo
+    int conexoes = obter_distancias_ia_e_preencher_grafo(origem, destino, ctx->grafo);
+
+    if (conexoes > 0) {
+        grafo_travar(ctx->grafo);
+
+        char msg_sucesso[768];
+        snprintf(msg_sucesso, sizeof(msg_sucesso),
+            "✅ <b>Malha de rotas criada!</b><br>"
+            "🏙️ <b>%d cidades</b> mapeadas<br>"
+            "🛣️ <b>%d conexões</b> adicionadas pela IA<br>"
+            "🔍 Buscando coordenadas e calculando menor caminho...<br><br>",
+            ctx->grafo->num_cidades, conexoes);
+
+        ui_mensagem_html(ctx, "Sistema", msg_sucesso);
+
+        // Salva o grafo atualizado com coordenadas E conexões
+        salvar_coordenadas_grafo(ctx->grafo, "coordenadas_grafo.txt");
+
+        // Calcula o menor caminho; a interface desenha a rota a partir do JSON
+        rota_json = calcular_rota_json(ctx->grafo, origem, destino);
+
+        // O restante da malha nova é geocodificado enquanto o usuário lê a rota
+        grafo_agendar_coordenadas(ctx->grafo);
+
+        // Atualiza estatísticas no painel (se estiver aberto)
+        char* stats = obter_estatisticas_grafo(ctx->grafo);
+        ui_estatisticas_grafo(ctx, stats);
+        free(stats);
 
+        grafo_destravar(ctx->grafo);
+    } else {
+        ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
+            "'❌ Não foi possível obter distâncias da IA.<br>"
+            "Verifique se as cidades são válidas.', false);");
+    }
+
+    return rota_json;
+}
+
+typedef struct {
+    AppContext* ctx;
+    const char* origem;
+    const char* destino;
+} PedidoRota;
+
+static void* tarefa_planejar_rota(void* arg) {
+    PedidoRota* pedido = (PedidoRota*)arg;
+    return planejar_rota(pedido->ctx, pedido->origem, pedido->destino);
+}
+
+// planejar_rota unificada: cliques repetidos em "Calcular rota" (ou o chat e o
+// painel pedindo a mesma rota) aguardam o cálculo em andamento em vez de
+// consultar a IA de novo. A origem e o destino ficam na ordem (o caminho tem sentido)
+static char* planejar_rota_unica(AppContext* ctx, const char* origem, const char* destino) {
+    char a[MAX_NOME_CIDADE];
+    char b[MAX_NOME_CIDADE];
+    char chave[2 * MAX_NOME_CIDADE + 8];
+    normalizar_nome(origem, a, sizeof(a));
+    normalizar_nome(destino, b, sizeof(b));
+    snprintf(chave, sizeof(chave), "rota|%s|%s", a, b);
+
+    PedidoRota pedido = {ctx, origem, destino};
+    return (char*)singleflight_executar(chave, tarefa_planejar_rota, &pedido, singleflight_copiar_string, NULL);
+}
+
+// Monta uma malha de uma vez: "A-B-C-D" vira os trechos A-B, B-C e C-D
+// (consultados em lote); um texto sem '-' é tratado como nome de região
+static void construir_malha(AppContext* ctx, const char* texto) {
+    ParCidades pares[32];
+    int num_pares = 0;
+    char anterior[MAX_NOME_CIDADE] = {0};
+    int regiao = strchr(texto, '-') == NULL;
+
+    const char* inicio = texto;
+    while (!regiao && *inicio) {
+        while (*inicio == ' ') inicio++;
+        const char* fim = strchr(inicio, '-');
+        size_t len = fim ? (size_t)(fim - inicio) : strlen(inicio);
+        while (len > 0 && inicio[len - 1] == ' ') len--;
+
+        char cidade[MAX_NOME_CIDADE];
+        if (len >= sizeof(cidade)) len = sizeof(cidade) - 1;
+        memcpy(cidade, inicio, len);
+        cidade[len] = '\0';
+
+        if (cidade[0] != '\0') {
+            if (anterior[0] != '\0' && num_pares < (int)(sizeof(pares) / sizeof(pares[0]))) {
+                strcpy(pares[num_pares].origem, anterior);
+                strcpy(pares[num_pares].destino, cidade);
+                num_pares++;
+            }
+            strcpy(anterior, cidade);
+        }
+
+        if (!fim) break;
+        inicio = fim + 1;
+    }
+
+    if (!regiao && num_pares == 0) {
+        ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
+            "'❌ Formato inválido. Use: <b>malha Cidade1-Cidade2-Cidade3</b> ou <b>malha Região</b>', false);");
+        return;
+    }
+
+    ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
+        "'🔄 <b>Consultando IA para montar a malha...</b><br>"
+        "⏳ Isso pode levar alguns minutos...', false);");
+
+    int conexoes;
+    if (regiao) {
+        fprintf(stderr, "[PLANEJAMENTO] Malha da região %s\n", texto);
+        conexoes = obter_distancias_regiao_ia_e_preencher_grafo(texto, ctx->grafo);
+    } else {
+        fprintf(stderr, "[PLANEJAMENTO] Malha em lote com %d trechos\n", num_pares);
+        conexoes = obter_distancias_lote_ia_e_preencher_grafo(pares, num_pares, ctx->grafo);
+    }
+    fflush(stderr);
+
+    if (conexoes <= 0) {
+        ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
+            "'❌ Não foi possível obter distâncias da IA.<br>"
+            "Verifique se as cidades são válidas.', false);");
+        return;
+    }
+
+    grafo_travar(ctx->grafo);
+
+    char msg_sucesso[512];
+    snprintf(msg_sucesso, sizeof(msg_sucesso),
+        "✅ <b>Malha de rotas criada!</b><br>"
+        "🏙️ <b>%d cidades</b> no grafo<br>"
+        "🛣️ <b>%d conexões</b> adicionadas pela IA",
+        ctx->grafo->num_cidades, conexoes);
+    ui_mensagem_html(ctx, "Sistema", msg_sucesso);
+
+    salvar_coordenadas_grafo(ctx->grafo, "coordenadas_grafo.txt");
+    grafo_agendar_coordenadas(ctx->grafo);
+
+    char* stats = obter_estatisticas_grafo(ctx->grafo);
+    ui_estatisticas_grafo(ctx, stats);
+    free(stats);
+
+    grafo_destravar(ctx->grafo);
+}
+
+// Balão de chat que recebe os trechos de uma resposta em streaming
+typedef struct {
+    AppContext* ctx;
+    int id;
+    double inicio;                  // obter_tempo_ms() no envio da pergunta
+    double primeiro_trecho;         // Latência até o primeiro trecho (0 = ainda não chegou)
+} StreamUI;
+
+// Encaminha um trecho de texto do Gemini para o balão correspondente
+static void enviar_delta_stream(const char* delta, void* userdata) {
+    StreamUI* stream_ui = (StreamUI*)userdata;
+    if (stream_ui->primeiro_trecho == 0.0) {
+        stream_ui->primeiro_trecho = obter_tempo_ms() - stream_ui->inicio;
+    }
+
+    // Escapa o trecho usando cJSON
+    cJSON *tmp = cJSON_CreateString(delta);
+    char *quoted = cJSON_PrintUnformatted(tmp);
+    cJSON_Delete(tmp);
+    if (!quoted) return;
+
+    StrBuilder js;
+    sb_iniciar(&js, strlen(quoted) + 64);
+    sb_formatar(&js, "anexarMensagemStream(%d, ", stream_ui->id);
+    sb_anexar(&js, quoted);
+    sb_anexar(&js, ");");
+    free(quoted);
+
+    char* js_code = sb_finalizar(&js);
+    if (js_code) {
+        ui_eval(stream_ui->ctx, js_code);
+        free(js_code);
+    }
+}
+
+// Processa uma chamada RPC (executa em uma thread de trabalho)
+static void processar_rpc(AppContext* ctx, const char *seq, const char *req) {
     // DEBUG: Log para ver o que está chegando
     const char* seq_str;
     if (seq != NULL) {
@@ -61,7 +386,7 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
     cJSON *root = cJSON_Parse(req);
     if (!root) {
         fprintf(stderr, "[ERRO] JSON inválido recebido\n");
-        webview_return(w, seq, 1, "{\"error\":\"invalid_json\"}");
+        ui_return(ctx, seq, 1, "{\"error\":\"invalid_json\"}");
         return;
     }
 
@@ -156,14 +481,17 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
         if (texto && texto[0] != '\0') {
             // Verifica comandos especiais
             if (strcmp(texto, "ajuda") == 0 || strcmp(texto, "help") == 0) {
-                char ajuda[3072];
-                const char* cidade_exemplo;
+                char cidade_exemplo[100];
+                pthread_mutex_lock(&ctx->trava);
                 if (ctx->cidade[0] != '\0') {
-                    cidade_exemplo = ctx->cidade;
+                    strcpy(cidade_exemplo, ctx->cidade);
                 } else {
-                    cidade_exemplo = "minha cidade";
+                    strcpy(cidade_exemplo, "minha cidade");
                 }
-                snprintf(ajuda, sizeof(ajuda),
+                pthread_mutex_unlock(&ctx->trava);
+                StrBuilder ajuda;
+                sb_iniciar(&ajuda, 2048);
+                sb_formatar(&ajuda,
                     "📚 <b>AJUDA - GenieC</b><br><br>"
                     "🎯 <b>Como usar:</b><br>"
                     "• Digite sua pergunta e pressione Enter<br>"
@@ -175,6 +503,8 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
                     "• <b>grafo Cidade1-Cidade2</b> - Calcula menor caminho<br>"
                     "  Exemplo: <b>grafo São Paulo-Rio de Janeiro</b><br>"
                     "  → A IA busca distâncias reais + mostra no mapa!<br>"
+                    "• <b>malha Cidade1-Cidade2-Cidade3</b> - Monta um corredor de uma vez<br>"
+                    "• <b>malha Região</b> - Monta a malha principal de uma região<br>"
                     "• <b>grafocidades</b> - Lista todas as cidades no grafo<br>"
                     "• <b>grafomapa</b> - Visualiza o grafo no mapa interativo<br><br>"
                     "💡 <b>Dicas:</b><br>"
@@ -188,21 +518,21 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
                     "• \"grafo Curitiba-Florianópolis\"",
                     cidade_exemplo);
 
-                char js_code[4096];
-                snprintf(js_code, sizeof(js_code),
-                    "adicionarMensagemHTML('Sistema', `%s`, false);", ajuda);
-                webview_eval(w, js_code);
-                webview_return(w, seq, 0, "{}");
+                if (ajuda.dados) ui_mensagem_html(ctx, "Sistema", ajuda.dados);
+                sb_liberar(&ajuda);
+                ui_return(ctx, seq, 0, "{}");
                 cJSON_Delete(root);
                 return;
             }
 
             if (strcmp(texto, "historico") == 0) {
-                char historico_html[8192] = "📜 <b>Histórico da Conversa:</b><br><br>";
+                StrBuilder historico_html;
+                sb_iniciar(&historico_html, 4096);
+                sb_anexar(&historico_html, "📜 <b>Histórico da Conversa:</b><br><br>");
 
+                pthread_mutex_lock(&ctx->trava);
                 if (ctx->historico && ctx->historico->contador > 0) {
-                    int pos = strlen(historico_html);
-                    for (int i = 0; i < ctx->historico->contador && pos < 7500; i++) {
+                    for (int i = 0; i < ctx->historico->contador; i++) {
                         const char* icone;
                         const char* nome;
                         if (strcmp(ctx->historico->turno[i].role, "user") == 0) {
@@ -213,11 +543,7 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
                             nome = "GenieC";
                         }
 
-                        char linha[512];
-                        char msg_preview[200];
                         size_t texto_len = strlen(ctx->historico->turno[i].text);
-                        strncpy(msg_preview, ctx->historico->turno[i].text, 150);
-                        msg_preview[150] = '\0';
 
                         const char* ellipsis;
                         if (texto_len > 150) {
@@ -226,60 +552,52 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
                             ellipsis = "";
                         }
 
-                        snprintf(linha, sizeof(linha), "%s <b>%s:</b> %s%s<br><br>",
-                            icone, nome, msg_preview, ellipsis);
-
-                        if (pos + strlen(linha) < sizeof(historico_html) - 100) {
-                            strcat(historico_html, linha);
-                            pos += strlen(linha);
-                        } else {
-                            break;
-                        }
+                        sb_formatar(&historico_html, "%s <b>%s:</b> %.150s%s<br><br>",
+                            icone, nome, ctx->historico->turno[i].text, ellipsis);
                     }
                 } else {
-                    strcat(historico_html, "<i>Nenhuma conversa ainda.</i>");
+                    sb_anexar(&historico_html, "<i>Nenhuma conversa ainda.</i>");
                 }
+                pthread_mutex_unlock(&ctx->trava);
 
-                char js_code[10000];
-                snprintf(js_code, sizeof(js_code),
-                    "adicionarMensagemHTML('Sistema', `%s`, false);", historico_html);
-                webview_eval(w, js_code);
-                webview_return(w, seq, 0, "{}");
+                if (historico_html.dados) ui_mensagem_html(ctx, "Sistema", historico_html.dados);
+                sb_liberar(&historico_html);
+                ui_return(ctx, seq, 0, "{}");
                 cJSON_Delete(root);
                 return;
             }
 
             // Comando para listar cidades no grafo
             if (strcmp(texto, "grafocidades") == 0) {
+                grafo_travar(ctx->grafo);
                 char* resultado = listar_cidades_grafo(ctx->grafo);
+                grafo_destravar(ctx->grafo);
 
                 // Usa buffer maior para evitar truncamento
-                size_t js_size = strlen(resultado) + 256;
-                char* js_code = (char*)malloc(js_size);
-                snprintf(js_code, js_size,
-                    "adicionarMensagemHTML('Sistema', `%s`, false);", resultado);
-                webview_eval(w, js_code);
-
-                free(js_code);
+                ui_mensagem_html(ctx, "Sistema", resultado);
                 free(resultado);
-                webview_return(w, seq, 0, "{}");
+                ui_return(ctx, seq, 0, "{}");
                 cJSON_Delete(root);
                 return;
             }
 
             // Comando para ver mapa do grafo
             if (strcmp(texto, "grafomapa") == 0) {
+                grafo_travar(ctx->grafo);
                 char* resultado = gerar_mapa_grafo(ctx->grafo);
+                grafo_destravar(ctx->grafo);
 
-                size_t js_size = strlen(resultado) + 256;
-                char* js_code = (char*)malloc(js_size);
-                snprintf(js_code, js_size,
-                    "adicionarMensagemHTML('Sistema', `%s`, false);", resultado);
-                webview_eval(w, js_code);
-
-                free(js_code);
+                ui_mensagem_html(ctx, "Sistema", resultado);
                 free(resultado);
-                webview_return(w, seq, 0, "{}");
+                ui_return(ctx, seq, 0, "{}");
+                cJSON_Delete(root);
+                return;
+            }
+
+            // Comando para montar vários trechos (ou uma região) de uma vez
+            if (strncmp(texto, "malha ", 6) == 0) {
+                construir_malha(ctx, texto + 6);
+                ui_return(ctx, seq, 0, "{}");
                 cJSON_Delete(root);
                 return;
             }
@@ -288,6 +606,7 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
             if (strncmp(texto, "grafo ", 6) == 0) {
                 char origem[MAX_NOME_CIDADE] = {0};
                 char destino[MAX_NOME_CIDADE] = {0};
+                char* rota_json = NULL;
 
                 // Parse: "grafo São Paulo-Rio de Janeiro"
                 const char* input = texto + 6;
@@ -311,117 +630,143 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
                     destino[MAX_NOME_CIDADE - 1] = '\0';
 
                     if (strlen(origem) > 0 && strlen(destino) > 0) {
-                        // Mostra mensagem de processamento
-                        webview_eval(w, "adicionarMensagemHTML('Sistema', "
-                            "'🔄 <b>Consultando IA para obter distâncias...</b><br>"
-                            "⏳ Isso pode levar alguns minutos...', false);");
-
                         fprintf(stderr, "[INFO GRAFO] Processando rota: %s -> %s\n", origem, destino);
                         fflush(stderr);
 
-                        // Consulta a IA para preencher o grafo
-                        int conexoes = obter_distancias_ia_e_preencher_grafo(origem, destino, ctx->grafo);
-
-                        if (conexoes > 0) {
-                            char msg_sucesso[768];
-                            snprintf(msg_sucesso, sizeof(msg_sucesso),
-                                "✅ <b>Malha de rotas criada!</b><br>"
-                                "🏙️ <b>%d cidades</b> mapeadas<br>"
-                                "🛣️ <b>%d conexões</b> adicionadas pela IA<br>"
-                                "🔍 Buscando coordenadas e calculando menor caminho com Dijkstra...<br><br>",
-                                ctx->grafo->num_cidades, conexoes);
-
-                            char* js_code = (char*)malloc(2048);
-                            snprintf(js_code, 2048,
-                                "adicionarMensagemHTML('Sistema', `%s`, false);", msg_sucesso);
-                            webview_eval(w, js_code);
-                            free(js_code);
-
-                            // Salva o grafo atualizado com coordenadas E conexões
-                            salvar_coordenadas_grafo(ctx->grafo, "coordenadas_grafo.txt");
-
-                            // Calcula o menor caminho usando Dijkstra COM MAPA
-                            char* resultado = calcular_menor_caminho_com_mapa(ctx->grafo, origem, destino);
-
-                            // Usa buffer dinâmico para suportar o HTML do mapa
-                            size_t resultado_size = strlen(resultado) + 256;
-                            js_code = (char*)malloc(resultado_size);
-                            snprintf(js_code, resultado_size,
-                                "adicionarMensagemHTML('GenieC', `%s`, false);", resultado);
-                            webview_eval(w, js_code);
-
-                            free(js_code);
-                            free(resultado);
-
-                            // Atualiza estatísticas no painel (se estiver aberto)
-                            char* stats = obter_estatisticas_grafo(ctx->grafo);
-                            js_code = (char*)malloc(strlen(stats) + 256);
-                            snprintf(js_code, strlen(stats) + 256,
-                                "if(typeof onEstatisticasGrafo === 'function') onEstatisticasGrafo(%s);", stats);
-                            webview_eval(w, js_code);
-                            free(js_code);
-                            free(stats);
-                        } else {
-                            webview_eval(w, "adicionarMensagemHTML('Sistema', "
-                                "'❌ Não foi possível obter distâncias da IA.<br>"
-                                "Verifique se as cidades são válidas.', false);");
-                        }
+                        rota_json = planejar_rota_unica(ctx, origem, destino);
                     } else {
-                        webview_eval(w, "adicionarMensagemHTML('Sistema', "
+                        ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
                             "'❌ Formato inválido. Use: <b>grafo Cidade1-Cidade2</b>', false);");
                     }
                 } else {
-                    webview_eval(w, "adicionarMensagemHTML('Sistema', "
+                    ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
                         "'❌ Formato inválido. Use: <b>grafo Cidade1-Cidade2</b><br>"
                         "Exemplo: <b>grafo São Paulo-Rio de Janeiro</b>', false);");
                 }
 
-                webview_return(w, seq, 0, "{}");
+                ui_return(ctx, seq, 0, rota_json ? rota_json : "{}");
+                free(rota_json);
                 cJSON_Delete(root);
                 return;
             }
 
-            // Adiciona ao histórico
+            // Adiciona ao histórico e tira uma cópia para consultar sem segurar a trava
+            char cidade[100];
+            pthread_mutex_lock(&ctx->trava);
             adicionar_turno(ctx->historico, "user", texto);
+            HistoricoChat* historico = copiar_historico(ctx->historico);
+            strcpy(cidade, ctx->cidade);
+            pthread_mutex_unlock(&ctx->trava);
 
-            fprintf(stderr, "[DEBUG] Consultando Gemini com cidade: %s\n", ctx->cidade);
+            fprintf(stderr, "[DEBUG] Consultando Gemini com cidade: %s\n", cidade);
             fflush(stderr);
 
-            // Consulta o Gemini
-            char* resposta = consultar_gemini(texto, ctx->historico, ctx->cidade);
+            char* resposta = NULL;
+            int resposta_exibida = 0;
+            double inicio_pergunta = obter_tempo_ms();
+            double primeiro_trecho = 0.0;
+
+            // Um prazo para a pergunta inteira: o fallback usa só o que o stream deixou
+            double prazo = http_prazo_novo(HTTP_PRAZO_TOTAL_MS);
+
+            // Consulta o Gemini em streaming (cada trecho vai direto para o balão)
+            if (GEMINI_STREAMING) {
+                static int stream_contador = 0;
+                StreamUI stream_ui = { ctx, __atomic_add_fetch(&stream_contador, 1, __ATOMIC_RELAXED),
+                                       inicio_pergunta, 0.0 };
+
+                char js_stream[128];
+                snprintf(js_stream, sizeof(js_stream),
+                    "iniciarMensagemStream(%d, 'GenieC');", stream_ui.id);
+                ui_eval(ctx, js_stream);
+
+                int stream_completo = 0;
+                resposta = consultar_gemini_stream(texto, historico, cidade,
+                                                   enviar_delta_stream, &stream_ui, prazo, &stream_completo);
+                primeiro_trecho = stream_ui.primeiro_trecho;
+
+                // Texto parcial fica no balão marcado como interrompido
+                snprintf(js_stream, sizeof(js_stream),
+                    "finalizarMensagemStream(%d, %s);", stream_ui.id,
+                    resposta && !stream_completo ? "true" : "false");
+                ui_eval(ctx, js_stream);
+
+                if (resposta && stream_completo) {
+                    resposta_exibida = 1;
+                } else if (resposta) {
+                    // O parcial não entra no histórico; a resposta do fallback o substitui
+                    fprintf(stderr, "[AVISO] Streaming interrompido, repetindo com generateContent\n");
+                    fflush(stderr);
+                    free(resposta);
+                    resposta = NULL;
+                } else {
+                    fprintf(stderr, "[AVISO] Streaming falhou, usando generateContent\n");
+                    fflush(stderr);
+                }
+            }
+
+            // Consulta o Gemini (modo bloqueante ou fallback do streaming)
+            if (!resposta) {
+                resposta = consultar_gemini_com_prazo(texto, historico, cidade, prazo);
+            }
+
+            // A primeira pergunta é a que paga DNS + TLS quando não há pré-aquecimento
+            static int primeira_pergunta = 1;
+            if (resposta && __atomic_exchange_n(&primeira_pergunta, 0, __ATOMIC_RELAXED)) {
+                char trecho[48] = "sem streaming";
+                if (primeiro_trecho > 0.0) {
+                    snprintf(trecho, sizeof(trecho), "primeiro trecho em %.0f ms", primeiro_trecho);
+                }
+                fprintf(stderr, "[PERFORMANCE] Primeira pergunta: %s | resposta completa em %.0f ms | "
+                        "pré-aquecimento %s\n",
+                        trecho, obter_tempo_ms() - inicio_pergunta,
+                        preaquecimento_ativo() ? "ativo" : "desativado");
+            }
 
             if (resposta) {
                 fprintf(stderr, "[DEBUG] Resposta recebida: %.100s...\n", resposta);
                 fflush(stderr);
 
+                pthread_mutex_lock(&ctx->trava);
                 adicionar_turno(ctx->historico, "model", resposta);
-
-                // Escapa a resposta usando cJSON
-                cJSON *tmp = cJSON_CreateString(resposta);
-                char *quoted = cJSON_PrintUnformatted(tmp);
-                cJSON_Delete(tmp);
-
-                if (quoted) {
-                    char js_code[8192];
-                    snprintf(js_code, sizeof(js_code),
-                        "adicionarMensagem('GenieC', %s, false);", quoted);
-                    webview_eval(w, js_code);
-                    free(quoted);
-                } else {
-                    webview_eval(w, "adicionarMensagem('Sistema', 'Erro ao formatar resposta', false);");
+                pthread_mutex_unlock(&ctx->trava);
+
+                if (!resposta_exibida) {
+                    // Escapa a resposta usando cJSON
+                    cJSON *tmp = cJSON_CreateString(resposta);
+                    char *quoted = cJSON_PrintUnformatted(tmp);
+                    cJSON_Delete(tmp);
+
+                    if (quoted) {
+                        StrBuilder js;
+                        sb_iniciar(&js, strlen(quoted) + 64);
+                        sb_anexar(&js, "adicionarMensagem('GenieC', ");
+                        sb_anexar(&js, quoted);
+                        sb_anexar(&js, ", false);");
+                        free(quoted);
+
+                        char* js_code = sb_finalizar(&js);
+                        if (js_code) {
+                            ui_eval(ctx, js_code);
+                            free(js_code);
+                        }
+                    } else {
+                        ui_eval(ctx, "adicionarMensagem('Sistema', 'Erro ao formatar resposta', false);");
+                    }
                 }
 
                 free(resposta);
             } else {
                 fprintf(stderr, "[ERRO] consultar_gemini retornou NULL\n");
                 fflush(stderr);
-                webview_eval(w, "adicionarMensagem('Sistema', 'Erro ao consultar IA', false);");
+                ui_eval(ctx, "adicionarMensagem('Sistema', 'Erro ao consultar IA', false);");
             }
+            liberar_historico_chat(historico);
         } else {
-            webview_eval(w, "adicionarMensagem('Sistema', 'Pergunta vazia', false);");
+            ui_eval(ctx, "adicionarMensagem('Sistema', 'Pergunta vazia', false);");
         }
 
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     else if (method && strcmp(method, "atualizar_clima") == 0) {
         if (texto && texto[0] != '\0') {
@@ -432,23 +777,22 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
 
             if (clima.valid) {
                 // Usa o nome da cidade retornado pela API (padronizado)
+                pthread_mutex_lock(&ctx->trava);
                 strncpy(ctx->cidade, clima.cidade, sizeof(ctx->cidade) - 1);
                 ctx->cidade[sizeof(ctx->cidade) - 1] = '\0';
+                pthread_mutex_unlock(&ctx->trava);
+
+                // O system prompt guardado no cache de contexto cita a cidade antiga
+                gemini_contexto_invalidar();
 
-                fprintf(stderr, "[DEBUG] Cidade global atualizada para: %s (da API)\n", ctx->cidade);
+                fprintf(stderr, "[DEBUG] Cidade global atualizada para: %s (da API)\n", clima.cidade);
                 fflush(stderr);
 
-                const char* icone = obter_icone_clima(clima.description);
-                char js_clima[512];
-                snprintf(js_clima, sizeof(js_clima),
-                    "document.getElementById('clima-info').innerHTML = "
-                    "'%s <b>%s:</b> %.1f°C - %s';"
-                    "document.getElementById('cidade-input').value = '';",
-                    icone, clima.cidade, clima.temperatura, clima.description);
-                webview_eval(w, js_clima);
+                ui_widget_clima(ctx, &clima);
+                ui_eval(ctx, "document.getElementById('cidade-input').value = '';");
 
                 // Notifica o JavaScript que o clima foi carregado com sucesso
-                webview_eval(w, "if(typeof onClimaAtualizado === 'function') onClimaAtualizado(true, 'Clima carregado');");
+                ui_eval(ctx, "if(typeof onClimaAtualizado === 'function') onClimaAtualizado(true, 'Clima carregado');");
 
                 char msg[512];
                 snprintf(msg, sizeof(msg),
@@ -459,17 +803,14 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
                     "usarei automaticamente <b>%s</b> como referência.",
                     clima.cidade, clima.temperatura, clima.description, clima.cidade);
 
-                char js_code[1024];
-                snprintf(js_code, sizeof(js_code),
-                    "adicionarMensagemHTML('Sistema', `%s`, false);", msg);
-                webview_eval(w, js_code);
+                ui_mensagem_html(ctx, "Sistema", msg);
             } else {
                 // Notifica o JavaScript que houve erro ao carregar o clima
-                webview_eval(w, "if(typeof onClimaAtualizado === 'function') onClimaAtualizado(false, 'Cidade não encontrada');");
-                webview_eval(w, "document.getElementById('clima-info').innerHTML = '❌ Não foi possível obter dados do clima';");
+                ui_eval(ctx, "if(typeof onClimaAtualizado === 'function') onClimaAtualizado(false, 'Cidade não encontrada');");
+                ui_eval(ctx, "document.getElementById('clima-info').innerHTML = '❌ Não foi possível obter dados do clima';");
             }
         }
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     // Método limpar histórico
     else if (method && strcmp(method, "limpar") == 0) {
@@ -477,12 +818,15 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
         fflush(stderr);
 
         // Libera histórico atual e cria novo
+        pthread_mutex_lock(&ctx->trava);
         liberar_historico_chat(ctx->historico);
         ctx->historico = inicializar_chat_historico();
+        pthread_mutex_unlock(&ctx->trava);
+        gemini_contexto_invalidar();
         // Limpa interface e mostra mensagem inicial
-        webview_eval(w, "document.getElementById('chat-messages').innerHTML = '';"
+        ui_eval(ctx, "document.getElementById('chat-messages').innerHTML = '';"
                         "adicionarMensagem('GenieC', 'Olá! Sou o GenieC. Como posso ajudar?', false);");
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     // ===== HANDLERS DO PAINEL DE GRAFOS =====
     // Método para obter estatísticas do grafo
@@ -491,18 +835,14 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
         fflush(stderr);
 
         // Gera JSON com estatísticas
+        grafo_travar(ctx->grafo);
         char* stats = obter_estatisticas_grafo(ctx->grafo);
+        grafo_destravar(ctx->grafo);
 
         // Envia estatísticas para JavaScript
-        char* js_code = (char*)malloc(strlen(stats) + 256);
-        snprintf(js_code, strlen(stats) + 256,
-            "if(typeof onEstatisticasGrafo === 'function') onEstatisticasGrafo(%s);", stats);
-        webview_eval(w, js_code);
-
-        // Libera memória
-        free(js_code);
+        ui_estatisticas_grafo(ctx, stats);
         free(stats);
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     // Método para calcular rota do grafo
     else if (method && strcmp(method, "grafo_calcular_rota") == 0) {
@@ -513,6 +853,7 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
         cJSON *first_item = cJSON_GetArrayItem(root, 0);
         cJSON *origem_item = cJSON_GetObjectItemCaseSensitive(first_item, "origem");
         cJSON *destino_item = cJSON_GetObjectItemCaseSensitive(first_item, "destino");
+        char* rota_json = NULL;
 
         if (origem_item && destino_item &&
             cJSON_IsString(origem_item) && cJSON_IsString(destino_item)) {
@@ -523,136 +864,183 @@ void handle_rpc(const char *seq, const char *req, void *arg) {
             fprintf(stderr, "[INFO GRAFO] Processando rota via painel: %s -> %s\n", origem, destino);
             fflush(stderr);
 
-            // Mostra mensagem de processamento
-            webview_eval(w, "adicionarMensagemHTML('Sistema', "
-                "'🔄 <b>Consultando IA para obter distâncias...</b><br>"
-                "⏳ Isso pode levar alguns minutos...', false);");
-
-            // Consulta a IA para preencher o grafo
-            int conexoes = obter_distancias_ia_e_preencher_grafo(origem, destino, ctx->grafo);
-
-            if (conexoes > 0) {
-                char msg_sucesso[768];
-                snprintf(msg_sucesso, sizeof(msg_sucesso),
-                    "✅ <b>Malha de rotas criada!</b><br>"
-                    "🏙️ <b>%d cidades</b> mapeadas<br>"
-                    "🛣️ <b>%d conexões</b> adicionadas pela IA<br>"
-                    "🔍 Calculando menor caminho com Dijkstra...<br><br>",
-                    ctx->grafo->num_cidades, conexoes);
-
-                char* js_code = (char*)malloc(2048);
-                snprintf(js_code, 2048,
-                    "adicionarMensagemHTML('Sistema', `%s`, false);", msg_sucesso);
-                webview_eval(w, js_code);
-                free(js_code);
-
-                // Salva o grafo atualizado
-                salvar_coordenadas_grafo(ctx->grafo, "coordenadas_grafo.txt");
-
-                // Calcula o menor caminho usando Dijkstra COM MAPA
-                char* resultado = calcular_menor_caminho_com_mapa(ctx->grafo, origem, destino);
-
-                size_t resultado_size = strlen(resultado) + 256;
-                js_code = (char*)malloc(resultado_size);
-                snprintf(js_code, resultado_size,
-                    "adicionarMensagemHTML('GenieC', `%s`, false);", resultado);
-                webview_eval(w, js_code);
-
-                free(js_code);
-                free(resultado);
-
-                // Atualiza estatísticas no painel (se estiver aberto)
-                char* stats = obter_estatisticas_grafo(ctx->grafo);
-                js_code = (char*)malloc(strlen(stats) + 256);
-                snprintf(js_code, strlen(stats) + 256,
-                    "if(typeof onEstatisticasGrafo === 'function') onEstatisticasGrafo(%s);", stats);
-                webview_eval(w, js_code);
-                free(js_code);
-                free(stats);
-            } else {
-                webview_eval(w, "adicionarMensagemHTML('Sistema', "
-                    "'❌ Não foi possível obter distâncias da IA.<br>"
-                    "Verifique se as cidades são válidas.', false);");
-            }
+            rota_json = planejar_rota_unica(ctx, origem, destino);
         } else {
-            webview_eval(w, "adicionarMensagemHTML('Sistema', "
+            ui_eval(ctx, "adicionarMensagemHTML('Sistema', "
                 "'❌ Parâmetros inválidos. Informe origem e destino.', false);");
         }
 
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, rota_json ? rota_json : "{}");
+        free(rota_json);
     }
     else if (method && strcmp(method, "grafo_visualizar_mapa") == 0) {
         fprintf(stderr, "[DEBUG] Visualizando mapa do grafo via painel\n");
         fflush(stderr);
 
+        grafo_travar(ctx->grafo);
         char* resultado = gerar_mapa_grafo(ctx->grafo);
+        grafo_destravar(ctx->grafo);
 
-        size_t js_size = strlen(resultado) + 256;
-        char* js_code = (char*)malloc(js_size);
-        snprintf(js_code, js_size,
-            "adicionarMensagemHTML('Sistema', `%s`, false);", resultado);
-        webview_eval(w, js_code);
-
-        free(js_code);
+        ui_mensagem_html(ctx, "Sistema", resultado);
         free(resultado);
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     else if (method && strcmp(method, "grafo_listar_cidades") == 0) {
         fprintf(stderr, "[DEBUG] Listando cidades do grafo via painel\n");
         fflush(stderr);
 
+        grafo_travar(ctx->grafo);
         char* resultado = listar_cidades_grafo(ctx->grafo);
+        grafo_destravar(ctx->grafo);
 
-        size_t js_size = strlen(resultado) + 256;
-        char* js_code = (char*)malloc(js_size);
-        snprintf(js_code, js_size,
-            "adicionarMensagemHTML('Sistema', `%s`, false);", resultado);
-        webview_eval(w, js_code);
-
-        free(js_code);
+        ui_mensagem_html(ctx, "Sistema", resultado);
         free(resultado);
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     else if (method && strcmp(method, "grafo_limpar") == 0) {
         fprintf(stderr, "[DEBUG] Limpando grafo via painel\n");
         fflush(stderr);
 
+        grafo_travar(ctx->grafo);
         limpar_grafo(ctx->grafo);
 
-        // Remove o arquivo de coordenadas também
-        remove("coordenadas_grafo.txt");
+        // Remove o arquivo de coordenadas e os derivados (snapshot, log, hierarquia)
+        remover_arquivos_grafo("coordenadas_grafo.txt");
+        grafo_destravar(ctx->grafo);
 
         // Envia estatísticas zeradas para o painel
-        webview_eval(w, "if(typeof onEstatisticasGrafo === 'function') onEstatisticasGrafo({cidades: 0, conexoes: 0, listaCidades: []});");
+        ui_eval(ctx, "if(typeof onEstatisticasGrafo === 'function') onEstatisticasGrafo({cidades: 0, conexoes: 0, listaCidades: []});");
 
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     else if (method && strcmp(method, "grafo_salvar") == 0) {
         fprintf(stderr, "[DEBUG] Salvando grafo via painel\n");
         fflush(stderr);
 
-        int salvos = salvar_coordenadas_grafo(ctx->grafo, "coordenadas_grafo.txt");
+        grafo_travar(ctx->grafo);
+        int salvos = grafo_persistir_completo(ctx->grafo, "coordenadas_grafo.txt");
+        grafo_destravar(ctx->grafo);
 
         char msg[256];
         snprintf(msg, sizeof(msg),
             "💾 Grafo salvo com sucesso!<br>📊 %d cidades salvas.", salvos);
 
-        char js_code[512];
-        snprintf(js_code, sizeof(js_code),
-            "adicionarMensagemHTML('Sistema', '%s', false);", msg);
-        webview_eval(w, js_code);
+        ui_mensagem_html(ctx, "Sistema", msg);
 
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
     else {
         fprintf(stderr, "[AVISO] Método não reconhecido: %s\n", method ? method : "(null)");
         fflush(stderr);
-        webview_return(w, seq, 0, "{}");
+        ui_return(ctx, seq, 0, "{}");
     }
 
     cJSON_Delete(root);
 }
 
+// Chamada RPC enfileirada para uma thread de trabalho
+typedef struct {
+    AppContext* ctx;
+    char* seq;
+    char* req;
+} TarefaRPC;
+
+static void executar_tarefa_rpc(void* arg) {
+    TarefaRPC* tarefa = (TarefaRPC*)arg;
+    processar_rpc(tarefa->ctx, tarefa->seq, tarefa->req);
+    free(tarefa->seq);
+    free(tarefa->req);
+    free(tarefa);
+}
+
+// Callback quando JavaScript chama funções C
+// Roda na thread da interface: apenas enfileira o trabalho e retorna
+void handle_rpc(const char *seq, const char *req, void *arg) {
+    AppContext* ctx = (AppContext*)arg;
+
+    TarefaRPC* tarefa = (TarefaRPC*)malloc(sizeof(TarefaRPC));
+    if (tarefa) {
+        tarefa->ctx = ctx;
+        tarefa->seq = strdup(seq ? seq : "");
+        tarefa->req = strdup(req ? req : "");
+    }
+
+    if (!tarefa || !tarefas_submeter(executar_tarefa_rpc, tarefa)) {
+        fprintf(stderr, "[ERRO] Não foi possível enfileirar o RPC\n");
+        if (tarefa) {
+            free(tarefa->seq);
+            free(tarefa->req);
+            free(tarefa);
+        }
+        webview_return(ctx->webview, seq, 1, "{\"error\":\"fila_indisponivel\"}");
+    }
+}
+
+// ===== ATUALIZAÇÃO PERIÓDICA DO CLIMA NO CABEÇALHO =====
+// Thread própria: a consulta à API nunca ocupa uma thread de RPC
+
+static pthread_t thread_clima;
+static pthread_mutex_t trava_auto_clima = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_auto_clima = PTHREAD_COND_INITIALIZER;
+static int auto_clima_ativo = 0;
+static int auto_clima_encerrar = 0;
+
+static void* laco_auto_clima(void* arg) {
+    AppContext* ctx = (AppContext*)arg;
+
+    pthread_mutex_lock(&trava_auto_clima);
+    while (!auto_clima_encerrar) {
+        struct timespec limite = {time(NULL) + CLIMA_AUTO_ATUALIZAR_S, 0};
+        int espera = 0;
+        while (!auto_clima_encerrar && espera != ETIMEDOUT) {
+            espera = pthread_cond_timedwait(&cond_auto_clima, &trava_auto_clima, &limite);
+        }
+        if (auto_clima_encerrar) break;
+        pthread_mutex_unlock(&trava_auto_clima);
+
+        char cidade[100];
+        pthread_mutex_lock(&ctx->trava);
+        snprintf(cidade, sizeof(cidade), "%s", ctx->cidade);
+        pthread_mutex_unlock(&ctx->trava);
+
+        // Sem cidade escolhida ainda não há o que atualizar
+        if (cidade[0] != '\0') {
+            DataClima clima = atualizar_dados_clima(cidade);
+            if (clima.valid) {
+                fprintf(stderr, "[DEBUG CLIMA] Cabeçalho atualizado: %s %.1f°C\n", clima.cidade, clima.temperatura);
+                ui_widget_clima(ctx, &clima);
+            }
+        }
+        pthread_mutex_lock(&trava_auto_clima);
+    }
+    pthread_mutex_unlock(&trava_auto_clima);
+    return NULL;
+}
+
+static void auto_clima_iniciar(AppContext* ctx) {
+    if (CLIMA_AUTO_ATUALIZAR_S <= 0) return;
+
+    auto_clima_encerrar = 0;
+    if (pthread_create(&thread_clima, NULL, laco_auto_clima, ctx) != 0) {
+        fprintf(stderr, "[AVISO] Não foi possível criar a thread de atualização do clima\n");
+        return;
+    }
+    auto_clima_ativo = 1;
+}
+
+// Acorda a thread e espera ela sair (antes de destruir a janela)
+static void auto_clima_finalizar(void) {
+    if (!auto_clima_ativo) return;
+
+    pthread_mutex_lock(&trava_auto_clima);
+    auto_clima_encerrar = 1;
+    pthread_cond_broadcast(&cond_auto_clima);
+    pthread_mutex_unlock(&trava_auto_clima);
+
+    pthread_join(thread_clima, NULL);
+    auto_clima_ativo = 0;
+}
+
 int main() {
     // Configura localidade para português brasileiro e UTF-8
     setlocale(LC_ALL, "Portuguese_Brazil.utf8");
@@ -666,8 +1054,25 @@ int main() {
         return 1;
     }
 
+    // Inicializa o cliente HTTP (libcurl + pool de conexões compartilhado)
+    if (!http_inicializar()) {
+        fprintf(stderr, "Erro ao inicializar o cliente HTTP\n");
+        limpar_env();
+        return 1;
+    }
+
+    // Enquanto o usuário escolhe a cidade, DNS + TCP + TLS com as duas APIs já
+    // ficam prontos no cache de conexões (a primeira pergunta não paga o handshake)
+    if (preaquecimento_ativo()) {
+        gemini_preaquecer_conexao();
+        clima_preaquecer_conexao();
+    } else {
+        fprintf(stderr, "[INFO] Pré-aquecimento de conexões desativado\n");
+    }
+
     // Inicializa o contexto da aplicação (substitui variáveis globais)
     AppContext ctx = {0};
+    pthread_mutex_init(&ctx.trava, NULL);
     ctx.historico = inicializar_chat_historico();
     ctx.cidade[0] = '\0'; // Inicia sem cidade - usuário vai definir na tela de boas-vindas
 
@@ -676,6 +1081,7 @@ int main() {
     if (!ctx.grafo) {
         fprintf(stderr, "Erro ao criar grafo\n");
         liberar_historico_chat(ctx.historico);
+        http_finalizar();
         limpar_env();
         return 1;
     }
@@ -687,6 +1093,13 @@ int main() {
         fprintf(stderr, "[INFO] %d coordenadas carregadas do cache ao iniciar\n", coords_carregadas);
     }
 
+    // Inicia as threads que executam as chamadas RPC fora da thread da interface
+    tarefas_iniciar(NUM_THREADS_TRABALHO);
+
+    // Motor curl_multi: consultas independentes (lotes de distâncias e coordenadas)
+    // seguem juntas, multiplexadas na mesma conexão HTTP/2
+    http_multi_iniciar();
+
     // Cria a janela
     webview_t w = webview_create(0, NULL);
     ctx.webview = w;
@@ -713,6 +1126,9 @@ int main() {
     fflush(stderr);
     webview_bind(w, "rpc", handle_rpc, &ctx);
 
+    // Renova o clima do cabeçalho a cada CLIMA_AUTO_ATUALIZAR_S
+    auto_clima_iniciar(&ctx);
+
     // Carrega e define o HTML da interface
     fprintf(stderr, "[INFO] Carregando HTML da interface...\n");
     fflush(stderr);
@@ -734,10 +1150,19 @@ int main() {
     // Roda a interface
     webview_run(w);
 
-    // Cleanup
+    // Cleanup (as threads precisam terminar antes de destruir a janela)
+    auto_clima_finalizar();
+    tarefas_finalizar();
     webview_destroy(w);
     liberar_historico_chat(ctx.historico);
     liberar_grafo(ctx.grafo);
+    cache_distancias_liberar();
+    cache_coordenadas_liberar();
+    pthread_mutex_destroy(&ctx.trava);
+    gemini_contexto_liberar();
+    singleflight_registrar_estatisticas();
+    http_multi_finalizar();
+    http_finalizar();
     limpar_env();
 
     return 0;
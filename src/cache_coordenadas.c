@@ -0,0 +1,227 @@
+/* cache_coordenadas.c - Cache persistente de coordenadas geográficas
+ * GenieC - Assistente Inteligente
+ */
+
+#include "cache_coordenadas.h"
+#include "normalizacao.h"
+#include "grafo.h"
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char nome[MAX_NOME_CIDADE];     // Nome como foi geocodificado
+    char chave[MAX_NOME_CIDADE];    // Nome normalizado
+    double latitude;
+    double longitude;
+} EntradaCoordenada;
+
+static EntradaCoordenada* entradas = NULL;
+static int num_entradas = 0;
+static int capacidade_entradas = 0;
+
+// Índice hash (sondagem linear) de chave -> entrada, ocupação <= 50%
+static int* indice = NULL;
+static int capacidade_indice = 0;
+
+// Entradas novas ainda não gravadas (write-behind)
+static int* pendentes = NULL;
+static int num_pendentes = 0;
+static int capacidade_pendentes = 0;
+
+static int carregado = 0;
+static pthread_mutex_t trava_cache = PTHREAD_MUTEX_INITIALIZER;
+
+static int indice_localizar(const char* chave) {
+    int mascara = capacidade_indice - 1;
+    int pos = (int)(hash_nome(chave) & (unsigned int)mascara);
+
+    while (indice[pos] != -1) {
+        if (strcmp(entradas[indice[pos]].chave, chave) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & mascara;
+    }
+    return pos;
+}
+
+static int indice_expandir(void) {
+    int nova_capacidade = capacidade_indice > 0 ? capacidade_indice * 2 : 64;
+    int* novo = (int*)malloc(nova_capacidade * sizeof(int));
+    if (!novo) return 0;
+    memset(novo, -1, nova_capacidade * sizeof(int));
+
+    free(indice);
+    indice = novo;
+    capacidade_indice = nova_capacidade;
+
+    for (int i = 0; i < num_entradas; i++) {
+        indice[indice_localizar(entradas[i].chave)] = i;
+    }
+    return 1;
+}
+
+// Insere ou atualiza; retorna o índice da entrada se algo mudou, -1 caso contrário
+static int inserir(const char* nome, double latitude, double longitude) {
+    char chave[MAX_NOME_CIDADE];
+    normalizar_nome(nome, chave, sizeof(chave));
+    if (chave[0] == '\0') return -1;
+
+    if ((num_entradas + 1) * 2 > capacidade_indice && !indice_expandir()) return -1;
+
+    int pos = indice_localizar(chave);
+    if (indice[pos] != -1) {
+        EntradaCoordenada* e = &entradas[indice[pos]];
+        if (e->latitude == latitude && e->longitude == longitude) return -1;
+        e->latitude = latitude;
+        e->longitude = longitude;
+        return indice[pos];
+    }
+
+    if (num_entradas >= capacidade_entradas) {
+        int nova_capacidade = capacidade_entradas > 0 ? capacidade_entradas * 2 : 64;
+        EntradaCoordenada* novas = (EntradaCoordenada*)realloc(entradas,
+                                                               nova_capacidade * sizeof(EntradaCoordenada));
+        if (!novas) return -1;
+        entradas = novas;
+        capacidade_entradas = nova_capacidade;
+    }
+
+    EntradaCoordenada* e = &entradas[num_entradas];
+    snprintf(e->nome, sizeof(e->nome), "%s", nome);
+    strcpy(e->chave, chave);
+    e->latitude = latitude;
+    e->longitude = longitude;
+    indice[pos] = num_entradas;
+
+    return num_entradas++;
+}
+
+// Lê o arquivo (uma vez por execução); linhas posteriores prevalecem
+static void carregar_cache(void) {
+    if (carregado) return;
+    carregado = 1;
+
+    FILE* f = fopen(ARQUIVO_CACHE_COORDENADAS, "r");
+    if (!f) return;
+
+    char linha[512];
+    while (fgets(linha, sizeof(linha), f)) {
+        if (linha[0] == '#' || linha[0] == '\n') continue;
+
+        // Formato: CIDADE|LATITUDE|LONGITUDE
+        char* sep1 = strchr(linha, '|');
+        char* sep2 = sep1 ? strchr(sep1 + 1, '|') : NULL;
+        if (!sep2) continue;
+        *sep1 = '\0';
+
+        double latitude = atof(sep1 + 1);
+        double longitude = atof(sep2 + 1);
+        if (latitude == 0.0 && longitude == 0.0) continue;
+
+        inserir(linha, latitude, longitude);
+    }
+    fclose(f);
+
+    fprintf(stderr, "[DEBUG CACHE] %d coordenadas carregadas de %s\n", num_entradas, ARQUIVO_CACHE_COORDENADAS);
+}
+
+// Acrescenta as entradas pendentes ao arquivo em uma única escrita
+static void gravar_pendentes(void) {
+    if (num_pendentes == 0) return;
+
+    FILE* f = fopen(ARQUIVO_CACHE_COORDENADAS, "a");
+    if (!f) {
+        fprintf(stderr, "[ERRO CACHE] Não foi possível abrir %s\n", ARQUIVO_CACHE_COORDENADAS);
+        return;
+    }
+
+    // Arquivo novo ganha o cabeçalho
+    if (ftell(f) == 0) {
+        fprintf(f, "# Cache de coordenadas GenieC\n");
+        fprintf(f, "# Formato: CIDADE|LATITUDE|LONGITUDE\n");
+    }
+
+    for (int i = 0; i < num_pendentes; i++) {
+        const EntradaCoordenada* e = &entradas[pendentes[i]];
+        fprintf(f, "%s|%.6f|%.6f\n", e->nome, e->latitude, e->longitude);
+    }
+    fclose(f);
+
+    fprintf(stderr, "[DEBUG CACHE] %d coordenadas gravadas em %s\n", num_pendentes, ARQUIVO_CACHE_COORDENADAS);
+    num_pendentes = 0;
+}
+
+int cache_coordenadas_buscar(const char* cidade, double* latitude, double* longitude) {
+    if (!cidade || !latitude || !longitude) return 0;
+
+    char chave[MAX_NOME_CIDADE];
+    normalizar_nome(cidade, chave, sizeof(chave));
+
+    int encontrada = 0;
+    pthread_mutex_lock(&trava_cache);
+    carregar_cache();
+
+    if (capacidade_indice > 0) {
+        int pos = indice_localizar(chave);
+        if (indice[pos] != -1) {
+            *latitude = entradas[indice[pos]].latitude;
+            *longitude = entradas[indice[pos]].longitude;
+            encontrada = 1;
+        }
+    }
+    pthread_mutex_unlock(&trava_cache);
+
+    return encontrada;
+}
+
+void cache_coordenadas_gravar(const char* cidade, double latitude, double longitude) {
+    if (!cidade || (latitude == 0.0 && longitude == 0.0)) return;
+
+    pthread_mutex_lock(&trava_cache);
+    carregar_cache();
+
+    int idx = inserir(cidade, latitude, longitude);
+    if (idx != -1) {
+        if (num_pendentes >= capacidade_pendentes) {
+            int nova_capacidade = capacidade_pendentes > 0 ? capacidade_pendentes * 2 : CACHE_COORDENADAS_LOTE;
+            int* novos = (int*)realloc(pendentes, nova_capacidade * sizeof(int));
+            if (novos) {
+                pendentes = novos;
+                capacidade_pendentes = nova_capacidade;
+            }
+        }
+        if (num_pendentes < capacidade_pendentes) {
+            pendentes[num_pendentes++] = idx;
+        }
+        if (num_pendentes >= CACHE_COORDENADAS_LOTE) {
+            gravar_pendentes();
+        }
+    }
+    pthread_mutex_unlock(&trava_cache);
+}
+
+void cache_coordenadas_sincronizar(void) {
+    pthread_mutex_lock(&trava_cache);
+    gravar_pendentes();
+    pthread_mutex_unlock(&trava_cache);
+}
+
+void cache_coordenadas_liberar(void) {
+    pthread_mutex_lock(&trava_cache);
+    gravar_pendentes();
+    free(entradas);
+    free(indice);
+    free(pendentes);
+    entradas = NULL;
+    indice = NULL;
+    pendentes = NULL;
+    num_entradas = 0;
+    capacidade_entradas = 0;
+    capacidade_indice = 0;
+    capacidade_pendentes = 0;
+    carregado = 0;
+    pthread_mutex_unlock(&trava_cache);
+}
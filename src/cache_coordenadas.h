@@ -0,0 +1,21 @@
+/* cache_coordenadas.h - Cache persistente de coordenadas geográficas
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef CACHE_COORDENADAS_H
+#define CACHE_COORDENADAS_H
+
+// Procura a cidade pelo nome normalizado; retorna 1 e preenche as coordenadas se existir
+int cache_coordenadas_buscar(const char* cidade, double* latitude, double* longitude);
+
+// Registra as coordenadas em memória; o arquivo só é atualizado em lote
+// (a cada CACHE_COORDENADAS_LOTE entradas novas ou em cache_coordenadas_sincronizar)
+void cache_coordenadas_gravar(const char* cidade, double latitude, double longitude);
+
+// Grava no arquivo as entradas ainda pendentes
+void cache_coordenadas_sincronizar(void);
+
+// Sincroniza e descarta as entradas em memória
+void cache_coordenadas_liberar(void);
+
+#endif // CACHE_COORDENADAS_H
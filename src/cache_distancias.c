@@ -0,0 +1,297 @@
+/* cache_distancias.c - Cache em disco das distâncias obtidas da IA
+ * GenieC - Assistente Inteligente
+ */
+
+#include "cache_distancias.h"
+#include "normalizacao.h"
+#include "config.h"
+#include <cjson/cJSON.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Uma consulta já respondida pela IA
+typedef struct {
+    char* chave;                    // "v<versão>|<cidade>|<cidade>|<modelo>" normalizado
+    unsigned int hash;
+    long long criado;               // time() da gravação
+    char* resposta;                 // Texto bruto devolvido pela IA
+    ArestaCache* arestas;
+    int num_arestas;
+} EntradaCache;
+
+static EntradaCache* entradas = NULL;
+static int num_entradas = 0;
+static int capacidade_entradas = 0;
+static int carregado = 0;
+static pthread_mutex_t trava_cache = PTHREAD_MUTEX_INITIALIZER;
+
+// Monta a chave do par; os nomes são ordenados porque a malha não tem direção
+static void montar_chave(const char* origem, const char* destino, const char* modelo,
+                         char* chave, size_t tamanho) {
+    char a[MAX_NOME_CIDADE], b[MAX_NOME_CIDADE];
+    normalizar_nome(origem, a, sizeof(a));
+    normalizar_nome(destino, b, sizeof(b));
+
+    if (strcmp(a, b) > 0) {
+        snprintf(chave, tamanho, "v%d|%s|%s|%s", PROMPT_DISTANCIAS_VERSAO, b, a, modelo);
+    } else {
+        snprintf(chave, tamanho, "v%d|%s|%s|%s", PROMPT_DISTANCIAS_VERSAO, a, b, modelo);
+    }
+}
+
+static int expirada(const EntradaCache* e, long long agora) {
+    return agora - e->criado > (long long)CACHE_DISTANCIAS_TTL_DIAS * 24 * 60 * 60;
+}
+
+static void liberar_entrada(EntradaCache* e) {
+    free(e->chave);
+    free(e->resposta);
+    free(e->arestas);
+}
+
+static EntradaCache* localizar(const char* chave, unsigned int hash) {
+    for (int i = 0; i < num_entradas; i++) {
+        if (entradas[i].hash == hash && strcmp(entradas[i].chave, chave) == 0) {
+            return &entradas[i];
+        }
+    }
+    return NULL;
+}
+
+// Reserva uma entrada no fim da tabela (NULL sem memória)
+static EntradaCache* nova_entrada(void) {
+    if (num_entradas >= capacidade_entradas) {
+        int nova_capacidade = capacidade_entradas > 0 ? capacidade_entradas * 2 : 16;
+        EntradaCache* novas = (EntradaCache*)realloc(entradas, nova_capacidade * sizeof(EntradaCache));
+        if (!novas) return NULL;
+        entradas = novas;
+        capacidade_entradas = nova_capacidade;
+    }
+    EntradaCache* e = &entradas[num_entradas++];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+// Lê o arquivo do cache (uma vez por execução), descartando entradas vencidas
+static void carregar_cache(void) {
+    if (carregado) return;
+    carregado = 1;
+
+    FILE* f = fopen(ARQUIVO_CACHE_DISTANCIAS, "rb");
+    if (!f) return;
+
+    fseek(f, 0, SEEK_END);
+    long tamanho = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char* conteudo = tamanho > 0 ? (char*)malloc(tamanho + 1) : NULL;
+    if (!conteudo || fread(conteudo, 1, tamanho, f) != (size_t)tamanho) {
+        free(conteudo);
+        fclose(f);
+        return;
+    }
+    conteudo[tamanho] = '\0';
+    fclose(f);
+
+    cJSON* raiz = cJSON_Parse(conteudo);
+    free(conteudo);
+    if (!raiz) {
+        fprintf(stderr, "[AVISO CACHE] %s inválido, ignorando\n", ARQUIVO_CACHE_DISTANCIAS);
+        return;
+    }
+
+    long long agora = (long long)time(NULL);
+    cJSON* lista = cJSON_GetObjectItemCaseSensitive(raiz, "entradas");
+    cJSON* item;
+    cJSON_ArrayForEach(item, lista) {
+        cJSON* chave = cJSON_GetObjectItemCaseSensitive(item, "chave");
+        cJSON* criado = cJSON_GetObjectItemCaseSensitive(item, "criado");
+        cJSON* resposta = cJSON_GetObjectItemCaseSensitive(item, "resposta");
+        cJSON* arestas = cJSON_GetObjectItemCaseSensitive(item, "arestas");
+        if (!cJSON_IsString(chave) || !cJSON_IsNumber(criado) || !cJSON_IsArray(arestas)) continue;
+
+        EntradaCache* e = nova_entrada();
+        if (!e) break;
+        e->criado = (long long)criado->valuedouble;
+        if (expirada(e, agora)) {
+            num_entradas--;
+            continue;
+        }
+        e->chave = strdup(chave->valuestring);
+        e->hash = hash_nome(e->chave);
+        e->resposta = strdup(cJSON_IsString(resposta) ? resposta->valuestring : "");
+
+        int n = cJSON_GetArraySize(arestas);
+        e->arestas = (ArestaCache*)calloc(n > 0 ? n : 1, sizeof(ArestaCache));
+        if (!e->chave || !e->resposta || !e->arestas) {
+            liberar_entrada(e);
+            num_entradas--;
+            break;
+        }
+
+        // Cada aresta é gravada como ["CidadeA", "CidadeB", km]
+        cJSON* aresta;
+        cJSON_ArrayForEach(aresta, arestas) {
+            cJSON* c1 = cJSON_GetArrayItem(aresta, 0);
+            cJSON* c2 = cJSON_GetArrayItem(aresta, 1);
+            cJSON* km = cJSON_GetArrayItem(aresta, 2);
+            if (!cJSON_IsString(c1) || !cJSON_IsString(c2) || !cJSON_IsNumber(km)) continue;
+
+            ArestaCache* a = &e->arestas[e->num_arestas++];
+            snprintf(a->cidade1, sizeof(a->cidade1), "%s", c1->valuestring);
+            snprintf(a->cidade2, sizeof(a->cidade2), "%s", c2->valuestring);
+            a->distancia = km->valueint;
+        }
+    }
+    cJSON_Delete(raiz);
+
+    fprintf(stderr, "[DEBUG CACHE] %d consultas de distâncias carregadas de %s\n",
+            num_entradas, ARQUIVO_CACHE_DISTANCIAS);
+}
+
+// Regrava o arquivo inteiro (escreve num temporário e renomeia)
+static void salvar_cache(void) {
+    cJSON* raiz = cJSON_CreateObject();
+    cJSON_AddNumberToObject(raiz, "v", 1);
+    cJSON* lista = cJSON_AddArrayToObject(raiz, "entradas");
+
+    for (int i = 0; i < num_entradas; i++) {
+        EntradaCache* e = &entradas[i];
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "chave", e->chave);
+        cJSON_AddNumberToObject(item, "criado", (double)e->criado);
+        cJSON_AddStringToObject(item, "resposta", e->resposta);
+
+        cJSON* arestas = cJSON_AddArrayToObject(item, "arestas");
+        for (int j = 0; j < e->num_arestas; j++) {
+            cJSON* aresta = cJSON_CreateArray();
+            cJSON_AddItemToArray(aresta, cJSON_CreateString(e->arestas[j].cidade1));
+            cJSON_AddItemToArray(aresta, cJSON_CreateString(e->arestas[j].cidade2));
+            cJSON_AddItemToArray(aresta, cJSON_CreateNumber(e->arestas[j].distancia));
+            cJSON_AddItemToArray(arestas, aresta);
+        }
+        cJSON_AddItemToArray(lista, item);
+    }
+
+    char* texto = cJSON_PrintUnformatted(raiz);
+    cJSON_Delete(raiz);
+    if (!texto) return;
+
+    char temporario[512];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", ARQUIVO_CACHE_DISTANCIAS);
+
+    FILE* f = fopen(temporario, "wb");
+    if (!f) {
+        fprintf(stderr, "[ERRO CACHE] Não foi possível gravar %s\n", temporario);
+        free(texto);
+        return;
+    }
+    size_t tamanho = strlen(texto);
+    int ok = fwrite(texto, 1, tamanho, f) == tamanho;
+    ok = (fclose(f) == 0) && ok;
+    free(texto);
+
+    if (!ok) {
+        remove(temporario);
+        return;
+    }
+
+#ifdef _WIN32
+    // No Windows rename não sobrescreve um arquivo existente
+    remove(ARQUIVO_CACHE_DISTANCIAS);
+#endif
+    if (rename(temporario, ARQUIVO_CACHE_DISTANCIAS) != 0) {
+        fprintf(stderr, "[ERRO CACHE] Não foi possível substituir %s\n", ARQUIVO_CACHE_DISTANCIAS);
+        remove(temporario);
+    }
+}
+
+ArestaCache* cache_distancias_buscar(const char* origem, const char* destino, const char* modelo,
+                                     int* num_arestas) {
+    if (!origem || !destino || !modelo || !num_arestas) return NULL;
+    *num_arestas = 0;
+
+    char chave[3 * MAX_NOME_CIDADE + 128];
+    montar_chave(origem, destino, modelo, chave, sizeof(chave));
+    unsigned int hash = hash_nome(chave);
+
+    ArestaCache* copia = NULL;
+    pthread_mutex_lock(&trava_cache);
+    carregar_cache();
+
+    EntradaCache* e = localizar(chave, hash);
+    if (e && !expirada(e, (long long)time(NULL)) && e->num_arestas > 0) {
+        copia = (ArestaCache*)malloc(e->num_arestas * sizeof(ArestaCache));
+        if (copia) {
+            memcpy(copia, e->arestas, e->num_arestas * sizeof(ArestaCache));
+            *num_arestas = e->num_arestas;
+        }
+    }
+    pthread_mutex_unlock(&trava_cache);
+
+    return copia;
+}
+
+void cache_distancias_gravar(const char* origem, const char* destino, const char* modelo,
+                             const char* resposta, const ArestaCache* arestas, int num_arestas) {
+    if (!origem || !destino || !modelo || !arestas || num_arestas <= 0) return;
+
+    char chave[3 * MAX_NOME_CIDADE + 128];
+    montar_chave(origem, destino, modelo, chave, sizeof(chave));
+    unsigned int hash = hash_nome(chave);
+
+    char* chave_copia = strdup(chave);
+    char* resposta_copia = strdup(resposta ? resposta : "");
+    ArestaCache* arestas_copia = (ArestaCache*)malloc(num_arestas * sizeof(ArestaCache));
+    if (!chave_copia || !resposta_copia || !arestas_copia) {
+        free(chave_copia);
+        free(resposta_copia);
+        free(arestas_copia);
+        return;
+    }
+    memcpy(arestas_copia, arestas, num_arestas * sizeof(ArestaCache));
+
+    pthread_mutex_lock(&trava_cache);
+    carregar_cache();
+
+    // Uma consulta repetida (entrada vencida) substitui a anterior
+    EntradaCache* e = localizar(chave, hash);
+    if (e) {
+        liberar_entrada(e);
+    } else {
+        e = nova_entrada();
+    }
+
+    if (e) {
+        e->chave = chave_copia;
+        e->hash = hash;
+        e->criado = (long long)time(NULL);
+        e->resposta = resposta_copia;
+        e->arestas = arestas_copia;
+        e->num_arestas = num_arestas;
+        salvar_cache();
+        fprintf(stderr, "[DEBUG CACHE] Distâncias de %s - %s guardadas (%d conexões)\n",
+                origem, destino, num_arestas);
+    } else {
+        free(chave_copia);
+        free(resposta_copia);
+        free(arestas_copia);
+    }
+    pthread_mutex_unlock(&trava_cache);
+}
+
+void cache_distancias_liberar(void) {
+    pthread_mutex_lock(&trava_cache);
+    for (int i = 0; i < num_entradas; i++) {
+        liberar_entrada(&entradas[i]);
+    }
+    free(entradas);
+    entradas = NULL;
+    num_entradas = 0;
+    capacidade_entradas = 0;
+    carregado = 0;
+    pthread_mutex_unlock(&trava_cache);
+}
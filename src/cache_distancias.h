@@ -0,0 +1,29 @@
+/* cache_distancias.h - Cache em disco das distâncias obtidas da IA
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef CACHE_DISTANCIAS_H
+#define CACHE_DISTANCIAS_H
+
+#include "grafo.h"
+
+// Conexão extraída da resposta da IA
+typedef struct {
+    char cidade1[MAX_NOME_CIDADE];
+    char cidade2[MAX_NOME_CIDADE];
+    int distancia;                  // Em km
+} ArestaCache;
+
+// Procura a malha de um par de cidades (a ordem do par não importa).
+// Retorna as arestas (liberar com free) ou NULL se ausente/expirada
+ArestaCache* cache_distancias_buscar(const char* origem, const char* destino, const char* modelo,
+                                     int* num_arestas);
+
+// Guarda a resposta bruta (pode ser NULL) e as arestas interpretadas, regravando o arquivo
+void cache_distancias_gravar(const char* origem, const char* destino, const char* modelo,
+                             const char* resposta, const ArestaCache* arestas, int num_arestas);
+
+// Descarta as entradas em memória (o arquivo é mantido)
+void cache_distancias_liberar(void);
+
+#endif // CACHE_DISTANCIAS_H
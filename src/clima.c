@@ -6,14 +6,19 @@
 #include "http_utils.h"
 #include "config.h"
 #include "env_loader.h"
+#include "normalizacao.h"
+#include "singleflight.h"
+#include "tarefas.h"
 #include <curl/curl.h>
 #include <cjson/cJSON.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-// Obtém dados do clima da API OpenWeather
-DataClima obter_dados_clima(const char* cidade) {
+// Consulta a API OpenWeather
+static DataClima consultar_clima(const char* cidade) {
     // Inicializa estrutura de dados do clima
     DataClima clima = {0};
     clima.valid = 0;
@@ -34,78 +39,320 @@ DataClima obter_dados_clima(const char* cidade) {
     // Monta a URL da API
     char url[512];
     snprintf(url, sizeof(url),
-             "https://api.openweathermap.org/data/2.5/weather?q=%s&appid=%s&units=metric&lang=pt_br",
-             cidade_encoded, api_key);
-
-    // Faz a requisição HTTP
-    CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-
-    // Aloca memória inicial para resposta
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    // Inicializa cURL
-    curl = curl_easy_init();
-    if (curl) {
-        // Configura opções do cURL
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, HTTP_TIMEOUT);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
-
-        // Executa a requisição
-        res = curl_easy_perform(curl);
-
-        // Processa resposta se bem-sucedida
-        if (res == CURLE_OK) {
-            // Parse do JSON retornado
-            cJSON *json = cJSON_Parse(chunk.memory);
-            if (json) {
-                // Extrai campos do JSON
-                cJSON *main = cJSON_GetObjectItemCaseSensitive(json, "main");
-                cJSON *weather_array = cJSON_GetObjectItemCaseSensitive(json, "weather");
-                cJSON *name = cJSON_GetObjectItemCaseSensitive(json, "name");
-
-                // Valida estrutura do JSON
-                if (main && weather_array && cJSON_IsArray(weather_array) &&
-                    name && cJSON_IsString(name)) {
-
-                    // Extrai temperatura e descrição
-                    cJSON *temp = cJSON_GetObjectItemCaseSensitive(main, "temp");
-                    cJSON *weather_item = cJSON_GetArrayItem(weather_array, 0);
-
-                    if (temp && cJSON_IsNumber(temp) && weather_item) {
-                        cJSON *description = cJSON_GetObjectItemCaseSensitive(weather_item, "description");
-
-                        // Preenche estrutura de dados
-                        clima.temperatura = (float)cJSON_GetNumberValue(temp);
-                        strncpy(clima.cidade, cJSON_GetStringValue(name), sizeof(clima.cidade) - 1);
-                        clima.cidade[sizeof(clima.cidade) - 1] = '\0';
-
-                        if (description && cJSON_IsString(description)) {
-                            strncpy(clima.description, cJSON_GetStringValue(description),
-                                   sizeof(clima.description) - 1);
-                            clima.description[sizeof(clima.description) - 1] = '\0';
-                        }
-
-                        // Marca como válido
-                        clima.valid = 1;
+             "%s/data/2.5/weather?q=%s&appid=%s&units=metric&lang=pt_br",
+             OPENWEATHER_API_BASE, cidade_encoded, api_key);
+
+    // GET com retry e circuito: com a API fora, as próximas consultas falham na
+    // hora e o cache de clima segue mostrando o último dado
+    char* resposta = fazer_requisicao_http_com_prazo(url, NULL, MAX_RETRIES, http_prazo_novo(CLIMA_PRAZO_MS));
+
+    // Libera a cidade codificada
+    curl_free(cidade_encoded);
+
+    // Processa resposta se bem-sucedida
+    if (resposta) {
+        // Parse do JSON retornado
+        cJSON *json = cJSON_Parse(resposta);
+        if (json) {
+            // Extrai campos do JSON
+            cJSON *main = cJSON_GetObjectItemCaseSensitive(json, "main");
+            cJSON *weather_array = cJSON_GetObjectItemCaseSensitive(json, "weather");
+            cJSON *name = cJSON_GetObjectItemCaseSensitive(json, "name");
+
+            // Valida estrutura do JSON
+            if (main && weather_array && cJSON_IsArray(weather_array) &&
+                name && cJSON_IsString(name)) {
+
+                // Extrai temperatura e descrição
+                cJSON *temp = cJSON_GetObjectItemCaseSensitive(main, "temp");
+                cJSON *weather_item = cJSON_GetArrayItem(weather_array, 0);
+
+                if (temp && cJSON_IsNumber(temp) && weather_item) {
+                    cJSON *description = cJSON_GetObjectItemCaseSensitive(weather_item, "description");
+
+                    // Preenche estrutura de dados
+                    clima.temperatura = (float)cJSON_GetNumberValue(temp);
+                    strncpy(clima.cidade, cJSON_GetStringValue(name), sizeof(clima.cidade) - 1);
+                    clima.cidade[sizeof(clima.cidade) - 1] = '\0';
+
+                    if (description && cJSON_IsString(description)) {
+                        strncpy(clima.description, cJSON_GetStringValue(description),
+                               sizeof(clima.description) - 1);
+                        clima.description[sizeof(clima.description) - 1] = '\0';
                     }
+
+                    // Marca como válido
+                    clima.valid = 1;
                 }
-                // Libera JSON
-                cJSON_Delete(json);
             }
+            // Libera JSON
+            cJSON_Delete(json);
         }
-        // Limpa cURL
-        curl_easy_cleanup(curl);
+        // Libera memória alocada
+        free(resposta);
     }
 
-    // Libera memória alocada
-    curl_free(cidade_encoded);
-    free(chunk.memory);
+    return clima;
+}
 
+static void* tarefa_consultar_clima(void* arg) {
+    DataClima* clima = (DataClima*)malloc(sizeof(DataClima));
+    if (clima) *clima = consultar_clima((const char*)arg);
     return clima;
 }
+
+static void* copiar_clima(const void* resultado) {
+    DataClima* copia = (DataClima*)malloc(sizeof(DataClima));
+    if (copia) memcpy(copia, resultado, sizeof(DataClima));
+    return copia;
+}
+
+// Consulta a API; pedidos simultâneos para a mesma cidade (cliques repetidos)
+// compartilham uma única consulta
+static DataClima consultar_clima_unica(const char* cidade, const char* chave_cidade) {
+    DataClima clima = {0};
+    char chave[MAX_CITY_NAME + 8];
+    snprintf(chave, sizeof(chave), "clima|%s", chave_cidade);
+
+    DataClima* resultado = (DataClima*)singleflight_executar(chave, tarefa_consultar_clima, (void*)cidade,
+                                                             copiar_clima, NULL);
+    if (resultado) {
+        clima = *resultado;
+        free(resultado);
+    }
+    return clima;
+}
+
+// ===== CACHE DE CLIMA (MEMÓRIA + DISCO) =====
+// O tempo muda em escala de minutos: dentro do TTL a resposta sai do cache;
+// depois disso, até CACHE_CLIMA_IDADE_MAX_S, o dado antigo é entregue na hora
+// e a consulta nova roda em segundo plano (stale-while-revalidate)
+
+typedef struct {
+    char chave[MAX_CITY_NAME];      // Nome normalizado
+    DataClima clima;
+    time_t obtido_em;
+    int renovando;                  // Renovação em segundo plano já agendada
+} EntradaClima;
+
+static EntradaClima entradas_clima[CACHE_CLIMA_MAX_ENTRADAS];
+static int num_entradas_clima = 0;
+static int cache_clima_carregado = 0;
+static pthread_mutex_t trava_cache_clima = PTHREAD_MUTEX_INITIALIZER;
+
+// TTL do config.h, ajustável no .env (GENIEC_CLIMA_TTL_S)
+static long ttl_clima(void) {
+    const char* valor = obter_env("GENIEC_CLIMA_TTL_S");
+    long ttl = valor ? atol(valor) : 0;
+    return ttl > 0 ? ttl : CACHE_CLIMA_TTL_S;
+}
+
+// Chamar com a trava
+static EntradaClima* buscar_entrada(const char* chave) {
+    for (int i = 0; i < num_entradas_clima; i++) {
+        if (strcmp(entradas_clima[i].chave, chave) == 0) {
+            return &entradas_clima[i];
+        }
+    }
+    return NULL;
+}
+
+// Chamar com a trava; com a tabela cheia reaproveita a entrada mais antiga
+static void inserir_entrada(const char* chave, const DataClima* clima, time_t obtido_em) {
+    if (chave[0] == '\0') return;
+
+    EntradaClima* e = buscar_entrada(chave);
+    if (!e && num_entradas_clima < CACHE_CLIMA_MAX_ENTRADAS) {
+        e = &entradas_clima[num_entradas_clima++];
+    } else if (!e) {
+        e = &entradas_clima[0];
+        for (int i = 1; i < num_entradas_clima; i++) {
+            if (entradas_clima[i].obtido_em < e->obtido_em) e = &entradas_clima[i];
+        }
+        e->renovando = 0;
+    }
+    snprintf(e->chave, sizeof(e->chave), "%s", chave);
+    e->clima = *clima;
+    e->obtido_em = obtido_em;
+}
+
+// Lê o arquivo (uma vez por execução); entradas velhas demais são ignoradas
+static void carregar_cache_clima(void) {
+    if (cache_clima_carregado) return;
+    cache_clima_carregado = 1;
+
+    FILE* f = fopen(ARQUIVO_CACHE_CLIMA, "r");
+    if (!f) return;
+
+    time_t agora = time(NULL);
+    char linha[512];
+    while (fgets(linha, sizeof(linha), f)) {
+        if (linha[0] == '#' || linha[0] == '\n') continue;
+        linha[strcspn(linha, "\r\n")] = '\0';
+
+        // Formato: CHAVE|CIDADE|TEMPERATURA|DESCRICAO|OBTIDO_EM
+        char* campos[5];
+        int num_campos = 0;
+        char* p = linha;
+        campos[num_campos++] = p;
+        while (num_campos < 5 && (p = strchr(p, '|')) != NULL) {
+            *p++ = '\0';
+            campos[num_campos++] = p;
+        }
+        if (num_campos < 5) continue;
+
+        time_t obtido_em = (time_t)atoll(campos[4]);
+        if (agora - obtido_em > CACHE_CLIMA_IDADE_MAX_S) continue;
+
+        DataClima clima = {0};
+        snprintf(clima.cidade, sizeof(clima.cidade), "%s", campos[1]);
+        clima.temperatura = (float)atof(campos[2]);
+        snprintf(clima.description, sizeof(clima.description), "%s", campos[3]);
+        clima.valid = 1;
+        inserir_entrada(campos[0], &clima, obtido_em);
+    }
+    fclose(f);
+
+    fprintf(stderr, "[DEBUG CLIMA] %d cidades carregadas de %s\n", num_entradas_clima, ARQUIVO_CACHE_CLIMA);
+}
+
+// Reescreve o arquivo inteiro (poucas entradas); chamar com a trava
+static void gravar_cache_clima(void) {
+    char temporario[512];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", ARQUIVO_CACHE_CLIMA);
+
+    FILE* f = fopen(temporario, "w");
+    if (!f) {
+        fprintf(stderr, "[ERRO CLIMA] Não foi possível gravar %s\n", temporario);
+        return;
+    }
+    fprintf(f, "# Cache de clima GenieC\n");
+    fprintf(f, "# Formato: CHAVE|CIDADE|TEMPERATURA|DESCRICAO|OBTIDO_EM\n");
+    for (int i = 0; i < num_entradas_clima; i++) {
+        const EntradaClima* e = &entradas_clima[i];
+        fprintf(f, "%s|%s|%.1f|%s|%lld\n", e->chave, e->clima.cidade, e->clima.temperatura,
+                e->clima.description, (long long)e->obtido_em);
+    }
+    if (fclose(f) != 0) {
+        remove(temporario);
+        return;
+    }
+
+#ifdef _WIN32
+    // No Windows rename não sobrescreve um arquivo existente
+    remove(ARQUIVO_CACHE_CLIMA);
+#endif
+    if (rename(temporario, ARQUIVO_CACHE_CLIMA) != 0) {
+        fprintf(stderr, "[ERRO CLIMA] Não foi possível substituir %s\n", ARQUIVO_CACHE_CLIMA);
+        remove(temporario);
+    }
+}
+
+// Guarda a resposta sob o nome pedido e sob o nome devolvido pela API (a
+// interface passa a usar o nome padronizado nas próximas consultas)
+static void registrar_clima(const char* chave, const DataClima* clima) {
+    char chave_api[MAX_CITY_NAME];
+    normalizar_nome(clima->cidade, chave_api, sizeof(chave_api));
+    time_t agora = time(NULL);
+
+    pthread_mutex_lock(&trava_cache_clima);
+    inserir_entrada(chave, clima, agora);
+    if (strcmp(chave_api, chave) != 0) {
+        inserir_entrada(chave_api, clima, agora);
+    }
+    gravar_cache_clima();
+    pthread_mutex_unlock(&trava_cache_clima);
+}
+
+// Busca, grava no cache e libera a marca de renovação da cidade
+static DataClima renovar_clima(const char* cidade, const char* chave) {
+    DataClima clima = consultar_clima_unica(cidade, chave);
+    if (clima.valid) {
+        registrar_clima(chave, &clima);
+    }
+
+    pthread_mutex_lock(&trava_cache_clima);
+    EntradaClima* e = buscar_entrada(chave);
+    if (e) e->renovando = 0;
+    pthread_mutex_unlock(&trava_cache_clima);
+    return clima;
+}
+
+typedef struct {
+    char cidade[MAX_CITY_NAME];
+    char chave[MAX_CITY_NAME];
+} RenovacaoClima;
+
+static void tarefa_renovar_clima(void* arg) {
+    RenovacaoClima* renovacao = (RenovacaoClima*)arg;
+    DataClima clima = renovar_clima(renovacao->cidade, renovacao->chave);
+    fprintf(stderr, "[DEBUG CLIMA] Renovação em segundo plano de %s %s\n",
+            renovacao->cidade, clima.valid ? "concluída" : "falhou (mantido o dado antigo)");
+    free(renovacao);
+}
+
+// Obtém dados do clima da API OpenWeather, passando pelo cache
+DataClima obter_dados_clima(const char* cidade) {
+    DataClima clima = {0};
+    if (!cidade) return clima;
+
+    char chave[MAX_CITY_NAME];
+    normalizar_nome(cidade, chave, sizeof(chave));
+
+    pthread_mutex_lock(&trava_cache_clima);
+    carregar_cache_clima();
+
+    EntradaClima* e = buscar_entrada(chave);
+    long idade = e ? (long)(time(NULL) - e->obtido_em) : 0;
+    if (e && idade <= CACHE_CLIMA_IDADE_MAX_S) {
+        clima = e->clima;
+
+        // Vencido: entrega o dado antigo agora e renova fora desta chamada
+        int agendar = idade >= ttl_clima() && !e->renovando;
+        RenovacaoClima* renovacao = NULL;
+        if (agendar) {
+            renovacao = (RenovacaoClima*)malloc(sizeof(RenovacaoClima));
+            if (renovacao) {
+                snprintf(renovacao->cidade, sizeof(renovacao->cidade), "%s", cidade);
+                snprintf(renovacao->chave, sizeof(renovacao->chave), "%s", chave);
+                e->renovando = 1;
+            }
+        }
+        pthread_mutex_unlock(&trava_cache_clima);
+
+        if (renovacao && !tarefas_submeter(tarefa_renovar_clima, renovacao)) {
+            // Pool inativo: o dado antigo continua valendo até a próxima consulta
+            free(renovacao);
+            renovacao = NULL;
+            pthread_mutex_lock(&trava_cache_clima);
+            e = buscar_entrada(chave);
+            if (e) e->renovando = 0;
+            pthread_mutex_unlock(&trava_cache_clima);
+        }
+        fprintf(stderr, "[DEBUG CLIMA] %s obtido do cache (%ld s)%s\n",
+                cidade, idade, renovacao ? "; renovando em segundo plano" : "");
+        return clima;
+    }
+    pthread_mutex_unlock(&trava_cache_clima);
+
+    return renovar_clima(cidade, chave);
+}
+
+DataClima atualizar_dados_clima(const char* cidade) {
+    DataClima clima = {0};
+    if (!cidade) return clima;
+
+    char chave[MAX_CITY_NAME];
+    normalizar_nome(cidade, chave, sizeof(chave));
+
+    pthread_mutex_lock(&trava_cache_clima);
+    carregar_cache_clima();
+    pthread_mutex_unlock(&trava_cache_clima);
+
+    return renovar_clima(cidade, chave);
+}
+
+// Abre a conexão com a OpenWeather antes da primeira consulta
+void clima_preaquecer_conexao(void) {
+    http_preaquecer(OPENWEATHER_API_BASE "/");
+}
@@ -10,6 +10,13 @@ typedef struct {
 } DataClima;
 
 // Funções de clima
+// Passa pelo cache (memória + ARQUIVO_CACHE_CLIMA): dentro do TTL não consulta
+// a API; vencido, devolve o dado antigo na hora e renova em segundo plano
 DataClima obter_dados_clima(const char* cidade);
 
+// Sempre consulta a API e atualiza o cache (bloqueia; para a atualização periódica)
+DataClima atualizar_dados_clima(const char* cidade);
+
+void clima_preaquecer_conexao(void);
+
 #endif // CLIMA_H
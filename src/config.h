@@ -14,6 +14,12 @@
 // Modelo padrão (compatibilidade)
 #define MODELO_GEMINI MODELO_GEMINI_CHAT
 
+// Respostas do chat via streamGenerateContent (1 = exibe o texto conforme chega)
+#define GEMINI_STREAMING 1
+
+// Raiz da API; a variável de ambiente GEMINI_API_BASE substitui (ex: servidor local de testes)
+#define GEMINI_API_BASE_PADRAO "https://generativelanguage.googleapis.com"
+
 // ============================================================================
 // CONFIGURAÇÕES DE LIMITES
 // ============================================================================
@@ -21,6 +27,7 @@
 #define MAX_PROMPT_SIZE 10000
 #define MAX_HISTORY_SIZE 50
 #define MAX_HISTORY_TURNS 20
+#define HISTORICO_DESCARTE_BLOCO 10  // Turnos removidos de uma vez ao passar do limite (mantém o cache de contexto)
 #define MAX_CITY_NAME 100
 
 // ============================================================================
@@ -28,10 +35,83 @@
 // ============================================================================
 
 #define MAX_RETRIES 3
-#define INITIAL_RETRY_DELAY 1000  // 1 segundo em ms
+#define INITIAL_RETRY_DELAY 1000  // Espera mínima entre tentativas (ms); base do jitter
+#define HTTP_RETRY_ESPERA_MAX_MS 10000  // Teto de cada espera entre tentativas
+#define HTTP_PRAZO_TOTAL_MS 120000      // Prazo de uma chamada inteira (tentativas + esperas)
+#define HTTP_CIRCUITO_FALHAS 5          // Falhas transitórias seguidas que abrem o circuito do endpoint
+#ifndef HTTP_CIRCUITO_ABERTO_MS         // Os testes usam um intervalo curto
+#define HTTP_CIRCUITO_ABERTO_MS 30000   // Tempo falhando na hora antes da chamada de teste
+#endif
+#define HTTP_CIRCUITO_MAX_ENDPOINTS 16
+#define CLIMA_PRAZO_MS 20000            // Prazo da consulta de clima (tentativas + esperas)
 #define HTTP_TIMEOUT 120L          // 30 segundos
 #define HTTP_CONNECT_TIMEOUT 60L  // 10 segundos
 
+// ============================================================================
+// CONFIGURAÇÕES DO CLIENTE HTTP
+// ============================================================================
+
+#define HTTP_POOL_TAMANHO 8        // Handles cURL mantidos vivos para reutilização
+#define HTTP_KEEPALIVE_IDLE 60L    // Segundos até o primeiro probe TCP keep-alive
+#define HTTP_MULTI_CONEXOES_HOST 6     // Conexões por host no motor curl_multi (em HTTP/2 basta uma, com streams multiplexados)
+#define HTTP_MULTI_STREAMS_CONEXAO 100 // Streams simultâneos por conexão HTTP/2
+#define HTTP_CONEXAO_OCIOSA_MAX 300L   // Segundos que uma conexão ociosa pode ser reutilizada
+#define HTTP_DNS_CACHE_S 600L          // Validade do cache de DNS compartilhado
+
+// Pré-aquecimento: abre as conexões com Gemini e OpenWeather durante a tela de
+// boas-vindas (GENIEC_PREAQUECER=0 no .env desativa, para comparar a latência)
+#define HTTP_PREAQUECER 1
+#define HTTP_PREAQUECER_TIMEOUT 10L    // Segundos; o pré-aquecimento nunca segura o encerramento por mais que isso
+
+#define OPENWEATHER_API_BASE "https://api.openweathermap.org"
+
+// ============================================================================
+// CONFIGURAÇÕES DE CONCORRÊNCIA
+// ============================================================================
+
+#define NUM_THREADS_TRABALHO 4     // Threads que executam as chamadas RPC da interface
+#define DISTANCIAS_LOTE_PARES 6    // Pares de cidades por prompt na consulta de distâncias em lote
+#define DISTANCIAS_LOTE_PARALELO 3 // Prompts de distâncias em andamento ao mesmo tempo
+#define DISTANCIAS_LOTE_FOLGA 0.5  // No cache de cada par do lote: trechos de rotas até 50% mais longas que a menor
+#define SINGLEFLIGHT_MAX_CATEGORIAS 8  // Categorias com contadores próprios (clima, rota, distancias...)
+
+// ============================================================================
+// CONFIGURAÇÕES DO GRAFO
+// ============================================================================
+
+#define GRAFO_USAR_ASTAR 1         // Rotas usam A* (linha reta como estimativa) quando há coordenadas
+#define GRAFO_ASTAR_FATOR 0.9      // Estimativa = fator x linha reta (folga para coordenadas imprecisas da IA)
+#define RAIO_TERRA_KM 6371.0
+#define GRAFO_USAR_CH 1            // Usa hierarquia de contração em grafos grandes
+#define GRAFO_CH_MIN_CIDADES 2000  // Abaixo disso o pré-processamento não compensa
+#define ESCALA_COORDENADAS 100000  // Coordenadas das rotas enviadas como inteiros (5 casas decimais)
+#define GRAFO_WAL_MAX_REGISTROS 5000  // Tamanho do log incremental que dispara a compactação
+#define DISTANCIAS_DIVERGENCIA_MAX 0.15  // Diferença relativa entre respostas que gera aviso
+
+// ============================================================================
+// CONFIGURAÇÕES DE CACHE
+// ============================================================================
+
+#define ARQUIVO_CACHE_DISTANCIAS "cache_distancias.json"
+#define CACHE_DISTANCIAS_TTL_DIAS 30   // Distâncias rodoviárias quase não mudam
+#define PROMPT_DISTANCIAS_VERSAO 2     // Incrementar ao alterar PROMPT_DISTANCIAS_GRAFO (invalida o cache)
+
+#define ARQUIVO_CACHE_COORDENADAS "cache_coordenadas.txt"  // Independente do grafo (sobrevive a "limpar")
+#define CACHE_COORDENADAS_LOTE 32      // Entradas novas acumuladas antes de escrever no arquivo
+#define COORDENADAS_LOTE_MAX 30        // Cidades por requisição de geocodificação em lote
+
+#define ARQUIVO_CACHE_CLIMA "cache_clima.txt"
+#define CACHE_CLIMA_TTL_S 600          // Dentro disso o clima sai do cache (GENIEC_CLIMA_TTL_S no .env)
+#define CACHE_CLIMA_IDADE_MAX_S 21600  // Até aqui o dado vencido é mostrado enquanto renova
+#define CACHE_CLIMA_MAX_ENTRADAS 32
+#define CLIMA_AUTO_ATUALIZAR_S 900     // Intervalo da atualização do clima no cabeçalho (0 = desligada)
+
+// Cache de contexto do Gemini (cachedContents): system prompt + histórico ficam no servidor
+#define CACHE_CONTEXTO_ATIVO 1
+#define CACHE_CONTEXTO_MIN_TOKENS 1024  // Mínimo aceito pela API (estimado como bytes / 4)
+#define CACHE_CONTEXTO_TTL_S 600        // Validade pedida ao criar ou renovar
+#define CACHE_CONTEXTO_RENOVAR_S 120    // Renova quando faltar menos que isso para expirar
+
 // ============================================================================
 // PROMPTS DO SISTEMA
 // ============================================================================
@@ -54,6 +134,7 @@
 "- Evite listas longas, use apenas o essencial"
 
 // Prompt para obter distâncias entre cidades (usado em grafos)
+// A resposta segue ESQUEMA_DISTANCIAS (saída estruturada), por isso o prompt não descreve formato
 #define PROMPT_DISTANCIAS_GRAFO \
 "Liste distâncias rodoviárias REAIS (BR-XXX, rodovias principais) entre %s e %s.\n\n" \
 "REGRAS OBRIGATÓRIAS:\n" \
@@ -63,56 +144,65 @@
 "4. Distâncias entre cidades VIZINHAS (adjacentes), não diretas\n" \
 "5. Cada trecho deve ter 50-300 km (trechos curtos, realistas)\n" \
 "6. Siga rodovias principais (BR-101, BR-116, BR-381, etc)\n\n" \
-"NORMALIZAÇÃO DE NOMES (CRÍTICO):\n" \
-"- SEMPRE use os nomes das cidades EXATAMENTE como informado pelo usuário\n" \
-"- Se o usuário escreveu 'Sao Paulo' (sem acento), use 'Sao Paulo' na resposta\n" \
-"- Se o usuário escreveu 'São Paulo' (com acento), use 'São Paulo' na resposta\n" \
-"- NUNCA corrija ou altere a grafia das cidades de origem e destino\n" \
-"- Para cidades intermediárias, prefira nomes SEM ACENTOS para compatibilidade\n\n" \
-"FORMATO OBRIGATÓRIO (uma linha por conexão):\n" \
-"CidadeA-CidadeB:XXX\n\n" \
-"EXEMPLO DE MALHA REAL:\n" \
-"Sao Paulo-Sao Jose dos Campos:85\n" \
-"Sao Jose dos Campos-Taubate:45\n" \
-"Taubate-Resende:115\n" \
-"Resende-Volta Redonda:35\n" \
-"Volta Redonda-Barra Mansa:15\n" \
-"Barra Mansa-Rio de Janeiro:128\n\n" \
-"IMPORTANTE: Use apenas distâncias VERIFICADAS. Não invente valores!\n" \
-"RESPONDA APENAS COM AS LINHAS NO FORMATO, SEM TEXTO EXTRA."
-
-// Prompt para obter coordenadas de uma única cidade
+"NOMES: use origem e destino EXATAMENTE como informados; " \
+"para cidades intermediárias, prefira nomes SEM ACENTOS.\n" \
+"Use apenas distâncias VERIFICADAS. Não invente valores!"
+
+// Prompt para vários pares de cidades de uma vez (consulta em lote)
+#define PROMPT_DISTANCIAS_LOTE \
+"Liste distâncias rodoviárias REAIS (BR-XXX, rodovias principais) para TODAS as rotas abaixo:\n\n" \
+"%s\n" \
+"REGRAS OBRIGATÓRIAS:\n" \
+"1. Use GOOGLE MAPS ou dados reais de rodovias brasileiras\n" \
+"2. Para cada rota, inclua as cidades intermediárias IMPORTANTES da rota principal\n" \
+"3. Distâncias entre cidades VIZINHAS (adjacentes), não diretas\n" \
+"4. Cada trecho deve ter 50-300 km (trechos curtos, realistas)\n" \
+"5. Trechos compartilhados entre rotas aparecem UMA única vez\n\n" \
+"NOMES: use as cidades da lista EXATAMENTE como informadas; " \
+"para cidades intermediárias, prefira nomes SEM ACENTOS.\n" \
+"Use apenas distâncias VERIFICADAS. Não invente valores!"
+
+// Prompt para a malha rodoviária principal de uma região
+#define PROMPT_DISTANCIAS_REGIAO \
+"Liste a malha rodoviária principal (BR-XXX, rodovias estaduais) da região: %s.\n\n" \
+"REGRAS OBRIGATÓRIAS:\n" \
+"1. Use GOOGLE MAPS ou dados reais de rodovias brasileiras\n" \
+"2. Inclua as 20-40 cidades mais importantes da região\n" \
+"3. Distâncias entre cidades VIZINHAS (adjacentes), não diretas\n" \
+"4. Cada trecho deve ter 20-300 km (trechos curtos, realistas)\n" \
+"5. Prefira nomes SEM ACENTOS para compatibilidade\n\n" \
+"Use apenas distâncias VERIFICADAS. Não invente valores!"
+
+// Prompt para obter coordenadas de uma única cidade (resposta em ESQUEMA_COORDENADA)
 #define PROMPT_COORDENADAS_UNICA \
-"Qual a coordenada geográfica exata de %s?\n\n" \
-"INTERPRETAÇÃO DO NOME:\n" \
-"- Aceite variações com ou sem acentos (ex: 'Sao Paulo' = 'São Paulo')\n" \
-"- Identifique a cidade correta mesmo com pequenos erros de digitação\n\n" \
-"RESPONDA APENAS NO FORMATO:\n" \
-"LAT:valor_latitude\n" \
-"LNG:valor_longitude\n\n" \
-"EXEMPLO:\n" \
-"LAT:-23.5505\n" \
-"LNG:-46.6333\n\n" \
-"NÃO ADICIONE TEXTO EXTRA. APENAS AS DUAS LINHAS."
-
-// Prompt para obter coordenadas de múltiplas cidades em lote
+"Qual a coordenada geográfica exata (graus decimais) de %s?\n" \
+"Aceite variações com ou sem acentos e pequenos erros de digitação no nome."
+
+// Prompt para obter coordenadas de múltiplas cidades em lote (resposta em ESQUEMA_COORDENADAS)
 #define PROMPT_COORDENADAS_MULTIPLAS \
-"Forneça as coordenadas geográficas exatas das seguintes cidades:\n\n" \
+"Forneça as coordenadas geográficas exatas (graus decimais) das seguintes cidades:\n\n" \
 "%s\n\n" \
-"RESPONDA APENAS NO FORMATO (uma cidade por linha):\n" \
-"CIDADE|LAT:valor|LNG:valor\n\n" \
-"REGRAS CRÍTICAS:\n" \
-"- Use o NOME EXATO da cidade como foi informado na lista acima\n" \
-"- NÃO adicione ou remova acentos dos nomes\n" \
-"- Se na lista está 'Sao Paulo', responda 'Sao Paulo', NÃO 'São Paulo'\n\n" \
-"EXEMPLO:\n" \
-"Sao Paulo|LAT:-23.5505|LNG:-46.6333\n" \
-"Rio de Janeiro|LAT:-22.9068|LNG:-43.1729\n" \
-"Curitiba|LAT:-25.4284|LNG:-49.2733\n\n" \
-"IMPORTANTE:\n" \
-"- Use coordenadas REAIS e PRECISAS\n" \
-"- Uma linha por cidade\n" \
-"- Formato exato: CIDADE|LAT:numero|LNG:numero\n" \
-"- NÃO adicione texto extra, apenas as linhas no formato"
+"Use coordenadas REAIS e PRECISAS e repita cada nome EXATAMENTE como está na lista."
+
+// ============================================================================
+// ESQUEMAS DE SAÍDA ESTRUTURADA (responseSchema)
+// ============================================================================
+
+// Gemini 3 aceita a busca do Google junto com responseSchema; desligar para modelos 2.x
+#define GEMINI_JSON_COM_BUSCA 1
+
+#define ESQUEMA_DISTANCIAS \
+"{\"type\":\"OBJECT\",\"properties\":{\"conexoes\":{\"type\":\"ARRAY\",\"items\":" \
+"{\"type\":\"OBJECT\",\"properties\":{\"origem\":{\"type\":\"STRING\"},\"destino\":{\"type\":\"STRING\"}," \
+"\"km\":{\"type\":\"INTEGER\"}},\"required\":[\"origem\",\"destino\",\"km\"]}}},\"required\":[\"conexoes\"]}"
+
+#define ESQUEMA_COORDENADA \
+"{\"type\":\"OBJECT\",\"properties\":{\"lat\":{\"type\":\"NUMBER\"},\"lng\":{\"type\":\"NUMBER\"}}," \
+"\"required\":[\"lat\",\"lng\"]}"
+
+#define ESQUEMA_COORDENADAS \
+"{\"type\":\"OBJECT\",\"properties\":{\"cidades\":{\"type\":\"ARRAY\",\"items\":" \
+"{\"type\":\"OBJECT\",\"properties\":{\"nome\":{\"type\":\"STRING\"},\"lat\":{\"type\":\"NUMBER\"}," \
+"\"lng\":{\"type\":\"NUMBER\"}},\"required\":[\"nome\",\"lat\",\"lng\"]}}},\"required\":[\"cidades\"]}"
 
 #endif // CONFIG_H
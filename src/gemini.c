@@ -4,54 +4,104 @@
 
 #include "gemini.h"
 #include "http_utils.h"
+#include "http_multi.h"
 #include "config.h"
 #include "env_loader.h"
 #include "grafo.h"
+#include "cache_distancias.h"
+#include "cache_coordenadas.h"
+#include "normalizacao.h"
+#include "json_extrator.h"
+#include "str_builder.h"
+#include "tarefas.h"
+#include "singleflight.h"
 #include <cjson/cJSON.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <time.h>
+
+// Cabeçalho do payload (system_instruction + abertura de "contents") já
+// serializado; só muda quando muda a cidade do usuário
+static pthread_mutex_t trava_cabecalho = PTHREAD_MUTEX_INITIALIZER;
+static StrBuilder cabecalho_payload = {NULL, 0, 0, 0};
+static char cidade_cabecalho[MAX_CITY_NAME];
+
+static void anexar_cabecalho_payload(StrBuilder* payload, const char* cidade) {
+    pthread_mutex_lock(&trava_cabecalho);
+
+    if (cabecalho_payload.dados == NULL || cabecalho_payload.erro || strcmp(cidade_cabecalho, cidade) != 0) {
+        fprintf(stderr, "[DEBUG GEMINI] Criando cabeçalho do payload com cidade: %s\n", cidade);
+
+        StrBuilder system_prompt;
+        sb_iniciar(&system_prompt, 4096);
+        sb_formatar(&system_prompt, SYSTEM_PROMPT, cidade);
+
+        sb_liberar(&cabecalho_payload);
+        sb_iniciar(&cabecalho_payload, system_prompt.tamanho + 128);
+        sb_anexar(&cabecalho_payload, "{\"system_instruction\":{\"parts\":[{\"text\":");
+        sb_anexar_json_string(&cabecalho_payload, system_prompt.dados);
+        sb_anexar(&cabecalho_payload, "}]},\"contents\":[");
+        if (system_prompt.erro) cabecalho_payload.erro = 1;
+        sb_liberar(&system_prompt);
+
+        snprintf(cidade_cabecalho, sizeof(cidade_cabecalho), "%s", cidade);
+    }
+    sb_anexar_n(payload, cabecalho_payload.dados, cabecalho_payload.tamanho);
+    if (cabecalho_payload.erro) payload->erro = 1;
+
+    pthread_mutex_unlock(&trava_cabecalho);
+}
 
 // Cria o payload JSON para a API Gemini
+// Cabeçalho e turnos anteriores já vêm serializados; só a pergunta atual é escapada aqui
 char* criar_payload_json_com_historico(const char* prompt, HistoricoChat* historico, const char* cidade) {
-    cJSON *root = cJSON_CreateObject();
-
-    // System instruction
-    cJSON *system_instruction = cJSON_CreateObject();
-    cJSON *system_parts = cJSON_CreateArray();
-    cJSON *system_part = cJSON_CreateObject();
-
-    char system_prompt_formatado[4096];
-    snprintf(system_prompt_formatado, sizeof(system_prompt_formatado), SYSTEM_PROMPT, cidade);
+    // O último turno do histórico é a própria pergunta, enviada à parte
+    int turnos = 0;
+    size_t bytes_turnos = 0;
+    if (historico != NULL && historico->contador > 1) {
+        turnos = historico->contador - 1;
+        for (int i = 0; i < turnos; i++) {
+            bytes_turnos += historico->tamanho_json[i];
+        }
+    }
 
-    fprintf(stderr, "[DEBUG GEMINI] Criando payload com cidade: %s\n", cidade);
-    fflush(stderr);
+    StrBuilder payload;
+    sb_iniciar(&payload, bytes_turnos + strlen(prompt) + 8192);
+    anexar_cabecalho_payload(&payload, cidade);
 
-    cJSON_AddItemToObject(system_part, "text", cJSON_CreateString(system_prompt_formatado));
-    cJSON_AddItemToArray(system_parts, system_part);
-    cJSON_AddItemToObject(system_instruction, "parts", system_parts);
-    cJSON_AddItemToObject(root, "system_instruction", system_instruction);
+    if (turnos > 0 && !historico->turnos_json.erro) {
+        sb_anexar_n(&payload, historico->turnos_json.dados, bytes_turnos);
+    } else {
+        for (int i = 0; i < turnos; i++) {
+            historico_serializar_turno(&payload, historico->turno[i].role, historico->turno[i].text);
+            sb_anexar_n(&payload, ",", 1);
+        }
+    }
 
-    // Contents com histórico
-    cJSON *contents_array = cJSON_CreateArray();
+    // Pergunta atual e Google Search tools
+    historico_serializar_turno(&payload, "user", prompt);
+    sb_anexar(&payload, "],\"tools\":[{\"google_search\":{}}]}");
 
-    if (historico != NULL && historico->contador > 1) {
-        for (int i = 0; i < historico->contador - 1; i++) {
-            cJSON *content_item = cJSON_CreateObject();
-            cJSON *parts_array = cJSON_CreateArray();
-            cJSON *part_item = cJSON_CreateObject();
-
-            cJSON_AddItemToObject(part_item, "text", cJSON_CreateString(historico->turno[i].text));
-            cJSON_AddItemToArray(parts_array, part_item);
-            cJSON_AddItemToObject(content_item, "parts", parts_array);
-            cJSON_AddItemToObject(content_item, "role", cJSON_CreateString(historico->turno[i].role));
+    return sb_finalizar(&payload);
+}
 
-            cJSON_AddItemToArray(contents_array, content_item);
-        }
+// Payload de saída estruturada: sem histórico nem persona do chat, com a
+// resposta restrita ao esquema (responseMimeType + responseSchema)
+static char* criar_payload_json_estruturado(const char* prompt, const char* esquema) {
+    cJSON *schema = cJSON_Parse(esquema);
+    if (!schema) {
+        fprintf(stderr, "[ERRO GEMINI] Esquema de resposta inválido\n");
+        return NULL;
     }
 
-    // Pergunta atual
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON *contents_array = cJSON_CreateArray();
     cJSON *user_content = cJSON_CreateObject();
     cJSON *user_parts = cJSON_CreateArray();
     cJSON *user_part = cJSON_CreateObject();
@@ -61,17 +111,20 @@ char* criar_payload_json_com_historico(const char* prompt, HistoricoChat* histor
     cJSON_AddItemToObject(user_content, "parts", user_parts);
     cJSON_AddItemToObject(user_content, "role", cJSON_CreateString("user"));
     cJSON_AddItemToArray(contents_array, user_content);
-
     cJSON_AddItemToObject(root, "contents", contents_array);
 
-    // Google Search tools
-    cJSON *tools_array = cJSON_CreateArray();
-    cJSON *tool_item = cJSON_CreateObject();
-    cJSON *google_search = cJSON_CreateObject();
-
-    cJSON_AddItemToObject(tool_item, "google_search", google_search);
-    cJSON_AddItemToArray(tools_array, tool_item);
-    cJSON_AddItemToObject(root, "tools", tools_array);
+    cJSON *generation_config = cJSON_CreateObject();
+    cJSON_AddItemToObject(generation_config, "responseMimeType", cJSON_CreateString("application/json"));
+    cJSON_AddItemToObject(generation_config, "responseSchema", schema);
+    cJSON_AddItemToObject(root, "generationConfig", generation_config);
+
+    if (GEMINI_JSON_COM_BUSCA) {
+        cJSON *tools_array = cJSON_CreateArray();
+        cJSON *tool_item = cJSON_CreateObject();
+        cJSON_AddItemToObject(tool_item, "google_search", cJSON_CreateObject());
+        cJSON_AddItemToArray(tools_array, tool_item);
+        cJSON_AddItemToObject(root, "tools", tools_array);
+    }
 
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -79,75 +132,399 @@ char* criar_payload_json_com_historico(const char* prompt, HistoricoChat* histor
     return json_string;
 }
 
-// Extrai o texto da resposta JSON
+// Extrai o texto da resposta JSON (todas as partes do primeiro candidato)
 char* extrair_texto_da_resposta(const char* resposta_json) {
-    char* texto_extraido = NULL;
-    // Parse do JSON
-    cJSON *root = cJSON_Parse(resposta_json);
+    if (resposta_json == NULL) return NULL;
 
-    if (root == NULL) {
+    char* texto = strdup(resposta_json);
+    if (texto == NULL) return NULL;
+
+    size_t tamanho = json_extrair_texto_gemini(texto, strlen(texto));
+    if (tamanho == JSON_TEXTO_AUSENTE) {
         fprintf(stderr, "Erro ao parsear o JSON da resposta.\n");
+        free(texto);
         return NULL;
     }
 
-    // Extrai array de candidatos
-    cJSON *candidates = cJSON_GetObjectItemCaseSensitive(root, "candidates");
-    if (cJSON_IsArray(candidates) && cJSON_GetArraySize(candidates) > 0) {
-        // Pega primeiro candidato
-        cJSON *first_candidate = cJSON_GetArrayItem(candidates, 0);
-        cJSON *content = cJSON_GetObjectItemCaseSensitive(first_candidate, "content");
+    // Devolve a sobra do buffer (metadados de grounding costumam ser maiores que o texto)
+    char* menor = realloc(texto, tamanho + 1);
+    return menor ? menor : texto;
+}
 
-        if (content) {
-            // Extrai partes do conteúdo
-            cJSON *parts = cJSON_GetObjectItemCaseSensitive(content, "parts");
+// Raiz da API (GEMINI_API_BASE permite apontar para um servidor local de testes)
+static const char* base_api_gemini(void) {
+    const char* base = obter_env("GEMINI_API_BASE");
+    if (base && base[0] != '\0') return base;
+    return GEMINI_API_BASE_PADRAO;
+}
 
-            if (cJSON_IsArray(parts) && cJSON_GetArraySize(parts) > 0) {
-                // Pega primeira parte
-                cJSON *first_part = cJSON_GetArrayItem(parts, 0);
-                cJSON *text_node = cJSON_GetObjectItemCaseSensitive(first_part, "text");
+// Monta a URL de um recurso da API (models/X:generateContent, cachedContents/...)
+static int montar_url_api(char* url, size_t tamanho, const char* recurso) {
+    // Obtém a API key das variáveis de ambiente
+    const char* api_key = obter_env("GEMINI_API_KEY");
+    if (!api_key) {
+        fprintf(stderr, "Erro: API key do Gemini não encontrada.\n");
+        return 0;
+    }
 
-                if (text_node && cJSON_IsString(text_node)) {
-                    const char* texto = cJSON_GetStringValue(text_node);
-                    if (texto) {
-                        texto_extraido = strdup(texto);
-                    }
-                }
-            }
+    const char* separador;
+    if (strchr(recurso, '?')) {
+        separador = "&";
+    } else {
+        separador = "?";
+    }
+
+    snprintf(url, tamanho, "%s/v1beta/%s%skey=%s", base_api_gemini(), recurso, separador, api_key);
+    return 1;
+}
+
+// Abre a conexão com a API antes da primeira pergunta
+void gemini_preaquecer_conexao(void) {
+    char url[256];
+    snprintf(url, sizeof(url), "%s/", base_api_gemini());
+    http_preaquecer(url);
+}
+
+// Monta a URL de um método da API (generateContent, streamGenerateContent?alt=sse...)
+static int montar_url_gemini(char* url, size_t tamanho, const char* modelo, const char* metodo) {
+    char recurso[256];
+    snprintf(recurso, sizeof(recurso), "models/%s:%s", modelo, metodo);
+    return montar_url_api(url, tamanho, recurso);
+}
+
+// ===== CACHE DE CONTEXTO (cachedContents) =====
+//
+// System prompt, tools e os turnos iniciais da conversa ficam guardados no
+// servidor; cada mensagem referencia o cache e envia só os turnos novos. O
+// cache é criado em segundo plano (a mensagem que o dispara segue sem ele) e
+// é descartado quando muda a cidade ou o modelo, quando o histórico perde os
+// turnos mais antigos (em blocos de HISTORICO_DESCARTE_BLOCO, para o cache
+// durar várias mensagens) ou quando expira.
+
+typedef struct {
+    char nome[128];                 // "cachedContents/..." ('\0' = sem cache)
+    char modelo[64];
+    char cidade[MAX_CITY_NAME];
+    int turnos;                     // Turnos do histórico guardados no cache
+    size_t bytes;                   // Bytes serializados desses turnos
+    unsigned int hash;              // FNV-1a desses bytes (detecta turnos removidos)
+    time_t expira;
+    time_t proxima_tentativa;       // Espera depois de uma criação recusada
+    unsigned int geracao;           // Incrementada a cada invalidação
+    int criando;
+    int renovando;
+} CacheContexto;
+
+static pthread_mutex_t trava_contexto = PTHREAD_MUTEX_INITIALIZER;
+static CacheContexto contexto;
+
+// Criação em andamento (a tarefa é dona do corpo)
+typedef struct {
+    char* corpo;
+    CacheContexto dados;
+} CriacaoContexto;
+
+static unsigned int hash_bytes(const char* dados, size_t tamanho) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < tamanho; i++) {
+        h ^= (unsigned char)dados[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Lê o "name" de uma resposta de cachedContents; retorna 1 se encontrou
+static int ler_nome_contexto(const char* resposta, char* nome, size_t tamanho) {
+    cJSON* json = cJSON_Parse(resposta);
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(json, "name");
+    int encontrado = 0;
+    if (cJSON_IsString(item) && strlen(item->valuestring) < tamanho) {
+        strcpy(nome, item->valuestring);
+        encontrado = 1;
+    }
+    cJSON_Delete(json);
+    return encontrado;
+}
+
+static void apagar_contexto_remoto(const char* nome) {
+    char url[512];
+    if (!montar_url_api(url, sizeof(url), nome)) return;
+
+    char* resposta = http_requisicao_metodo("DELETE", url, NULL);
+    if (resposta) {
+        fprintf(stderr, "[DEBUG GEMINI] Cache de contexto removido: %s\n", nome);
+        free(resposta);
+    }
+}
+
+static void tarefa_apagar_contexto(void* arg) {
+    apagar_contexto_remoto((const char*)arg);
+    free(arg);
+}
+
+static void agendar_remocao_contexto(const char* nome) {
+    char* copia = strdup(nome);
+    if (!copia) return;
+    if (!tarefas_submeter(tarefa_apagar_contexto, copia)) {
+        tarefa_apagar_contexto(copia);
+    }
+}
+
+static void tarefa_renovar_contexto(void* arg) {
+    char* nome = (char*)arg;
+    char url[512];
+    char recurso[160];
+    char corpo[64];
+    int renovado = 0;
+
+    snprintf(recurso, sizeof(recurso), "%s?updateMask=ttl", nome);
+    snprintf(corpo, sizeof(corpo), "{\"ttl\":\"%ds\"}", CACHE_CONTEXTO_TTL_S);
+    if (montar_url_api(url, sizeof(url), recurso)) {
+        char* resposta = http_requisicao_metodo("PATCH", url, corpo);
+        char nome_resposta[128];
+        renovado = resposta && ler_nome_contexto(resposta, nome_resposta, sizeof(nome_resposta));
+        free(resposta);
+    }
+
+    pthread_mutex_lock(&trava_contexto);
+    contexto.renovando = 0;
+    if (renovado && strcmp(contexto.nome, nome) == 0) {
+        contexto.expira = time(NULL) + CACHE_CONTEXTO_TTL_S;
+        fprintf(stderr, "[DEBUG GEMINI] Cache de contexto renovado por %ds\n", CACHE_CONTEXTO_TTL_S);
+    }
+    pthread_mutex_unlock(&trava_contexto);
+
+    free(nome);
+}
+
+static void tarefa_criar_contexto(void* arg) {
+    CriacaoContexto* criacao = (CriacaoContexto*)arg;
+    char url[512];
+    char nome[128] = "";
+
+    if (montar_url_api(url, sizeof(url), "cachedContents")) {
+        char* resposta = fazer_requisicao_http(url, criacao->corpo);
+        if (resposta) {
+            ler_nome_contexto(resposta, nome, sizeof(nome));
+            free(resposta);
         }
     }
 
-    cJSON_Delete(root);
-    return texto_extraido;
+    int descartar = 0;
+    pthread_mutex_lock(&trava_contexto);
+    contexto.criando = 0;
+    if (nome[0] == '\0') {
+        // Modelo sem suporte, contexto pequeno demais...: não insiste a cada mensagem
+        contexto.proxima_tentativa = time(NULL) + CACHE_CONTEXTO_TTL_S;
+        fprintf(stderr, "[AVISO GEMINI] Cache de contexto recusado; nova tentativa em %ds\n",
+                CACHE_CONTEXTO_TTL_S);
+    } else if (criacao->dados.geracao != contexto.geracao) {
+        descartar = 1;              // Invalidado enquanto era criado
+    } else {
+        contexto = criacao->dados;
+        snprintf(contexto.nome, sizeof(contexto.nome), "%s", nome);
+        contexto.expira = time(NULL) + CACHE_CONTEXTO_TTL_S;
+        fprintf(stderr, "[DEBUG GEMINI] Cache de contexto criado: %s (%d turnos, %zu bytes)\n",
+                contexto.nome, contexto.turnos, contexto.bytes);
+    }
+    pthread_mutex_unlock(&trava_contexto);
+
+    if (descartar) {
+        apagar_contexto_remoto(nome);
+    }
+    free(criacao->corpo);
+    free(criacao);
 }
 
-// Função para consultar o Gemini com modelo específico
-char* consultar_gemini_com_modelo(const char* pergunta, HistoricoChat* historico, const char* cidade, const char* modelo) {
-    // Cria o payload
-    char* payload = criar_payload_json_com_historico(pergunta, historico, cidade);
-    if (payload == NULL) {
-        fprintf(stderr, "Erro: Não foi possível criar o pacote JSON.\n");
+// Monta o corpo do POST cachedContents: modelo, ttl, system_instruction,
+// turnos (sem a vírgula final) e tools
+static char* criar_corpo_contexto(const char* turnos_json, size_t bytes, const char* cidade,
+                                  const char* modelo, size_t* tokens) {
+    StrBuilder cabecalho;
+    sb_iniciar(&cabecalho, 8192);
+    anexar_cabecalho_payload(&cabecalho, cidade);
+
+    *tokens = (cabecalho.tamanho + bytes) / 4;
+    if (cabecalho.erro || *tokens < CACHE_CONTEXTO_MIN_TOKENS) {
+        sb_liberar(&cabecalho);
         return NULL;
     }
 
-    // Obtém a API key das variáveis de ambiente
-    const char* api_key = obter_env("GEMINI_API_KEY");
-    if (!api_key) {
-        fprintf(stderr, "Erro: API key do Gemini não encontrada.\n");
-        free(payload);
+    StrBuilder corpo;
+    sb_iniciar(&corpo, cabecalho.tamanho + bytes + 256);
+    sb_formatar(&corpo, "{\"model\":\"models/%s\",\"ttl\":\"%ds\",", modelo, CACHE_CONTEXTO_TTL_S);
+    sb_anexar_n(&corpo, cabecalho.dados + 1, cabecalho.tamanho - 1);
+    sb_anexar_n(&corpo, turnos_json, bytes - 1);
+    sb_anexar(&corpo, "],\"tools\":[{\"google_search\":{}}]}");
+    sb_liberar(&cabecalho);
+
+    return sb_finalizar(&corpo);
+}
+
+// Payload que referencia o cache de contexto (só turnos novos + pergunta).
+// Retorna NULL quando não há cache válido; nesse caso pode agendar a criação
+static char* criar_payload_com_contexto(const char* prompt, HistoricoChat* historico,
+                                        const char* cidade, const char* modelo) {
+    if (!CACHE_CONTEXTO_ATIVO || historico == NULL || historico->turnos_json.erro) return NULL;
+
+    // O último turno do histórico é a própria pergunta, enviada à parte
+    int turnos = historico->contador > 1 ? historico->contador - 1 : 0;
+    size_t bytes_turnos = 0;
+    for (int i = 0; i < turnos; i++) {
+        bytes_turnos += historico->tamanho_json[i];
+    }
+    const char* turnos_json = historico->turnos_json.dados;
+
+    time_t agora = time(NULL);
+    char remover[128] = "";
+    char* renovar = NULL;
+    CriacaoContexto* criacao = NULL;
+    char* payload = NULL;
+
+    pthread_mutex_lock(&trava_contexto);
+
+    if (contexto.nome[0] != '\0') {
+        int valido = agora < contexto.expira &&
+                     strcmp(contexto.modelo, modelo) == 0 &&
+                     strcmp(contexto.cidade, cidade) == 0 &&
+                     contexto.turnos <= turnos &&
+                     contexto.bytes <= bytes_turnos &&
+                     hash_bytes(turnos_json, contexto.bytes) == contexto.hash;
+
+        if (!valido) {
+            fprintf(stderr, "[DEBUG GEMINI] Cache de contexto descartado: %s\n", contexto.nome);
+            strcpy(remover, contexto.nome);
+            contexto.nome[0] = '\0';
+            contexto.geracao++;
+        } else {
+            StrBuilder sb;
+            sb_iniciar(&sb, bytes_turnos - contexto.bytes + strlen(prompt) + 256);
+            sb_anexar(&sb, "{\"cachedContent\":");
+            sb_anexar_json_string(&sb, contexto.nome);
+            sb_anexar(&sb, ",\"contents\":[");
+            sb_anexar_n(&sb, turnos_json + contexto.bytes, bytes_turnos - contexto.bytes);
+            historico_serializar_turno(&sb, "user", prompt);
+            sb_anexar(&sb, "]}");
+            payload = sb_finalizar(&sb);
+
+            if (contexto.expira - agora < CACHE_CONTEXTO_RENOVAR_S && !contexto.renovando) {
+                renovar = strdup(contexto.nome);
+                if (renovar) contexto.renovando = 1;
+            }
+        }
+    }
+
+    if (contexto.nome[0] == '\0' && !contexto.criando && turnos > 0 && agora >= contexto.proxima_tentativa) {
+        size_t tokens;
+        char* corpo = criar_corpo_contexto(turnos_json, bytes_turnos, cidade, modelo, &tokens);
+        if (corpo) {
+            criacao = (CriacaoContexto*)calloc(1, sizeof(CriacaoContexto));
+            if (criacao) {
+                criacao->corpo = corpo;
+                snprintf(criacao->dados.modelo, sizeof(criacao->dados.modelo), "%s", modelo);
+                snprintf(criacao->dados.cidade, sizeof(criacao->dados.cidade), "%s", cidade);
+                criacao->dados.turnos = turnos;
+                criacao->dados.bytes = bytes_turnos;
+                criacao->dados.hash = hash_bytes(turnos_json, bytes_turnos);
+                criacao->dados.geracao = contexto.geracao;
+                contexto.criando = 1;
+                fprintf(stderr, "[DEBUG GEMINI] Criando cache de contexto (~%zu tokens)\n", tokens);
+            } else {
+                free(corpo);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&trava_contexto);
+
+    if (remover[0] != '\0') {
+        agendar_remocao_contexto(remover);
+    }
+    if (renovar && !tarefas_submeter(tarefa_renovar_contexto, renovar)) {
+        tarefa_renovar_contexto(renovar);
+    }
+    // Sem pool de trabalho não vale atrasar a mensagem atual criando o cache
+    if (criacao && !tarefas_submeter(tarefa_criar_contexto, criacao)) {
+        pthread_mutex_lock(&trava_contexto);
+        contexto.criando = 0;
+        pthread_mutex_unlock(&trava_contexto);
+        free(criacao->corpo);
+        free(criacao);
+    }
+
+    return payload;
+}
+
+// Payload do chat: referencia o cache de contexto quando houver, senão completo
+static char* criar_payload_chat(const char* prompt, HistoricoChat* historico,
+                                const char* cidade, const char* modelo) {
+    char* payload = criar_payload_com_contexto(prompt, historico, cidade, modelo);
+    if (payload) return payload;
+    return criar_payload_json_com_historico(prompt, historico, cidade);
+}
+
+void gemini_contexto_invalidar(void) {
+    char remover[128] = "";
+
+    pthread_mutex_lock(&trava_contexto);
+    if (contexto.nome[0] != '\0') {
+        strcpy(remover, contexto.nome);
+        contexto.nome[0] = '\0';
+    }
+    contexto.geracao++;
+    contexto.proxima_tentativa = 0;
+    pthread_mutex_unlock(&trava_contexto);
+
+    if (remover[0] != '\0') {
+        agendar_remocao_contexto(remover);
+    }
+}
+
+void gemini_contexto_liberar(void) {
+    char remover[128] = "";
+
+    pthread_mutex_lock(&trava_contexto);
+    if (contexto.nome[0] != '\0') {
+        strcpy(remover, contexto.nome);
+        contexto.nome[0] = '\0';
+    }
+    contexto.geracao++;
+    pthread_mutex_unlock(&trava_contexto);
+
+    // No encerramento o pool já foi finalizado: remove na thread atual
+    if (remover[0] != '\0') {
+        apagar_contexto_remoto(remover);
+    }
+}
+
+// Extrai o texto no próprio buffer da resposta, sem cópias (liberado em caso de erro)
+static char* texto_da_resposta_bruta(char* resposta_bruta) {
+    size_t tamanho = json_extrair_texto_gemini(resposta_bruta, strlen(resposta_bruta));
+    if (tamanho == JSON_TEXTO_AUSENTE) {
+        fprintf(stderr, "Erro: Não foi possível extrair o texto da resposta da API.\n");
+        free(resposta_bruta);
         return NULL;
     }
 
+    char* texto_final = realloc(resposta_bruta, tamanho + 1);
+    return texto_final ? texto_final : resposta_bruta;
+}
+
+// Envia um payload pronto para generateContent e devolve o texto da resposta
+// (o payload é liberado aqui); tentativas e esperas param no prazo absoluto
+static char* enviar_payload_gemini(char* payload, const char* modelo, double prazo) {
     // Monta a URL com o modelo especificado
     char url_completa[512];
-    snprintf(url_completa, sizeof(url_completa),
-             "https://generativelanguage.googleapis.com/v1beta/models/%s:generateContent?key=%s",
-             modelo, api_key);
+    if (!montar_url_gemini(url_completa, sizeof(url_completa), modelo, "generateContent")) {
+        free(payload);
+        return NULL;
+    }
 
     fprintf(stderr, "[DEBUG GEMINI] Usando modelo: %s\n", modelo);
     fflush(stderr);
 
     // Faz a requisição com retry
-    char* resposta_bruta = fazer_requisicao_http_com_retry(url_completa, payload, MAX_RETRIES);
+    char* resposta_bruta = fazer_requisicao_http_com_prazo(url_completa, payload, MAX_RETRIES, prazo);
     free(payload);
 
     if (resposta_bruta == NULL) {
@@ -155,15 +532,227 @@ char* consultar_gemini_com_modelo(const char* pergunta, HistoricoChat* historico
         return NULL;
     }
 
-    // Extrai o texto
-    char* texto_final = extrair_texto_da_resposta(resposta_bruta);
-    free(resposta_bruta);
+    return texto_da_resposta_bruta(resposta_bruta);
+}
 
-    if (texto_final == NULL) {
-        fprintf(stderr, "Erro: Não foi possível extrair o texto da resposta da API.\n");
+// Função para consultar o Gemini com modelo específico
+char* consultar_gemini_com_modelo(const char* pergunta, HistoricoChat* historico, const char* cidade, const char* modelo) {
+    // Cria o payload
+    char* payload = criar_payload_chat(pergunta, historico, cidade, modelo);
+    if (payload == NULL) {
+        fprintf(stderr, "Erro: Não foi possível criar o pacote JSON.\n");
+        return NULL;
+    }
+
+    return enviar_payload_gemini(payload, modelo, http_prazo_novo(HTTP_PRAZO_TOTAL_MS));
+}
+
+// Consulta de chat limitada a um prazo já em curso (ex.: fallback do streaming
+// dentro do prazo da mesma pergunta)
+char* consultar_gemini_com_prazo(const char* pergunta, HistoricoChat* historico, const char* cidade, double prazo) {
+    if (http_prazo_restante(prazo) <= 0) {
+        fprintf(stderr, "[AVISO GEMINI] Prazo da pergunta esgotado; consulta não enviada\n");
+        return NULL;
+    }
+
+    char* payload = criar_payload_chat(pergunta, historico, cidade, MODELO_GEMINI_CHAT);
+    if (payload == NULL) {
+        fprintf(stderr, "Erro: Não foi possível criar o pacote JSON.\n");
+        return NULL;
+    }
+
+    return enviar_payload_gemini(payload, MODELO_GEMINI_CHAT, prazo);
+}
+
+// Consulta com saída estruturada: o texto devolvido é um JSON no formato do esquema
+char* consultar_gemini_estruturado(const char* pergunta, const char* esquema, const char* modelo) {
+    char* payload = criar_payload_json_estruturado(pergunta, esquema);
+    if (payload == NULL) {
+        fprintf(stderr, "Erro: Não foi possível criar o pacote JSON.\n");
+        return NULL;
+    }
+
+    return enviar_payload_gemini(payload, modelo, http_prazo_novo(HTTP_PRAZO_TOTAL_MS));
+}
+
+// Consulta estruturada em duas etapas: a requisição segue pelo motor concorrente
+// (http_multi) e o texto é recolhido depois, então várias ficam em andamento juntas
+static HttpMultiRequisicao* submeter_gemini_estruturado(const char* pergunta, const char* esquema,
+                                                        const char* modelo) {
+    char* payload = criar_payload_json_estruturado(pergunta, esquema);
+    if (payload == NULL) return NULL;
+
+    char url_completa[512];
+    HttpMultiRequisicao* req = NULL;
+    if (montar_url_gemini(url_completa, sizeof(url_completa), modelo, "generateContent")) {
+        req = http_multi_submeter(url_completa, payload, NULL, NULL);
+    }
+    free(payload);
+    return req;
+}
+
+// Se a tentativa concorrente falhar, repete pelo caminho bloqueante (com retry)
+static char* aguardar_gemini_estruturado(HttpMultiRequisicao* req, const char* pergunta,
+                                         const char* esquema, const char* modelo) {
+    char* resposta_bruta = http_multi_aguardar(req, NULL);
+    if (resposta_bruta) {
+        char* texto = texto_da_resposta_bruta(resposta_bruta);
+        if (texto) return texto;
+    }
+
+    fprintf(stderr, "[AVISO GEMINI] Consulta concorrente falhou; repetindo com retry\n");
+    return consultar_gemini_estruturado(pergunta, esquema, modelo);
+}
+
+// ===== STREAMING (Server-Sent Events) =====
+
+static void memoria_iniciar(struct MemoryStruct* mem) {
+    mem->memory = malloc(1);
+    mem->memory[0] = '\0';
+    mem->size = 0;
+}
+
+static void memoria_anexar(struct MemoryStruct* mem, const char* dados, size_t tamanho) {
+    WriteMemoryCallback((void*)dados, 1, tamanho, mem);
+}
+
+// Inicializa o parser SSE
+void sse_parser_iniciar(GeminiSseParser* parser, GeminiDeltaCallback on_delta, void* userdata) {
+    memoria_iniciar(&parser->pendente);
+    memoria_iniciar(&parser->evento);
+    memoria_iniciar(&parser->texto);
+    parser->on_delta = on_delta;
+    parser->userdata = userdata;
+    parser->eventos = 0;
+}
+
+// Processa um evento completo: cada "data:" é um GenerateContentResponse parcial
+static void sse_despachar_evento(GeminiSseParser* parser) {
+    if (parser->evento.size == 0) return;
+
+    if (strcmp(parser->evento.memory, "[DONE]") != 0) {
+        // O evento é descartado em seguida, então o texto é extraído nele mesmo
+        char* delta = parser->evento.memory;
+        size_t tamanho = json_extrair_texto_gemini(delta, parser->evento.size);
+        if (tamanho != JSON_TEXTO_AUSENTE && tamanho > 0) {
+            memoria_anexar(&parser->texto, delta, tamanho);
+            if (parser->on_delta) {
+                parser->on_delta(delta, parser->userdata);
+            }
+        }
+        parser->eventos++;
+    }
+
+    parser->evento.size = 0;
+    parser->evento.memory[0] = '\0';
+}
+
+// Processa uma linha do stream (sem o '\n' final)
+static void sse_processar_linha(GeminiSseParser* parser, const char* linha, size_t tamanho) {
+    if (tamanho > 0 && linha[tamanho - 1] == '\r') tamanho--;
+
+    // Linha vazia encerra o evento
+    if (tamanho == 0) {
+        sse_despachar_evento(parser);
+        return;
+    }
+
+    // Apenas o campo "data" interessa (event:, id: e comentários são ignorados)
+    if (tamanho >= 5 && strncmp(linha, "data:", 5) == 0) {
+        const char* valor = linha + 5;
+        size_t tamanho_valor = tamanho - 5;
+        if (tamanho_valor > 0 && *valor == ' ') {
+            valor++;
+            tamanho_valor--;
+        }
+        if (parser->evento.size > 0) {
+            memoria_anexar(&parser->evento, "\n", 1);
+        }
+        memoria_anexar(&parser->evento, valor, tamanho_valor);
+    }
+}
+
+// Alimenta o parser com bytes recebidos (podem cortar linhas e eventos ao meio)
+void sse_parser_alimentar(GeminiSseParser* parser, const char* dados, size_t tamanho) {
+    memoria_anexar(&parser->pendente, dados, tamanho);
+
+    size_t inicio = 0;
+    for (size_t i = 0; i < parser->pendente.size; i++) {
+        if (parser->pendente.memory[i] == '\n') {
+            sse_processar_linha(parser, parser->pendente.memory + inicio, i - inicio);
+            inicio = i + 1;
+        }
+    }
+
+    // Mantém apenas a linha incompleta
+    if (inicio > 0) {
+        memmove(parser->pendente.memory, parser->pendente.memory + inicio,
+                parser->pendente.size - inicio + 1);
+        parser->pendente.size -= inicio;
+    }
+}
+
+// Processa o que sobrou e devolve o texto completo (NULL se vazio)
+char* sse_parser_finalizar(GeminiSseParser* parser) {
+    if (parser->pendente.size > 0) {
+        sse_processar_linha(parser, parser->pendente.memory, parser->pendente.size);
     }
+    sse_despachar_evento(parser);
 
-    return texto_final;
+    free(parser->pendente.memory);
+    free(parser->evento.memory);
+
+    char* texto = parser->texto.memory;
+    if (parser->texto.size == 0) {
+        free(texto);
+        texto = NULL;
+    }
+    parser->texto.memory = NULL;
+    return texto;
+}
+
+// Callback do cURL: repassa os bytes ao parser sem bufferizar a resposta inteira
+static size_t StreamWriteCallback(char* contents, size_t size, size_t nmemb, void* userp) {
+    size_t realsize = size * nmemb;
+    sse_parser_alimentar((GeminiSseParser*)userp, contents, realsize);
+    return realsize;
+}
+
+// Consulta o Gemini em modo streaming (modelo de chat) dentro do prazo absoluto
+// completo recebe 1 só se a transferência terminou bem (senão o texto é parcial)
+char* consultar_gemini_stream(const char* pergunta, HistoricoChat* historico, const char* cidade,
+                              GeminiDeltaCallback on_delta, void* userdata, double prazo, int* completo) {
+    *completo = 0;
+    char* payload = criar_payload_chat(pergunta, historico, cidade, MODELO_GEMINI_CHAT);
+    if (payload == NULL) {
+        fprintf(stderr, "Erro: Não foi possível criar o pacote JSON.\n");
+        return NULL;
+    }
+
+    char url_completa[512];
+    if (!montar_url_gemini(url_completa, sizeof(url_completa), MODELO_GEMINI_CHAT,
+                           "streamGenerateContent?alt=sse")) {
+        free(payload);
+        return NULL;
+    }
+
+    fprintf(stderr, "[DEBUG GEMINI] Streaming com modelo: %s\n", MODELO_GEMINI_CHAT);
+    fflush(stderr);
+
+    GeminiSseParser parser;
+    sse_parser_iniciar(&parser, on_delta, userdata);
+
+    int sucesso = fazer_requisicao_http_stream(url_completa, payload, StreamWriteCallback, &parser, prazo);
+    free(payload);
+
+    int eventos = parser.eventos;
+    char* texto = sse_parser_finalizar(&parser);
+
+    if (!sucesso && texto) {
+        fprintf(stderr, "[AVISO GEMINI] Stream interrompido após %d eventos; texto parcial\n", eventos);
+    }
+    *completo = sucesso;
+    return texto;
 }
 
 // Função principal para consultar o Gemini (usa modelo padrão para chat)
@@ -171,20 +760,107 @@ char* consultar_gemini(const char* pergunta, HistoricoChat* historico, const cha
     return consultar_gemini_com_modelo(pergunta, historico, cidade, MODELO_GEMINI_CHAT);
 }
 
-// Função para obter distâncias entre cidades usando IA e preencher o grafo
-int obter_distancias_ia_e_preencher_grafo(const char* cidade1, const char* cidade2, Grafo* grafo) {
-    if (!cidade1 || !cidade2 || !grafo) return 0;
+// Copia um nome de cidade da resposta sem os espaços das pontas
+// Retorna 0 se não for texto, estiver vazio ou não couber
+static int copiar_nome_cidade(const cJSON* item, char* destino) {
+    const char* nome = cJSON_GetStringValue(item);
+    if (!nome) return 0;
 
-    // Monta prompt usando template do config.h
-    char prompt[2048];
-    snprintf(prompt, sizeof(prompt), PROMPT_DISTANCIAS_GRAFO, cidade1, cidade2);
+    while (*nome && isspace((unsigned char)*nome)) nome++;
+    size_t len = strlen(nome);
+    while (len > 0 && isspace((unsigned char)nome[len - 1])) len--;
+    if (len == 0 || len >= MAX_NOME_CIDADE) return 0;
+
+    memcpy(destino, nome, len);
+    destino[len] = '\0';
+    return 1;
+}
+
+// Decodifica a resposta em ESQUEMA_DISTANCIAS ({"conexoes":[{origem, destino, km}]})
+// Retorna um vetor alocado (possivelmente vazio) ou NULL se a resposta não for
+// JSON (nada vai para o cache) ou faltar memória
+static ArestaCache* interpretar_resposta_distancias(const char* resposta, int* num_arestas) {
+    *num_arestas = 0;
+
+    cJSON* root = cJSON_Parse(resposta);
+    if (!root) {
+        fprintf(stderr, "[ERRO GRAFO] Resposta da IA não é um JSON válido\n");
+        return NULL;
+    }
+
+    const cJSON* conexoes = cJSON_GetObjectItemCaseSensitive(root, "conexoes");
+    int total = cJSON_GetArraySize(conexoes);
+    ArestaCache* arestas = (ArestaCache*)malloc((total > 0 ? total : 1) * sizeof(ArestaCache));
+    if (!arestas) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+
+    const cJSON* item;
+    cJSON_ArrayForEach(item, conexoes) {
+        ArestaCache* aresta = &arestas[*num_arestas];
+        const cJSON* km = cJSON_GetObjectItemCaseSensitive(item, "km");
+
+        if (!copiar_nome_cidade(cJSON_GetObjectItemCaseSensitive(item, "origem"), aresta->cidade1) ||
+            !copiar_nome_cidade(cJSON_GetObjectItemCaseSensitive(item, "destino"), aresta->cidade2) ||
+            !cJSON_IsNumber(km)) {
+            fprintf(stderr, "[DEBUG GRAFO] Conexão ignorada: campos ausentes ou inválidos\n");
+            continue;
+        }
+
+        // Valida a conexão
+        aresta->distancia = (int)(km->valuedouble + 0.5);
+        if (aresta->distancia <= 0 || aresta->distancia >= 10000 ||
+            strcmp(aresta->cidade1, aresta->cidade2) == 0) {
+            fprintf(stderr, "[DEBUG GRAFO] Conexão ignorada: %s - %s (%d km)\n",
+                    aresta->cidade1, aresta->cidade2, aresta->distancia);
+            continue;
+        }
+        (*num_arestas)++;
+    }
+
+    cJSON_Delete(root);
+    return arestas;
+}
+
+// Adiciona as conexões ao grafo (trava o grafo só durante a mesclagem)
+static int mesclar_arestas_grafo(Grafo* grafo, const ArestaCache* arestas, int num_arestas) {
+    grafo_travar(grafo);
+    for (int i = 0; i < num_arestas; i++) {
+        fprintf(stderr, "[DEBUG GRAFO] Adicionando: %s - %s: %d km\n",
+                arestas[i].cidade1, arestas[i].cidade2, arestas[i].distancia);
+        adicionar_aresta(grafo, arestas[i].cidade1, arestas[i].cidade2, arestas[i].distancia);
+    }
 
-    fprintf(stderr, "[DEBUG GRAFO] Consultando IA (modelo: %s) para distâncias entre %s e %s\n",
-            MODELO_GEMINI_GRAFO, cidade1, cidade2);
+    fprintf(stderr, "[DEBUG GRAFO] Total de conexões adicionadas: %d\n", num_arestas);
+    fprintf(stderr, "[DEBUG GRAFO] Total de cidades no grafo: %d\n", grafo->num_cidades);
+    fflush(stderr);
+    grafo_destravar(grafo);
+
+    return num_arestas;
+}
+
+// Consulta a IA com um prompt de distâncias (ou o cache, pela chave chave1/chave2)
+// e mescla as conexões no grafo; descricao só aparece nos logs
+static int preencher_grafo_com_prompt(const char* chave1, const char* chave2, const char* prompt,
+                                      const char* descricao, Grafo* grafo) {
+    // Consultas já feitas vêm do cache em disco, sem chamar a IA
+    int num_arestas = 0;
+    ArestaCache* arestas = cache_distancias_buscar(chave1, chave2, MODELO_GEMINI_GRAFO, &num_arestas);
+    if (arestas) {
+        fprintf(stderr, "[DEBUG GRAFO] Distâncias de %s obtidas do cache (%d conexões)\n",
+                descricao, num_arestas);
+        int conexoes = mesclar_arestas_grafo(grafo, arestas, num_arestas);
+        free(arestas);
+        return conexoes;
+    }
+
+    fprintf(stderr, "[DEBUG GRAFO] Consultando IA (modelo: %s) para distâncias de %s\n",
+            MODELO_GEMINI_GRAFO, descricao);
     fflush(stderr);
 
     // Consulta a IA usando modelo específico para grafos (sem histórico)
-    char* resposta = consultar_gemini_com_modelo(prompt, NULL, "", MODELO_GEMINI_GRAFO);
+    char* resposta = consultar_gemini_estruturado(prompt, ESQUEMA_DISTANCIAS, MODELO_GEMINI_GRAFO);
 
     if (!resposta) {
         fprintf(stderr, "[ERRO GRAFO] IA não retornou resposta\n");
@@ -194,101 +870,488 @@ int obter_distancias_ia_e_preencher_grafo(const char* cidade1, const char* cidad
     fprintf(stderr, "[DEBUG GRAFO] Resposta da IA:\n%s\n", resposta);
     fflush(stderr);
 
-    // Parse da resposta linha por linha
-    int conexoes_adicionadas = 0;
-    char* linha = strtok(resposta, "\n\r");
+    arestas = interpretar_resposta_distancias(resposta, &num_arestas);
+    if (!arestas) {
+        free(resposta);
+        return 0;
+    }
 
-    while (linha) {
-        // Remove espaços em branco no início
-        while (*linha && isspace(*linha)) linha++;
+    int conexoes = mesclar_arestas_grafo(grafo, arestas, num_arestas);
+    cache_distancias_gravar(chave1, chave2, MODELO_GEMINI_GRAFO, resposta, arestas, num_arestas);
 
-        // Ignora linhas vazias ou que começam com caracteres especiais
-        if (*linha == '\0' || *linha == '#' || *linha == '*' || *linha == '-' || *linha == '=') {
-            linha = strtok(NULL, "\n\r");
-            continue;
+    free(resposta);
+    free(arestas);
+    return conexoes;
+}
+
+// Definidas com as demais consultas de coordenadas, mais abaixo
+static char* montar_prompt_lote_coordenadas(char cidades[][100], const int* indices, int num_indices);
+static int interpretar_lote_coordenadas(char* resposta, char cidades[][100], const int* indices,
+                                        int num_indices, double latitudes[], double longitudes[]);
+static void montar_chave_par(const char* cidade1, const char* cidade2, char* chave, size_t tamanho);
+
+// Consulta as distâncias entre cidades usando IA e preenche o grafo
+// As coordenadas das duas pontas (usadas pelo A*) são buscadas em paralelo
+static int consultar_distancias_e_preencher_grafo(const char* cidade1, const char* cidade2, Grafo* grafo) {
+    if (!cidade1 || !cidade2 || !grafo) return 0;
+
+    char pontas[2][100];
+    int indices[2];
+    int num_pontas = 0;
+    const char* nomes[2] = {cidade1, cidade2};
+    for (int i = 0; i < 2; i++) {
+        grafo_travar(grafo);
+        int idx = encontrar_cidade(grafo, nomes[i]);
+        int no_grafo = idx != -1 && grafo->cidades[idx].coords_validas;
+        grafo_destravar(grafo);
+
+        double lat, lng;
+        if (!no_grafo && !cache_coordenadas_buscar(nomes[i], &lat, &lng)) {
+            snprintf(pontas[num_pontas], sizeof(pontas[num_pontas]), "%s", nomes[i]);
+            indices[num_pontas] = num_pontas;
+            num_pontas++;
         }
+    }
+
+    char* prompt_coords = NULL;
+    HttpMultiRequisicao* req_coords = NULL;
+    if (num_pontas > 0) {
+        prompt_coords = montar_prompt_lote_coordenadas(pontas, indices, num_pontas);
+        if (prompt_coords) {
+            req_coords = submeter_gemini_estruturado(prompt_coords, ESQUEMA_COORDENADAS, MODELO_GEMINI_GRAFO);
+        }
+    }
+
+    // Monta prompt usando template do config.h
+    char prompt[2048];
+    snprintf(prompt, sizeof(prompt), PROMPT_DISTANCIAS_GRAFO, cidade1, cidade2);
 
-        // Procura pelo padrão: Cidade1-Cidade2:distancia
-        char c1[MAX_NOME_CIDADE] = {0};
-        char c2[MAX_NOME_CIDADE] = {0};
-        int distancia = 0;
-
-        // Tenta fazer parse de várias formas
-        char* sep1 = strchr(linha, '-');
-        char* sep2 = strchr(linha, ':');
-
-        if (sep1 && sep2 && sep1 < sep2) {
-            // Extrai cidade1
-            size_t len1 = sep1 - linha;
-            if (len1 > 0 && len1 < MAX_NOME_CIDADE) {
-                strncpy(c1, linha, len1);
-                c1[len1] = '\0';
-
-                // Remove espaços e caracteres especiais no final de c1
-                char* end = c1 + strlen(c1) - 1;
-                while (end > c1 && (isspace(*end) || *end == '*' || *end == '.')) *end-- = '\0';
-
-                // Remove caracteres especiais no início
-                char* start = c1;
-                while (*start && (*start == '*' || *start == '-' || *start == '.' || isspace(*start))) start++;
-                if (start != c1) {
-                    memmove(c1, start, strlen(start) + 1);
+    char descricao[2 * MAX_NOME_CIDADE + 8];
+    snprintf(descricao, sizeof(descricao), "%s e %s", cidade1, cidade2);
+
+    int conexoes = preencher_grafo_com_prompt(cidade1, cidade2, prompt, descricao, grafo);
+
+    if (prompt_coords) {
+        double latitudes[2] = {0.0, 0.0};
+        double longitudes[2] = {0.0, 0.0};
+        char* resposta = aguardar_gemini_estruturado(req_coords, prompt_coords, ESQUEMA_COORDENADAS,
+                                                     MODELO_GEMINI_GRAFO);
+        int encontradas = interpretar_lote_coordenadas(resposta, pontas, indices, num_pontas,
+                                                       latitudes, longitudes);
+        cache_coordenadas_sincronizar();
+        free(prompt_coords);
+
+        if (encontradas > 0 && conexoes > 0) {
+            grafo_travar(grafo);
+            for (int i = 0; i < num_pontas; i++) {
+                int idx = encontrar_cidade(grafo, pontas[i]);
+                if (idx != -1 && !grafo->cidades[idx].coords_validas &&
+                    (latitudes[i] != 0.0 || longitudes[i] != 0.0)) {
+                    grafo_definir_coordenadas(grafo, idx, latitudes[i], longitudes[i]);
                 }
             }
+            grafo_destravar(grafo);
+        }
+    }
 
-            // Extrai cidade2
-            char* start2 = sep1 + 1;
-            while (*start2 && isspace(*start2)) start2++;
-            size_t len2 = sep2 - start2;
-            if (len2 > 0 && len2 < MAX_NOME_CIDADE) {
-                strncpy(c2, start2, len2);
-                c2[len2] = '\0';
-
-                // Remove espaços e caracteres especiais no final de c2
-                char* end = c2 + strlen(c2) - 1;
-                while (end > c2 && (isspace(*end) || *end == '*' || *end == '.')) *end-- = '\0';
-            }
+    return conexoes;
+}
+
+typedef struct {
+    const char* cidade1;
+    const char* cidade2;
+    Grafo* grafo;
+} PedidoDistancias;
+
+static void* tarefa_consultar_distancias(void* arg) {
+    PedidoDistancias* pedido = (PedidoDistancias*)arg;
+    return (void*)(intptr_t)consultar_distancias_e_preencher_grafo(pedido->cidade1, pedido->cidade2, pedido->grafo);
+}
+
+// Função para obter distâncias entre cidades usando IA e preencher o grafo
+// O mesmo par pedido de novo enquanto a consulta anterior está em andamento
+// (ex: chat e painel ao mesmo tempo) aguarda essa consulta em vez de repeti-la
+int obter_distancias_ia_e_preencher_grafo(const char* cidade1, const char* cidade2, Grafo* grafo) {
+    if (!cidade1 || !cidade2 || !grafo) return 0;
+
+    // O grafo entra na chave: só quem preenche o mesmo grafo pode aproveitar a consulta
+    char par[2 * MAX_NOME_CIDADE + 2];
+    char chave[sizeof(par) + 48];
+    montar_chave_par(cidade1, cidade2, par, sizeof(par));
+    snprintf(chave, sizeof(chave), "distancias|%p|%s", (void*)grafo, par);
+
+    PedidoDistancias pedido = {cidade1, cidade2, grafo};
+    return (int)(intptr_t)singleflight_executar(chave, tarefa_consultar_distancias, &pedido, NULL, NULL);
+}
+
+// Malha rodoviária de uma região inteira em uma consulta (a região vira a chave do cache)
+int obter_distancias_regiao_ia_e_preencher_grafo(const char* regiao, Grafo* grafo) {
+    if (!regiao || !grafo || regiao[0] == '\0') return 0;
+
+    char prompt[2048];
+    snprintf(prompt, sizeof(prompt), PROMPT_DISTANCIAS_REGIAO, regiao);
+
+    char descricao[MAX_NOME_CIDADE + 16];
+    snprintf(descricao, sizeof(descricao), "região %s", regiao);
+
+    return preencher_grafo_com_prompt(regiao, regiao, prompt, descricao, grafo);
+}
+
+// ===== DISTÂNCIAS EM LOTE =====
+
+// Pares do mesmo bloco vão em um único prompt
+typedef struct {
+    const ParCidades* pares;
+    int num_pares;
+    char* prompt;
+    HttpMultiRequisicao* req;       // Consulta em andamento no motor concorrente
+    char* resposta;                 // Texto da IA (NULL se a consulta falhou)
+    ArestaCache* arestas;
+    int num_arestas;
+} BlocoDistancias;
+
+// Aresta com a chave do par normalizado, para ordenar e agrupar repetições
+typedef struct {
+    char chave[2 * MAX_NOME_CIDADE + 2];
+    ArestaCache aresta;
+} ArestaAgrupada;
+
+// Chave "a|b" com os nomes normalizados e ordenados (a malha não tem direção)
+static void montar_chave_par(const char* cidade1, const char* cidade2, char* chave, size_t tamanho) {
+    char a[MAX_NOME_CIDADE];
+    char b[MAX_NOME_CIDADE];
+    normalizar_nome(cidade1, a, sizeof(a));
+    normalizar_nome(cidade2, b, sizeof(b));
+
+    if (strcmp(a, b) > 0) {
+        snprintf(chave, tamanho, "%s|%s", b, a);
+    } else {
+        snprintf(chave, tamanho, "%s|%s", a, b);
+    }
+}
+
+static int anexar_arestas(ArestaCache** destino, int* num, int* capacidade,
+                          const ArestaCache* origem, int quantidade) {
+    if (quantidade <= 0) return 1;
+    if (*num + quantidade > *capacidade) {
+        int nova_capacidade = *capacidade > 0 ? *capacidade : 64;
+        while (nova_capacidade < *num + quantidade) nova_capacidade *= 2;
+
+        ArestaCache* novas = (ArestaCache*)realloc(*destino, nova_capacidade * sizeof(ArestaCache));
+        if (!novas) return 0;
+        *destino = novas;
+        *capacidade = nova_capacidade;
+    }
+
+    memcpy(*destino + *num, origem, quantidade * sizeof(ArestaCache));
+    *num += quantidade;
+    return 1;
+}
+
+static void submeter_bloco_distancias(BlocoDistancias* bloco) {
+    // Lista numerada de pares (DISTANCIAS_LOTE_PARES nomes cabem no buffer)
+    char lista[DISTANCIAS_LOTE_PARES * (2 * MAX_NOME_CIDADE + 16)];
+    size_t usado = 0;
+    for (int i = 0; i < bloco->num_pares && usado < sizeof(lista); i++) {
+        usado += snprintf(lista + usado, sizeof(lista) - usado, "%d. %s - %s\n",
+                          i + 1, bloco->pares[i].origem, bloco->pares[i].destino);
+    }
+
+    char prompt[8192];
+    snprintf(prompt, sizeof(prompt), PROMPT_DISTANCIAS_LOTE, lista);
+    bloco->prompt = strdup(prompt);
+    if (!bloco->prompt) return;
+
+    fprintf(stderr, "[DEBUG GRAFO LOTE] Consultando IA (modelo: %s) para %d pares\n",
+            MODELO_GEMINI_GRAFO, bloco->num_pares);
+    fflush(stderr);
+
+    bloco->req = submeter_gemini_estruturado(bloco->prompt, ESQUEMA_DISTANCIAS, MODELO_GEMINI_GRAFO);
+}
+
+static void concluir_bloco_distancias(BlocoDistancias* bloco) {
+    if (!bloco->prompt) return;
+
+    bloco->resposta = aguardar_gemini_estruturado(bloco->req, bloco->prompt, ESQUEMA_DISTANCIAS,
+                                                  MODELO_GEMINI_GRAFO);
+    bloco->req = NULL;
+    if (!bloco->resposta) {
+        fprintf(stderr, "[ERRO GRAFO LOTE] IA não retornou resposta para um bloco de %d pares\n",
+                bloco->num_pares);
+        return;
+    }
+
+    bloco->arestas = interpretar_resposta_distancias(bloco->resposta, &bloco->num_arestas);
+    fprintf(stderr, "[DEBUG GRAFO LOTE] Bloco de %d pares: %d conexões\n",
+            bloco->num_pares, bloco->num_arestas);
+}
+
+static int comparar_arestas_agrupadas(const void* a, const void* b) {
+    const ArestaAgrupada* x = (const ArestaAgrupada*)a;
+    const ArestaAgrupada* y = (const ArestaAgrupada*)b;
+
+    int cmp = strcmp(x->chave, y->chave);
+    if (cmp != 0) return cmp;
+    return x->aresta.distancia - y->aresta.distancia;
+}
+
+// Remove conexões repetidas; quando as distâncias divergem fica a mediana
+// Retorna o novo número de arestas (o vetor é reescrito no lugar)
+static int deduplicar_arestas(ArestaCache* arestas, int num_arestas) {
+    if (num_arestas < 2) return num_arestas;
+
+    ArestaAgrupada* agrupadas = (ArestaAgrupada*)malloc(num_arestas * sizeof(ArestaAgrupada));
+    if (!agrupadas) return num_arestas;
+
+    for (int i = 0; i < num_arestas; i++) {
+        montar_chave_par(arestas[i].cidade1, arestas[i].cidade2,
+                         agrupadas[i].chave, sizeof(agrupadas[i].chave));
+        agrupadas[i].aresta = arestas[i];
+    }
+    qsort(agrupadas, num_arestas, sizeof(ArestaAgrupada), comparar_arestas_agrupadas);
+
+    int unicas = 0;
+    int divergentes = 0;
+    for (int inicio = 0; inicio < num_arestas;) {
+        int fim = inicio + 1;
+        while (fim < num_arestas && strcmp(agrupadas[fim].chave, agrupadas[inicio].chave) == 0) fim++;
+
+        // O grupo está ordenado por distância
+        int menor = agrupadas[inicio].aresta.distancia;
+        int maior = agrupadas[fim - 1].aresta.distancia;
+        ArestaCache escolhida = agrupadas[inicio + (fim - inicio) / 2].aresta;
+
+        if (maior - menor > escolhida.distancia * DISTANCIAS_DIVERGENCIA_MAX) {
+            divergentes++;
+            fprintf(stderr, "[AVISO GRAFO] Distâncias divergentes para %s - %s (%d a %d km); usando %d km\n",
+                    escolhida.cidade1, escolhida.cidade2, menor, maior, escolhida.distancia);
+        }
+
+        arestas[unicas++] = escolhida;
+        inicio = fim;
+    }
+    free(agrupadas);
+
+    fprintf(stderr, "[DEBUG GRAFO LOTE] %d conexões recebidas, %d únicas, %d com divergência\n",
+            num_arestas, unicas, divergentes);
+    return unicas;
+}
 
-            // Extrai distância (remove texto adicional como "km")
-            char* dist_str = sep2 + 1;
-            while (*dist_str && isspace(*dist_str)) dist_str++;
+// Índice da cidade (nome normalizado) em nomes; acrescenta se ainda não estiver lá
+static int indice_no_bloco(char (*nomes)[MAX_NOME_CIDADE], int* num_nomes, const char* cidade) {
+    char nome[MAX_NOME_CIDADE];
+    normalizar_nome(cidade, nome, sizeof(nome));
+    for (int i = 0; i < *num_nomes; i++) {
+        if (strcmp(nomes[i], nome) == 0) return i;
+    }
+    strcpy(nomes[*num_nomes], nome);
+    return (*num_nomes)++;
+}
 
-            // Extrai apenas os dígitos
-            char dist_num[20] = {0};
-            int idx = 0;
-            while (*dist_str && isdigit(*dist_str) && idx < 19) {
-                dist_num[idx++] = *dist_str++;
+// Menores distâncias a partir de origem só com as arestas do bloco (Dijkstra
+// O(V²): o bloco tem poucas dezenas de cidades)
+static void distancias_no_bloco(const int* extremos, const ArestaCache* arestas, int num_arestas,
+                                int num_nomes, int origem, long* dist) {
+    char* fechado = (char*)calloc(num_nomes, 1);
+    for (int i = 0; i < num_nomes; i++) dist[i] = LONG_MAX;
+    dist[origem] = 0;
+
+    for (int passo = 0; fechado && passo < num_nomes; passo++) {
+        int u = -1;
+        for (int i = 0; i < num_nomes; i++) {
+            if (!fechado[i] && dist[i] != LONG_MAX && (u == -1 || dist[i] < dist[u])) u = i;
+        }
+        if (u == -1) break;
+        fechado[u] = 1;
+
+        for (int a = 0; a < num_arestas; a++) {
+            int x = extremos[2 * a];
+            int y = extremos[2 * a + 1];
+            int v = x == u ? y : (y == u ? x : -1);
+            if (v != -1 && dist[u] + arestas[a].distancia < dist[v]) {
+                dist[v] = dist[u] + arestas[a].distancia;
             }
-            dist_num[idx] = '\0';
-            distancia = atoi(dist_num);
-
-            // Valida e adiciona ao grafo
-            if (strlen(c1) > 2 && strlen(c2) > 2 && distancia > 0 && distancia < 10000) {
-                fprintf(stderr, "[DEBUG GRAFO] Adicionando: %s - %s: %d km\n", c1, c2, distancia);
-                adicionar_aresta(grafo, c1, c2, distancia);
-                conexoes_adicionadas++;
-            } else {
-                fprintf(stderr, "[DEBUG GRAFO] Linha ignorada: '%s' (c1='%s', c2='%s', dist=%d)\n",
-                    linha, c1, c2, distancia);
+        }
+    }
+    free(fechado);
+}
+
+// Separa as conexões de um bloco que pertencem a um par: as que estão em algum
+// caminho origem→destino até DISTANCIAS_LOTE_FOLGA mais longo que o menor
+// (rota principal e alternativas). A resposta não diz de qual rota é cada
+// trecho, e trechos compartilhados aparecem uma vez só.
+// Retorna quantas foram copiadas para saida (0 se o par não se liga na resposta)
+static int arestas_do_par(const ArestaCache* arestas, int num_arestas, const char* origem,
+                          const char* destino, ArestaCache* saida) {
+    int max_nomes = 2 * num_arestas + 2;
+    char (*nomes)[MAX_NOME_CIDADE] = malloc(max_nomes * sizeof(*nomes));
+    int* extremos = (int*)malloc(2 * num_arestas * sizeof(int));
+    long* dist_origem = (long*)malloc(max_nomes * sizeof(long));
+    long* dist_destino = (long*)malloc(max_nomes * sizeof(long));
+    int copiadas = 0;
+
+    if (nomes && extremos && dist_origem && dist_destino) {
+        int num_nomes = 0;
+        for (int a = 0; a < num_arestas; a++) {
+            extremos[2 * a] = indice_no_bloco(nomes, &num_nomes, arestas[a].cidade1);
+            extremos[2 * a + 1] = indice_no_bloco(nomes, &num_nomes, arestas[a].cidade2);
+        }
+        int o = indice_no_bloco(nomes, &num_nomes, origem);
+        int d = indice_no_bloco(nomes, &num_nomes, destino);
+
+        distancias_no_bloco(extremos, arestas, num_arestas, num_nomes, o, dist_origem);
+        distancias_no_bloco(extremos, arestas, num_arestas, num_nomes, d, dist_destino);
+
+        if (o != d && dist_origem[d] != LONG_MAX) {
+            long limite = (long)(dist_origem[d] * (1.0 + DISTANCIAS_LOTE_FOLGA));
+            for (int a = 0; a < num_arestas; a++) {
+                int x = extremos[2 * a];
+                int y = extremos[2 * a + 1];
+                if (dist_origem[x] == LONG_MAX || dist_origem[y] == LONG_MAX) continue;
+
+                long ida = dist_origem[x] + arestas[a].distancia + dist_destino[y];
+                long volta = dist_origem[y] + arestas[a].distancia + dist_destino[x];
+                if (ida <= limite || volta <= limite) saida[copiadas++] = arestas[a];
             }
         }
+    }
+
+    free(nomes);
+    free(extremos);
+    free(dist_origem);
+    free(dist_destino);
+    return copiadas;
+}
 
-        linha = strtok(NULL, "\n\r");
+// Consulta vários pares de uma vez: pares repetidos e em cache não vão para a IA,
+// os demais são agrupados em blocos de DISTANCIAS_LOTE_PARES consultados em paralelo
+// pelo motor concorrente (até DISTANCIAS_LOTE_PARALELO por vez) e tudo é mesclado
+// no grafo em uma única trava
+int obter_distancias_lote_ia_e_preencher_grafo(const ParCidades* pares, int num_pares, Grafo* grafo) {
+    if (!pares || num_pares <= 0 || !grafo) return 0;
+
+    ParCidades* pendentes = (ParCidades*)malloc(num_pares * sizeof(ParCidades));
+    char (*chaves)[2 * MAX_NOME_CIDADE + 2] = malloc(num_pares * sizeof(*chaves));
+    if (!pendentes || !chaves) {
+        free(pendentes);
+        free(chaves);
+        return 0;
     }
 
-    free(resposta);
+    ArestaCache* todas = NULL;
+    int num_todas = 0;
+    int capacidade_todas = 0;
+    int num_pendentes = 0;
+    int num_chaves = 0;
+    int do_cache = 0;
+
+    for (int i = 0; i < num_pares; i++) {
+        char chave[2 * MAX_NOME_CIDADE + 2];
+        montar_chave_par(pares[i].origem, pares[i].destino, chave, sizeof(chave));
+
+        // Ignora pares vazios, de uma cidade com ela mesma e repetidos
+        const char* sep = strchr(chave, '|');
+        size_t len_origem = sep - chave;
+        if (len_origem == 0 || sep[1] == '\0') continue;
+        if (strlen(sep + 1) == len_origem && strncmp(chave, sep + 1, len_origem) == 0) continue;
+
+        int repetido = 0;
+        for (int k = 0; k < num_chaves && !repetido; k++) {
+            repetido = strcmp(chaves[k], chave) == 0;
+        }
+        if (repetido) continue;
+        strcpy(chaves[num_chaves++], chave);
+
+        int num_arestas = 0;
+        ArestaCache* arestas = cache_distancias_buscar(pares[i].origem, pares[i].destino,
+                                                       MODELO_GEMINI_GRAFO, &num_arestas);
+        if (arestas) {
+            anexar_arestas(&todas, &num_todas, &capacidade_todas, arestas, num_arestas);
+            free(arestas);
+            do_cache++;
+        } else {
+            pendentes[num_pendentes++] = pares[i];
+        }
+    }
+    free(chaves);
 
-    fprintf(stderr, "[DEBUG GRAFO] Total de conexões adicionadas: %d\n", conexoes_adicionadas);
-    fprintf(stderr, "[DEBUG GRAFO] Total de cidades no grafo: %d\n", grafo->num_cidades);
+    int num_blocos = (num_pendentes + DISTANCIAS_LOTE_PARES - 1) / DISTANCIAS_LOTE_PARES;
+    fprintf(stderr, "[DEBUG GRAFO LOTE] %d pares: %d do cache, %d para a IA em %d blocos\n",
+            num_pares, do_cache, num_pendentes, num_blocos);
     fflush(stderr);
 
-    return conexoes_adicionadas;
+    BlocoDistancias* blocos = NULL;
+    if (num_blocos > 0) {
+        blocos = (BlocoDistancias*)calloc(num_blocos, sizeof(BlocoDistancias));
+    }
+    if (blocos) {
+        for (int b = 0; b < num_blocos; b++) {
+            blocos[b].pares = pendentes + b * DISTANCIAS_LOTE_PARES;
+            blocos[b].num_pares = num_pendentes - b * DISTANCIAS_LOTE_PARES;
+            if (blocos[b].num_pares > DISTANCIAS_LOTE_PARES) blocos[b].num_pares = DISTANCIAS_LOTE_PARES;
+        }
+
+        // Janela de até DISTANCIAS_LOTE_PARALELO consultas em andamento no motor
+        // concorrente: cada bloco concluído libera a vaga para o próximo
+        int submetidos = 0;
+        for (int b = 0; b < num_blocos; b++) {
+            while (submetidos < num_blocos && submetidos < b + DISTANCIAS_LOTE_PARALELO) {
+                submeter_bloco_distancias(&blocos[submetidos++]);
+            }
+            concluir_bloco_distancias(&blocos[b]);
+        }
+
+        // Cada par do bloco guarda no cache só as conexões das rotas dele
+        for (int b = 0; b < num_blocos; b++) {
+            BlocoDistancias* bloco = &blocos[b];
+            if (bloco->arestas) {
+                anexar_arestas(&todas, &num_todas, &capacidade_todas, bloco->arestas, bloco->num_arestas);
+                ArestaCache* do_par = bloco->num_arestas > 0
+                    ? (ArestaCache*)malloc(bloco->num_arestas * sizeof(ArestaCache)) : NULL;
+                for (int i = 0; i < bloco->num_pares && do_par; i++) {
+                    int num_do_par = arestas_do_par(bloco->arestas, bloco->num_arestas, bloco->pares[i].origem,
+                                                    bloco->pares[i].destino, do_par);
+                    if (num_do_par > 0) {
+                        cache_distancias_gravar(bloco->pares[i].origem, bloco->pares[i].destino,
+                                                MODELO_GEMINI_GRAFO, NULL, do_par, num_do_par);
+                    } else {
+                        fprintf(stderr, "[AVISO GRAFO LOTE] Sem rota %s - %s na resposta; par fora do cache\n",
+                                bloco->pares[i].origem, bloco->pares[i].destino);
+                    }
+                }
+                free(do_par);
+            }
+            free(bloco->prompt);
+            free(bloco->resposta);
+            free(bloco->arestas);
+        }
+        free(blocos);
+    }
+    free(pendentes);
+
+    int conexoes = 0;
+    if (todas) {
+        num_todas = deduplicar_arestas(todas, num_todas);
+        conexoes = mesclar_arestas_grafo(grafo, todas, num_todas);
+        free(todas);
+    }
+    return conexoes;
 }
 
-// Função para obter coordenadas geográficas de uma cidade via IA
-int obter_coordenadas_cidade(const char* cidade, double* latitude, double* longitude) {
-    if (!cidade || !latitude || !longitude) return 0;
+// Lê "lat" e "lng" de um objeto da resposta; retorna 1 se forem coordenadas plausíveis
+static int interpretar_coordenadas(const cJSON* objeto, double* latitude, double* longitude) {
+    const cJSON* lat = cJSON_GetObjectItemCaseSensitive(objeto, "lat");
+    const cJSON* lng = cJSON_GetObjectItemCaseSensitive(objeto, "lng");
+    if (!cJSON_IsNumber(lat) || !cJSON_IsNumber(lng)) return 0;
+
+    *latitude = lat->valuedouble;
+    *longitude = lng->valuedouble;
+    if (*latitude < -90.0 || *latitude > 90.0 || *longitude < -180.0 || *longitude > 180.0) return 0;
+    return *latitude != 0.0 || *longitude != 0.0;
+}
 
+// Consulta a IA pelas coordenadas de uma cidade e grava no cache
+static int consultar_coordenadas_ia(const char* cidade, double* latitude, double* longitude) {
     // Monta prompt usando template do config.h
     char prompt[1024];
     snprintf(prompt, sizeof(prompt), PROMPT_COORDENADAS_UNICA, cidade);
@@ -298,7 +1361,7 @@ int obter_coordenadas_cidade(const char* cidade, double* latitude, double* longi
     fflush(stderr);
 
     // Consulta a IA usando modelo específico para grafos (sem histórico)
-    char* resposta = consultar_gemini_com_modelo(prompt, NULL, "", MODELO_GEMINI_GRAFO);
+    char* resposta = consultar_gemini_estruturado(prompt, ESQUEMA_COORDENADA, MODELO_GEMINI_GRAFO);
 
     if (!resposta) {
         fprintf(stderr, "[ERRO COORDS] IA não retornou resposta\n");
@@ -308,46 +1371,20 @@ int obter_coordenadas_cidade(const char* cidade, double* latitude, double* longi
     fprintf(stderr, "[DEBUG COORDS] Resposta da IA:\n%s\n", resposta);
     fflush(stderr);
 
-    // Parse da resposta
-    double lat = 0.0, lng = 0.0;
-    int lat_found = 0, lng_found = 0;
-
-    char* linha = strtok(resposta, "\n\r");
-    while (linha) {
-        // Remove espaços em branco no início
-        while (*linha && isspace(*linha)) linha++;
-
-        // Procura por LAT:
-        if (strncasecmp(linha, "LAT:", 4) == 0) {
-            char* valor = linha + 4;
-            while (*valor && isspace(*valor)) valor++;
-            lat = atof(valor);
-            if (lat != 0.0 || *valor == '0') {
-                lat_found = 1;
-                fprintf(stderr, "[DEBUG COORDS] Latitude encontrada: %.4f\n", lat);
-            }
-        }
-        // Procura por LNG: ou LON:
-        else if (strncasecmp(linha, "LNG:", 4) == 0 || strncasecmp(linha, "LON:", 4) == 0) {
-            char* valor = linha + 4;
-            while (*valor && isspace(*valor)) valor++;
-            lng = atof(valor);
-            if (lng != 0.0 || *valor == '0') {
-                lng_found = 1;
-                fprintf(stderr, "[DEBUG COORDS] Longitude encontrada: %.4f\n", lng);
-            }
-        }
-
-        linha = strtok(NULL, "\n\r");
-    }
-
+    // Resposta em ESQUEMA_COORDENADA: {"lat": ..., "lng": ...}
+    cJSON* root = cJSON_Parse(resposta);
     free(resposta);
 
-    // Valida se encontrou ambas as coordenadas
-    if (lat_found && lng_found) {
+    double lat = 0.0, lng = 0.0;
+    int encontradas = interpretar_coordenadas(root, &lat, &lng);
+    cJSON_Delete(root);
+
+    if (encontradas) {
         *latitude = lat;
         *longitude = lng;
         fprintf(stderr, "[DEBUG COORDS] Coordenadas de %s: %.4f, %.4f\n", cidade, lat, lng);
+        cache_coordenadas_gravar(cidade, lat, lng);
+        cache_coordenadas_sincronizar();
         return 1;
     }
 
@@ -355,17 +1392,56 @@ int obter_coordenadas_cidade(const char* cidade, double* latitude, double* longi
     return 0;
 }
 
-// Função OTIMIZADA para obter coordenadas de múltiplas cidades em UMA ÚNICA requisição
-int obter_coordenadas_multiplas(char cidades[][100], int num_cidades, double latitudes[], double longitudes[]) {
-    if (!cidades || num_cidades <= 0 || !latitudes || !longitudes) return 0;
+// Resultado compartilhado: {latitude, longitude}, ou NULL se a consulta falhou
+static void* tarefa_consultar_coordenadas(void* arg) {
+    double coords[2];
+    if (!consultar_coordenadas_ia((const char*)arg, &coords[0], &coords[1])) return NULL;
+
+    double* resultado = (double*)malloc(sizeof(coords));
+    if (resultado) memcpy(resultado, coords, sizeof(coords));
+    return resultado;
+}
 
-    fprintf(stderr, "[DEBUG COORDS BATCH] Buscando coordenadas de %d cidades em uma única requisição\n", num_cidades);
+static void* copiar_coordenadas(const void* resultado) {
+    double* copia = (double*)malloc(2 * sizeof(double));
+    if (copia) memcpy(copia, resultado, 2 * sizeof(double));
+    return copia;
+}
+
+// Função para obter coordenadas geográficas de uma cidade via IA
+int obter_coordenadas_cidade(const char* cidade, double* latitude, double* longitude) {
+    if (!cidade || !latitude || !longitude) return 0;
+
+    if (cache_coordenadas_buscar(cidade, latitude, longitude)) {
+        fprintf(stderr, "[DEBUG COORDS] Coordenadas de %s obtidas do cache\n", cidade);
+        return 1;
+    }
+
+    // Pedidos simultâneos da mesma cidade fazem uma única consulta à IA
+    char nome[MAX_NOME_CIDADE];
+    char chave[MAX_NOME_CIDADE + 8];
+    normalizar_nome(cidade, nome, sizeof(nome));
+    snprintf(chave, sizeof(chave), "coords|%s", nome);
+
+    double* coords = (double*)singleflight_executar(chave, tarefa_consultar_coordenadas, (void*)cidade,
+                                                    copiar_coordenadas, NULL);
+    if (!coords) return 0;
+
+    *latitude = coords[0];
+    *longitude = coords[1];
+    free(coords);
+    return 1;
+}
+
+// Prompt de um lote de cidades (indices aponta para as posições em cidades[])
+static char* montar_prompt_lote_coordenadas(char cidades[][100], const int* indices, int num_indices) {
+    fprintf(stderr, "[DEBUG COORDS BATCH] Buscando coordenadas de %d cidades em uma única requisição\n", num_indices);
 
-    // Monta lista de cidades para o prompt
+    // Monta lista de cidades para o prompt (COORDENADAS_LOTE_MAX nomes cabem no buffer)
     char lista_cidades[4096] = "";
-    for (int i = 0; i < num_cidades; i++) {
-        strcat(lista_cidades, cidades[i]);
-        if (i < num_cidades - 1) strcat(lista_cidades, ", ");
+    for (int k = 0; k < num_indices; k++) {
+        strcat(lista_cidades, cidades[indices[k]]);
+        if (k < num_indices - 1) strcat(lista_cidades, ", ");
     }
 
     // Monta prompt usando template do config.h
@@ -373,12 +1449,15 @@ int obter_coordenadas_multiplas(char cidades[][100], int num_cidades, double lat
     snprintf(prompt, sizeof(prompt), PROMPT_COORDENADAS_MULTIPLAS, lista_cidades);
 
     fprintf(stderr, "[DEBUG COORDS BATCH] Consultando IA (modelo: %s) para %d cidades\n",
-            MODELO_GEMINI_GRAFO, num_cidades);
+            MODELO_GEMINI_GRAFO, num_indices);
     fflush(stderr);
 
-    // Consulta a IA usando modelo específico para grafos (sem histórico)
-    char* resposta = consultar_gemini_com_modelo(prompt, NULL, "", MODELO_GEMINI_GRAFO);
+    return strdup(prompt);
+}
 
+// Aplica a resposta de um lote (liberada aqui); retorna as cidades encontradas
+static int interpretar_lote_coordenadas(char* resposta, char cidades[][100], const int* indices,
+                                        int num_indices, double latitudes[], double longitudes[]) {
     if (!resposta) {
         fprintf(stderr, "[ERRO COORDS BATCH] IA não retornou resposta\n");
         return 0;
@@ -387,95 +1466,114 @@ int obter_coordenadas_multiplas(char cidades[][100], int num_cidades, double lat
     fprintf(stderr, "[DEBUG COORDS BATCH] Resposta da IA:\n%s\n", resposta);
     fflush(stderr);
 
-    // Parse da resposta - processa linha por linha
-    int coords_encontradas = 0;
-    char* resposta_copia = strdup(resposta); // Cópia para não modificar original
-    char* linha = strtok(resposta_copia, "\n\r");
+    // Resposta em ESQUEMA_COORDENADAS: {"cidades":[{nome, lat, lng}]}
+    cJSON* root = cJSON_Parse(resposta);
+    free(resposta);
 
-    while (linha && coords_encontradas < num_cidades) {
-        // Remove espaços em branco no início
-        while (*linha && isspace(*linha)) linha++;
+    // Nomes da lista normalizados uma vez (a IA pode trocar acentos ou caixa)
+    char (*chaves)[MAX_NOME_CIDADE] = malloc(num_indices * sizeof(*chaves));
+    if (!chaves) {
+        cJSON_Delete(root);
+        return 0;
+    }
+    for (int k = 0; k < num_indices; k++) {
+        normalizar_nome(cidades[indices[k]], chaves[k], sizeof(chaves[k]));
+    }
 
-        // Ignora linhas vazias ou que começam com caracteres especiais
-        if (*linha == '\0' || *linha == '#' || *linha == '*' || *linha == '-' || *linha == '=') {
-            linha = strtok(NULL, "\n\r");
+    int coords_encontradas = 0;
+    const cJSON* lista = cJSON_GetObjectItemCaseSensitive(root, "cidades");
+    const cJSON* item;
+    cJSON_ArrayForEach(item, lista) {
+        char nome_cidade[MAX_NOME_CIDADE];
+        double lat, lng;
+        if (!copiar_nome_cidade(cJSON_GetObjectItemCaseSensitive(item, "nome"), nome_cidade) ||
+            !interpretar_coordenadas(item, &lat, &lng)) {
             continue;
         }
 
-        // Procura pelo padrão: CIDADE|LAT:valor|LNG:valor
-        char* sep1 = strchr(linha, '|');
-        if (!sep1) {
-            linha = strtok(NULL, "\n\r");
-            continue;
+        char chave[MAX_NOME_CIDADE];
+        normalizar_nome(nome_cidade, chave, sizeof(chave));
+
+        // Encontra qual cidade corresponde (cada uma é preenchida só uma vez)
+        for (int k = 0; k < num_indices; k++) {
+            if (chaves[k][0] != '\0' && strcmp(chave, chaves[k]) == 0) {
+                int i = indices[k];
+                latitudes[i] = lat;
+                longitudes[i] = lng;
+                chaves[k][0] = '\0';
+                coords_encontradas++;
+                cache_coordenadas_gravar(cidades[i], lat, lng);
+                fprintf(stderr, "[DEBUG COORDS BATCH] ✓ %s: %.4f, %.4f\n", cidades[i], lat, lng);
+                break;
+            }
         }
+    }
 
-        // Extrai nome da cidade
-        char nome_cidade[100] = {0};
-        size_t len_nome = sep1 - linha;
-        if (len_nome > 0 && len_nome < 100) {
-            strncpy(nome_cidade, linha, len_nome);
-            nome_cidade[len_nome] = '\0';
-
-            // Remove espaços extras
-            char* end = nome_cidade + strlen(nome_cidade) - 1;
-            while (end > nome_cidade && isspace(*end)) *end-- = '\0';
-            char* start = nome_cidade;
-            while (*start && isspace(*start)) start++;
-            if (start != nome_cidade) memmove(nome_cidade, start, strlen(start) + 1);
-        }
+    free(chaves);
+    cJSON_Delete(root);
 
-        // Encontra LAT:
-        char* lat_pos = strstr(sep1, "LAT:");
-        char* lng_pos = strstr(sep1, "LNG:");
+    fprintf(stderr, "[DEBUG COORDS BATCH] Total de coordenadas encontradas: %d de %d\n",
+            coords_encontradas, num_indices);
 
-        if (lat_pos && lng_pos) {
-            // Extrai latitude
-            double lat = 0.0;
-            char* lat_val = lat_pos + 4;
-            while (*lat_val && isspace(*lat_val)) lat_val++;
+    return coords_encontradas;
+}
 
-            char lat_str[32] = {0};
-            int idx = 0;
-            while (*lat_val && (isdigit(*lat_val) || *lat_val == '.' || *lat_val == '-') && idx < 31) {
-                lat_str[idx++] = *lat_val++;
-            }
-            lat_str[idx] = '\0';
-            lat = atof(lat_str);
-
-            // Extrai longitude
-            double lng = 0.0;
-            char* lng_val = lng_pos + 4;
-            while (*lng_val && isspace(*lng_val)) lng_val++;
-
-            char lng_str[32] = {0};
-            idx = 0;
-            while (*lng_val && (isdigit(*lng_val) || *lng_val == '.' || *lng_val == '-') && idx < 31) {
-                lng_str[idx++] = *lng_val++;
-            }
-            lng_str[idx] = '\0';
-            lng = atof(lng_str);
-
-            // Encontra qual cidade corresponde
-            for (int i = 0; i < num_cidades; i++) {
-                if (strcasecmp(nome_cidade, cidades[i]) == 0) {
-                    latitudes[i] = lat;
-                    longitudes[i] = lng;
-                    coords_encontradas++;
-                    fprintf(stderr, "[DEBUG COORDS BATCH] ✓ %s: %.4f, %.4f\n", cidades[i], lat, lng);
-                    break;
-                }
-            }
+// Função para obter coordenadas de múltiplas cidades (cache primeiro, depois IA em lotes)
+int obter_coordenadas_multiplas(char cidades[][100], int num_cidades, double latitudes[], double longitudes[]) {
+    if (!cidades || num_cidades <= 0 || !latitudes || !longitudes) return 0;
+
+    int* faltando = (int*)malloc(num_cidades * sizeof(int));
+    if (!faltando) return 0;
+
+    int encontradas = 0;
+    int num_faltando = 0;
+    for (int i = 0; i < num_cidades; i++) {
+        if (cache_coordenadas_buscar(cidades[i], &latitudes[i], &longitudes[i])) {
+            encontradas++;
+        } else {
+            faltando[num_faltando++] = i;
         }
+    }
 
-        linha = strtok(NULL, "\n\r");
+    if (encontradas > 0) {
+        fprintf(stderr, "[DEBUG COORDS BATCH] %d de %d cidades obtidas do cache\n", encontradas, num_cidades);
     }
 
-    free(resposta_copia);
-    free(resposta);
+    // Todos os lotes seguem juntos pelo motor concorrente; as respostas são
+    // aplicadas na ordem em que foram submetidas
+    int num_lotes = (num_faltando + COORDENADAS_LOTE_MAX - 1) / COORDENADAS_LOTE_MAX;
+    char** prompts = num_lotes > 0 ? (char**)calloc(num_lotes, sizeof(char*)) : NULL;
+    HttpMultiRequisicao** reqs = num_lotes > 0 ? (HttpMultiRequisicao**)calloc(num_lotes, sizeof(*reqs)) : NULL;
 
-    fprintf(stderr, "[DEBUG COORDS BATCH] Total de coordenadas encontradas: %d de %d\n",
-            coords_encontradas, num_cidades);
+    for (int l = 0; prompts && reqs && l < num_lotes; l++) {
+        int inicio = l * COORDENADAS_LOTE_MAX;
+        int tamanho = num_faltando - inicio;
+        if (tamanho > COORDENADAS_LOTE_MAX) tamanho = COORDENADAS_LOTE_MAX;
 
-    return coords_encontradas;
-}
+        prompts[l] = montar_prompt_lote_coordenadas(cidades, faltando + inicio, tamanho);
+        if (prompts[l]) {
+            reqs[l] = submeter_gemini_estruturado(prompts[l], ESQUEMA_COORDENADAS, MODELO_GEMINI_GRAFO);
+        }
+    }
 
+    for (int l = 0; prompts && reqs && l < num_lotes; l++) {
+        if (!prompts[l]) continue;
+
+        int inicio = l * COORDENADAS_LOTE_MAX;
+        int tamanho = num_faltando - inicio;
+        if (tamanho > COORDENADAS_LOTE_MAX) tamanho = COORDENADAS_LOTE_MAX;
+
+        char* resposta = aguardar_gemini_estruturado(reqs[l], prompts[l], ESQUEMA_COORDENADAS, MODELO_GEMINI_GRAFO);
+        encontradas += interpretar_lote_coordenadas(resposta, cidades, faltando + inicio, tamanho,
+                                                    latitudes, longitudes);
+        free(prompts[l]);
+    }
+    free(prompts);
+    free(reqs);
+
+    // Uma única escrita no arquivo para todo o lote
+    cache_coordenadas_sincronizar();
+    free(faltando);
+
+    return encontradas;
+}
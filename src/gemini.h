@@ -3,16 +3,68 @@
 
 #include "historico.h"
 #include "grafo.h"
+#include "http_utils.h"
+#include <stddef.h>
+
+// Callback chamado a cada trecho de texto recebido em modo streaming
+typedef void (*GeminiDeltaCallback)(const char* delta, void* userdata);
+
+// Parser incremental de Server-Sent Events do streamGenerateContent
+typedef struct {
+    struct MemoryStruct pendente;   // Bytes ainda sem quebra de linha
+    struct MemoryStruct evento;     // Linhas "data:" do evento atual
+    struct MemoryStruct texto;      // Texto completo acumulado
+    GeminiDeltaCallback on_delta;
+    void* userdata;
+    int eventos;                    // Eventos processados (para debug)
+} GeminiSseParser;
 
 // Funções da API Gemini
 char* criar_payload_json_com_historico(const char* prompt, HistoricoChat* historico, const char* cidade);
 char* extrair_texto_da_resposta(const char* resposta_json);
 char* consultar_gemini(const char* pergunta, HistoricoChat* historico, const char* cidade);
 char* consultar_gemini_com_modelo(const char* pergunta, HistoricoChat* historico, const char* cidade, const char* modelo);
+// Chat dentro de um prazo absoluto (http_prazo_novo) já usado por outra chamada
+char* consultar_gemini_com_prazo(const char* pergunta, HistoricoChat* historico, const char* cidade, double prazo);
+// Saída estruturada (responseMimeType application/json + responseSchema): o texto
+// devolvido é um JSON no formato de esquema (ver ESQUEMA_* em config.h)
+char* consultar_gemini_estruturado(const char* pergunta, const char* esquema, const char* modelo);
+
+// Cache de contexto (cachedContents) usado pelo chat quando a conversa é longa:
+// invalidar descarta o cache atual (conversa limpa, cidade trocada) e o remove
+// do servidor em segundo plano; liberar remove na hora (chamar no encerramento)
+void gemini_contexto_invalidar(void);
+void gemini_contexto_liberar(void);
+
+// Abre em segundo plano a conexão com a API (DNS + TLS prontos para a primeira pergunta)
+void gemini_preaquecer_conexao(void);
+
+// Streaming (streamGenerateContent?alt=sse): entrega deltas conforme chegam
+// Retorna o texto recebido ou NULL se nada chegou; completo = 0 quando a
+// transferência falhou no meio (texto parcial: não vai para o histórico).
+// prazo é absoluto (http_prazo_novo) para o fallback dividir o mesmo orçamento
+char* consultar_gemini_stream(const char* pergunta, HistoricoChat* historico, const char* cidade,
+                              GeminiDeltaCallback on_delta, void* userdata, double prazo, int* completo);
+void sse_parser_iniciar(GeminiSseParser* parser, GeminiDeltaCallback on_delta, void* userdata);
+void sse_parser_alimentar(GeminiSseParser* parser, const char* dados, size_t tamanho);
+char* sse_parser_finalizar(GeminiSseParser* parser);
+
+// Par origem/destino para consultas de distâncias em lote
+typedef struct {
+    char origem[MAX_NOME_CIDADE];
+    char destino[MAX_NOME_CIDADE];
+} ParCidades;
 
 // Função para integração com grafos
 int obter_distancias_ia_e_preencher_grafo(const char* cidade1, const char* cidade2, Grafo* grafo);
 
+// Vários pares em poucos prompts consultados em paralelo; conexões repetidas são
+// unificadas (mediana quando as distâncias divergem). Retorna as conexões mescladas
+int obter_distancias_lote_ia_e_preencher_grafo(const ParCidades* pares, int num_pares, Grafo* grafo);
+
+// Malha rodoviária principal de uma região (ex: "Sul de Minas") em uma consulta
+int obter_distancias_regiao_ia_e_preencher_grafo(const char* regiao, Grafo* grafo);
+
 // Função para obter coordenadas geográficas via IA
 int obter_coordenadas_cidade(const char* cidade, double* latitude, double* longitude);
 
@@ -1,15 +1,27 @@
 #include "grafo.h"
 #include "gemini.h"
+#include "normalizacao.h"
+#include "grafo_ch.h"
+#include "str_builder.h"
+#include "cache_coordenadas.h"
+#include "tarefas.h"
+#include "grafo_snapshot.h"
+#include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
+#include <sys/stat.h>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <time.h>
+#include <io.h>
 #else
 #include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 // Função auxiliar para obter tempo em microsegundos (alta precisão)
@@ -28,59 +40,236 @@ static double obter_tempo_ms() {
 }
 //
 Grafo* criar_grafo() {
-    Grafo* g = (Grafo*)malloc(sizeof(Grafo));
+    Grafo* g = (Grafo*)calloc(1, sizeof(Grafo));
     if (!g) return NULL;
 
+    // Tabela de nós e CSR começam vazios e crescem sob demanda
     g->num_cidades = 0;
+    pthread_mutex_init(&g->trava, NULL);
+    pthread_mutex_init(&g->trava_gravacao, NULL);
+    return g;
+}
 
-    // Inicializa todas as adjacências como -1 (sem conexão)
-    for (int i = 0; i < MAX_CIDADES; i++) {
-        g->cidades[i].nome[0] = '\0';
-        g->cidades[i].latitude = 0.0;
-        g->cidades[i].longitude = 0.0;
-        g->cidades[i].coords_validas = 0;
-        for (int j = 0; j < MAX_CIDADES; j++) {
-            g->cidades[i].adjacencias[j] = -1;
+// Procura a chave no índice; retorna a posição ocupada por ela ou a posição livre onde entraria
+static int indice_localizar(Grafo* g, const char* chave) {
+    int mascara = g->capacidade_indice - 1;
+    int pos = (int)(hash_nome(chave) & (unsigned int)mascara);
+
+    // Sondagem linear
+    while (g->indice_nomes[pos] != -1) {
+        if (strcmp(g->cidades[g->indice_nomes[pos]].chave, chave) == 0) {
+            return pos;
         }
+        pos = (pos + 1) & mascara;
     }
-    return g;
+    return pos;
 }
 
-int encontrar_cidade(Grafo* g, const char* nome) {
-    if (!g || !nome) return -1;
+// Dobra o índice e reinsere todas as cidades
+static int indice_expandir(Grafo* g) {
+    int nova_capacidade;
+    if (g->capacidade_indice == 0) {
+        nova_capacidade = 32;
+    } else {
+        nova_capacidade = g->capacidade_indice * 2;
+    }
+
+    int* novo = (int*)malloc(nova_capacidade * sizeof(int));
+    if (!novo) return 0;
+    memset(novo, -1, nova_capacidade * sizeof(int));
+
+    free(g->indice_nomes);
+    g->indice_nomes = novo;
+    g->capacidade_indice = nova_capacidade;
 
-    // Busca cidade pelo nome (case-insensitive)
     for (int i = 0; i < g->num_cidades; i++) {
-        if (strcasecmp(g->cidades[i].nome, nome) == 0) {
-            return i;
-        }
+        g->indice_nomes[indice_localizar(g, g->cidades[i].chave)] = i;
     }
-    return -1;
+    return 1;
 }
 
-void adicionar_cidade(Grafo* g, const char* nome) {
-    if (!g || !nome || g->num_cidades >= MAX_CIDADES) return;
+int encontrar_cidade(Grafo* g, const char* nome) {
+    if (!g || !nome || g->capacidade_indice == 0) return -1;
+
+    // Busca pelo nome normalizado (ignora maiúsculas, acentos e espaços extras)
+    char chave[MAX_NOME_CIDADE];
+    normalizar_nome(nome, chave, sizeof(chave));
+
+    return g->indice_nomes[indice_localizar(g, chave)];
+}
+
+// Adiciona uma cidade e retorna seu índice (ou o índice existente)
+int adicionar_cidade(Grafo* g, const char* nome) {
+    if (!g || !nome) return -1;
+
+    // Mantém o índice com ocupação de no máximo 50%
+    if ((g->num_cidades + 1) * 2 > g->capacidade_indice && !indice_expandir(g)) {
+        fprintf(stderr, "[ERRO GRAFO] Sem memória para indexar cidade: %s\n", nome);
+        return -1;
+    }
 
     // Verifica se já existe
-    if (encontrar_cidade(g, nome) != -1) return;
+    char chave[MAX_NOME_CIDADE];
+    normalizar_nome(nome, chave, sizeof(chave));
+
+    int pos_indice = indice_localizar(g, chave);
+    if (g->indice_nomes[pos_indice] != -1) return g->indice_nomes[pos_indice];
+
+    // Expande a tabela de nós (crescimento geométrico)
+    if (g->num_cidades >= g->capacidade_cidades) {
+        int nova_capacidade;
+        if (g->capacidade_cidades == 0) {
+            nova_capacidade = 16;
+        } else {
+            nova_capacidade = g->capacidade_cidades * 2;
+        }
+
+        int* novo_pai = (int*)realloc(g->componente_pai, nova_capacidade * sizeof(int));
+        if (novo_pai) g->componente_pai = novo_pai;
+        int* novo_tamanho = (int*)realloc(g->componente_tamanho, nova_capacidade * sizeof(int));
+        if (novo_tamanho) g->componente_tamanho = novo_tamanho;
+
+        Cidade* novas = (Cidade*)realloc(g->cidades, nova_capacidade * sizeof(Cidade));
+        if (!novas || !novo_pai || !novo_tamanho) {
+            if (novas) g->cidades = novas;
+            fprintf(stderr, "[ERRO GRAFO] Sem memória para adicionar cidade: %s\n", nome);
+            return -1;
+        }
+        g->cidades = novas;
+        g->capacidade_cidades = nova_capacidade;
+    }
+
+    Cidade* cidade = &g->cidades[g->num_cidades];
+    memset(cidade, 0, sizeof(Cidade));
 
-    strncpy(g->cidades[g->num_cidades].nome, nome, MAX_NOME_CIDADE - 1);
-    g->cidades[g->num_cidades].nome[MAX_NOME_CIDADE - 1] = '\0';
+    strncpy(cidade->nome, nome, MAX_NOME_CIDADE - 1);
+    cidade->nome[MAX_NOME_CIDADE - 1] = '\0';
 
     // Remove espaços extras no início e fim
-    char* start = g->cidades[g->num_cidades].nome;
+    char* start = cidade->nome;
     while (*start == ' ') start++;
-    if (start != g->cidades[g->num_cidades].nome) {
-        memmove(g->cidades[g->num_cidades].nome, start, strlen(start) + 1);
+    if (start != cidade->nome) {
+        memmove(cidade->nome, start, strlen(start) + 1);
     }
 
-    char* end = g->cidades[g->num_cidades].nome + strlen(g->cidades[g->num_cidades].nome) - 1;
-    while (end > g->cidades[g->num_cidades].nome && *end == ' ') {
+    char* end = cidade->nome + strlen(cidade->nome) - 1;
+    while (end > cidade->nome && *end == ' ') {
         *end = '\0';
         end--;
     }
 
-    g->num_cidades++;
+    strcpy(cidade->chave, chave);
+    g->indice_nomes[pos_indice] = g->num_cidades;
+
+    // Cidade nova começa isolada, em um componente só dela
+    g->componente_pai[g->num_cidades] = g->num_cidades;
+    g->componente_tamanho[g->num_cidades] = 1;
+    g->num_componentes++;
+
+    return g->num_cidades++;
+}
+
+// Raiz do componente de uma cidade (com compressão de caminho por divisão)
+int grafo_componente(Grafo* g, int idx) {
+    if (!g || idx < 0 || idx >= g->num_cidades) return -1;
+
+    int* pai = g->componente_pai;
+    while (pai[idx] != idx) {
+        pai[idx] = pai[pai[idx]];
+        idx = pai[idx];
+    }
+    return idx;
+}
+
+// Une os componentes de duas cidades (o menor passa a apontar para o maior)
+static void unir_componentes(Grafo* g, int idx1, int idx2) {
+    int a = grafo_componente(g, idx1);
+    int b = grafo_componente(g, idx2);
+    if (a == b) return;
+
+    if (g->componente_tamanho[a] < g->componente_tamanho[b]) {
+        int tmp = a;
+        a = b;
+        b = tmp;
+    }
+    g->componente_pai[b] = a;
+    g->componente_tamanho[a] += g->componente_tamanho[b];
+    g->num_componentes--;
+}
+
+void grafo_recalcular_componentes(Grafo* g) {
+    if (!g) return;
+
+    for (int i = 0; i < g->num_cidades; i++) {
+        g->componente_pai[i] = i;
+        g->componente_tamanho[i] = 1;
+    }
+    g->num_componentes = g->num_cidades;
+
+    for (int u = 0; u < g->csr_num_cidades; u++) {
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            unir_componentes(g, u, g->csr_destino[e]);
+        }
+    }
+    for (int i = 0; i < g->num_pendentes; i++) {
+        unir_componentes(g, g->pendentes[i].origem, g->pendentes[i].destino);
+    }
+}
+
+int grafo_cidades_conectadas(Grafo* g, const char* origem, const char* destino) {
+    int idx_origem = encontrar_cidade(g, origem);
+    int idx_destino = encontrar_cidade(g, destino);
+    if (idx_origem == -1 || idx_destino == -1) return 0;
+
+    return grafo_componente(g, idx_origem) == grafo_componente(g, idx_destino);
+}
+
+// Anota uma mudança para a próxima gravação incremental (.wal)
+static void registrar_mutacao(Grafo* g, int tipo, int cidade1, int cidade2, int distancia) {
+    if (g->num_mutacoes >= g->capacidade_mutacoes) {
+        int nova_capacidade = g->capacidade_mutacoes > 0 ? g->capacidade_mutacoes * 2 : 64;
+        MutacaoGrafo* novas = (MutacaoGrafo*)realloc(g->mutacoes, nova_capacidade * sizeof(MutacaoGrafo));
+        if (!novas) {
+            // Sem memória para o log: força a próxima gravação a ser completa
+            g->registros_wal = GRAFO_WAL_MAX_REGISTROS;
+            return;
+        }
+        g->mutacoes = novas;
+        g->capacidade_mutacoes = nova_capacidade;
+    }
+
+    MutacaoGrafo* m = &g->mutacoes[g->num_mutacoes++];
+    m->tipo = tipo;
+    m->cidade1 = cidade1;
+    m->cidade2 = cidade2;
+    m->distancia = distancia;
+}
+
+// Único ponto de escrita de coordenadas fora da carga de arquivos
+void grafo_definir_coordenadas(Grafo* g, int idx, double latitude, double longitude) {
+    if (!g || idx < 0 || idx >= g->num_cidades) return;
+
+    Cidade* cidade = &g->cidades[idx];
+    if (cidade->coords_validas && cidade->latitude == latitude && cidade->longitude == longitude) return;
+
+    cidade->latitude = latitude;
+    cidade->longitude = longitude;
+    cidade->coords_validas = 1;
+    g->astar_verificado = 0;
+    registrar_mutacao(g, MUTACAO_COORDENADAS, idx, -1, 0);
+}
+
+// A hierarquia continua válida se a aresta não encurta nenhum menor caminho
+// e não alonga uma conexão existente
+static int aresta_preserva_hierarquia(Grafo* g, int idx1, int idx2, int distancia) {
+    if (idx1 >= g->ch->num_cidades || idx2 >= g->ch->num_cidades) return 0;
+    if (idx1 == idx2) return 1;
+
+    int atual = grafo_distancia(g, idx1, idx2);
+    if (atual != -1 && distancia > atual) return 0;
+
+    int menor = ch_distancia(g->ch, idx1, idx2);
+    return menor != -1 && distancia >= menor;
 }
 
 // Adiciona aresta (conexão) entre duas cidades
@@ -88,164 +277,558 @@ void adicionar_aresta(Grafo* g, const char* cidade1, const char* cidade2, int di
     // Valida parâmetros
     if (!g || !cidade1 || !cidade2 || distancia <= 0) return;
 
-    // Busca índices das cidades
-    int idx1 = encontrar_cidade(g, cidade1);
-    int idx2 = encontrar_cidade(g, cidade2);
+    // Busca índices das cidades (adiciona se não existirem)
+    int idx1 = adicionar_cidade(g, cidade1);
+    int idx2 = adicionar_cidade(g, cidade2);
+    if (idx1 == -1 || idx2 == -1) return;
 
-    // Adiciona cidades se não existirem
-    if (idx1 == -1) {
-        adicionar_cidade(g, cidade1);
-        idx1 = g->num_cidades - 1;
+    if (g->ch && !aresta_preserva_hierarquia(g, idx1, idx2, distancia)) {
+        ch_liberar(g->ch);
+        g->ch = NULL;
     }
-    if (idx2 == -1) {
-        adicionar_cidade(g, cidade2);
-        idx2 = g->num_cidades - 1;
+
+    // Guarda no buffer de inserção; o CSR é reconstruído só na próxima leitura
+    if (g->num_pendentes >= g->capacidade_pendentes) {
+        int nova_capacidade;
+        if (g->capacidade_pendentes == 0) {
+            nova_capacidade = 64;
+        } else {
+            nova_capacidade = g->capacidade_pendentes * 2;
+        }
+
+        ArestaPendente* novas = (ArestaPendente*)realloc(g->pendentes,
+                                                         nova_capacidade * sizeof(ArestaPendente));
+        if (!novas) {
+            fprintf(stderr, "[ERRO GRAFO] Sem memória para adicionar aresta %s - %s\n", cidade1, cidade2);
+            return;
+        }
+        g->pendentes = novas;
+        g->capacidade_pendentes = nova_capacidade;
     }
 
-    // Grafo não-direcionado (bidirecional)
-    g->cidades[idx1].adjacencias[idx2] = distancia;
-    g->cidades[idx2].adjacencias[idx1] = distancia;
+    // Grafo não-direcionado (bidirecional): a compactação gera os dois sentidos
+    ArestaPendente* aresta = &g->pendentes[g->num_pendentes++];
+    aresta->origem = idx1;
+    aresta->destino = idx2;
+    aresta->distancia = distancia;
+
+    unir_componentes(g, idx1, idx2);
+    g->astar_verificado = 0;
+    registrar_mutacao(g, MUTACAO_ARESTA, idx1, idx2, distancia);
 }
 
-// Algoritmo de Dijkstra para encontrar o menor caminho
-char* calcular_menor_caminho(Grafo* g, const char* origem, const char* destino) {
-    time_t inicio, fim;
+// Incorpora o buffer de inserção ao CSR
+// Arestas repetidas ficam com a distância inserida por último
+void grafo_compactar(Grafo* g) {
+    if (!g) return;
+    if (g->num_pendentes == 0 && g->csr_num_cidades == g->num_cidades) return;
+
+    int n = g->num_cidades;
+    int total = g->csr_num_entradas + 2 * g->num_pendentes;
+
+    int* inicio = (int*)calloc(n + 1, sizeof(int));
+    int* cursor = (int*)malloc((n + 1) * sizeof(int));
+    int* destino = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    int* peso = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    int* marca = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    int* posicao = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+
+    if (!inicio || !cursor || !destino || !peso || !marca || !posicao) {
+        fprintf(stderr, "[ERRO GRAFO] Sem memória para compactar o grafo\n");
+        free(inicio); free(cursor); free(destino); free(peso); free(marca); free(posicao);
+        return;
+    }
 
-    if (!g || !origem || !destino) {
-        return strdup("❌ Erro: parâmetros inválidos");
+    // Conta quantas entradas cada cidade terá
+    for (int u = 0; u < g->csr_num_cidades; u++) {
+        inicio[u + 1] += g->csr_inicio[u + 1] - g->csr_inicio[u];
+    }
+    for (int i = 0; i < g->num_pendentes; i++) {
+        inicio[g->pendentes[i].origem + 1]++;
+        inicio[g->pendentes[i].destino + 1]++;
+    }
+    for (int u = 0; u < n; u++) {
+        inicio[u + 1] += inicio[u];
+    }
+    memcpy(cursor, inicio, (n + 1) * sizeof(int));
+
+    // Distribui: primeiro o CSR antigo, depois os pendentes em ordem de inserção
+    for (int u = 0; u < g->csr_num_cidades; u++) {
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            destino[cursor[u]] = g->csr_destino[e];
+            peso[cursor[u]] = g->csr_peso[e];
+            cursor[u]++;
+        }
+    }
+    for (int i = 0; i < g->num_pendentes; i++) {
+        ArestaPendente* a = &g->pendentes[i];
+        destino[cursor[a->origem]] = a->destino;
+        peso[cursor[a->origem]] = a->distancia;
+        cursor[a->origem]++;
+        destino[cursor[a->destino]] = a->origem;
+        peso[cursor[a->destino]] = a->distancia;
+        cursor[a->destino]++;
     }
 
-    int idx_origem = encontrar_cidade(g, origem);
-    int idx_destino = encontrar_cidade(g, destino);
+    // Remove duplicatas no próprio vetor (a última ocorrência vence)
+    for (int v = 0; v < n; v++) marca[v] = -1;
+    int escrita = 0;
+    for (int u = 0; u < n; u++) {
+        int seg_inicio = inicio[u];
+        int seg_fim = inicio[u + 1];
+        inicio[u] = escrita;
+        for (int e = seg_inicio; e < seg_fim; e++) {
+            int v = destino[e];
+            if (marca[v] == u) {
+                peso[posicao[v]] = peso[e];
+            } else {
+                marca[v] = u;
+                posicao[v] = escrita;
+                destino[escrita] = v;
+                peso[escrita] = peso[e];
+                escrita++;
+            }
+        }
+    }
+    inicio[n] = escrita;
+
+    free(cursor);
+    free(marca);
+    free(posicao);
+    free(g->csr_inicio);
+    free(g->csr_destino);
+    free(g->csr_peso);
+
+    g->csr_inicio = inicio;
+    g->csr_destino = destino;
+    g->csr_peso = peso;
+    g->csr_num_cidades = n;
+    g->csr_num_entradas = escrita;
+    g->num_pendentes = 0;
+}
 
-    if (idx_origem == -1 || idx_destino == -1) {
-        char* msg = (char*)malloc(512);
-        snprintf(msg, 512,
-            "❌ <b>Cidade não encontrada no grafo</b><br><br>"
-            "Cidades disponíveis no grafo: use o comando <b>grafocidades</b>");
-        return msg;
+// Distância direta entre duas cidades (-1 = sem conexão)
+int grafo_distancia(Grafo* g, int idx1, int idx2) {
+    if (!g || idx1 < 0 || idx2 < 0) return -1;
+
+    // Inserções recentes têm prioridade sobre o CSR
+    for (int i = g->num_pendentes - 1; i >= 0; i--) {
+        ArestaPendente* a = &g->pendentes[i];
+        if ((a->origem == idx1 && a->destino == idx2) ||
+            (a->origem == idx2 && a->destino == idx1)) {
+            return a->distancia;
+        }
+    }
+
+    if (idx1 < g->csr_num_cidades) {
+        for (int e = g->csr_inicio[idx1]; e < g->csr_inicio[idx1 + 1]; e++) {
+            if (g->csr_destino[e] == idx2) return g->csr_peso[e];
+        }
     }
+    return -1;
+}
 
-    // Arrays para o algoritmo de Dijkstra
-    int dist[MAX_CIDADES];
-    int anterior[MAX_CIDADES];
-    int visitado[MAX_CIDADES] = {0};
+// Número de conexões de uma cidade
+int grafo_grau(Grafo* g, int idx) {
+    if (!g || idx < 0 || idx >= g->num_cidades) return 0;
+    grafo_compactar(g);
+    return g->csr_inicio[idx + 1] - g->csr_inicio[idx];
+}
 
-    // Inicializa distâncias
-    for (int i = 0; i < g->num_cidades; i++) {
-        dist[i] = INT_MAX;
-        anterior[i] = -1;
+// Número de conexões (não-direcionadas) do grafo
+int grafo_num_conexoes(Grafo* g) {
+    if (!g) return 0;
+    grafo_compactar(g);
+
+    int total = 0;
+    for (int u = 0; u < g->num_cidades; u++) {
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            if (u < g->csr_destino[e]) total++;
+        }
+    }
+    return total;
+}
+
+// ===== MOTOR DE MENOR CAMINHO =====
+
+// Garante memória de trabalho para todas as cidades e abre uma nova época
+static int busca_preparar(Grafo* g) {
+    EspacoBusca* b = &g->busca;
+
+    if (b->capacidade < g->num_cidades) {
+        int nova_capacidade = b->capacidade > 0 ? b->capacidade : 64;
+        while (nova_capacidade < g->num_cidades) nova_capacidade *= 2;
+
+        int* dist = (int*)realloc(b->dist, nova_capacidade * sizeof(int));
+        if (dist) b->dist = dist;
+        int* anterior = (int*)realloc(b->anterior, nova_capacidade * sizeof(int));
+        if (anterior) b->anterior = anterior;
+        int* chave = (int*)realloc(b->chave, nova_capacidade * sizeof(int));
+        if (chave) b->chave = chave;
+        int* estimativa = (int*)realloc(b->estimativa, nova_capacidade * sizeof(int));
+        if (estimativa) b->estimativa = estimativa;
+        int* heap = (int*)realloc(b->heap, nova_capacidade * sizeof(int));
+        if (heap) b->heap = heap;
+        int* posicao = (int*)realloc(b->posicao, nova_capacidade * sizeof(int));
+        if (posicao) b->posicao = posicao;
+        unsigned int* epoca = (unsigned int*)realloc(b->epoca, nova_capacidade * sizeof(unsigned int));
+        if (epoca) b->epoca = epoca;
+
+        if (!dist || !anterior || !chave || !estimativa || !heap || !posicao || !epoca) {
+            fprintf(stderr, "[ERRO GRAFO] Sem memória para a busca de menor caminho\n");
+            return 0;
+        }
+
+        // Entradas novas começam numa época já encerrada
+        memset(b->epoca + b->capacidade, 0, (nova_capacidade - b->capacidade) * sizeof(unsigned int));
+        b->capacidade = nova_capacidade;
+    }
+
+    b->epoca_atual++;
+    if (b->epoca_atual == 0) {
+        // Contador deu a volta: invalida tudo explicitamente uma única vez
+        memset(b->epoca, 0, b->capacidade * sizeof(unsigned int));
+        b->epoca_atual = 1;
     }
-    dist[idx_origem] = 0;
+    b->tamanho_heap = 0;
+    return 1;
+}
 
-    // Inicia medição de tempo do Dijkstra (Matriz de Adjacência) - Alta Precisão
-    // double tempo_inicio = obter_tempo_ms();
-    time(&inicio);
+// Distância em linha reta entre duas coordenadas (fórmula de haversine), em km
+static double distancia_haversine(double lat1, double lon1, double lat2, double lon2) {
+    double rad = M_PI / 180.0;
+    double dlat = (lat2 - lat1) * rad;
+    double dlon = (lon2 - lon1) * rad;
+    double a = sin(dlat / 2) * sin(dlat / 2) +
+               cos(lat1 * rad) * cos(lat2 * rad) * sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * RAIO_TERRA_KM * asin(sqrt(a));
+}
 
-    // Algoritmo de Dijkstra
-    for (int count = 0; count < g->num_cidades - 1; count++) {
-        int min_dist = INT_MAX;
-        int u = -1;
+// Estimativa (km) da cidade v até o alvo: GRAFO_ASTAR_FATOR x linha reta, 0 sem coordenadas.
+// Só é limite inferior se heuristica_admissivel(g) confirmou as arestas
+static int estimar_distancia(Grafo* g, int v, int alvo) {
+    if (alvo < 0 || !g->cidades[v].coords_validas) return 0;
 
-        // Encontra o vértice não visitado com menor distância
-        for (int v = 0; v < g->num_cidades; v++) {
-            if (!visitado[v] && dist[v] < min_dist) {
-                min_dist = dist[v];
-                u = v;
+    return (int)(GRAFO_ASTAR_FATOR * distancia_haversine(g->cidades[v].latitude, g->cidades[v].longitude,
+                                                         g->cidades[alvo].latitude, g->cidades[alvo].longitude));
+}
+
+// Distâncias e coordenadas vêm da IA, então a linha reta não é um limite
+// inferior garantido. A estimativa só é consistente (e o A* exato) se toda
+// aresta medir pelo menos GRAFO_ASTAR_FATOR x a linha reta entre as pontas e as
+// duas pontas tiverem coordenadas. A contagem é refeita uma vez depois de
+// mudarem arestas ou coordenadas; com alguma violação as rotas usam Dijkstra
+static int heuristica_admissivel(Grafo* g) {
+    if (g->astar_verificado) return g->astar_violacoes == 0;
+
+    grafo_compactar(g);
+    int curtas = 0;
+    int sem_coordenadas = 0;
+    for (int u = 0; u < g->csr_num_cidades; u++) {
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            int v = g->csr_destino[e];
+            if (v < u) continue;
+            if (!g->cidades[u].coords_validas || !g->cidades[v].coords_validas) {
+                sem_coordenadas++;
+            } else if (g->csr_peso[e] < GRAFO_ASTAR_FATOR *
+                       distancia_haversine(g->cidades[u].latitude, g->cidades[u].longitude,
+                                           g->cidades[v].latitude, g->cidades[v].longitude)) {
+                curtas++;
             }
         }
+    }
+
+    g->astar_violacoes = curtas + sem_coordenadas;
+    g->astar_verificado = 1;
+    if (g->astar_violacoes > 0) {
+        fprintf(stderr, "[AVISO GRAFO] A* desativado: %d conexões mais curtas que %.0f%% da linha reta "
+                "e %d sem coordenadas; rotas por Dijkstra\n", curtas, GRAFO_ASTAR_FATOR * 100.0, sem_coordenadas);
+    }
+    return g->astar_violacoes == 0;
+}
+
+// Inicializa preguiçosamente a entrada de uma cidade na época atual
+static inline void busca_tocar(Grafo* g, EspacoBusca* b, int v, int alvo) {
+    if (b->epoca[v] != b->epoca_atual) {
+        b->epoca[v] = b->epoca_atual;
+        b->dist[v] = INT_MAX;
+        b->anterior[v] = -1;
+        b->posicao[v] = -1;
+        b->estimativa[v] = estimar_distancia(g, v, alvo);
+    }
+}
+
+static inline void heap_trocar(EspacoBusca* b, int i, int j) {
+    int vi = b->heap[i];
+    int vj = b->heap[j];
+    b->heap[i] = vj;
+    b->heap[j] = vi;
+    b->posicao[vj] = i;
+    b->posicao[vi] = j;
+}
 
-        if (u == -1) break;
-        visitado[u] = 1;
+static void heap_subir(EspacoBusca* b, int i) {
+    while (i > 0) {
+        int pai = (i - 1) / 2;
+        if (b->chave[b->heap[pai]] <= b->chave[b->heap[i]]) break;
+        heap_trocar(b, i, pai);
+        i = pai;
+    }
+}
+
+static void heap_descer(EspacoBusca* b, int i) {
+    for (;;) {
+        int menor = i;
+        int esq = 2 * i + 1;
+        int dir = esq + 1;
+        if (esq < b->tamanho_heap && b->chave[b->heap[esq]] < b->chave[b->heap[menor]]) menor = esq;
+        if (dir < b->tamanho_heap && b->chave[b->heap[dir]] < b->chave[b->heap[menor]]) menor = dir;
+        if (menor == i) break;
+        heap_trocar(b, i, menor);
+        i = menor;
+    }
+}
+
+// Insere a cidade no heap ou reposiciona após diminuir sua distância
+static void heap_inserir_ou_diminuir(EspacoBusca* b, int v) {
+    b->chave[v] = b->dist[v] + b->estimativa[v];
+    if (b->posicao[v] == -1) {
+        b->heap[b->tamanho_heap] = v;
+        b->posicao[v] = b->tamanho_heap;
+        b->tamanho_heap++;
+    }
+    heap_subir(b, b->posicao[v]);
+}
+
+static int heap_remover_min(EspacoBusca* b) {
+    int v = b->heap[0];
+    b->tamanho_heap--;
+    if (b->tamanho_heap > 0) {
+        b->heap[0] = b->heap[b->tamanho_heap];
+        b->posicao[b->heap[0]] = 0;
+        heap_descer(b, 0);
+    }
+    b->posicao[v] = -1;
+    return v;
+}
+
+// Busca com heap binário indexado sobre o CSR. Com alvo_heuristica >= 0 é A*
+// (prioridade = dist + estimativa até o alvo); com -1 é Dijkstra puro.
+// Cidades já fechadas podem ser reabertas se aparecer caminho mais curto, o
+// que mantém o resultado exato com estimativas admissíveis (o chamador garante).
+static int buscar_caminho(Grafo* g, int origem, int destino, int alvo_heuristica,
+                          ResultadoCaminho* resultado) {
+    if (!resultado) return 0;
+    memset(resultado, 0, sizeof(ResultadoCaminho));
+    if (!g || origem < 0 || destino < 0 || origem >= g->num_cidades || destino >= g->num_cidades) {
+        return 0;
+    }
+
+    grafo_compactar(g);
+    if (!busca_preparar(g)) return 0;
+
+    double tempo_inicio = obter_tempo_ms();
+    EspacoBusca* b = &g->busca;
+
+    resultado->algoritmo = alvo_heuristica >= 0 ? "A*" : "Dijkstra";
+
+    busca_tocar(g, b, origem, alvo_heuristica);
+    b->dist[origem] = 0;
+    heap_inserir_ou_diminuir(b, origem);
+
+    while (b->tamanho_heap > 0) {
+        int u = heap_remover_min(b);
+        resultado->nos_visitados++;
+
+        // Parada antecipada: o destino já tem distância definitiva
+        if (u == destino) break;
 
         // Atualiza distâncias dos vizinhos
-        for (int v = 0; v < g->num_cidades; v++) {
-            if (!visitado[v] && g->cidades[u].adjacencias[v] != -1) {
-                int nova_dist = dist[u] + g->cidades[u].adjacencias[v];
-                if (nova_dist < dist[v]) {
-                    dist[v] = nova_dist;
-                    anterior[v] = u;
-                }
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            int v = g->csr_destino[e];
+            busca_tocar(g, b, v, alvo_heuristica);
+            int nova_dist = b->dist[u] + g->csr_peso[e];
+            if (nova_dist < b->dist[v]) {
+                b->dist[v] = nova_dist;
+                b->anterior[v] = u;
+                heap_inserir_ou_diminuir(b, v);
             }
         }
     }
 
-    // Finaliza medição de tempo do Dijkstra
-    //double tempo_fim = obter_tempo_ms();
+    resultado->tempo_ms = obter_tempo_ms() - tempo_inicio;
 
-    time(&fim);
+    busca_tocar(g, b, destino, alvo_heuristica);
+    if (b->dist[destino] == INT_MAX) return 0;
 
-    // Calcula tempo de execução
-    long double tempo_execucao = difftime(fim,inicio);
-    fprintf(stderr, "[PERFORMANCE] Dijkstra (Matriz de Adjacência) - Tempo: %.6Lf ms | Cidades: %d\n",
-            tempo_execucao, g->num_cidades);
+    // Reconstrói o caminho (destino -> origem) e inverte
+    int tamanho = 0;
+    for (int v = destino; v != -1; v = b->anterior[v]) tamanho++;
 
-    // Verifica se encontrou caminho
-    if (dist[idx_destino] == INT_MAX) {
-        return strdup("❌ <b>Não há caminho entre as cidades</b><br>"
-                     "As cidades não estão conectadas no grafo.");
+    resultado->caminho = (int*)malloc(tamanho * sizeof(int));
+    if (!resultado->caminho) return 0;
+
+    int pos = tamanho - 1;
+    for (int v = destino; v != -1; v = b->anterior[v]) {
+        resultado->caminho[pos--] = v;
     }
 
-    // Reconstrói o caminho
-    int path[MAX_CIDADES];
-    int path_size = 0;
+    resultado->tamanho_caminho = tamanho;
+    resultado->distancia_total = b->dist[destino];
+    resultado->encontrado = 1;
+    return 1;
+}
+
+// Dijkstra: retorna 1 se há caminho; o chamador libera com liberar_resultado_caminho
+int grafo_menor_caminho(Grafo* g, int origem, int destino, ResultadoCaminho* resultado) {
+    return buscar_caminho(g, origem, destino, -1, resultado);
+}
 
-    // Percorre do destino até a origem
-    for (int v = idx_destino; v != -1; v = anterior[v]) {
-        path[path_size++] = v;
+// A*: só aplica a heurística quando o destino tem coordenadas e as arestas
+// do grafo a mantêm admissível (ver heuristica_admissivel)
+int grafo_menor_caminho_astar(Grafo* g, int origem, int destino, ResultadoCaminho* resultado) {
+    int alvo = -1;
+    if (g && destino >= 0 && destino < g->num_cidades && g->cidades[destino].coords_validas &&
+        heuristica_admissivel(g)) {
+        alvo = destino;
     }
+    return buscar_caminho(g, origem, destino, alvo, resultado);
+}
 
-    // Monta a string do caminho com detalhes de cada trecho
-    char caminho_visual[2048] = "";
-    char detalhes_trechos[2048] = "";
+int grafo_menor_caminho_ch(Grafo* g, int origem, int destino, ResultadoCaminho* resultado) {
+    if (!resultado) return 0;
+    memset(resultado, 0, sizeof(ResultadoCaminho));
+    if (!g) return 0;
+
+    if (!g->ch) {
+        double inicio_construcao = obter_tempo_ms();
+        g->ch = ch_construir(g);
+        if (!g->ch) return grafo_menor_caminho(g, origem, destino, resultado);
 
-    // Percorre caminho de trás para frente (origem -> destino)
-    for (int i = path_size - 1; i >= 0; i--) {
-        strcat(caminho_visual, g->cidades[path[i]].nome);
+        fprintf(stderr, "[PERFORMANCE] Hierarquia de contração construída - Tempo: %.3f ms | Cidades: %d | Arestas ascendentes: %d\n",
+                obter_tempo_ms() - inicio_construcao, g->ch->num_cidades, g->ch->num_arestas);
+    }
 
-        if (i > 0) {
-            strcat(caminho_visual, " → ");
+    double tempo_inicio = obter_tempo_ms();
+    int encontrado = ch_consultar(g->ch, origem, destino, resultado);
+    resultado->tempo_ms = obter_tempo_ms() - tempo_inicio;
+    resultado->algoritmo = "CH";
+    return encontrado;
+}
+
+void liberar_resultado_caminho(ResultadoCaminho* resultado) {
+    if (!resultado) return;
+    free(resultado->caminho);
+    resultado->caminho = NULL;
+    resultado->tamanho_caminho = 0;
+}
+
+// Calcula a rota com o motor configurado e registra o desempenho
+static int calcular_rota(Grafo* g, int origem, int destino, ResultadoCaminho* rota, const char* contexto) {
+    int encontrado;
+    if (GRAFO_USAR_CH && g->num_cidades >= GRAFO_CH_MIN_CIDADES) {
+        encontrado = grafo_menor_caminho_ch(g, origem, destino, rota);
+    } else if (GRAFO_USAR_ASTAR) {
+        encontrado = grafo_menor_caminho_astar(g, origem, destino, rota);
+    } else {
+        encontrado = grafo_menor_caminho(g, origem, destino, rota);
+    }
+
+    double fracao = g->num_cidades > 0 ? 100.0 * rota->nos_visitados / g->num_cidades : 0.0;
+    fprintf(stderr, "[PERFORMANCE] %s (%s) - Tempo: %.6f ms | Cidades: %d | Nós visitados: %d (%.1f%% do grafo)\n",
+            contexto, rota->algoritmo ? rota->algoritmo : "Dijkstra",
+            rota->tempo_ms, g->num_cidades, rota->nos_visitados, fracao);
+    return encontrado;
+}
+
+// Entrega o HTML montado (ou uma mensagem de erro se faltou memória)
+static char* finalizar_html(StrBuilder* sb) {
+    char* resultado = sb_finalizar(sb);
+    if (!resultado) return strdup("❌ Erro: memória insuficiente para montar a resposta");
+    return resultado;
+}
+
+// Monta a rota visual e os detalhes de cada trecho de um caminho
+static void formatar_trechos(Grafo* g, const ResultadoCaminho* r,
+                             StrBuilder* caminho_visual, StrBuilder* detalhes_trechos) {
+    for (int i = 0; i < r->tamanho_caminho; i++) {
+        sb_anexar(caminho_visual, g->cidades[r->caminho[i]].nome);
+
+        if (i < r->tamanho_caminho - 1) {
+            sb_anexar(caminho_visual, " → ");
 
             // Adiciona detalhes do trecho
-            int cidade_atual = path[i];
-            int proxima_cidade = path[i-1];
-            int dist_trecho = g->cidades[cidade_atual].adjacencias[proxima_cidade];
+            int cidade_atual = r->caminho[i];
+            int proxima_cidade = r->caminho[i + 1];
+            int dist_trecho = grafo_distancia(g, cidade_atual, proxima_cidade);
 
-            char linha_trecho[256];
-            snprintf(linha_trecho, sizeof(linha_trecho),
+            sb_formatar(detalhes_trechos,
                 "  • %s → %s: <b>%d km</b><br>",
                 g->cidades[cidade_atual].nome,
                 g->cidades[proxima_cidade].nome,
                 dist_trecho);
-            strcat(detalhes_trechos, linha_trecho);
         }
     }
+}
+
+// Menor caminho em HTML (apenas texto)
+char* calcular_menor_caminho(Grafo* g, const char* origem, const char* destino) {
+    if (!g || !origem || !destino) {
+        return strdup("❌ Erro: parâmetros inválidos");
+    }
+
+    int idx_origem = encontrar_cidade(g, origem);
+    int idx_destino = encontrar_cidade(g, destino);
+
+    if (idx_origem == -1 || idx_destino == -1) {
+        return strdup("❌ <b>Cidade não encontrada no grafo</b><br><br>"
+                     "Cidades disponíveis no grafo: use o comando <b>grafocidades</b>");
+    }
+
+    ResultadoCaminho rota;
+    int encontrado = calcular_rota(g, idx_origem, idx_destino, &rota, "Menor Caminho");
+
+    // Verifica se encontrou caminho
+    if (!encontrado) {
+        return strdup("❌ <b>Não há caminho entre as cidades</b><br>"
+                     "As cidades não estão conectadas no grafo.");
+    }
+
+    // Monta a string do caminho com detalhes de cada trecho
+    StrBuilder caminho_visual, detalhes_trechos;
+    sb_iniciar(&caminho_visual, 512);
+    sb_iniciar(&detalhes_trechos, 1024);
+    formatar_trechos(g, &rota, &caminho_visual, &detalhes_trechos);
 
     // Monta o resultado formatado
-    char* resultado = (char*)malloc(6144);
-    snprintf(resultado, 6144,
+    StrBuilder resultado;
+    sb_iniciar(&resultado, caminho_visual.tamanho + detalhes_trechos.tamanho + 1024);
+    sb_formatar(&resultado,
         "🗺️ <b>Menor Caminho Encontrado (Dijkstra):</b><br><br>"
         "📍 <b>Origem:</b> %s<br>"
         "🎯 <b>Destino:</b> %s<br>"
         "🏙️ <b>Cidades no percurso:</b> %d<br><br>"
         "🛣️ <b>Rota Visual:</b><br>"
-        "<div style='background: #f5f5f5; padding: 10px; border-radius: 5px; margin: 10px 0;'>"
-        "%s"
+        "<div style='background: #f5f5f5; padding: 10px; border-radius: 5px; margin: 10px 0;'>",
+        g->cidades[idx_origem].nome,
+        g->cidades[idx_destino].nome,
+        rota.tamanho_caminho);
+    sb_anexar_n(&resultado, caminho_visual.dados, caminho_visual.tamanho);
+    sb_anexar(&resultado,
         "</div><br>"
         "📊 <b>Detalhes dos Trechos:</b><br>"
-        "<div style='background: #fff3cd; padding: 10px; border-radius: 5px; margin: 10px 0;'>"
-        "%s"
+        "<div style='background: #fff3cd; padding: 10px; border-radius: 5px; margin: 10px 0;'>");
+    sb_anexar_n(&resultado, detalhes_trechos.dados, detalhes_trechos.tamanho);
+    sb_formatar(&resultado,
         "</div>"
         "📏 <b>Distância Total:</b> <span style='color: #4CAF50; font-size: 1.3em;'><b>%d km</b></span><br><br>"
         "💡 <i>Calculado usando o algoritmo de Dijkstra (menor caminho garantido)</i>",
-        g->cidades[idx_origem].nome,
-        g->cidades[idx_destino].nome,
-        path_size,
-        caminho_visual,
-        detalhes_trechos,
-        dist[idx_destino]);
+        rota.distancia_total);
 
-    return resultado;
+    sb_liberar(&caminho_visual);
+    sb_liberar(&detalhes_trechos);
+    liberar_resultado_caminho(&rota);
+    return finalizar_html(&resultado);
 }
 
 char* listar_cidades_grafo(Grafo* g) {
@@ -255,19 +838,13 @@ char* listar_cidades_grafo(Grafo* g) {
                      "Use: <b>grafo Cidade1-Cidade2</b> para começar!");
     }
 
-    char* resultado = (char*)malloc(16384);
+    StrBuilder resultado;
+    sb_iniciar(&resultado, 4096);
 
     // Conta o total de conexões
-    int total_conexoes = 0;
-    for (int i = 0; i < g->num_cidades; i++) {
-        for (int j = i + 1; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) {
-                total_conexoes++;
-            }
-        }
-    }
+    int total_conexoes = grafo_num_conexoes(g);
 
-    snprintf(resultado, 16384,
+    sb_formatar(&resultado,
         "🗺️ <b>Malha de Rotas (Grafo):</b><br><br>"
         "📊 <b>Estatísticas:</b><br>"
         "🏙️ Cidades: <b>%d</b><br>"
@@ -277,46 +854,88 @@ char* listar_cidades_grafo(Grafo* g) {
         g->num_cidades, total_conexoes);
 
     for (int i = 0; i < g->num_cidades; i++) {
-        char linha[2048];
-
         // Conta conexões desta cidade
-        int num_conexoes = 0;
-        for (int j = 0; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) {
-                num_conexoes++;
-            }
-        }
+        int num_conexoes = grafo_grau(g, i);
 
-        snprintf(linha, sizeof(linha),
+        sb_formatar(&resultado,
             "<b>%d. %s</b> <span style='color: #666;'>(%d conexões)</span><br>",
             i + 1, g->cidades[i].nome, num_conexoes);
-        strcat(resultado, linha);
 
         // Lista conexões com formatação melhor
         if (num_conexoes > 0) {
-            strcat(resultado, "<div style='margin-left: 20px; color: #555;'>");
-            int conexoes_listadas = 0;
-            for (int j = 0; j < g->num_cidades; j++) {
-                if (g->cidades[i].adjacencias[j] != -1) {
-                    char temp[256];
-                    snprintf(temp, sizeof(temp),
-                        "  → %s <span style='color: #4CAF50;'><b>%d km</b></span><br>",
-                        g->cidades[j].nome, g->cidades[i].adjacencias[j]);
-                    strcat(resultado, temp);
-                    conexoes_listadas++;
-                }
+            sb_anexar(&resultado, "<div style='margin-left: 20px; color: #555;'>");
+            for (int e = g->csr_inicio[i]; e < g->csr_inicio[i + 1]; e++) {
+                sb_formatar(&resultado,
+                    "  → %s <span style='color: #4CAF50;'><b>%d km</b></span><br>",
+                    g->cidades[g->csr_destino[e]].nome, g->csr_peso[e]);
             }
-            strcat(resultado, "</div>");
+            sb_anexar(&resultado, "</div>");
         }
-        strcat(resultado, "<br>");
+        sb_anexar(&resultado, "<br>");
     }
 
-    strcat(resultado,
+    sb_anexar(&resultado,
         "</div><br>"
         "💡 <b>Dica:</b> Use <b>grafo origem-destino</b> para calcular o menor caminho<br>"
         "📖 <b>Exemplo:</b> grafo São Paulo-Rio de Janeiro");
 
-    return resultado;
+    return finalizar_html(&resultado);
+}
+
+// Geocodifica em lote as cidades (indices, ou as num_indices primeiras se
+// indices for NULL) que ainda não têm coordenadas. Chamar com o grafo travado:
+// os nomes são copiados, a trava é solta durante a consulta à IA e retomada só
+// para aplicar o resultado, pelo nome (o grafo pode ter mudado nesse meio
+// tempo). Retorna quantas cidades foram atualizadas
+static int geocodificar_cidades(Grafo* g, const int* indices, int num_indices, const char* contexto) {
+    char (*cidades_sem_coords)[100] = malloc((num_indices > 0 ? num_indices : 1) * sizeof(*cidades_sem_coords));
+    if (!cidades_sem_coords) return 0;
+
+    int num_sem_coords = 0;
+    for (int i = 0; i < num_indices; i++) {
+        int idx = indices ? indices[i] : i;
+        if (!g->cidades[idx].coords_validas) {
+            strncpy(cidades_sem_coords[num_sem_coords], g->cidades[idx].nome, 99);
+            cidades_sem_coords[num_sem_coords][99] = '\0';
+            num_sem_coords++;
+        }
+    }
+    if (num_sem_coords == 0) {
+        free(cidades_sem_coords);
+        return 0;
+    }
+
+    double* latitudes = (double*)calloc(num_sem_coords, sizeof(double));
+    double* longitudes = (double*)calloc(num_sem_coords, sizeof(double));
+    int encontradas = 0;
+
+    // As demais chamadas (rotas, mapa, estatísticas) seguem durante a consulta
+    grafo_destravar(g);
+    if (latitudes && longitudes) {
+        fprintf(stderr, "[DEBUG %s] Buscando coordenadas de %d cidades em LOTE\n", contexto, num_sem_coords);
+        encontradas = obter_coordenadas_multiplas(cidades_sem_coords, num_sem_coords, latitudes, longitudes);
+    }
+    grafo_travar(g);
+
+    int aplicadas = 0;
+    for (int i = 0; encontradas > 0 && i < num_sem_coords; i++) {
+        if (latitudes[i] == 0.0 && longitudes[i] == 0.0) continue;
+
+        int idx = encontrar_cidade(g, cidades_sem_coords[i]);
+        if (idx != -1 && !g->cidades[idx].coords_validas) {
+            grafo_definir_coordenadas(g, idx, latitudes[i], longitudes[i]);
+            aplicadas++;
+        }
+    }
+    if (aplicadas > 0) {
+        fprintf(stderr, "[DEBUG %s] ✓ Coordenadas de %d cidades obtidas com sucesso!\n", contexto, aplicadas);
+        salvar_coordenadas_grafo(g, "coordenadas_grafo.txt");
+    }
+
+    free(cidades_sem_coords);
+    free(latitudes);
+    free(longitudes);
+    return aplicadas;
 }
 
 // Gera um mapa interativo com OpenStreetMap/Leaflet
@@ -325,26 +944,27 @@ char* gerar_mapa_grafo(Grafo* g) {
         return strdup("📭 <b>Grafo vazio</b><br>Adicione cidades primeiro!");
     }
 
+    // Cidades sem coordenadas são buscadas em UMA ÚNICA requisição, com o grafo
+    // liberado; o mapa é montado depois, com o estado que o grafo tiver então
+    geocodificar_cidades(g, NULL, g->num_cidades, "MAPA");
+    if (g->num_cidades == 0) {
+        return strdup("📭 <b>Grafo vazio</b><br>Adicione cidades primeiro!");
+    }
+
     fprintf(stderr, "[DEBUG MAPA] Gerando mapa do grafo com %d cidades\n", g->num_cidades);
 
     // Gera HTML com mapa Leaflet
-    char* resultado = (char*)malloc(32768);
+    StrBuilder resultado;
+    sb_iniciar(&resultado, 4096);
 
     // Usa um ID único baseado em timestamp
     static int mapa_counter = 0;
     mapa_counter++;
 
     // Conta estatísticas do grafo
-    int total_conexoes = 0;
-    for (int i = 0; i < g->num_cidades; i++) {
-        for (int j = i + 1; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) {
-                total_conexoes++;
-            }
-        }
-    }
+    int total_conexoes = grafo_num_conexoes(g);
 
-    snprintf(resultado, 32768,
+    sb_formatar(&resultado,
         "🗺️ <b>Mapa Interativo das Rotas</b><br><br>"
         "📊 <b>Estatísticas da Malha Rodoviária:</b><br>"
         "🏙️ <b>Total de Cidades:</b> %d<br>"
@@ -373,388 +993,277 @@ char* gerar_mapa_grafo(Grafo* g) {
         "    var allMarkers = [];"
         , g->num_cidades, total_conexoes, mapa_counter, mapa_counter, mapa_counter, mapa_counter, mapa_counter, mapa_counter, mapa_counter);
 
-    // OTIMIZAÇÃO: Obtém todas as coordenadas em UMA ÚNICA requisição
-    // Nota: Coordenadas já foram carregadas no início do programa
-    fprintf(stderr, "[DEBUG MAPA] Verificando coordenadas para %d cidades\n", g->num_cidades);
-
-    // Identifica quais cidades precisam de coordenadas
-    char cidades_sem_coords[MAX_CIDADES][100];
-    int indices_sem_coords[MAX_CIDADES];
-    int num_sem_coords = 0;
-
-    for (int i = 0; i < g->num_cidades; i++) {
-        if (!g->cidades[i].coords_validas) {
-            strncpy(cidades_sem_coords[num_sem_coords], g->cidades[i].nome, 99);
-            cidades_sem_coords[num_sem_coords][99] = '\0';
-            indices_sem_coords[num_sem_coords] = i;
-            num_sem_coords++;
-        }
-    }
-
-    // Se há cidades sem coordenadas, busca TODAS de uma vez
-    if (num_sem_coords > 0) {
-        fprintf(stderr, "[DEBUG MAPA] Buscando coordenadas de %d cidades em LOTE\n", num_sem_coords);
-
-        double latitudes[MAX_CIDADES];
-        double longitudes[MAX_CIDADES];
-
-        int encontradas = obter_coordenadas_multiplas(cidades_sem_coords, num_sem_coords,
-                                                       latitudes, longitudes);
-
-        if (encontradas > 0) {
-            // Atualiza coordenadas no grafo
-            for (int i = 0; i < num_sem_coords; i++) {
-                if (latitudes[i] != 0.0 || longitudes[i] != 0.0) {
-                    int idx = indices_sem_coords[i];
-                    g->cidades[idx].latitude = latitudes[i];
-                    g->cidades[idx].longitude = longitudes[i];
-                    g->cidades[idx].coords_validas = 1;
-                }
-            }
-            fprintf(stderr, "[DEBUG MAPA] ✓ Coordenadas de %d cidades obtidas com sucesso!\n", encontradas);
-
-            // Salva as novas coordenadas no arquivo
-            salvar_coordenadas_grafo(g, "coordenadas_grafo.txt");
-        }
-    } else {
-        fprintf(stderr, "[DEBUG MAPA] Todas as cidades já têm coordenadas em cache\n");
-    }
-
     // Adiciona marcadores para cada cidade
     for (int i = 0; i < g->num_cidades; i++) {
         if (g->cidades[i].coords_validas) {
-            char marker_code[1024];
-
             // Conta conexões
-            int num_conexoes = 0;
-            for (int j = 0; j < g->num_cidades; j++) {
-                if (g->cidades[i].adjacencias[j] != -1) num_conexoes++;
-            }
+            int num_conexoes = grafo_grau(g, i);
 
-            snprintf(marker_code, sizeof(marker_code),
+            sb_formatar(&resultado,
                 "    var marker_%d = L.marker([%.4f, %.4f]).addTo(window.mapaGrafo_%d)"
                 ".bindPopup('<b>%s</b><br>%d conexões');"
                 "    allMarkers.push(marker_%d);"
                 , i, g->cidades[i].latitude, g->cidades[i].longitude, mapa_counter,
                 g->cidades[i].nome, num_conexoes, i);
-            strcat(resultado, marker_code);
         }
     }
 
     // Adiciona linhas conectando as cidades (usando coordenadas dinâmicas)
     for (int i = 0; i < g->num_cidades; i++) {
         if (g->cidades[i].coords_validas) {
-            for (int j = i + 1; j < g->num_cidades; j++) {
-                if (g->cidades[i].adjacencias[j] != -1 && g->cidades[j].coords_validas) {
-                    char line_code[512];
-                    snprintf(line_code, sizeof(line_code),
+            for (int e = g->csr_inicio[i]; e < g->csr_inicio[i + 1]; e++) {
+                int j = g->csr_destino[e];
+                if (i < j && g->cidades[j].coords_validas) {
+                    sb_formatar(&resultado,
                         "    L.polyline([[%.4f,%.4f],[%.4f,%.4f]], {color: '#2196F3', weight: 2, opacity: 0.7})"
                         ".addTo(window.mapaGrafo_%d).bindPopup('%s ↔ %s: %d km');"
                         , g->cidades[i].latitude, g->cidades[i].longitude,
                         g->cidades[j].latitude, g->cidades[j].longitude,
                         mapa_counter,
                         g->cidades[i].nome, g->cidades[j].nome,
-                        g->cidades[i].adjacencias[j]);
-                    strcat(resultado, line_code);
+                        g->csr_peso[e]);
                 }
             }
         }
     }
 
-    strcat(resultado, "    if (allMarkers.length > 0) {");
-    strcat(resultado, "      var group = new L.featureGroup(allMarkers);");
-    strcat(resultado, "      window.mapaGrafo_" );
-    char temp_counter[32];
-    snprintf(temp_counter, sizeof(temp_counter), "%d", mapa_counter);
-    strcat(resultado, temp_counter);
-    strcat(resultado, ".fitBounds(group.getBounds().pad(0.1));");
-    strcat(resultado, "    }");
-    strcat(resultado, "  } catch(e) { console.error('Erro ao criar mapa:', e); }");
-    strcat(resultado, "})();");
-    strcat(resultado, "</script>");
-    strcat(resultado, "<br>🗺️ <i>Mapa interativo com OpenStreetMap</i><br>");
-    strcat(resultado, "💡 Clique nos marcadores para ver detalhes");
+    sb_formatar(&resultado,
+        "    if (allMarkers.length > 0) {"
+        "      var group = new L.featureGroup(allMarkers);"
+        "      window.mapaGrafo_%d.fitBounds(group.getBounds().pad(0.1));"
+        "    }"
+        "  } catch(e) { console.error('Erro ao criar mapa:', e); }"
+        "})();"
+        "</script>"
+        "<br>🗺️ <i>Mapa interativo com OpenStreetMap</i><br>"
+        "💡 Clique nos marcadores para ver detalhes",
+        mapa_counter);
 
     fprintf(stderr, "[DEBUG MAPA] Mapa do grafo gerado com sucesso\n");
 
-    return resultado;
+    return finalizar_html(&resultado);
 }
 
-// Calcula menor caminho e mostra no mapa
-char* calcular_menor_caminho_com_mapa(Grafo* g, const char* origem, const char* destino) {
+// Resposta de erro no mesmo formato do resultado da rota
+static char* erro_rota_json(const char* mensagem) {
+    StrBuilder json;
+    sb_iniciar(&json, 128);
+    sb_anexar(&json, "{\"v\":1,\"erro\":");
+    sb_anexar_json_string(&json, mensagem);
+    sb_anexar(&json, "}");
+    return sb_finalizar(&json);
+}
+
+// Calcula o menor caminho e devolve os dados da rota em JSON para o renderizador da interface
+char* calcular_rota_json(Grafo* g, const char* origem, const char* destino) {
     if (!g || !origem || !destino) {
-        return strdup("❌ Erro: parâmetros inválidos");
+        return erro_rota_json("Parâmetros inválidos");
     }
 
     int idx_origem = encontrar_cidade(g, origem);
     int idx_destino = encontrar_cidade(g, destino);
 
     if (idx_origem == -1 || idx_destino == -1) {
-        return strdup("❌ <b>Cidade não encontrada no grafo</b>");
+        return erro_rota_json("Cidade não encontrada no grafo");
     }
 
-    // Primeiro calcula o caminho (Dijkstra)
-    int dist[MAX_CIDADES];
-    int anterior[MAX_CIDADES];
-    int visitado[MAX_CIDADES] = {0};
+    ResultadoCaminho rota;
+    int encontrado = calcular_rota(g, idx_origem, idx_destino, &rota, "Rota JSON");
 
-    for (int i = 0; i < g->num_cidades; i++) {
-        dist[i] = INT_MAX;
-        anterior[i] = -1;
+    if (!encontrado) {
+        return erro_rota_json("Não há caminho entre as cidades");
     }
-    dist[idx_origem] = 0;
 
-    // Inicia medição de tempo do Dijkstra (Matriz de Adjacência) - Alta Precisão
-    double tempo_inicio = obter_tempo_ms();
+    int faltando = 0;
+    for (int i = 0; i < rota.tamanho_caminho; i++) {
+        if (!g->cidades[rota.caminho[i]].coords_validas) faltando++;
+    }
 
-    // Dijkstra
-    for (int count = 0; count < g->num_cidades - 1; count++) {
-        int min_dist = INT_MAX;
-        int u = -1;
+    // Cidades do caminho sem coordenadas: geocodifica com o grafo liberado e
+    // recalcula a rota sobre o grafo como ele estiver ao retomar a trava
+    if (faltando > 0) {
+        geocodificar_cidades(g, rota.caminho, rota.tamanho_caminho, "MAPA ROTA");
+        liberar_resultado_caminho(&rota);
 
-        for (int v = 0; v < g->num_cidades; v++) {
-            if (!visitado[v] && dist[v] < min_dist) {
-                min_dist = dist[v];
-                u = v;
-            }
+        idx_origem = encontrar_cidade(g, origem);
+        idx_destino = encontrar_cidade(g, destino);
+        if (idx_origem == -1 || idx_destino == -1) {
+            return erro_rota_json("Cidade não encontrada no grafo");
         }
-
-        if (u == -1) break;
-        visitado[u] = 1;
-
-        for (int v = 0; v < g->num_cidades; v++) {
-            if (!visitado[v] && g->cidades[u].adjacencias[v] != -1) {
-                int nova_dist = dist[u] + g->cidades[u].adjacencias[v];
-                if (nova_dist < dist[v]) {
-                    dist[v] = nova_dist;
-                    anterior[v] = u;
-                }
-            }
+        if (!calcular_rota(g, idx_origem, idx_destino, &rota, "Rota JSON")) {
+            return erro_rota_json("Não há caminho entre as cidades");
         }
     }
 
-    // Finaliza medição de tempo do Dijkstra
-    double tempo_fim = obter_tempo_ms();
-    double tempo_execucao = tempo_fim - tempo_inicio; // em milissegundos
+    StrBuilder json;
+    sb_iniciar(&json, 256 + (size_t)rota.tamanho_caminho * 64);
 
-    fprintf(stderr, "[PERFORMANCE] Dijkstra com Mapa (Matriz de Adjacência) - Tempo: %.6f ms | Cidades: %d\n",
-            tempo_execucao, g->num_cidades);
+    sb_anexar(&json, "{\"v\":1,\"origem\":");
+    sb_anexar_json_string(&json, g->cidades[idx_origem].nome);
+    sb_anexar(&json, ",\"destino\":");
+    sb_anexar_json_string(&json, g->cidades[idx_destino].nome);
+    sb_anexar(&json, ",\"algoritmo\":");
+    sb_anexar_json_string(&json, rota.algoritmo ? rota.algoritmo : "Dijkstra");
+    sb_formatar(&json, ",\"distanciaTotal\":%d,\"cidades\":[", rota.distancia_total);
 
-    if (dist[idx_destino] == INT_MAX) {
-        return strdup("❌ <b>Não há caminho entre as cidades</b>");
+    for (int i = 0; i < rota.tamanho_caminho; i++) {
+        if (i > 0) sb_anexar(&json, ",");
+        sb_anexar_json_string(&json, g->cidades[rota.caminho[i]].nome);
     }
 
-    // Reconstrói o caminho
-    int path[MAX_CIDADES];
-    int path_size = 0;
-    for (int v = idx_destino; v != -1; v = anterior[v]) {
-        path[path_size++] = v;
+    sb_anexar(&json, "],\"caminho\":[");
+    for (int i = 0; i < rota.tamanho_caminho; i++) {
+        sb_formatar(&json, i > 0 ? ",%d" : "%d", rota.caminho[i]);
     }
 
-    // OTIMIZAÇÃO: Obtém coordenadas das cidades da rota em UMA ÚNICA requisição
-    // Nota: Coordenadas já foram carregadas no início do programa
-    char cidades_sem_coords[MAX_CIDADES][100];
-    int indices_sem_coords[MAX_CIDADES];
-    int num_sem_coords = 0;
-
-    for (int i = 0; i < path_size; i++) {
-        int idx = path[i];
-        if (!g->cidades[idx].coords_validas) {
-            strncpy(cidades_sem_coords[num_sem_coords], g->cidades[idx].nome, 99);
-            cidades_sem_coords[num_sem_coords][99] = '\0';
-            indices_sem_coords[num_sem_coords] = idx;
-            num_sem_coords++;
-        }
+    // Distância de cada trecho (caminho[i] -> caminho[i + 1])
+    sb_anexar(&json, "],\"trechos\":[");
+    for (int i = 0; i + 1 < rota.tamanho_caminho; i++) {
+        sb_formatar(&json, i > 0 ? ",%d" : "%d",
+                    grafo_distancia(g, rota.caminho[i], rota.caminho[i + 1]));
     }
 
-    if (num_sem_coords > 0) {
-        fprintf(stderr, "[DEBUG MAPA ROTA] Buscando coordenadas de %d cidades em LOTE\n", num_sem_coords);
-
-        double latitudes[MAX_CIDADES];
-        double longitudes[MAX_CIDADES];
-
-        int encontradas = obter_coordenadas_multiplas(cidades_sem_coords, num_sem_coords,
-                                                       latitudes, longitudes);
-
-        if (encontradas > 0) {
-            for (int i = 0; i < num_sem_coords; i++) {
-                if (latitudes[i] != 0.0 || longitudes[i] != 0.0) {
-                    int idx = indices_sem_coords[i];
-                    g->cidades[idx].latitude = latitudes[i];
-                    g->cidades[idx].longitude = longitudes[i];
-                    g->cidades[idx].coords_validas = 1;
-                }
-            }
-            fprintf(stderr, "[DEBUG MAPA ROTA] ✓ Coordenadas obtidas com sucesso!\n");
-
-            // Salva as novas coordenadas no arquivo
-            salvar_coordenadas_grafo(g, "coordenadas_grafo.txt");
+    // Coordenadas em inteiros (graus * escala), codificadas por diferença em
+    // relação ao ponto anterior; só entram as cidades que têm coordenadas
+    sb_formatar(&json, "],\"escala\":%d,\"comCoords\":[", ESCALA_COORDENADAS);
+    int primeiro = 1;
+    for (int i = 0; i < rota.tamanho_caminho; i++) {
+        if (g->cidades[rota.caminho[i]].coords_validas) {
+            sb_formatar(&json, primeiro ? "%d" : ",%d", i);
+            primeiro = 0;
         }
     }
 
-    // Monta resultado com mapa
-    char* resultado = (char*)malloc(32768);
-
-    // Calcula centro do mapa (usa coordenadas da origem ou Brasil central)
-    char centro_lat[32] = "-15.7939";
-    char centro_lng[32] = "-47.8828";
-
-    if (g->cidades[idx_origem].coords_validas) {
-        snprintf(centro_lat, sizeof(centro_lat), "%.4f", g->cidades[idx_origem].latitude);
-        snprintf(centro_lng, sizeof(centro_lng), "%.4f", g->cidades[idx_origem].longitude);
+    sb_anexar(&json, "],\"coords\":[");
+    long lat_anterior = 0;
+    long lng_anterior = 0;
+    primeiro = 1;
+    for (int i = 0; i < rota.tamanho_caminho; i++) {
+        Cidade* c = &g->cidades[rota.caminho[i]];
+        if (!c->coords_validas) continue;
+
+        long lat = lround(c->latitude * ESCALA_COORDENADAS);
+        long lng = lround(c->longitude * ESCALA_COORDENADAS);
+        sb_formatar(&json, primeiro ? "%ld,%ld" : ",%ld,%ld", lat - lat_anterior, lng - lng_anterior);
+        lat_anterior = lat;
+        lng_anterior = lng;
+        primeiro = 0;
     }
 
-    // Monta caminho visual
-    char caminho_visual[2048] = "";
-    char detalhes_trechos[2048] = "";
+    sb_formatar(&json, "],\"nosVisitados\":%d}", rota.nos_visitados);
 
-    for (int i = path_size - 1; i >= 0; i--) {
-        strcat(caminho_visual, g->cidades[path[i]].nome);
-        if (i > 0) {
-            strcat(caminho_visual, " → ");
-            int cidade_atual = path[i];
-            int proxima_cidade = path[i-1];
-            int dist_trecho = g->cidades[cidade_atual].adjacencias[proxima_cidade];
+    fprintf(stderr, "[DEBUG MAPA] Rota de %s para %s: %d cidades, %zu bytes de JSON\n",
+            origem, destino, rota.tamanho_caminho, json.tamanho);
 
-            char linha_trecho[256];
-            snprintf(linha_trecho, sizeof(linha_trecho),
-                "  • %s → %s: <b>%d km</b><br>",
-                g->cidades[cidade_atual].nome,
-                g->cidades[proxima_cidade].nome,
-                dist_trecho);
-            strcat(detalhes_trechos, linha_trecho);
-        }
-    }
+    liberar_resultado_caminho(&rota);
 
-    // ID único para o mapa
-    static int rota_counter = 0;
-    rota_counter++;
-
-    fprintf(stderr, "[DEBUG MAPA] Gerando mapa de rota de %s para %s\n", origem, destino);
-
-    snprintf(resultado, 32768,
-        "🗺️ <b>Menor Caminho Encontrado (Dijkstra):</b><br><br>"
-        "📍 <b>Origem:</b> %s<br>"
-        "🎯 <b>Destino:</b> %s<br>"
-        "🏙️ <b>Cidades no percurso:</b> %d<br>"
-        "📏 <b>Distância Total:</b> <span style='color: #4CAF50; font-size: 1.3em;'><b>%d km</b></span><br><br>"
-
-        "🗺️ <b>Mapa da Rota:</b><br>"
-        "<div id='mapa-rota-%d' style='width: 100%%; height: 500px; border: 2px solid #4CAF50; border-radius: 8px; margin: 10px 0;'></div>"
-        "<script>"
-        "(function() {"
-        "  console.log('Inicializando mapa de rota...');"
-        "  if (typeof L === 'undefined') {"
-        "    console.error('ERRO: Leaflet não está carregado!');"
-        "    document.getElementById('mapa-rota-%d').innerHTML = '<div style=\"padding: 20px; color: red; text-align: center;\">❌ Erro: Biblioteca de mapas não carregada. Recarregue a página.</div>';"
-        "    return;"
-        "  }"
-        "  try {"
-        "    if (typeof window.mapaRota_%d !== 'undefined') { window.mapaRota_%d.remove(); }"
-        "    window.mapaRota_%d = L.map('mapa-rota-%d').setView([%s, %s], 6);"
-        "    L.tileLayer('https://{s}.tile.openstreetmap.org/{z}/{x}/{y}.png', {"
-        "      attribution: '© OpenStreetMap',"
-        "      maxZoom: 18"
-        "    }).addTo(window.mapaRota_%d);"
-        "    console.log('Mapa de rota criado com sucesso!');"
-        , origem, destino, path_size, dist[idx_destino], rota_counter, rota_counter,
-          rota_counter, rota_counter, rota_counter, rota_counter, centro_lat, centro_lng, rota_counter);
-
-    // Adiciona marcadores e linha da rota (usando coordenadas dinâmicas)
-    char polyline_points[4096] = "[";
-
-    for (int i = path_size - 1; i >= 0; i--) {
-        int idx = path[i];
-
-        if (g->cidades[idx].coords_validas) {
-            // Adiciona ao polyline
-            char point[128];
-            const char* separator;
-            if (i < path_size - 1) {
-                separator = ",";
-            } else {
-                separator = "";
-            }
-            snprintf(point, sizeof(point), "%s[%.4f,%.4f]",
-                separator,
-                g->cidades[idx].latitude,
-                g->cidades[idx].longitude);
-            strcat(polyline_points, point);
-
-            // Adiciona marcador
-            char marker[512];
-            const char* label;
-            if (i == path_size - 1) {
-                label = "🚩 Origem";
-            } else if (i == 0) {
-                label = "🎯 Destino";
-            } else {
-                label = "📍";
-            }
-
-            snprintf(marker, sizeof(marker),
-                "    L.marker([%.4f,%.4f]).addTo(window.mapaRota_%d).bindPopup('<b>%s</b><br>%s');"
-                , g->cidades[idx].latitude, g->cidades[idx].longitude,
-                rota_counter, g->cidades[idx].nome, label);
-            strcat(resultado, marker);
-        }
-    }
+    char* resultado = sb_finalizar(&json);
+    if (!resultado) return erro_rota_json("Memória insuficiente");
+    return resultado;
+}
 
-    strcat(polyline_points, "]");
+// Busca em segundo plano das cidades ainda sem coordenadas
+static void tarefa_buscar_coordenadas(void* arg) {
+    Grafo* g = (Grafo*)arg;
 
-    // Adiciona linha da rota
-    char route_line[512];
-    snprintf(route_line, sizeof(route_line),
-        "    var routeLine = L.polyline(%s, {color: '#4CAF50', weight: 4, opacity: 0.8})"
-        ".addTo(window.mapaRota_%d);"
-        "    window.mapaRota_%d.fitBounds(routeLine.getBounds());"
-        , polyline_points, rota_counter, rota_counter);
-    strcat(resultado, route_line);
+    grafo_travar(g);
+    int aplicadas = geocodificar_cidades(g, NULL, g->num_cidades, "COORDS");
+    g->buscando_coordenadas = 0;
+    grafo_destravar(g);
 
-    strcat(resultado, "  } catch(e) { console.error('Erro ao criar mapa de rota:', e); }");
-    strcat(resultado, "})();");
-    strcat(resultado, "</script><br>");
+    fprintf(stderr, "[DEBUG COORDS] Pré-carregamento concluído: %d cidades atualizadas\n", aplicadas);
+}
 
-    fprintf(stderr, "[DEBUG MAPA] Mapa de rota gerado com sucesso\n");
+void grafo_agendar_coordenadas(Grafo* g) {
+    if (!g || g->buscando_coordenadas) return;
 
-    // Adiciona detalhes textuais
-    char detalhes[2048];
-    snprintf(detalhes, sizeof(detalhes),
-        "🛣️ <b>Rota Visual:</b><br>"
-        "<div style='background: #f5f5f5; padding: 10px; border-radius: 5px; margin: 10px 0;'>"
-        "%s</div><br>"
-        "📊 <b>Detalhes dos Trechos:</b><br>"
-        "<div style='background: #fff3cd; padding: 10px; border-radius: 5px; margin: 10px 0;'>"
-        "%s</div>"
-        "💡 <i>Calculado com Dijkstra + Visualizado no OpenStreetMap</i>"
-        , caminho_visual, detalhes_trechos);
-    strcat(resultado, detalhes);
+    int faltando = 0;
+    for (int i = 0; i < g->num_cidades; i++) {
+        if (!g->cidades[i].coords_validas) faltando++;
+    }
+    if (faltando == 0) return;
 
-    return resultado;
+    g->buscando_coordenadas = 1;
+    if (!tarefas_submeter(tarefa_buscar_coordenadas, g)) {
+        g->buscando_coordenadas = 0;
+    }
 }
 
 void liberar_grafo(Grafo* g) {
     if (g) {
+        free(g->cidades);
+        free(g->csr_inicio);
+        free(g->csr_destino);
+        free(g->csr_peso);
+        free(g->pendentes);
+        free(g->indice_nomes);
+        free(g->componente_pai);
+        free(g->componente_tamanho);
+        free(g->mutacoes);
+        ch_liberar(g->ch);
+        free(g->busca.dist);
+        free(g->busca.anterior);
+        free(g->busca.chave);
+        free(g->busca.estimativa);
+        free(g->busca.heap);
+        free(g->busca.posicao);
+        free(g->busca.epoca);
+        pthread_mutex_destroy(&g->trava);
+        pthread_mutex_destroy(&g->trava_gravacao);
         free(g);
     }
 }
 
+// Trava o grafo para uso exclusivo pela thread atual
+void grafo_travar(Grafo* g) {
+    if (g) pthread_mutex_lock(&g->trava);
+}
+
+// Libera o grafo para as demais threads
+void grafo_destravar(Grafo* g) {
+    if (g) pthread_mutex_unlock(&g->trava);
+}
+
 // Limpa o grafo sem liberar a memória (reseta para estado inicial)
 void limpar_grafo(Grafo* g) {
     if (!g) return;
 
-    g->num_cidades = 0;
-
-    // Reinicializa todas as cidades
-    for (int i = 0; i < MAX_CIDADES; i++) {
-        g->cidades[i].nome[0] = '\0';
-        g->cidades[i].latitude = 0.0;
-        g->cidades[i].longitude = 0.0;
-        g->cidades[i].coords_validas = 0;
-        for (int j = 0; j < MAX_CIDADES; j++) {
-            g->cidades[i].adjacencias[j] = -1;
+    // As coordenadas conhecidas continuam disponíveis no cache de geocodificação
+    for (int i = 0; i < g->num_cidades; i++) {
+        if (g->cidades[i].coords_validas) {
+            cache_coordenadas_gravar(g->cidades[i].nome, g->cidades[i].latitude, g->cidades[i].longitude);
         }
     }
+    cache_coordenadas_sincronizar();
+
+    // Descarta a adjacência (a tabela de nós mantém a capacidade alocada)
+    free(g->csr_inicio);
+    free(g->csr_destino);
+    free(g->csr_peso);
+    g->csr_inicio = NULL;
+    g->csr_destino = NULL;
+    g->csr_peso = NULL;
+    g->csr_num_cidades = 0;
+    g->csr_num_entradas = 0;
+    g->num_pendentes = 0;
+    g->num_cidades = 0;
+    g->num_componentes = 0;
+    g->num_mutacoes = 0;
+    g->registros_wal = 0;
+    g->astar_verificado = 0;
+
+    ch_liberar(g->ch);
+    g->ch = NULL;
+
+    // Uma compactação que ainda não gravou não pode regravar o grafo antigo depois da limpeza
+    pthread_mutex_lock(&g->trava_gravacao);
+    g->versao_gravada = ++g->versao_copia;
+    pthread_mutex_unlock(&g->trava_gravacao);
+
+    // Esvazia o índice de nomes
+    if (g->indice_nomes) {
+        memset(g->indice_nomes, -1, g->capacidade_indice * sizeof(int));
+    }
 
     fprintf(stderr, "[INFO GRAFO] Grafo limpo com sucesso\n");
 }
@@ -766,59 +1275,129 @@ char* obter_estatisticas_grafo(Grafo* g) {
     }
 
     // Conta conexões
-    int total_conexoes = 0;
-    for (int i = 0; i < g->num_cidades; i++) {
-        for (int j = i + 1; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) {
-                total_conexoes++;
-            }
-        }
-    }
+    int total_conexoes = grafo_num_conexoes(g);
 
     // Monta JSON com estatísticas
-    char* resultado = (char*)malloc(4096);
-    snprintf(resultado, 4096,
+    StrBuilder resultado;
+    sb_iniciar(&resultado, 256 + (size_t)g->num_cidades * 64);
+    sb_formatar(&resultado,
         "{\"cidades\": %d, \"conexoes\": %d, \"listaCidades\": [",
         g->num_cidades, total_conexoes);
 
     for (int i = 0; i < g->num_cidades; i++) {
-        char cidade_json[256];
-        int num_conexoes = 0;
-        for (int j = 0; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) num_conexoes++;
+        int num_conexoes = grafo_grau(g, i);
+
+        sb_anexar(&resultado, i > 0 ? ", {\"nome\": " : "{\"nome\": ");
+        sb_anexar_json_string(&resultado, g->cidades[i].nome);
+        sb_formatar(&resultado, ", \"conexoes\": %d}", num_conexoes);
+    }
+
+    sb_anexar(&resultado, "]}");
+
+    char* json = sb_finalizar(&resultado);
+    if (!json) return strdup("{\"cidades\": 0, \"conexoes\": 0}");
+    return json;
+}
+
+// Identifica o conteúdo do grafo (não depende da ordem das arestas no CSR)
+static unsigned int grafo_assinatura(Grafo* g) {
+    grafo_compactar(g);
+
+    unsigned int assinatura = 2166136261u ^ (unsigned int)g->num_cidades;
+    for (int u = 0; u < g->num_cidades; u++) {
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            unsigned int h = (unsigned int)u * 2654435761u;
+            h ^= (unsigned int)g->csr_destino[e] * 2246822519u;
+            h ^= (unsigned int)g->csr_peso[e] * 3266489917u;
+            h ^= h >> 15;
+            assinatura += h * 668265263u;
         }
+    }
+    return assinatura;
+}
+
+// Hierarquia e snapshot ficam ao lado do arquivo do grafo:
+// coordenadas_grafo.txt -> coordenadas_grafo.ch / coordenadas_grafo.bin
+static void caminho_arquivo_derivado(const char* arquivo, const char* extensao, char* saida, size_t tamanho) {
+    snprintf(saida, tamanho, "%s", arquivo);
+    char* ponto = strrchr(saida, '.');
+    char* barra = strrchr(saida, '/');
+    if (ponto && (!barra || ponto > barra)) *ponto = '\0';
 
-        snprintf(cidade_json, sizeof(cidade_json),
-            "%s{\"nome\": \"%s\", \"conexoes\": %d}",
-            i > 0 ? ", " : "",
-            g->cidades[i].nome,
-            num_conexoes);
-        strcat(resultado, cidade_json);
+    size_t len = strlen(saida);
+    if (len + strlen(extensao) + 1 <= tamanho) strcat(saida, extensao);
+}
+
+// O snapshot só vale se foi gravado depois da última alteração do arquivo texto
+static int snapshot_atualizado(const char* arquivo_texto, const char* arquivo_snapshot) {
+    struct stat texto, snapshot;
+    if (stat(arquivo_texto, &texto) != 0 || stat(arquivo_snapshot, &snapshot) != 0) return 0;
+    return snapshot.st_mtime >= texto.st_mtime;
+}
+
+// Garante que os dados chegaram ao disco antes de seguir (renomear, esvaziar o log)
+static int sincronizar_arquivo(FILE* f) {
+    if (fflush(f) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Troca o arquivo pelo temporário. No Windows o rename não substitui um arquivo
+// existente; MoveFileEx substitui sem um instante em que nenhum dos dois exista
+static int substituir_arquivo(const char* temporario, const char* arquivo) {
+#ifdef _WIN32
+    return MoveFileExA(temporario, arquivo, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(temporario, arquivo) == 0;
+#endif
+}
+
+// O rename só é definitivo quando a entrada do diretório chega ao disco; sem isso
+// uma queda pode desfazer a troca depois de o log já ter sido apagado
+static int sincronizar_diretorio(const char* arquivo) {
+#ifdef _WIN32
+    (void)arquivo;                  // Sem fsync de diretório: o rename fica com o NTFS
+    return 1;
+#else
+    char diretorio[512];
+    snprintf(diretorio, sizeof(diretorio), "%s", arquivo);
+    char* barra = strrchr(diretorio, '/');
+    if (barra == diretorio) {
+        barra[1] = '\0';
+    } else if (barra) {
+        *barra = '\0';
+    } else {
+        snprintf(diretorio, sizeof(diretorio), ".");
     }
 
-    strcat(resultado, "]}");
-    return resultado;
+    int fd = open(diretorio, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
 }
 
-// Salva as coordenadas e conexões do grafo em arquivo
-int salvar_coordenadas_grafo(Grafo* g, const char* arquivo) {
-    if (!g || !arquivo) return 0;
+// Salva as coordenadas e conexões do grafo no formato texto
+// Escreve num temporário e renomeia: uma queda no meio nunca deixa o arquivo truncado
+// Retorna o número de cidades salvas ou -1 em caso de erro
+int salvar_texto_grafo(Grafo* g, const char* arquivo) {
+    if (!g || !arquivo) return -1;
+
+    char temporario[512];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", arquivo);
 
-    FILE* f = fopen(arquivo, "w");
+    FILE* f = fopen(temporario, "w");
     if (!f) {
-        fprintf(stderr, "[ERRO COORDS] Não foi possível abrir arquivo para salvar: %s\n", arquivo);
-        return 0;
+        fprintf(stderr, "[ERRO COORDS] Não foi possível abrir arquivo para salvar: %s\n", temporario);
+        return -1;
     }
 
     // Conta conexões
-    int total_conexoes = 0;
-    for (int i = 0; i < g->num_cidades; i++) {
-        for (int j = i + 1; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) {
-                total_conexoes++;
-            }
-        }
-    }
+    int total_conexoes = grafo_num_conexoes(g);
 
     fprintf(f, "# Grafo GenieC - Coordenadas e Conexões\n");
     fprintf(f, "# Formato Cidade: CIDADE|LATITUDE|LONGITUDE\n");
@@ -847,24 +1426,334 @@ int salvar_coordenadas_grafo(Grafo* g, const char* arquivo) {
     fprintf(f, "\n# === CONEXÕES ===\n");
     int conexoes_salvas = 0;
     for (int i = 0; i < g->num_cidades; i++) {
-        for (int j = i + 1; j < g->num_cidades; j++) {
-            if (g->cidades[i].adjacencias[j] != -1) {
+        for (int e = g->csr_inicio[i]; e < g->csr_inicio[i + 1]; e++) {
+            int j = g->csr_destino[e];
+            if (i < j) {
                 fprintf(f, "CONEXAO|%s|%s|%d\n",
                     g->cidades[i].nome,
                     g->cidades[j].nome,
-                    g->cidades[i].adjacencias[j]);
+                    g->csr_peso[e]);
                 conexoes_salvas++;
             }
         }
     }
 
-    fclose(f);
+    int ok = !ferror(f) && sincronizar_arquivo(f);
+    if (fclose(f) != 0) ok = 0;
+
+    if (!ok) {
+        fprintf(stderr, "[ERRO COORDS] Falha ao gravar: %s\n", arquivo);
+        remove(temporario);
+        return -1;
+    }
+    // Se a troca falhar (arquivo preso por antivírus ou indexador), o anterior
+    // continua inteiro e o temporário fica como está
+    if (!substituir_arquivo(temporario, arquivo)) {
+        fprintf(stderr, "[ERRO COORDS] Não foi possível substituir %s por %s\n", arquivo, temporario);
+        return -1;
+    }
+    if (!sincronizar_diretorio(arquivo)) {
+        fprintf(stderr, "[ERRO COORDS] Falha ao sincronizar o diretório de: %s\n", arquivo);
+        return -1;
+    }
+
     fprintf(stderr, "[INFO GRAFO] Salvo: %d cidades, %d conexões em: %s\n", salvos, conexoes_salvas, arquivo);
     return salvos;
 }
 
-// Carrega as coordenadas e conexões do grafo de arquivo
-int carregar_coordenadas_grafo(Grafo* g, const char* arquivo) {
+// Grava texto, snapshot e hierarquia de g (o grafo travado ou uma cópia dele)
+static int gravar_arquivos_grafo(Grafo* g, const char* arquivo) {
+    int salvos = salvar_texto_grafo(g, arquivo);
+    if (salvos < 0) return -1;
+
+    // O snapshot é gravado depois do texto para ficar mais recente que ele
+    char derivado[512];
+    caminho_arquivo_derivado(arquivo, ".bin", derivado, sizeof(derivado));
+    grafo_snapshot_salvar(g, derivado);
+
+    // Salva a hierarquia de contração junto, se estiver montada
+    if (g->ch) {
+        caminho_arquivo_derivado(arquivo, ".ch", derivado, sizeof(derivado));
+        ch_salvar(g->ch, derivado, grafo_assinatura(g));
+    }
+    return salvos;
+}
+
+// Reescreve texto, snapshot e hierarquia e esvazia o log (.wal e .wal.ant)
+int grafo_persistir_completo(Grafo* g, const char* arquivo) {
+    if (!g || !arquivo) return -1;
+
+    // Versão nova: uma compactação que ainda não gravou a cópia dela fica obsoleta
+    unsigned int versao = ++g->versao_copia;
+    pthread_mutex_lock(&g->trava_gravacao);
+    int salvos = gravar_arquivos_grafo(g, arquivo);
+    if (salvos >= 0) {
+        // Tudo o que estava no log já está no texto (reaplicar o log seria inofensivo)
+        char derivado[512];
+        caminho_arquivo_derivado(arquivo, ".wal.ant", derivado, sizeof(derivado));
+        remove(derivado);
+        caminho_arquivo_derivado(arquivo, ".wal", derivado, sizeof(derivado));
+        remove(derivado);
+        g->versao_gravada = versao;
+    }
+    pthread_mutex_unlock(&g->trava_gravacao);
+    if (salvos < 0) return -1;
+
+    g->num_mutacoes = 0;
+    g->registros_wal = 0;
+    return salvos;
+}
+
+// Cópia do que vai para o disco (tabela de nós, CSR e hierarquia), para a
+// compactação gravar sem segurar a trava do grafo
+static Grafo* copiar_para_gravacao(Grafo* g) {
+    grafo_compactar(g);
+    if (g->num_pendentes > 0 || g->csr_num_cidades != g->num_cidades) return NULL;
+
+    Grafo* copia = criar_grafo();
+    if (!copia) return NULL;
+
+    int n = g->num_cidades;
+    int m = g->csr_num_entradas;
+    copia->cidades = (Cidade*)malloc((n > 0 ? n : 1) * sizeof(Cidade));
+    copia->csr_inicio = (int*)malloc((n + 1) * sizeof(int));
+    copia->csr_destino = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    copia->csr_peso = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    copia->ch = ch_copiar(g->ch);
+    if (!copia->cidades || !copia->csr_inicio || !copia->csr_destino || !copia->csr_peso ||
+        (g->ch && !copia->ch)) {
+        liberar_grafo(copia);
+        return NULL;
+    }
+
+    memcpy(copia->cidades, g->cidades, n * sizeof(Cidade));
+    if (n > 0) {
+        memcpy(copia->csr_inicio, g->csr_inicio, (n + 1) * sizeof(int));
+    } else {
+        copia->csr_inicio[0] = 0;
+    }
+    memcpy(copia->csr_destino, g->csr_destino, m * sizeof(int));
+    memcpy(copia->csr_peso, g->csr_peso, m * sizeof(int));
+    copia->num_cidades = n;
+    copia->capacidade_cidades = n;
+    copia->csr_num_cidades = n;
+    copia->csr_num_entradas = m;
+    return copia;
+}
+
+// Separa o log atual em .wal.ant antes de gravar a cópia: o que chegar durante a
+// gravação vai para um .wal novo, que a compactação não apaga. Se sobrou um
+// .wal.ant de uma compactação que falhou, o .wal vai para o fim dele
+static int separar_log_grafo(const char* arquivo) {
+    char wal[512];
+    char anterior[512];
+    caminho_arquivo_derivado(arquivo, ".wal", wal, sizeof(wal));
+    caminho_arquivo_derivado(arquivo, ".wal.ant", anterior, sizeof(anterior));
+
+    FILE* origem = fopen(wal, "rb");
+    if (!origem) return 1;          // Log vazio: nada a separar
+
+    struct stat st;
+    if (stat(anterior, &st) != 0) {
+        fclose(origem);
+        return rename(wal, anterior) == 0 && sincronizar_diretorio(wal);
+    }
+
+    FILE* destino = fopen(anterior, "ab");
+    int ok = destino != NULL;
+    char bloco[8192];
+    size_t lidos;
+    while (ok && (lidos = fread(bloco, 1, sizeof(bloco), origem)) > 0) {
+        ok = fwrite(bloco, 1, lidos, destino) == lidos;
+    }
+    ok = ok && !ferror(origem) && sincronizar_arquivo(destino);
+    if (destino && fclose(destino) != 0) ok = 0;
+    fclose(origem);
+    return ok && remove(wal) == 0;
+}
+
+typedef struct {
+    Grafo* g;
+    char arquivo[512];
+} TarefaCompactacao;
+
+// A trava do grafo só fica presa durante a cópia e a troca do log; a reescrita
+// e os fsyncs acontecem sem ela, enquanto o chat e o painel continuam usando o grafo
+static void tarefa_compactar_grafo(void* arg) {
+    TarefaCompactacao* tarefa = (TarefaCompactacao*)arg;
+    Grafo* g = tarefa->g;
+
+    grafo_travar(g);
+    double inicio = obter_tempo_ms();
+    unsigned int versao = 0;
+    Grafo* copia = copiar_para_gravacao(g);
+    if (copia && separar_log_grafo(tarefa->arquivo)) {
+        versao = ++g->versao_copia;
+        g->registros_wal = 0;
+    } else {
+        fprintf(stderr, "[ERRO GRAFO] Compactação adiada: não foi possível copiar o grafo ou separar o log\n");
+        liberar_grafo(copia);
+        copia = NULL;
+        g->compactando = 0;
+    }
+    double tempo_travado = obter_tempo_ms() - inicio;
+    grafo_destravar(g);
+
+    if (copia) {
+        pthread_mutex_lock(&g->trava_gravacao);
+        // Uma gravação completa ou uma limpeza depois da cópia já deixou o disco mais novo
+        if (versao > g->versao_gravada && gravar_arquivos_grafo(copia, tarefa->arquivo) >= 0) {
+            char anterior[512];
+            caminho_arquivo_derivado(tarefa->arquivo, ".wal.ant", anterior, sizeof(anterior));
+            remove(anterior);
+            g->versao_gravada = versao;
+        }
+        pthread_mutex_unlock(&g->trava_gravacao);
+        liberar_grafo(copia);
+
+        grafo_travar(g);
+        g->compactando = 0;
+        grafo_destravar(g);
+        fprintf(stderr, "[PERFORMANCE] Log do grafo compactado em %.1f ms (%.1f ms com o grafo travado)\n",
+                obter_tempo_ms() - inicio, tempo_travado);
+    }
+    free(tarefa);
+}
+
+// Compacta o log numa thread de trabalho (ou aqui mesmo, se o pool não estiver ativo)
+static void agendar_compactacao(Grafo* g, const char* arquivo) {
+    if (g->compactando) return;
+
+    TarefaCompactacao* tarefa = (TarefaCompactacao*)malloc(sizeof(TarefaCompactacao));
+    if (tarefa) {
+        tarefa->g = g;
+        snprintf(tarefa->arquivo, sizeof(tarefa->arquivo), "%s", arquivo);
+        g->compactando = 1;
+        if (tarefas_submeter(tarefa_compactar_grafo, tarefa)) return;
+        g->compactando = 0;
+        free(tarefa);
+    }
+    grafo_persistir_completo(g, arquivo);
+}
+
+// Registro do log: TIPO|campos...|checksum (linhas sem '\n' ou com checksum errado são ignoradas)
+static int escrever_registro_wal(FILE* f, const char* registro) {
+    return fprintf(f, "%s|%08x\n", registro, hash_nome(registro)) > 0;
+}
+
+// Grava de forma incremental: acrescenta ao log só as mudanças desde a última
+// gravação (um fsync por lote) e agenda a compactação quando o log cresce
+int salvar_coordenadas_grafo(Grafo* g, const char* arquivo) {
+    if (!g || !arquivo) return 0;
+    if (g->registros_wal >= GRAFO_WAL_MAX_REGISTROS) {
+        agendar_compactacao(g, arquivo);
+        return g->num_cidades;
+    }
+    if (g->num_mutacoes == 0) return g->num_cidades;
+
+    char arquivo_wal[512];
+    caminho_arquivo_derivado(arquivo, ".wal", arquivo_wal, sizeof(arquivo_wal));
+
+    FILE* f = fopen(arquivo_wal, "a");
+    if (!f) {
+        fprintf(stderr, "[ERRO GRAFO] Não foi possível abrir o log %s; gravando o grafo completo\n", arquivo_wal);
+        return grafo_persistir_completo(g, arquivo);
+    }
+
+    char registro[3 * MAX_NOME_CIDADE + 64];
+    int ok = 1;
+    for (int i = 0; ok && i < g->num_mutacoes; i++) {
+        const MutacaoGrafo* m = &g->mutacoes[i];
+        if (m->tipo == MUTACAO_ARESTA) {
+            snprintf(registro, sizeof(registro), "ARESTA|%s|%s|%d",
+                     g->cidades[m->cidade1].nome, g->cidades[m->cidade2].nome, m->distancia);
+        } else {
+            const Cidade* c = &g->cidades[m->cidade1];
+            snprintf(registro, sizeof(registro), "COORD|%s|%.6f|%.6f", c->nome, c->latitude, c->longitude);
+        }
+        ok = escrever_registro_wal(f, registro);
+    }
+    ok = ok && sincronizar_arquivo(f);
+    if (fclose(f) != 0) ok = 0;
+
+    if (!ok) {
+        // As mudanças continuam pendentes; reaplicar registros repetidos é inofensivo
+        fprintf(stderr, "[ERRO GRAFO] Falha ao gravar o log %s\n", arquivo_wal);
+        return g->num_cidades;
+    }
+
+    fprintf(stderr, "[INFO GRAFO] %d mudanças acrescentadas ao log %s\n", g->num_mutacoes, arquivo_wal);
+    g->registros_wal += g->num_mutacoes;
+    g->num_mutacoes = 0;
+
+    if (g->registros_wal >= GRAFO_WAL_MAX_REGISTROS) {
+        agendar_compactacao(g, arquivo);
+    }
+    return g->num_cidades;
+}
+
+// Reaplica o log sobre o grafo carregado; para no primeiro registro incompleto
+static int aplicar_log_grafo(Grafo* g, const char* arquivo_wal) {
+    FILE* f = fopen(arquivo_wal, "r");
+    if (!f) return 0;
+
+    char linha[512];
+    int aplicados = 0;
+    while (fgets(linha, sizeof(linha), f)) {
+        size_t len = strlen(linha);
+        if (len == 0 || linha[len - 1] != '\n') break;   // Escrita interrompida
+        linha[len - 1] = '\0';
+
+        char* sep_soma = strrchr(linha, '|');
+        if (!sep_soma) break;
+        *sep_soma = '\0';
+        if ((unsigned int)strtoul(sep_soma + 1, NULL, 16) != hash_nome(linha)) break;
+
+        char* campos[4] = {0};
+        int num_campos = 0;
+        char* resto = linha;
+        while (num_campos < 4) {
+            campos[num_campos++] = resto;
+            char* sep = strchr(resto, '|');
+            if (!sep) break;
+            *sep = '\0';
+            resto = sep + 1;
+        }
+        if (num_campos != 4) continue;
+
+        if (strcmp(campos[0], "ARESTA") == 0) {
+            adicionar_aresta(g, campos[1], campos[2], atoi(campos[3]));
+        } else if (strcmp(campos[0], "COORD") == 0) {
+            int idx = adicionar_cidade(g, campos[1]);
+            grafo_definir_coordenadas(g, idx, atof(campos[2]), atof(campos[3]));
+        } else {
+            continue;
+        }
+        aplicados++;
+    }
+    fclose(f);
+
+    if (aplicados > 0) {
+        fprintf(stderr, "[INFO GRAFO] %d mudanças reaplicadas do log %s\n", aplicados, arquivo_wal);
+    }
+    return aplicados;
+}
+
+// Remove o grafo salvo e todos os arquivos derivados (.bin, .wal, .wal.ant, .ch)
+void remover_arquivos_grafo(const char* arquivo) {
+    if (!arquivo) return;
+
+    static const char* extensoes[] = {".bin", ".wal", ".wal.ant", ".ch"};
+    char derivado[512];
+    remove(arquivo);
+    for (size_t i = 0; i < sizeof(extensoes) / sizeof(extensoes[0]); i++) {
+        caminho_arquivo_derivado(arquivo, extensoes[i], derivado, sizeof(derivado));
+        remove(derivado);
+    }
+}
+
+// Carrega as coordenadas e conexões do grafo do formato texto
+int carregar_texto_grafo(Grafo* g, const char* arquivo) {
     if (!g || !arquivo) return 0;
 
     FILE* f = fopen(arquivo, "r");
@@ -949,10 +1838,10 @@ int carregar_coordenadas_grafo(Grafo* g, const char* arquivo) {
                 }
                 cidades_carregadas++;
                 fprintf(stderr, "[DEBUG GRAFO] Coordenadas atualizadas: %s (%.4f, %.4f)\n", nome, lat, lng);
-            } else if (g->num_cidades < MAX_CIDADES) {
+            } else {
                 // Cidade não existe - adiciona com coordenadas
-                adicionar_cidade(g, nome);
-                idx = g->num_cidades - 1;
+                idx = adicionar_cidade(g, nome);
+                if (idx == -1) continue;
                 if (lat != 0.0 || lng != 0.0) {
                     g->cidades[idx].latitude = lat;
                     g->cidades[idx].longitude = lng;
@@ -965,7 +1854,49 @@ int carregar_coordenadas_grafo(Grafo* g, const char* arquivo) {
     }
 
     fclose(f);
+    g->astar_verificado = 0;    // Coordenadas gravadas direto na tabela de nós
     fprintf(stderr, "[INFO GRAFO] Carregado: %d cidades, %d conexões de: %s\n",
             cidades_carregadas, conexoes_carregadas, arquivo);
     return cidades_carregadas;
+}
+
+// Carrega o grafo: usa o snapshot binário se estiver atualizado, senão o texto
+int carregar_coordenadas_grafo(Grafo* g, const char* arquivo) {
+    if (!g || !arquivo) return 0;
+
+    double tempo_inicio = obter_tempo_ms();
+    char derivado[512];
+    caminho_arquivo_derivado(arquivo, ".bin", derivado, sizeof(derivado));
+
+    int cidades_carregadas = -1;
+    const char* formato = "snapshot";
+    if (snapshot_atualizado(arquivo, derivado)) {
+        cidades_carregadas = grafo_snapshot_carregar(g, derivado);
+    }
+    if (cidades_carregadas < 0) {
+        formato = "texto";
+        cidades_carregadas = carregar_texto_grafo(g, arquivo);
+    }
+
+    // Mudanças gravadas depois da última compactação; um .wal.ant que sobrou de
+    // uma compactação interrompida é mais antigo que o .wal
+    caminho_arquivo_derivado(arquivo, ".wal.ant", derivado, sizeof(derivado));
+    g->registros_wal = aplicar_log_grafo(g, derivado);
+    caminho_arquivo_derivado(arquivo, ".wal", derivado, sizeof(derivado));
+    g->registros_wal += aplicar_log_grafo(g, derivado);
+    cidades_carregadas = g->num_cidades;
+
+    // O que veio do disco não precisa ser regravado
+    free(g->mutacoes);
+    g->mutacoes = NULL;
+    g->num_mutacoes = 0;
+    g->capacidade_mutacoes = 0;
+    fprintf(stderr, "[PERFORMANCE] Grafo carregado (%s) em %.3f ms\n", formato, obter_tempo_ms() - tempo_inicio);
+
+    // Reaproveita a hierarquia salva se ela corresponder ao grafo carregado
+    if (!g->ch && GRAFO_USAR_CH && g->num_cidades >= GRAFO_CH_MIN_CIDADES) {
+        caminho_arquivo_derivado(arquivo, ".ch", derivado, sizeof(derivado));
+        g->ch = ch_carregar(derivado, g->num_cidades, grafo_assinatura(g));
+    }
+    return cidades_carregadas;
 }
\ No newline at end of file
@@ -1,37 +1,174 @@
 #ifndef GRAFO_H
 #define GRAFO_H
 
-#define MAX_CIDADES 100
+#include <pthread.h>
+
 #define MAX_NOME_CIDADE 100
 
+// Atributos de cada cidade (tabela de nós)
 typedef struct {
     char nome[MAX_NOME_CIDADE];
-    int adjacencias[MAX_CIDADES];   // Distâncias em km (-1 = sem conexão)
+    char chave[MAX_NOME_CIDADE];    // Nome normalizado (sem acentos/caixa), usado na busca
     double latitude;                // Coordenada geográfica
     double longitude;               // Coordenada geográfica
     int coords_validas;             // Flag: 1 se coordenadas foram carregadas
 } Cidade;
 
+// Aresta recém-inserida, ainda fora do CSR
+typedef struct {
+    int origem;
+    int destino;
+    int distancia;                  // Distância em km
+} ArestaPendente;
+
+// Memória de trabalho reaproveitada entre consultas de menor caminho
+// (uma entrada só vale se epoca[v] == epoca_atual, evitando reinicializar tudo)
+typedef struct {
+    int* dist;
+    int* anterior;
+    int* chave;                     // Prioridade no heap: dist (Dijkstra) ou dist + estimativa (A*)
+    int* estimativa;                // Limite inferior até o destino, em km (0 sem heurística)
+    int* heap;                      // Heap binário indexado de cidades
+    int* posicao;                   // Posição de cada cidade no heap (-1 = fora)
+    unsigned int* epoca;
+    unsigned int epoca_atual;
+    int tamanho_heap;
+    int capacidade;
+} EspacoBusca;
+
+// Resultado de uma consulta de menor caminho
+typedef struct {
+    int encontrado;
+    int distancia_total;            // Em km
+    int* caminho;                   // Índices das cidades, da origem ao destino
+    int tamanho_caminho;
+    int nos_visitados;              // Cidades retiradas da fila de prioridade
+    const char* algoritmo;          // "Dijkstra", "A*" ou "CH"
+    double tempo_ms;
+} ResultadoCaminho;
+
+// Mudança ainda não gravada no log incremental (.wal)
+#define MUTACAO_ARESTA 1
+#define MUTACAO_COORDENADAS 2
+
+typedef struct {
+    int tipo;
+    int cidade1;
+    int cidade2;                    // Só em MUTACAO_ARESTA
+    int distancia;
+} MutacaoGrafo;
+
+// Hierarquia de contração (definida em grafo_ch.h)
+typedef struct HierarquiaContracao HierarquiaContracao;
+
 typedef struct {
-    Cidade cidades[MAX_CIDADES];
+    // Tabela de nós (cresce sob demanda)
+    Cidade* cidades;
     int num_cidades;
+    int capacidade_cidades;
+
+    // Índice hash (endereçamento aberto) de chave normalizada -> índice da cidade
+    int* indice_nomes;              // -1 = posição livre
+    int capacidade_indice;          // Potência de 2, mantida com ocupação <= 50%
+
+    // Componentes conexos (union-find mantido por adicionar_aresta)
+    int* componente_pai;            // Raiz = a própria cidade
+    int* componente_tamanho;        // Válido só nas raízes
+    int num_componentes;
+
+    // Adjacência compacta (CSR): os vizinhos de u ficam em
+    // csr_destino/csr_peso[csr_inicio[u] .. csr_inicio[u + 1])
+    int* csr_inicio;
+    int* csr_destino;
+    int* csr_peso;
+    int csr_num_cidades;            // Cidades cobertas pelo CSR atual
+    int csr_num_entradas;           // Arestas direcionadas no CSR
+
+    // Buffer de inserção, incorporado ao CSR na próxima leitura
+    ArestaPendente* pendentes;
+    int num_pendentes;
+    int capacidade_pendentes;
+
+    EspacoBusca busca;
+    int astar_verificado;           // 0 = arestas ou coordenadas mudaram desde a contagem
+    int astar_violacoes;            // Conexões que tornam a estimativa do A* inadmissível
+    HierarquiaContracao* ch;        // NULL quando precisa ser reconstruída
+    int buscando_coordenadas;       // Há uma geocodificação em segundo plano
+
+    // Persistência incremental
+    MutacaoGrafo* mutacoes;         // Mudanças desde a última gravação
+    int num_mutacoes;
+    int capacidade_mutacoes;
+    int registros_wal;              // Registros no .wal desde a última compactação
+    int compactando;                // Compactação agendada em segundo plano
+    unsigned int versao_copia;      // Última versão separada para gravar (sob a trava do grafo)
+    unsigned int versao_gravada;    // Versão mais nova já no disco (sob trava_gravacao)
+
+    pthread_mutex_t trava;          // Protege o grafo quando usado por várias threads
+    pthread_mutex_t trava_gravacao; // Ordena a escrita dos arquivos; a compactação grava sem a trava do grafo
 } Grafo;
 
 // Funções do grafo
 Grafo* criar_grafo();
-void adicionar_cidade(Grafo* g, const char* nome);
+int adicionar_cidade(Grafo* g, const char* nome);
 void adicionar_aresta(Grafo* g, const char* cidade1, const char* cidade2, int distancia);
 int encontrar_cidade(Grafo* g, const char* nome);
+// Define as coordenadas de uma cidade (registra a mudança para a gravação incremental)
+void grafo_definir_coordenadas(Grafo* g, int idx, double latitude, double longitude);
 char* calcular_menor_caminho(Grafo* g, const char* origem, const char* destino);
-char* calcular_menor_caminho_com_mapa(Grafo* g, const char* origem, const char* destino);
+// Rota em JSON para o renderizador da interface:
+// {"v":1,"origem","destino","algoritmo","distanciaTotal","cidades":[nomes],"caminho":[índices],
+//  "trechos":[km por trecho],"escala","comCoords":[posições no caminho com coordenadas],
+//  "coords":[lat,lng,dlat,dlng,...] (inteiros * escala, por diferença),"nosVisitados"}
+// ou {"v":1,"erro":"mensagem"}
+// calcular_rota_json e gerar_mapa_grafo são chamadas com o grafo travado, mas
+// soltam a trava enquanto geocodificam as cidades que ainda não têm coordenadas
+char* calcular_rota_json(Grafo* g, const char* origem, const char* destino);
 char* listar_cidades_grafo(Grafo* g);
 char* gerar_mapa_grafo(Grafo* g);
 void liberar_grafo(Grafo* g);
 void limpar_grafo(Grafo* g);
 char* obter_estatisticas_grafo(Grafo* g);
+void grafo_travar(Grafo* g);
+void grafo_destravar(Grafo* g);
+
+// Acesso à adjacência
+void grafo_compactar(Grafo* g);
+int grafo_distancia(Grafo* g, int idx1, int idx2);
+int grafo_grau(Grafo* g, int idx);
+int grafo_num_conexoes(Grafo* g);
+
+// Conectividade: 1 se as duas cidades existem e estão no mesmo componente
+int grafo_componente(Grafo* g, int idx);
+int grafo_cidades_conectadas(Grafo* g, const char* origem, const char* destino);
+// Refaz o union-find a partir da adjacência (usado quando o CSR é carregado em bloco)
+void grafo_recalcular_componentes(Grafo* g);
+
+// Motor de menor caminho (Dijkstra com heap binário, O((V+E) log V))
+int grafo_menor_caminho(Grafo* g, int origem, int destino, ResultadoCaminho* resultado);
+// A* guiado por GRAFO_ASTAR_FATOR x linha reta (haversine); usa Dijkstra se faltar
+// coordenada ou se alguma conexão for mais curta que essa estimativa
+int grafo_menor_caminho_astar(Grafo* g, int origem, int destino, ResultadoCaminho* resultado);
+// Consulta na hierarquia de contração (construída na primeira chamada após mudanças)
+int grafo_menor_caminho_ch(Grafo* g, int origem, int destino, ResultadoCaminho* resultado);
+void liberar_resultado_caminho(ResultadoCaminho* resultado);
+
+// Geocodifica em lote, numa thread de trabalho, as cidades ainda sem coordenadas
+// (chamar com o grafo travado; não faz nada se já houver uma busca em andamento)
+void grafo_agendar_coordenadas(Grafo* g);
 
 // Funções para persistência de coordenadas e conexões
+// salvar: acrescenta as mudanças ao log .wal (compactado em segundo plano quando cresce;
+//         a compactação grava uma cópia sem a trava do grafo, separando o log em .wal.ant)
+// carregar: usa o snapshot .bin se estiver atualizado, senão o texto, e reaplica .wal.ant e .wal
 int salvar_coordenadas_grafo(Grafo* g, const char* arquivo);
 int carregar_coordenadas_grafo(Grafo* g, const char* arquivo);
+// Reescreve texto, snapshot e hierarquia e esvazia o log; retorna cidades salvas ou -1
+int grafo_persistir_completo(Grafo* g, const char* arquivo);
+void remover_arquivos_grafo(const char* arquivo);
+
+// Apenas o formato texto (CIDADE|LAT|LNG e CONEXAO|C1|C2|KM)
+int salvar_texto_grafo(Grafo* g, const char* arquivo);
+int carregar_texto_grafo(Grafo* g, const char* arquivo);
 
-#endif // GRAFO_H
\ No newline at end of file
+#endif // GRAFO_H
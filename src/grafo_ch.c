@@ -0,0 +1,658 @@
+/* grafo_ch.c - Hierarquia de contração (Contraction Hierarchies) sobre o grafo de rotas
+ * GenieC - Assistente Inteligente
+ *
+ * Pré-processamento: as cidades são contraídas uma a uma (menos atalhos
+ * primeiro). Ao contrair v, para cada par de vizinhos u-w ainda ativos cujo
+ * menor caminho passa por v é criado um atalho u-w. A consulta faz Dijkstra
+ * a partir da origem e do destino subindo apenas para cidades de nível maior
+ * e junta as duas buscas na cidade de menor soma.
+ */
+
+#include "grafo_ch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define CH_MAGIA "GCH1"
+#define CH_VERSAO 1
+#define CH_LIMITE_TESTEMUNHA 100    // Cidades fechadas por busca de testemunha
+#define CH_LIMITE_SIMULACAO 20      // Idem ao só estimar a prioridade (pode superestimar atalhos)
+
+// ===== HEAP DE PARES (chave, cidade) COM REMOÇÃO PREGUIÇOSA =====
+
+typedef struct {
+    int chave;
+    int cidade;
+} ItemHeapCH;
+
+typedef struct HeapCH {
+    ItemHeapCH* itens;
+    int tamanho;
+    int capacidade;
+} HeapCH;
+
+static HeapCH* heap_criar(void) {
+    return (HeapCH*)calloc(1, sizeof(HeapCH));
+}
+
+static void heap_liberar(HeapCH* h) {
+    if (h) {
+        free(h->itens);
+        free(h);
+    }
+}
+
+static int heap_inserir(HeapCH* h, int chave, int cidade) {
+    if (h->tamanho >= h->capacidade) {
+        int nova_capacidade = h->capacidade > 0 ? h->capacidade * 2 : 64;
+        ItemHeapCH* novos = (ItemHeapCH*)realloc(h->itens, nova_capacidade * sizeof(ItemHeapCH));
+        if (!novos) return 0;
+        h->itens = novos;
+        h->capacidade = nova_capacidade;
+    }
+
+    int i = h->tamanho++;
+    while (i > 0) {
+        int pai = (i - 1) / 2;
+        if (h->itens[pai].chave <= chave) break;
+        h->itens[i] = h->itens[pai];
+        i = pai;
+    }
+    h->itens[i].chave = chave;
+    h->itens[i].cidade = cidade;
+    return 1;
+}
+
+static ItemHeapCH heap_remover(HeapCH* h) {
+    ItemHeapCH topo = h->itens[0];
+    ItemHeapCH ultimo = h->itens[--h->tamanho];
+
+    int i = 0;
+    for (;;) {
+        int filho = 2 * i + 1;
+        if (filho >= h->tamanho) break;
+        if (filho + 1 < h->tamanho && h->itens[filho + 1].chave < h->itens[filho].chave) filho++;
+        if (ultimo.chave <= h->itens[filho].chave) break;
+        h->itens[i] = h->itens[filho];
+        i = filho;
+    }
+    if (h->tamanho > 0) h->itens[i] = ultimo;
+    return topo;
+}
+
+// ===== LISTAS DE ADJACÊNCIA USADAS DURANTE A CONTRAÇÃO =====
+
+typedef struct {
+    int vizinho;
+    int peso;
+    int meio;
+} ArestaCH;
+
+typedef struct {
+    ArestaCH* itens;
+    int tamanho;
+    int capacidade;
+} ListaCH;
+
+// Insere ou encurta a aresta u -> v (mantém só a menor por par)
+static int lista_definir(ListaCH* lista, int vizinho, int peso, int meio) {
+    for (int i = 0; i < lista->tamanho; i++) {
+        if (lista->itens[i].vizinho == vizinho) {
+            if (peso < lista->itens[i].peso) {
+                lista->itens[i].peso = peso;
+                lista->itens[i].meio = meio;
+            }
+            return 1;
+        }
+    }
+
+    if (lista->tamanho >= lista->capacidade) {
+        int nova_capacidade = lista->capacidade > 0 ? lista->capacidade * 2 : 4;
+        ArestaCH* novos = (ArestaCH*)realloc(lista->itens, nova_capacidade * sizeof(ArestaCH));
+        if (!novos) return 0;
+        lista->itens = novos;
+        lista->capacidade = nova_capacidade;
+    }
+
+    ArestaCH* aresta = &lista->itens[lista->tamanho++];
+    aresta->vizinho = vizinho;
+    aresta->peso = peso;
+    aresta->meio = meio;
+    return 1;
+}
+
+static void lista_remover(ListaCH* lista, int vizinho) {
+    for (int i = 0; i < lista->tamanho; i++) {
+        if (lista->itens[i].vizinho == vizinho) {
+            lista->itens[i] = lista->itens[--lista->tamanho];
+            return;
+        }
+    }
+}
+
+// Estado do pré-processamento
+typedef struct {
+    int n;
+    ListaCH* adj;
+    int* contraida;
+    int* vizinhos_contraidos;
+
+    // Busca de testemunha (entradas válidas se epoca[v] == epoca_atual)
+    int* dist;
+    unsigned int* epoca;
+    unsigned int epoca_atual;
+    HeapCH* heap;
+} Contracao;
+
+// Dijkstra local a partir de u, ignorando a cidade sendo contraída e as já
+// contraídas; para quando passa de limite ou fecha max_fechadas cidades
+static void busca_testemunha(Contracao* c, int u, int ignorada, int limite, int max_fechadas) {
+    c->epoca_atual++;
+    if (c->epoca_atual == 0) {
+        memset(c->epoca, 0, c->n * sizeof(unsigned int));
+        c->epoca_atual = 1;
+    }
+    c->heap->tamanho = 0;
+
+    c->epoca[u] = c->epoca_atual;
+    c->dist[u] = 0;
+    heap_inserir(c->heap, 0, u);
+
+    int fechadas = 0;
+    while (c->heap->tamanho > 0) {
+        ItemHeapCH item = heap_remover(c->heap);
+        if (item.chave > c->dist[item.cidade]) continue;  // Entrada obsoleta
+        if (item.chave > limite || ++fechadas > max_fechadas) break;
+
+        ListaCH* lista = &c->adj[item.cidade];
+        for (int i = 0; i < lista->tamanho; i++) {
+            int v = lista->itens[i].vizinho;
+            if (v == ignorada || c->contraida[v]) continue;
+
+            int nova = item.chave + lista->itens[i].peso;
+            if (c->epoca[v] != c->epoca_atual || nova < c->dist[v]) {
+                c->epoca[v] = c->epoca_atual;
+                c->dist[v] = nova;
+                heap_inserir(c->heap, nova, v);
+            }
+        }
+    }
+}
+
+// Distância encontrada pela última busca de testemunha (INT_MAX se não alcançou)
+static inline int testemunha_dist(Contracao* c, int v) {
+    return c->epoca[v] == c->epoca_atual ? c->dist[v] : INT_MAX;
+}
+
+// Contrai v (ou só conta os atalhos necessários, se simular != 0)
+static int contrair(Contracao* c, int v, int simular) {
+    ListaCH* lista = &c->adj[v];
+    int atalhos = 0;
+
+    for (int i = 0; i < lista->tamanho; i++) {
+        int u = lista->itens[i].vizinho;
+        if (c->contraida[u]) continue;
+
+        // Maior atalho possível saindo de u limita a busca
+        int limite = 0;
+        for (int j = i + 1; j < lista->tamanho; j++) {
+            if (c->contraida[lista->itens[j].vizinho]) continue;
+            int via = lista->itens[i].peso + lista->itens[j].peso;
+            if (via > limite) limite = via;
+        }
+        if (limite == 0) continue;
+
+        busca_testemunha(c, u, v, limite, simular ? CH_LIMITE_SIMULACAO : CH_LIMITE_TESTEMUNHA);
+
+        for (int j = i + 1; j < lista->tamanho; j++) {
+            int w = lista->itens[j].vizinho;
+            if (c->contraida[w]) continue;
+
+            int via = lista->itens[i].peso + lista->itens[j].peso;
+            if (testemunha_dist(c, w) <= via) continue;  // Há caminho sem v
+
+            atalhos++;
+            if (!simular) {
+                if (!lista_definir(&c->adj[u], w, via, v) || !lista_definir(&c->adj[w], u, via, v)) {
+                    return -1;
+                }
+            }
+        }
+    }
+    return atalhos;
+}
+
+// Prioridade de contração: diferença de arestas + vizinhos já contraídos
+static int prioridade(Contracao* c, int v) {
+    int ativos = 0;
+    for (int i = 0; i < c->adj[v].tamanho; i++) {
+        if (!c->contraida[c->adj[v].itens[i].vizinho]) ativos++;
+    }
+    return contrair(c, v, 1) - ativos + c->vizinhos_contraidos[v];
+}
+
+static HierarquiaContracao* ch_alocar(int num_cidades, int num_arestas) {
+    HierarquiaContracao* ch = (HierarquiaContracao*)calloc(1, sizeof(HierarquiaContracao));
+    if (!ch) return NULL;
+
+    ch->num_cidades = num_cidades;
+    ch->num_arestas = num_arestas;
+    ch->nivel = (int*)malloc((num_cidades + 1) * sizeof(int));
+    ch->inicio = (int*)calloc(num_cidades + 1, sizeof(int));
+    ch->destino = (int*)malloc((num_arestas + 1) * sizeof(int));
+    ch->peso = (int*)malloc((num_arestas + 1) * sizeof(int));
+    ch->meio = (int*)malloc((num_arestas + 1) * sizeof(int));
+    ch->epoca = (unsigned int*)calloc(num_cidades + 1, sizeof(unsigned int));
+    for (int lado = 0; lado < 2; lado++) {
+        ch->dist[lado] = (int*)malloc((num_cidades + 1) * sizeof(int));
+        ch->anterior[lado] = (int*)malloc((num_cidades + 1) * sizeof(int));
+        ch->heap[lado] = heap_criar();
+    }
+
+    if (!ch->nivel || !ch->inicio || !ch->destino || !ch->peso || !ch->meio || !ch->epoca ||
+        !ch->dist[0] || !ch->dist[1] || !ch->anterior[0] || !ch->anterior[1] ||
+        !ch->heap[0] || !ch->heap[1]) {
+        ch_liberar(ch);
+        return NULL;
+    }
+    return ch;
+}
+
+HierarquiaContracao* ch_construir(Grafo* g) {
+    if (!g) return NULL;
+    grafo_compactar(g);
+
+    int n = g->num_cidades;
+    Contracao c;
+    memset(&c, 0, sizeof(c));
+    c.n = n;
+    c.adj = (ListaCH*)calloc(n + 1, sizeof(ListaCH));
+    c.contraida = (int*)calloc(n + 1, sizeof(int));
+    c.vizinhos_contraidos = (int*)calloc(n + 1, sizeof(int));
+    c.dist = (int*)malloc((n + 1) * sizeof(int));
+    c.epoca = (unsigned int*)calloc(n + 1, sizeof(unsigned int));
+    c.heap = heap_criar();
+    HeapCH* fila = heap_criar();
+    int* nivel = (int*)malloc((n + 1) * sizeof(int));
+
+    HierarquiaContracao* ch = NULL;
+    int ok = c.adj && c.contraida && c.vizinhos_contraidos && c.dist && c.epoca && c.heap && fila && nivel;
+
+    // Copia o CSR para listas que aceitam atalhos
+    for (int u = 0; ok && u < n; u++) {
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            if (g->csr_destino[e] == u) continue;
+            if (!lista_definir(&c.adj[u], g->csr_destino[e], g->csr_peso[e], -1)) {
+                ok = 0;
+                break;
+            }
+        }
+    }
+
+    // Ordem de contração com atualização preguiçosa das prioridades
+    for (int v = 0; ok && v < n; v++) {
+        ok = heap_inserir(fila, prioridade(&c, v), v);
+    }
+
+    int ordem = 0;
+    while (ok && fila->tamanho > 0) {
+        ItemHeapCH item = heap_remover(fila);
+        int v = item.cidade;
+
+        int atual = prioridade(&c, v);
+        if (fila->tamanho > 0 && atual > fila->itens[0].chave) {
+            ok = heap_inserir(fila, atual, v);
+            continue;
+        }
+
+        if (contrair(&c, v, 0) < 0) {
+            ok = 0;
+            break;
+        }
+        c.contraida[v] = 1;
+        nivel[v] = ordem++;
+
+        // Tira v das listas dos vizinhos ativos: as arestas ascendentes ficam na lista de v
+        for (int i = 0; i < c.adj[v].tamanho; i++) {
+            int u = c.adj[v].itens[i].vizinho;
+            if (c.contraida[u]) continue;
+            c.vizinhos_contraidos[u]++;
+            lista_remover(&c.adj[u], v);
+        }
+    }
+
+    if (ok) {
+        // Mantém só as arestas que sobem de nível
+        int total = 0;
+        for (int u = 0; u < n; u++) {
+            for (int i = 0; i < c.adj[u].tamanho; i++) {
+                if (nivel[c.adj[u].itens[i].vizinho] > nivel[u]) total++;
+            }
+        }
+
+        ch = ch_alocar(n, total);
+        if (ch) {
+            memcpy(ch->nivel, nivel, n * sizeof(int));
+            int pos = 0;
+            for (int u = 0; u < n; u++) {
+                ch->inicio[u] = pos;
+                for (int i = 0; i < c.adj[u].tamanho; i++) {
+                    ArestaCH* a = &c.adj[u].itens[i];
+                    if (nivel[a->vizinho] > nivel[u]) {
+                        ch->destino[pos] = a->vizinho;
+                        ch->peso[pos] = a->peso;
+                        ch->meio[pos] = a->meio;
+                        pos++;
+                    }
+                }
+            }
+            ch->inicio[n] = pos;
+        }
+    }
+
+    if (!ch) {
+        fprintf(stderr, "[ERRO GRAFO] Sem memória para construir a hierarquia de contração\n");
+    }
+
+    if (c.adj) {
+        for (int u = 0; u < n; u++) free(c.adj[u].itens);
+    }
+    free(c.adj);
+    free(c.contraida);
+    free(c.vizinhos_contraidos);
+    free(c.dist);
+    free(c.epoca);
+    heap_liberar(c.heap);
+    heap_liberar(fila);
+    free(nivel);
+    return ch;
+}
+
+// ===== CONSULTA =====
+
+static inline void consulta_tocar(HierarquiaContracao* ch, int v) {
+    if (ch->epoca[v] != ch->epoca_atual) {
+        ch->epoca[v] = ch->epoca_atual;
+        ch->dist[0][v] = INT_MAX;
+        ch->dist[1][v] = INT_MAX;
+        ch->anterior[0][v] = -1;
+        ch->anterior[1][v] = -1;
+    }
+}
+
+// Aresta ascendente entre a e b (guardada na cidade de menor nível)
+static int aresta_entre(HierarquiaContracao* ch, int a, int b) {
+    int baixo = ch->nivel[a] < ch->nivel[b] ? a : b;
+    int alto = baixo == a ? b : a;
+    for (int e = ch->inicio[baixo]; e < ch->inicio[baixo + 1]; e++) {
+        if (ch->destino[e] == alto) return e;
+    }
+    return -1;
+}
+
+// Expande recursivamente a aresta a -> b em cidades do grafo original (sem incluir a)
+static void desempacotar(HierarquiaContracao* ch, int a, int b, int* caminho, int* tamanho) {
+    int e = aresta_entre(ch, a, b);
+    if (e != -1 && ch->meio[e] != -1) {
+        desempacotar(ch, a, ch->meio[e], caminho, tamanho);
+        desempacotar(ch, ch->meio[e], b, caminho, tamanho);
+    } else {
+        caminho[(*tamanho)++] = b;
+    }
+}
+
+// Dijkstra bidirecional ascendente; retorna a cidade de encontro (-1 sem caminho)
+static int consulta_bidirecional(HierarquiaContracao* ch, int origem, int destino,
+                                 int* melhor, int* visitados) {
+    ch->epoca_atual++;
+    if (ch->epoca_atual == 0) {
+        memset(ch->epoca, 0, ch->num_cidades * sizeof(unsigned int));
+        ch->epoca_atual = 1;
+    }
+
+    int fontes[2] = { origem, destino };
+    for (int lado = 0; lado < 2; lado++) {
+        ch->heap[lado]->tamanho = 0;
+        consulta_tocar(ch, fontes[lado]);
+        ch->dist[lado][fontes[lado]] = 0;
+        heap_inserir(ch->heap[lado], 0, fontes[lado]);
+    }
+
+    *melhor = INT_MAX;
+    *visitados = 0;
+    int encontro = -1;
+
+    for (int lado = 0; ch->heap[0]->tamanho > 0 || ch->heap[1]->tamanho > 0; lado = 1 - lado) {
+        HeapCH* h = ch->heap[lado];
+
+        // Um lado para quando seu menor candidato já não melhora o resultado
+        if (h->tamanho == 0 || h->itens[0].chave >= *melhor) {
+            h->tamanho = 0;
+            continue;
+        }
+
+        ItemHeapCH item = heap_remover(h);
+        int u = item.cidade;
+        if (item.chave > ch->dist[lado][u]) continue;  // Entrada obsoleta
+        (*visitados)++;
+
+        int outro = ch->dist[1 - lado][u];
+        if (outro != INT_MAX && item.chave + outro < *melhor) {
+            *melhor = item.chave + outro;
+            encontro = u;
+        }
+
+        for (int e = ch->inicio[u]; e < ch->inicio[u + 1]; e++) {
+            int v = ch->destino[e];
+            consulta_tocar(ch, v);
+            int nova = item.chave + ch->peso[e];
+            if (nova < ch->dist[lado][v]) {
+                ch->dist[lado][v] = nova;
+                ch->anterior[lado][v] = u;
+                heap_inserir(h, nova, v);
+            }
+        }
+    }
+
+    return encontro;
+}
+
+int ch_distancia(HierarquiaContracao* ch, int origem, int destino) {
+    if (!ch || origem < 0 || destino < 0 || origem >= ch->num_cidades || destino >= ch->num_cidades) {
+        return -1;
+    }
+
+    int melhor, visitados;
+    if (consulta_bidirecional(ch, origem, destino, &melhor, &visitados) == -1) return -1;
+    return melhor;
+}
+
+int ch_consultar(HierarquiaContracao* ch, int origem, int destino, ResultadoCaminho* resultado) {
+    if (!resultado) return 0;
+    memset(resultado, 0, sizeof(ResultadoCaminho));
+    if (!ch || origem < 0 || destino < 0 || origem >= ch->num_cidades || destino >= ch->num_cidades) {
+        return 0;
+    }
+
+    int melhor;
+    int encontro = consulta_bidirecional(ch, origem, destino, &melhor, &resultado->nos_visitados);
+    if (encontro == -1) return 0;
+
+    // Cadeias origem -> encontro e destino -> encontro no grafo ascendente
+    int tam_ida = 0;
+    for (int v = encontro; v != -1; v = ch->anterior[0][v]) tam_ida++;
+    int tam_volta = 0;
+    for (int v = encontro; v != -1; v = ch->anterior[1][v]) tam_volta++;
+
+    int* cadeia = (int*)malloc((tam_ida + tam_volta) * sizeof(int));
+    int* caminho = (int*)malloc(ch->num_cidades * sizeof(int));
+    if (!cadeia || !caminho) {
+        free(cadeia);
+        free(caminho);
+        return 0;
+    }
+
+    // Sequência completa de cidades da hierarquia: origem ... encontro ... destino
+    int pos = tam_ida - 1;
+    for (int v = encontro; v != -1; v = ch->anterior[0][v]) cadeia[pos--] = v;
+    pos = tam_ida;
+    for (int v = ch->anterior[1][encontro]; v != -1; v = ch->anterior[1][v]) cadeia[pos++] = v;
+
+    // Expande os atalhos
+    int tamanho = 0;
+    caminho[tamanho++] = cadeia[0];
+    for (int i = 0; i + 1 < pos; i++) {
+        desempacotar(ch, cadeia[i], cadeia[i + 1], caminho, &tamanho);
+    }
+    free(cadeia);
+
+    resultado->caminho = caminho;
+    resultado->tamanho_caminho = tamanho;
+    resultado->distancia_total = melhor;
+    resultado->encontrado = 1;
+    return 1;
+}
+
+void ch_liberar(HierarquiaContracao* ch) {
+    if (!ch) return;
+    free(ch->nivel);
+    free(ch->inicio);
+    free(ch->destino);
+    free(ch->peso);
+    free(ch->meio);
+    free(ch->epoca);
+    for (int lado = 0; lado < 2; lado++) {
+        free(ch->dist[lado]);
+        free(ch->anterior[lado]);
+        heap_liberar(ch->heap[lado]);
+    }
+    free(ch);
+}
+
+// Copia só as tabelas da hierarquia (sem a memória de consulta), para gravar
+// a cópia sem segurar a trava do grafo
+HierarquiaContracao* ch_copiar(const HierarquiaContracao* ch) {
+    if (!ch) return NULL;
+
+    HierarquiaContracao* copia = (HierarquiaContracao*)calloc(1, sizeof(HierarquiaContracao));
+    if (!copia) return NULL;
+
+    int n = ch->num_cidades;
+    int m = ch->num_arestas;
+    copia->num_cidades = n;
+    copia->num_arestas = m;
+    copia->nivel = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    copia->inicio = (int*)malloc((n + 1) * sizeof(int));
+    copia->destino = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    copia->peso = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    copia->meio = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    if (!copia->nivel || !copia->inicio || !copia->destino || !copia->peso || !copia->meio) {
+        ch_liberar(copia);
+        return NULL;
+    }
+
+    memcpy(copia->nivel, ch->nivel, n * sizeof(int));
+    memcpy(copia->inicio, ch->inicio, (n + 1) * sizeof(int));
+    memcpy(copia->destino, ch->destino, m * sizeof(int));
+    memcpy(copia->peso, ch->peso, m * sizeof(int));
+    memcpy(copia->meio, ch->meio, m * sizeof(int));
+    return copia;
+}
+
+// ===== PERSISTÊNCIA =====
+
+// Cabeçalho do arquivo .ch
+typedef struct {
+    char magia[4];
+    int versao;
+    int num_cidades;
+    int num_arestas;
+    unsigned int assinatura;
+} CabecalhoCH;
+
+int ch_salvar(const HierarquiaContracao* ch, const char* arquivo, unsigned int assinatura) {
+    if (!ch || !arquivo) return 0;
+
+    FILE* f = fopen(arquivo, "wb");
+    if (!f) {
+        fprintf(stderr, "[ERRO GRAFO] Não foi possível salvar a hierarquia em: %s\n", arquivo);
+        return 0;
+    }
+
+    CabecalhoCH cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, CH_MAGIA, 4);
+    cab.versao = CH_VERSAO;
+    cab.num_cidades = ch->num_cidades;
+    cab.num_arestas = ch->num_arestas;
+    cab.assinatura = assinatura;
+
+    int n = ch->num_cidades;
+    int m = ch->num_arestas;
+    int ok = fwrite(&cab, sizeof(cab), 1, f) == 1 &&
+             fwrite(ch->nivel, sizeof(int), n, f) == (size_t)n &&
+             fwrite(ch->inicio, sizeof(int), n + 1, f) == (size_t)(n + 1) &&
+             fwrite(ch->destino, sizeof(int), m, f) == (size_t)m &&
+             fwrite(ch->peso, sizeof(int), m, f) == (size_t)m &&
+             fwrite(ch->meio, sizeof(int), m, f) == (size_t)m;
+
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "[ERRO GRAFO] Falha ao gravar a hierarquia em: %s\n", arquivo);
+        remove(arquivo);
+        return 0;
+    }
+
+    fprintf(stderr, "[INFO GRAFO] Hierarquia salva: %d cidades, %d arestas em: %s\n", n, m, arquivo);
+    return 1;
+}
+
+HierarquiaContracao* ch_carregar(const char* arquivo, int num_cidades, unsigned int assinatura) {
+    if (!arquivo) return NULL;
+
+    FILE* f = fopen(arquivo, "rb");
+    if (!f) return NULL;
+
+    CabecalhoCH cab;
+    if (fread(&cab, sizeof(cab), 1, f) != 1 || memcmp(cab.magia, CH_MAGIA, 4) != 0 ||
+        cab.versao != CH_VERSAO || cab.num_cidades != num_cidades ||
+        cab.assinatura != assinatura || cab.num_arestas < 0) {
+        fprintf(stderr, "[INFO GRAFO] Hierarquia em %s não corresponde ao grafo (será reconstruída)\n", arquivo);
+        fclose(f);
+        return NULL;
+    }
+
+    HierarquiaContracao* ch = ch_alocar(cab.num_cidades, cab.num_arestas);
+    if (!ch) {
+        fclose(f);
+        return NULL;
+    }
+
+    int n = cab.num_cidades;
+    int m = cab.num_arestas;
+    int ok = fread(ch->nivel, sizeof(int), n, f) == (size_t)n &&
+             fread(ch->inicio, sizeof(int), n + 1, f) == (size_t)(n + 1) &&
+             fread(ch->destino, sizeof(int), m, f) == (size_t)m &&
+             fread(ch->peso, sizeof(int), m, f) == (size_t)m &&
+             fread(ch->meio, sizeof(int), m, f) == (size_t)m;
+    fclose(f);
+
+    // Confere os limites para não confiar cegamente no arquivo
+    for (int u = 0; ok && u < n; u++) {
+        if (ch->inicio[u] < 0 || ch->inicio[u] > ch->inicio[u + 1]) ok = 0;
+    }
+    if (ok && ch->inicio[n] != m) ok = 0;
+    for (int e = 0; ok && e < m; e++) {
+        if (ch->destino[e] < 0 || ch->destino[e] >= n || ch->meio[e] < -1 || ch->meio[e] >= n) ok = 0;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "[ERRO GRAFO] Arquivo de hierarquia corrompido: %s\n", arquivo);
+        ch_liberar(ch);
+        return NULL;
+    }
+
+    fprintf(stderr, "[INFO GRAFO] Hierarquia carregada: %d cidades, %d arestas de: %s\n", n, m, arquivo);
+    return ch;
+}
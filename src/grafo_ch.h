@@ -0,0 +1,47 @@
+/* grafo_ch.h - Hierarquia de contração (Contraction Hierarchies) sobre o grafo de rotas
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef GRAFO_CH_H
+#define GRAFO_CH_H
+
+#include "grafo.h"
+
+// Grafo "ascendente": cada cidade guarda só as arestas (originais e atalhos)
+// para cidades contraídas depois dela, em formato CSR
+struct HierarquiaContracao {
+    int num_cidades;
+    int num_arestas;
+    int* nivel;                     // Ordem de contração de cada cidade
+    int* inicio;
+    int* destino;
+    int* peso;
+    int* meio;                      // Cidade contraída que o atalho substitui (-1 = aresta original)
+
+    // Memória de trabalho da consulta bidirecional (válida se epoca[v] == epoca_atual)
+    int* dist[2];
+    int* anterior[2];
+    unsigned int* epoca;
+    unsigned int epoca_atual;
+    struct HeapCH* heap[2];
+};
+
+// Constrói a hierarquia a partir do CSR já compactado do grafo
+HierarquiaContracao* ch_construir(Grafo* g);
+
+// Consulta bidirecional ascendente; preenche caminho, distância e nós visitados
+int ch_consultar(HierarquiaContracao* ch, int origem, int destino, ResultadoCaminho* resultado);
+
+// Apenas a distância (-1 se não houver caminho)
+int ch_distancia(HierarquiaContracao* ch, int origem, int destino);
+
+void ch_liberar(HierarquiaContracao* ch);
+
+// Cópia das tabelas, sem a memória de consulta (serve para ch_salvar, não para consultar)
+HierarquiaContracao* ch_copiar(const HierarquiaContracao* ch);
+
+// Persistência binária; a assinatura identifica o grafo que gerou a hierarquia
+int ch_salvar(const HierarquiaContracao* ch, const char* arquivo, unsigned int assinatura);
+HierarquiaContracao* ch_carregar(const char* arquivo, int num_cidades, unsigned int assinatura);
+
+#endif // GRAFO_CH_H
@@ -0,0 +1,314 @@
+/* grafo_snapshot.c - Snapshot binário do grafo (carregado via mmap)
+ * GenieC - Assistente Inteligente
+ */
+
+#include "grafo_snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static unsigned int checksum(const void* dados, size_t tamanho) {
+    const unsigned char* p = (const unsigned char*)dados;
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < tamanho; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t alinhar(size_t tamanho) {
+    return (tamanho + 7) & ~(size_t)7;
+}
+
+// Arquivo mapeado somente para leitura
+typedef struct {
+    const unsigned char* dados;
+    size_t tamanho;
+#ifdef _WIN32
+    HANDLE arquivo;
+    HANDLE mapeamento;
+#endif
+} ArquivoMapeado;
+
+static int mapear_arquivo(const char* caminho, ArquivoMapeado* m) {
+    memset(m, 0, sizeof(*m));
+#ifdef _WIN32
+    m->arquivo = CreateFileA(caminho, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->arquivo == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER tamanho;
+    if (!GetFileSizeEx(m->arquivo, &tamanho) || tamanho.QuadPart == 0) {
+        CloseHandle(m->arquivo);
+        return 0;
+    }
+    m->mapeamento = CreateFileMappingA(m->arquivo, NULL, PAGE_READONLY, 0, 0, NULL);
+    m->dados = m->mapeamento ? (const unsigned char*)MapViewOfFile(m->mapeamento, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!m->dados) {
+        if (m->mapeamento) CloseHandle(m->mapeamento);
+        CloseHandle(m->arquivo);
+        return 0;
+    }
+    m->tamanho = (size_t)tamanho.QuadPart;
+#else
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void* dados = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dados == MAP_FAILED) return 0;
+
+    m->dados = (const unsigned char*)dados;
+    m->tamanho = (size_t)st.st_size;
+#endif
+    return 1;
+}
+
+static void desmapear_arquivo(ArquivoMapeado* m) {
+    if (!m->dados) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m->dados);
+    CloseHandle(m->mapeamento);
+    CloseHandle(m->arquivo);
+#else
+    munmap((void*)m->dados, m->tamanho);
+#endif
+    m->dados = NULL;
+}
+
+int grafo_snapshot_salvar(Grafo* g, const char* arquivo) {
+    if (!g || !arquivo) return 0;
+    grafo_compactar(g);
+
+    int n = g->num_cidades;
+    int m = g->csr_num_entradas;
+
+    // Tabela de nomes e de cidades
+    size_t tamanho_nomes = 0;
+    for (int i = 0; i < n; i++) {
+        tamanho_nomes += strlen(g->cidades[i].nome) + 1;
+    }
+
+    NoSnapshot* nos = (NoSnapshot*)calloc(n > 0 ? n : 1, sizeof(NoSnapshot));
+    char* nomes = (char*)malloc(alinhar(tamanho_nomes) + 1);
+    if (!nos || !nomes) {
+        free(nos);
+        free(nomes);
+        return 0;
+    }
+
+    size_t deslocamento = 0;
+    for (int i = 0; i < n; i++) {
+        size_t len = strlen(g->cidades[i].nome) + 1;
+        memcpy(nomes + deslocamento, g->cidades[i].nome, len);
+        nos[i].nome = (int)deslocamento;
+        nos[i].coords_validas = g->cidades[i].coords_validas;
+        nos[i].latitude = g->cidades[i].latitude;
+        nos[i].longitude = g->cidades[i].longitude;
+        deslocamento += len;
+    }
+    memset(nomes + tamanho_nomes, 0, alinhar(tamanho_nomes) - tamanho_nomes);
+
+    // O CSR de um grafo vazio não tem nem o vetor de início
+    int inicio_vazio = 0;
+    const int* inicio = n > 0 ? g->csr_inicio : &inicio_vazio;
+
+    CabecalhoSnapshot cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, SNAPSHOT_MAGIA, 4);
+    cab.versao = SNAPSHOT_VERSAO;
+    cab.num_cidades = n;
+    cab.num_entradas = m;
+    cab.tamanho_nomes = (int)tamanho_nomes;
+    cab.soma_cidades = checksum(nos, (size_t)n * sizeof(NoSnapshot));
+    cab.soma_csr = checksum(inicio, (size_t)(n + 1) * sizeof(int)) ^
+                   checksum(g->csr_destino, (size_t)m * sizeof(int)) * 31u ^
+                   checksum(g->csr_peso, (size_t)m * sizeof(int)) * 131u;
+    cab.soma_nomes = checksum(nomes, tamanho_nomes);
+
+    // Escreve num temporário e renomeia, para nunca deixar um snapshot pela metade
+    char temporario[512];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", arquivo);
+    FILE* f = fopen(temporario, "wb");
+    if (!f) {
+        fprintf(stderr, "[ERRO GRAFO] Não foi possível salvar o snapshot em: %s\n", temporario);
+        free(nos);
+        free(nomes);
+        return 0;
+    }
+
+    static const char zeros[8] = {0};
+    size_t bytes_csr = (size_t)(n + 1 + 2 * m) * sizeof(int);
+    int ok = fwrite(&cab, sizeof(cab), 1, f) == 1 &&
+             fwrite(nos, sizeof(NoSnapshot), n, f) == (size_t)n &&
+             fwrite(inicio, sizeof(int), n + 1, f) == (size_t)(n + 1) &&
+             fwrite(g->csr_destino, sizeof(int), m, f) == (size_t)m &&
+             fwrite(g->csr_peso, sizeof(int), m, f) == (size_t)m &&
+             fwrite(zeros, 1, alinhar(bytes_csr) - bytes_csr, f) == alinhar(bytes_csr) - bytes_csr &&
+             fwrite(nomes, 1, alinhar(tamanho_nomes), f) == alinhar(tamanho_nomes);
+    if (fclose(f) != 0) ok = 0;
+    free(nos);
+    free(nomes);
+
+    if (!ok) {
+        fprintf(stderr, "[ERRO GRAFO] Falha ao gravar o snapshot em: %s\n", arquivo);
+        remove(temporario);
+        return 0;
+    }
+#ifdef _WIN32
+    // rename não substitui um arquivo existente no Windows
+    int trocado = MoveFileExA(temporario, arquivo, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    int trocado = rename(temporario, arquivo) == 0;
+#endif
+    if (!trocado) {
+        // O snapshot anterior continua inteiro (e o texto decide se ele ainda vale)
+        fprintf(stderr, "[ERRO GRAFO] Não foi possível substituir o snapshot %s\n", arquivo);
+        return 0;
+    }
+
+    fprintf(stderr, "[INFO GRAFO] Snapshot salvo: %d cidades, %d entradas CSR em: %s\n", n, m, arquivo);
+    return 1;
+}
+
+// Confere cabeçalho, tamanhos, checksums e limites antes de usar o conteúdo
+static int snapshot_valido(const ArquivoMapeado* arq, const CabecalhoSnapshot** cab_saida) {
+    if (arq->tamanho < sizeof(CabecalhoSnapshot)) return 0;
+
+    const CabecalhoSnapshot* cab = (const CabecalhoSnapshot*)arq->dados;
+    if (memcmp(cab->magia, SNAPSHOT_MAGIA, 4) != 0 || cab->versao != SNAPSHOT_VERSAO ||
+        cab->num_cidades < 0 || cab->num_entradas < 0 || cab->tamanho_nomes < 0) {
+        return 0;
+    }
+
+    size_t n = (size_t)cab->num_cidades;
+    size_t m = (size_t)cab->num_entradas;
+    size_t bytes_csr = (n + 1 + 2 * m) * sizeof(int);
+    size_t esperado = sizeof(CabecalhoSnapshot) + n * sizeof(NoSnapshot) +
+                      alinhar(bytes_csr) + alinhar((size_t)cab->tamanho_nomes);
+    if (arq->tamanho != esperado) return 0;
+
+    const NoSnapshot* nos = (const NoSnapshot*)(arq->dados + sizeof(CabecalhoSnapshot));
+    const int* inicio = (const int*)(nos + n);
+    const int* destino = inicio + n + 1;
+    const int* peso = destino + m;
+    const char* nomes = (const char*)inicio + alinhar(bytes_csr);
+
+    if (checksum(nos, n * sizeof(NoSnapshot)) != cab->soma_cidades ||
+        (checksum(inicio, (n + 1) * sizeof(int)) ^
+         checksum(destino, m * sizeof(int)) * 31u ^
+         checksum(peso, m * sizeof(int)) * 131u) != cab->soma_csr ||
+        checksum(nomes, (size_t)cab->tamanho_nomes) != cab->soma_nomes) {
+        return 0;
+    }
+
+    if (inicio[0] != 0 || inicio[n] != (int)m) return 0;
+    for (size_t u = 0; u < n; u++) {
+        if (inicio[u] > inicio[u + 1]) return 0;
+        if (nos[u].nome < 0 || nos[u].nome >= cab->tamanho_nomes) return 0;
+    }
+    for (size_t e = 0; e < m; e++) {
+        if (destino[e] < 0 || destino[e] >= (int)n || peso[e] <= 0) return 0;
+    }
+    if (cab->tamanho_nomes > 0 && nomes[cab->tamanho_nomes - 1] != '\0') return 0;
+
+    *cab_saida = cab;
+    return 1;
+}
+
+int grafo_snapshot_carregar(Grafo* g, const char* arquivo) {
+    if (!g || !arquivo || g->num_cidades > 0) return -1;
+
+    ArquivoMapeado arq;
+    if (!mapear_arquivo(arquivo, &arq)) return -1;
+
+    const CabecalhoSnapshot* cab = NULL;
+    if (!snapshot_valido(&arq, &cab)) {
+        fprintf(stderr, "[AVISO GRAFO] Snapshot %s inválido ou de outra versão; usando o arquivo texto\n", arquivo);
+        desmapear_arquivo(&arq);
+        return -1;
+    }
+
+    int n = cab->num_cidades;
+    int m = cab->num_entradas;
+    const NoSnapshot* nos = (const NoSnapshot*)(arq.dados + sizeof(CabecalhoSnapshot));
+    const int* inicio = (const int*)(nos + n);
+    const char* nomes = (const char*)inicio + alinhar((size_t)(n + 1 + 2 * m) * sizeof(int));
+
+    // Tabela de nós: cada cidade precisa da chave normalizada e da entrada no índice
+    for (int i = 0; i < n; i++) {
+        if (adicionar_cidade(g, nomes + nos[i].nome) != i) {
+            fprintf(stderr, "[AVISO GRAFO] Snapshot %s com cidades repetidas; usando o arquivo texto\n", arquivo);
+            desmapear_arquivo(&arq);
+            limpar_grafo(g);
+            return -1;
+        }
+        g->cidades[i].coords_validas = nos[i].coords_validas;
+        g->cidades[i].latitude = nos[i].latitude;
+        g->cidades[i].longitude = nos[i].longitude;
+    }
+
+    // Adjacência copiada em bloco (o grafo é dono do CSR, que a compactação realoca)
+    int* csr_inicio = (int*)malloc((n + 1) * sizeof(int));
+    int* csr_destino = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    int* csr_peso = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    if (!csr_inicio || !csr_destino || !csr_peso) {
+        free(csr_inicio);
+        free(csr_destino);
+        free(csr_peso);
+        desmapear_arquivo(&arq);
+        limpar_grafo(g);
+        return -1;
+    }
+    memcpy(csr_inicio, inicio, (n + 1) * sizeof(int));
+    memcpy(csr_destino, inicio + n + 1, m * sizeof(int));
+    memcpy(csr_peso, inicio + n + 1 + m, m * sizeof(int));
+    desmapear_arquivo(&arq);
+
+    free(g->csr_inicio);
+    free(g->csr_destino);
+    free(g->csr_peso);
+    g->csr_inicio = csr_inicio;
+    g->csr_destino = csr_destino;
+    g->csr_peso = csr_peso;
+    g->csr_num_cidades = n;
+    g->csr_num_entradas = m;
+    g->astar_verificado = 0;
+    grafo_recalcular_componentes(g);
+
+    fprintf(stderr, "[INFO GRAFO] Snapshot carregado: %d cidades, %d conexões de: %s\n", n, m / 2, arquivo);
+    return n;
+}
+
+int grafo_snapshot_de_texto(const char* arquivo_texto, const char* arquivo_snapshot) {
+    Grafo* g = criar_grafo();
+    if (!g) return 0;
+
+    int ok = carregar_texto_grafo(g, arquivo_texto) > 0 && grafo_snapshot_salvar(g, arquivo_snapshot);
+    liberar_grafo(g);
+    return ok;
+}
+
+int grafo_snapshot_para_texto(const char* arquivo_snapshot, const char* arquivo_texto) {
+    Grafo* g = criar_grafo();
+    if (!g) return 0;
+
+    int ok = grafo_snapshot_carregar(g, arquivo_snapshot) >= 0 && salvar_texto_grafo(g, arquivo_texto) >= 0;
+    liberar_grafo(g);
+    return ok;
+}
@@ -0,0 +1,47 @@
+/* grafo_snapshot.h - Snapshot binário do grafo (carregado via mmap)
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef GRAFO_SNAPSHOT_H
+#define GRAFO_SNAPSHOT_H
+
+#include "grafo.h"
+
+// Layout do arquivo (.bin), todas as seções alinhadas a 8 bytes:
+//   CabecalhoSnapshot
+//   NoSnapshot[num_cidades]
+//   int inicio[num_cidades + 1], destino[num_entradas], peso[num_entradas]   (CSR)
+//   char nomes[tamanho_nomes]                                                  (terminados em '\0')
+#define SNAPSHOT_MAGIA "GSNP"
+#define SNAPSHOT_VERSAO 1
+
+typedef struct {
+    char magia[4];
+    int versao;
+    int num_cidades;
+    int num_entradas;               // Arestas direcionadas do CSR
+    int tamanho_nomes;              // Bytes da tabela de nomes
+    unsigned int soma_cidades;      // Checksums (FNV-1a) de cada seção
+    unsigned int soma_csr;
+    unsigned int soma_nomes;
+} CabecalhoSnapshot;
+
+typedef struct {
+    int nome;                       // Deslocamento na tabela de nomes
+    int coords_validas;
+    double latitude;
+    double longitude;
+} NoSnapshot;
+
+// Grava o grafo (compacta o CSR antes); retorna 1 em caso de sucesso
+int grafo_snapshot_salvar(Grafo* g, const char* arquivo);
+
+// Carrega em um grafo vazio; retorna o número de cidades ou -1 se o arquivo
+// estiver ausente, corrompido ou o grafo já tiver cidades
+int grafo_snapshot_carregar(Grafo* g, const char* arquivo);
+
+// Conversores entre o formato texto (coordenadas_grafo.txt) e o snapshot
+int grafo_snapshot_de_texto(const char* arquivo_texto, const char* arquivo_snapshot);
+int grafo_snapshot_para_texto(const char* arquivo_snapshot, const char* arquivo_texto);
+
+#endif // GRAFO_SNAPSHOT_H
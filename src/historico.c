@@ -20,10 +20,20 @@ HistoricoChat* inicializar_chat_historico() {
     history->turno = NULL;
     history->contador = 0;
     history->capacidade = 0;
+    history->tamanho_json = NULL;
+    sb_iniciar(&history->turnos_json, 1024);
 
     return history;
 }
 
+void historico_serializar_turno(StrBuilder* sb, const char* role, const char* text) {
+    sb_anexar(sb, "{\"parts\":[{\"text\":");
+    sb_anexar_json_string(sb, text);
+    sb_anexar(sb, "}],\"role\":");
+    sb_anexar_json_string(sb, role);
+    sb_anexar_n(sb, "}", 1);
+}
+
 // Adiciona um turno ao histórico com limite automático
 void adicionar_turno(HistoricoChat* historico, const char* role, const char* text) {
     // Verifica se precisa expandir o array
@@ -39,36 +49,61 @@ void adicionar_turno(HistoricoChat* historico, const char* role, const char* tex
             historico->turno,
             nova_capacidade * sizeof(TurnoMensagem)
         );
+        if (novos_turnos != NULL) {
+            historico->turno = novos_turnos;
+        }
 
-        if (novos_turnos == NULL) {
+        size_t* novos_tamanhos = (size_t*)realloc(historico->tamanho_json, nova_capacidade * sizeof(size_t));
+        if (novos_tamanhos != NULL) {
+            historico->tamanho_json = novos_tamanhos;
+        }
+
+        if (novos_turnos == NULL || novos_tamanhos == NULL) {
             fprintf(stderr, "Erro ao alocar memória para os turnos do histórico.\n");
             return;
         }
 
-        historico->turno = novos_turnos;
         historico->capacidade = nova_capacidade;
     }
 
     // Adiciona o novo turno
-    TurnoMensagem* turno_atual = &historico->turno[historico->contador++];
+    TurnoMensagem* turno_atual = &historico->turno[historico->contador];
     turno_atual->role = strdup(role);
     turno_atual->text = strdup(text);
 
-    // Limita o histórico ao máximo definido
+    // Serializa uma única vez; o payload só copia os bytes
+    size_t antes = historico->turnos_json.tamanho;
+    historico_serializar_turno(&historico->turnos_json, role, text);
+    sb_anexar_n(&historico->turnos_json, ",", 1);
+    historico->tamanho_json[historico->contador] = historico->turnos_json.tamanho - antes;
+    historico->contador++;
+
+    // Limita o histórico ao máximo definido. Os turnos antigos saem em blocos
+    // (não um por mensagem): o cache de contexto do Gemini guarda o início da
+    // conversa e só precisa ser refeito quando esse início muda
     if (historico->contador > MAX_HISTORY_TURNS) {
-        // Remove o turno mais antigo
-        TurnoMensagem* turno_antigo = &historico->turno[0];
-        free(turno_antigo->role);
-        free(turno_antigo->text);
-
-        // Move todos os turnos uma posição para frente
-        memmove(
-            turno_antigo,
-            turno_antigo + 1,
-            (historico->contador - 1) * sizeof(TurnoMensagem)
-        );
+        int removidos = HISTORICO_DESCARTE_BLOCO;
+        if (removidos < historico->contador - MAX_HISTORY_TURNS) removidos = historico->contador - MAX_HISTORY_TURNS;
+        if (removidos > historico->contador) removidos = historico->contador;
+
+        size_t bytes_removidos = 0;
+        for (int i = 0; i < removidos; i++) {
+            free(historico->turno[i].role);
+            free(historico->turno[i].text);
+            bytes_removidos += historico->tamanho_json[i];
+        }
+        historico->contador -= removidos;
 
-        historico->contador--;
+        // Move os turnos restantes para o início
+        memmove(historico->turno, historico->turno + removidos, historico->contador * sizeof(TurnoMensagem));
+
+        // Tira os turnos removidos do início do trecho serializado
+        StrBuilder* json = &historico->turnos_json;
+        if (!json->erro) {
+            memmove(json->dados, json->dados + bytes_removidos, json->tamanho - bytes_removidos + 1);
+            json->tamanho -= bytes_removidos;
+        }
+        memmove(historico->tamanho_json, historico->tamanho_json + removidos, historico->contador * sizeof(size_t));
     }
 }
 
@@ -80,10 +115,42 @@ void liberar_historico_chat(HistoricoChat* historico) {
             free(historico->turno[i].text);
         }
         free(historico->turno);
+        free(historico->tamanho_json);
+        sb_liberar(&historico->turnos_json);
         free(historico);
     }
 }
 
+// Cria uma cópia independente do histórico (usada pelas threads de trabalho)
+// O trecho serializado é copiado byte a byte, sem escapar os turnos de novo
+HistoricoChat* copiar_historico(const HistoricoChat* historico) {
+    HistoricoChat* copia = inicializar_chat_historico();
+    if (copia == NULL || historico == NULL || historico->contador == 0) return copia;
+
+    copia->turno = (TurnoMensagem*)malloc(historico->contador * sizeof(TurnoMensagem));
+    copia->tamanho_json = (size_t*)malloc(historico->contador * sizeof(size_t));
+    if (copia->turno == NULL || copia->tamanho_json == NULL) {
+        fprintf(stderr, "Erro ao alocar memória para os turnos do histórico.\n");
+        return copia;
+    }
+    copia->capacidade = historico->contador;
+
+    for (int i = 0; i < historico->contador; i++) {
+        copia->turno[i].role = strdup(historico->turno[i].role);
+        copia->turno[i].text = strdup(historico->turno[i].text);
+    }
+    memcpy(copia->tamanho_json, historico->tamanho_json, historico->contador * sizeof(size_t));
+    copia->contador = historico->contador;
+
+    if (historico->turnos_json.erro) {
+        copia->turnos_json.erro = 1;
+    } else {
+        sb_anexar_n(&copia->turnos_json, historico->turnos_json.dados, historico->turnos_json.tamanho);
+    }
+
+    return copia;
+}
+
 // Exibe o histórico completo em tela separada
 void exibir_historico(HistoricoChat* historico) {
     // Limpa a tela para mostrar apenas o histórico
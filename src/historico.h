@@ -1,6 +1,8 @@
 #ifndef HISTORICO_H
 #define HISTORICO_H
 
+#include "str_builder.h"
+
 // Estrutura para mensagem individual
 typedef struct {
     char* role;
@@ -12,13 +14,22 @@ typedef struct {
     TurnoMensagem* turno;
     int contador;
     int capacidade;
+
+    // Turnos já serializados como itens de "contents" da API (cada um seguido de ','),
+    // para o payload de cada mensagem não reescapar a conversa inteira
+    StrBuilder turnos_json;
+    size_t* tamanho_json;           // Bytes de cada turno em turnos_json
 } HistoricoChat;
 
 // Funções de gerenciamento do histórico
 HistoricoChat* inicializar_chat_historico();
 void adicionar_turno(HistoricoChat* historico, const char* role, const char* text);
 void liberar_historico_chat(HistoricoChat* historico);
+HistoricoChat* copiar_historico(const HistoricoChat* historico);
 void exibir_historico(HistoricoChat* historico);
 
+// Serializa um turno no formato de "contents" da API: {"parts":[{"text":...}],"role":...}
+void historico_serializar_turno(StrBuilder* sb, const char* role, const char* text);
+
 #endif // HISTORICO_H
 
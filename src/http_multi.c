@@ -0,0 +1,294 @@
+/* http_multi.c - Motor de requisições concorrentes (curl_multi + HTTP/2)
+ * GenieC - Assistente Inteligente
+ *
+ * Uma única thread roda o laço de eventos do curl_multi. As outras threads só
+ * enfileiram requisições e esperam a conclusão; as transferências ao mesmo host
+ * viram streams de uma conexão HTTP/2 em vez de disputar conexões separadas.
+ */
+
+#include "http_multi.h"
+#include "http_utils.h"
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct HttpMultiRequisicao {
+    CURL* handle;
+    struct curl_slist* headers;
+    char* url;
+    char* payload;                  // NULL = GET
+    struct MemoryStruct corpo;
+    CURLcode resultado;
+    long codigo_http;
+    HttpMultiCallback ao_concluir;
+    void* userdata;
+    int concluida;
+    HttpMultiRequisicao* proxima;   // Fila de entrada do laço de eventos
+};
+
+// Estado do motor (tudo protegido por trava_motor, exceto o multi, que só a thread do laço usa)
+static pthread_mutex_t trava_motor = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_concluida = PTHREAD_COND_INITIALIZER;
+static CURLM* multi = NULL;
+static pthread_t thread_motor;
+static int motor_ativo = 0;
+static int encerrando = 0;
+static HttpMultiRequisicao* fila_inicio = NULL;
+static HttpMultiRequisicao* fila_fim = NULL;
+
+// Handles próprios do motor, usados só pela thread do laço. Ficam fora do
+// CURLSH do pool: as conexões (e os streams HTTP/2 multiplexados) vivem no
+// cache do próprio multi, que a libcurl não permite dividir entre threads
+static CURL* handles_livres[HTTP_POOL_TAMANHO];
+static int num_handles_livres = 0;
+
+static CURL* obter_handle_motor(void) {
+    CURL* handle = num_handles_livres > 0 ? handles_livres[--num_handles_livres] : curl_easy_init();
+    if (handle) http_aplicar_opcoes_padrao(handle);
+    return handle;
+}
+
+static void devolver_handle_motor(CURL* handle) {
+    curl_easy_reset(handle);
+    if (num_handles_livres < HTTP_POOL_TAMANHO) {
+        handles_livres[num_handles_livres++] = handle;
+    } else {
+        curl_easy_cleanup(handle);
+    }
+}
+
+static void liberar_requisicao(HttpMultiRequisicao* req) {
+    if (req->headers) curl_slist_free_all(req->headers);
+    free(req->corpo.memory);
+    free(req->url);
+    free(req->payload);
+    free(req);
+}
+
+// Registra o resultado, avisa o callback e acorda quem estiver aguardando
+static void concluir_requisicao(HttpMultiRequisicao* req) {
+    if (req->resultado != CURLE_OK) {
+        fprintf(stderr, "[AVISO HTTP MULTI] Requisição falhou: %s\n", curl_easy_strerror(req->resultado));
+    } else if (req->codigo_http != 200) {
+        fprintf(stderr, "[AVISO HTTP MULTI] Erro HTTP %ld\n", req->codigo_http);
+    }
+    if (req->resultado != CURLE_OK || req->codigo_http != 200) {
+        free(req->corpo.memory);
+        req->corpo.memory = NULL;
+        req->corpo.size = 0;
+    }
+
+    if (req->ao_concluir) {
+        req->ao_concluir(req->corpo.memory, req->codigo_http, req->userdata);
+    }
+
+    pthread_mutex_lock(&trava_motor);
+    req->concluida = 1;
+    pthread_cond_broadcast(&cond_concluida);
+    pthread_mutex_unlock(&trava_motor);
+}
+
+// Pega um handle do pool e o prepara para multiplexar; retorna 0 se a
+// requisição já foi concluída com erro
+static int preparar_requisicao(HttpMultiRequisicao* req) {
+    req->handle = obter_handle_motor();
+    if (!req->handle) {
+        req->resultado = CURLE_FAILED_INIT;
+        return 0;
+    }
+
+    curl_easy_setopt(req->handle, CURLOPT_URL, req->url);
+    if (req->payload) {
+        req->headers = curl_slist_append(req->headers, "Content-Type: application/json");
+        curl_easy_setopt(req->handle, CURLOPT_HTTPHEADER, req->headers);
+        curl_easy_setopt(req->handle, CURLOPT_POSTFIELDS, req->payload);
+    }
+    curl_easy_setopt(req->handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(req->handle, CURLOPT_PIPEWAIT, 1L);    // Espera a conexão HTTP/2 em vez de abrir outra
+    curl_easy_setopt(req->handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    curl_easy_setopt(req->handle, CURLOPT_WRITEDATA, (void*)&req->corpo);
+    curl_easy_setopt(req->handle, CURLOPT_PRIVATE, (void*)req);
+
+    if (curl_multi_add_handle(multi, req->handle) != CURLM_OK) {
+        devolver_handle_motor(req->handle);
+        req->handle = NULL;
+        req->resultado = CURLE_FAILED_INIT;
+        return 0;
+    }
+    return 1;
+}
+
+static void* laco_eventos(void* arg) {
+    (void)arg;
+    int em_andamento = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&trava_motor);
+        HttpMultiRequisicao* novas = fila_inicio;
+        fila_inicio = fila_fim = NULL;
+        int sair = encerrando;
+        pthread_mutex_unlock(&trava_motor);
+
+        while (novas) {
+            HttpMultiRequisicao* req = novas;
+            novas = req->proxima;
+            if (preparar_requisicao(req)) {
+                em_andamento++;
+            } else {
+                concluir_requisicao(req);
+            }
+        }
+
+        // No encerramento termina o que já foi submetido antes de sair
+        if (sair && em_andamento == 0) break;
+
+        int rodando = 0;
+        curl_multi_perform(multi, &rodando);
+
+        CURLMsg* msg;
+        int restantes;
+        while ((msg = curl_multi_info_read(multi, &restantes))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            HttpMultiRequisicao* req = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+            req->resultado = msg->data.result;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &req->codigo_http);
+
+            curl_multi_remove_handle(multi, msg->easy_handle);
+            devolver_handle_motor(msg->easy_handle);
+            req->handle = NULL;
+            em_andamento--;
+
+            concluir_requisicao(req);
+        }
+
+        // Dorme até haver atividade nos sockets ou um curl_multi_wakeup
+        curl_multi_poll(multi, NULL, 0, 1000, NULL);
+    }
+    return NULL;
+}
+
+int http_multi_iniciar(void) {
+    if (!http_inicializar()) return 0;
+
+    pthread_mutex_lock(&trava_motor);
+    if (motor_ativo) {
+        pthread_mutex_unlock(&trava_motor);
+        return 1;
+    }
+
+    multi = curl_multi_init();
+    if (!multi) {
+        pthread_mutex_unlock(&trava_motor);
+        fprintf(stderr, "[AVISO HTTP MULTI] curl_multi indisponível; requisições seguem bloqueantes\n");
+        return 0;
+    }
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)HTTP_MULTI_CONEXOES_HOST);
+    curl_multi_setopt(multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long)HTTP_MULTI_STREAMS_CONEXAO);
+
+    encerrando = 0;
+    if (pthread_create(&thread_motor, NULL, laco_eventos, NULL) != 0) {
+        curl_multi_cleanup(multi);
+        multi = NULL;
+        pthread_mutex_unlock(&trava_motor);
+        fprintf(stderr, "[AVISO HTTP MULTI] Não foi possível criar a thread do motor\n");
+        return 0;
+    }
+    motor_ativo = 1;
+    pthread_mutex_unlock(&trava_motor);
+
+    fprintf(stderr, "[INFO HTTP MULTI] Motor de requisições concorrentes iniciado\n");
+    return 1;
+}
+
+void http_multi_finalizar(void) {
+    pthread_mutex_lock(&trava_motor);
+    if (!motor_ativo) {
+        pthread_mutex_unlock(&trava_motor);
+        return;
+    }
+    encerrando = 1;
+    pthread_mutex_unlock(&trava_motor);
+
+    curl_multi_wakeup(multi);
+    pthread_join(thread_motor, NULL);
+
+    pthread_mutex_lock(&trava_motor);
+    curl_multi_cleanup(multi);
+    multi = NULL;
+    while (num_handles_livres > 0) {
+        curl_easy_cleanup(handles_livres[--num_handles_livres]);
+    }
+    motor_ativo = 0;
+    pthread_mutex_unlock(&trava_motor);
+}
+
+HttpMultiRequisicao* http_multi_submeter(const char* url, const char* payload,
+                                         HttpMultiCallback ao_concluir, void* userdata) {
+    if (!url) return NULL;
+
+    HttpMultiRequisicao* req = (HttpMultiRequisicao*)calloc(1, sizeof(HttpMultiRequisicao));
+    if (!req) return NULL;
+
+    req->url = strdup(url);
+    req->payload = payload ? strdup(payload) : NULL;
+    req->corpo.memory = malloc(1);
+    if (!req->url || (payload && !req->payload) || !req->corpo.memory) {
+        liberar_requisicao(req);
+        return NULL;
+    }
+    req->corpo.memory[0] = '\0';
+    req->ao_concluir = ao_concluir;
+    req->userdata = userdata;
+
+    pthread_mutex_lock(&trava_motor);
+    int enfileirada = motor_ativo && !encerrando;
+    if (enfileirada) {
+        if (fila_fim) {
+            fila_fim->proxima = req;
+        } else {
+            fila_inicio = req;
+        }
+        fila_fim = req;
+    }
+    pthread_mutex_unlock(&trava_motor);
+
+    if (enfileirada) {
+        curl_multi_wakeup(multi);
+        return req;
+    }
+
+    // Motor inativo: mesma requisição, bloqueante
+    free(req->corpo.memory);
+    req->corpo.memory = payload ? fazer_requisicao_http(url, payload) : http_get(url);
+    req->corpo.size = req->corpo.memory ? strlen(req->corpo.memory) : 0;
+    req->codigo_http = req->corpo.memory ? 200 : 0;
+    if (req->ao_concluir) {
+        req->ao_concluir(req->corpo.memory, req->codigo_http, req->userdata);
+    }
+    req->concluida = 1;
+    return req;
+}
+
+char* http_multi_aguardar(HttpMultiRequisicao* req, long* codigo_http) {
+    if (!req) {
+        if (codigo_http) *codigo_http = 0;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&trava_motor);
+    while (!req->concluida) {
+        pthread_cond_wait(&cond_concluida, &trava_motor);
+    }
+    pthread_mutex_unlock(&trava_motor);
+
+    if (codigo_http) *codigo_http = req->codigo_http;
+    char* resposta = req->corpo.memory;
+    req->corpo.memory = NULL;
+    liberar_requisicao(req);
+    return resposta;
+}
@@ -0,0 +1,32 @@
+/* http_multi.h - Motor de requisições concorrentes (curl_multi + HTTP/2)
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef HTTP_MULTI_H
+#define HTTP_MULTI_H
+
+typedef struct HttpMultiRequisicao HttpMultiRequisicao;
+
+// Chamado na thread do motor assim que a requisição termina (resposta NULL em
+// caso de falha). Deve ser rápido; a resposta continua sendo entregue (e
+// pertencendo) a quem chamar http_multi_aguardar
+typedef void (*HttpMultiCallback)(const char* resposta, long codigo_http, void* userdata);
+
+// Cria a thread do laço de eventos (idempotente); retorna 0 se não foi possível
+int http_multi_iniciar(void);
+
+// Conclui as requisições pendentes e encerra a thread
+void http_multi_finalizar(void);
+
+// Enfileira um GET (payload NULL) ou POST JSON e retorna sem bloquear.
+// Requisições ao mesmo host compartilham uma conexão HTTP/2 (streams multiplexados).
+// Com o motor inativo a requisição é feita na hora, na thread atual.
+// Toda requisição submetida precisa de exatamente um http_multi_aguardar
+HttpMultiRequisicao* http_multi_submeter(const char* url, const char* payload,
+                                         HttpMultiCallback ao_concluir, void* userdata);
+
+// Bloqueia até a requisição terminar, libera-a e devolve o corpo da resposta
+// (NULL em erro de rede ou HTTP != 200); codigo_http pode ser NULL
+char* http_multi_aguardar(HttpMultiRequisicao* req, long* codigo_http);
+
+#endif // HTTP_MULTI_H
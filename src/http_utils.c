@@ -1,5 +1,12 @@
 /* http_utils.c - Utilitários para requisições HTTP
  * GenieC - Assistente Inteligente
+ *
+ * A libcurl é inicializada uma única vez por processo. Os handles ficam em um
+ * pool e compartilham (via CURLSH) o cache de DNS e as sessões TLS. As conexões
+ * não entram no CURLSH (a libcurl não suporta dividi-las entre threads
+ * concorrentes): cada handle guarda as suas entre usos, e o pool entrega de
+ * preferência o handle que já falou com o mesmo host, de forma que requisições
+ * seguidas reaproveitam a conexão aberta em vez de refazer DNS + TCP + TLS.
  */
 
 #include "http_utils.h"
@@ -8,6 +15,212 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+// Estado global do cliente HTTP
+static pthread_once_t http_once = PTHREAD_ONCE_INIT;
+static int http_inicializado = 0;
+static CURLSH* http_share = NULL;
+static pthread_mutex_t http_share_travas[CURL_LOCK_DATA_LAST];
+
+// Pool de handles ociosos, cada um com o host da última requisição (é com ele
+// que a conexão guardada no handle continua aberta)
+typedef struct {
+    CURL* handle;
+    char host[128];
+} HandleOcioso;
+
+static pthread_mutex_t http_pool_trava = PTHREAD_MUTEX_INITIALIZER;
+static HandleOcioso http_pool[HTTP_POOL_TAMANHO];
+static int http_pool_livres = 0;
+
+// Pré-aquecimentos em andamento (http_finalizar espera terminarem)
+static pthread_mutex_t http_preaquecer_trava = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t http_preaquecer_cond = PTHREAD_COND_INITIALIZER;
+static int http_preaquecimentos = 0;
+
+// Callbacks de trava exigidos pelo CURLSH quando usado por várias threads
+static void http_share_travar(CURL* handle, curl_lock_data data, curl_lock_access acesso, void* userp) {
+    (void)handle; (void)acesso; (void)userp;
+    pthread_mutex_lock(&http_share_travas[data]);
+}
+
+static void http_share_destravar(CURL* handle, curl_lock_data data, void* userp) {
+    (void)handle; (void)userp;
+    pthread_mutex_unlock(&http_share_travas[data]);
+}
+
+static void http_inicializar_uma_vez(void) {
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+        fprintf(stderr, "Erro ao iniciar o cURL\n");
+        return;
+    }
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&http_share_travas[i], NULL);
+    }
+
+    http_share = curl_share_init();
+    if (http_share) {
+        curl_share_setopt(http_share, CURLSHOPT_LOCKFUNC, http_share_travar);
+        curl_share_setopt(http_share, CURLSHOPT_UNLOCKFUNC, http_share_destravar);
+        curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    } else {
+        fprintf(stderr, "[AVISO HTTP] Não foi possível criar o CURLSH; seguindo sem compartilhamento\n");
+    }
+
+    http_inicializado = 1;
+}
+
+// Inicializa a libcurl e o objeto de compartilhamento (idempotente)
+int http_inicializar(void) {
+    pthread_once(&http_once, http_inicializar_uma_vez);
+    return http_inicializado;
+}
+
+// Libera o pool, o CURLSH e a libcurl (chamar apenas no encerramento)
+void http_finalizar(void) {
+    if (!http_inicializado) return;
+
+    pthread_mutex_lock(&http_preaquecer_trava);
+    while (http_preaquecimentos > 0) {
+        pthread_cond_wait(&http_preaquecer_cond, &http_preaquecer_trava);
+    }
+    pthread_mutex_unlock(&http_preaquecer_trava);
+
+    pthread_mutex_lock(&http_pool_trava);
+    for (int i = 0; i < http_pool_livres; i++) {
+        curl_easy_cleanup(http_pool[i].handle);
+    }
+    http_pool_livres = 0;
+    pthread_mutex_unlock(&http_pool_trava);
+
+    if (http_share) {
+        curl_share_cleanup(http_share);
+        http_share = NULL;
+    }
+    curl_global_cleanup();
+    http_inicializado = 0;
+}
+
+// Opções comuns a todo handle (keep-alive, timeouts, validade das conexões)
+void http_aplicar_opcoes_padrao(CURL* handle) {
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, HTTP_KEEPALIVE_IDLE);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT, HTTP_TIMEOUT);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
+    curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN, HTTP_CONEXAO_OCIOSA_MAX);
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, HTTP_DNS_CACHE_S);
+}
+
+// Aplica as opções comuns a todo handle entregue pelo pool
+static void http_configurar_handle(CURL* handle) {
+    if (http_share) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, http_share);
+    }
+    http_aplicar_opcoes_padrao(handle);
+}
+
+// "host[:porta]" de uma URL (vazio se não houver URL)
+static void extrair_host(const char* url, char* host, size_t tamanho_host) {
+    host[0] = '\0';
+    if (!url) return;
+
+    const char* inicio = strstr(url, "://");
+    inicio = inicio ? inicio + 3 : url;
+    size_t tamanho = strcspn(inicio, "/?");
+    if (tamanho >= tamanho_host) tamanho = tamanho_host - 1;
+    memcpy(host, inicio, tamanho);
+    host[tamanho] = '\0';
+}
+
+// Quando a transferência precisou abrir conexão, registra quanto custou cada etapa
+// (conexões reaproveitadas não aparecem: é o que o pré-aquecimento quer evitar)
+static void registrar_conexao_nova(CURL* handle, const char* origem) {
+    long conexoes = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &conexoes);
+    if (conexoes <= 0) return;
+
+    curl_off_t dns = 0, tcp = 0, tls = 0;
+    char* url = NULL;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &tcp);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url);
+
+    // Os tempos são acumulados desde o início (microssegundos)
+    char host[128];
+    extrair_host(url, host, sizeof(host));
+    if (host[0] == '\0') strcpy(host, "?");
+    fprintf(stderr, "[PERFORMANCE] Conexão nova com %s (%s): DNS %.1f ms | TCP %.1f ms | TLS %.1f ms\n",
+            host, origem, dns / 1000.0, (tcp - dns) / 1000.0, tls > 0 ? (tls - tcp) / 1000.0 : 0.0);
+}
+
+// Obtém um handle do pool (ou cria um novo se o pool estiver vazio); com URL,
+// prefere o handle cuja conexão guardada é com o mesmo host
+CURL* http_obter_handle_para(const char* url) {
+    if (!http_inicializar()) return NULL;
+
+    char host[128];
+    extrair_host(url, host, sizeof(host));
+
+    CURL* handle = NULL;
+    pthread_mutex_lock(&http_pool_trava);
+    if (http_pool_livres > 0) {
+        int escolhido = http_pool_livres - 1;
+        for (int i = http_pool_livres - 1; i >= 0; i--) {
+            if (strcmp(http_pool[i].host, host) == 0) {
+                escolhido = i;
+                break;
+            }
+        }
+        handle = http_pool[escolhido].handle;
+        http_pool[escolhido] = http_pool[--http_pool_livres];
+    }
+    pthread_mutex_unlock(&http_pool_trava);
+
+    if (!handle) {
+        handle = curl_easy_init();
+        if (!handle) return NULL;
+    }
+
+    http_configurar_handle(handle);
+    return handle;
+}
+
+CURL* http_obter_handle(void) {
+    return http_obter_handle_para(NULL);
+}
+
+// Devolve o handle ao pool; o reset mantém as conexões vivas
+void http_devolver_handle(CURL* handle) {
+    if (!handle) return;
+
+    // Guarda o host antes do reset (handles usados só para url_encode não têm URL)
+    char* url = NULL;
+    curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url);
+    char host[128];
+    extrair_host(url, host, sizeof(host));
+
+    curl_easy_reset(handle);
+
+    pthread_mutex_lock(&http_pool_trava);
+    if (http_pool_livres < HTTP_POOL_TAMANHO) {
+        http_pool[http_pool_livres].handle = handle;
+        strcpy(http_pool[http_pool_livres].host, host);
+        http_pool_livres++;
+        handle = NULL;
+    }
+    pthread_mutex_unlock(&http_pool_trava);
+
+    // Pool cheio: descarta o handle excedente
+    if (handle) {
+        curl_easy_cleanup(handle);
+    }
+}
 
 // Callback para armazenar a resposta da requisição HTTP
 size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
@@ -28,39 +241,59 @@ size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *user
     return realsize;
 }
 
-// Função principal para fazer requisição HTTP
-char* fazer_requisicao_http(const char* url, const char* payload) {
+// Desfecho de uma tentativa, usado pela política de retry
+typedef struct {
+    CURLcode codigo_curl;
+    long codigo_http;
+    long retry_after_s;             // Cabeçalho Retry-After (-1 = ausente)
+} ResultadoHttp;
+
+// Executa GET (payload NULL) ou POST JSON usando um handle do pool
+// metodo troca o verbo (PATCH, DELETE...); NULL usa o padrão
+// timeout_ms > 0 encurta o timeout padrão; resultado (opcional) recebe o desfecho
+static char* executar_requisicao_com_prazo(const char* metodo, const char* url, const char* payload,
+                                           long timeout_ms, ResultadoHttp* resultado) {
     CURL *curl_handle;
     CURLcode res;
     struct MemoryStruct chunk;
     long http_code = 0;
 
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl_handle = curl_easy_init();
+    if (resultado) {
+        resultado->codigo_curl = CURLE_FAILED_INIT;
+        resultado->codigo_http = 0;
+        resultado->retry_after_s = -1;
+    }
 
+    curl_handle = http_obter_handle_para(url);
     if (!curl_handle) {
         fprintf(stderr, "Erro ao iniciar o cURL\n");
-        free(chunk.memory);
         return NULL;
     }
 
+    chunk.memory = malloc(1);
+    chunk.size = 0;
+
     struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
 
     // Configurações da requisição
     curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, payload);
+    if (payload) {
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+        curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, payload);
+    }
+    if (metodo) {
+        curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, metodo);
+    }
+    if (timeout_ms > 0 && timeout_ms < HTTP_TIMEOUT * 1000L) {
+        curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT_MS, timeout_ms);
+    }
     curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
     curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, HTTP_TIMEOUT);
-    curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
 
     // Executa a requisição
     res = curl_easy_perform(curl_handle);
+    if (resultado) resultado->codigo_curl = res;
 
     // Verifica erro de conexão
     if (res != CURLE_OK) {
@@ -76,13 +309,21 @@ char* fazer_requisicao_http(const char* url, const char* payload) {
 
         free(chunk.memory);
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl_handle);
-        curl_global_cleanup();
+        http_devolver_handle(curl_handle);
         return NULL;
     }
 
+    registrar_conexao_nova(curl_handle, "requisição");
+
     // Verifica código HTTP
     curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
+    if (resultado) {
+        curl_off_t retry_after = -1;
+        resultado->codigo_http = http_code;
+        if (curl_easy_getinfo(curl_handle, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+            resultado->retry_after_s = (long)retry_after;
+        }
+    }
 
     if (http_code != 200) {
         fprintf(stderr, "\n❌ Erro HTTP %ld\n", http_code);
@@ -103,57 +344,456 @@ char* fazer_requisicao_http(const char* url, const char* payload) {
 
         free(chunk.memory);
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl_handle);
-        curl_global_cleanup();
+        http_devolver_handle(curl_handle);
         return NULL;
     }
 
     curl_slist_free_all(headers);
-    curl_easy_cleanup(curl_handle);
-    curl_global_cleanup();
+    http_devolver_handle(curl_handle);
 
     return chunk.memory;
 }
 
-// Função com retry e backoff exponencial
-char* fazer_requisicao_http_com_retry(const char* url, const char* payload, int max_retries) {
-    int retry_delay = 1000; // 1 segundo inicial
+// Função principal para fazer requisição HTTP (POST com corpo JSON)
+static char* executar_requisicao(const char* metodo, const char* url, const char* payload) {
+    return executar_requisicao_com_prazo(metodo, url, payload, 0, NULL);
+}
 
-    for (int tentativa = 0; tentativa < max_retries; tentativa++) {
-        if (tentativa > 0) {
-            printf("\n⏳ Tentativa %d de %d (aguardando %d segundos)...\n",
-                   tentativa + 1, max_retries, retry_delay / 1000);
-            dormir(retry_delay);
-            retry_delay *= 2; // Backoff exponencial: 1s, 2s, 4s, 8s...
+char* fazer_requisicao_http(const char* url, const char* payload) {
+    return executar_requisicao(NULL, url, payload);
+}
+
+// Requisição GET simples (usada pelo módulo de clima)
+char* http_get(const char* url) {
+    return executar_requisicao(NULL, url, NULL);
+}
+
+// Requisição com outro verbo (PATCH, DELETE) e corpo JSON opcional
+char* http_requisicao_metodo(const char* metodo, const char* url, const char* payload) {
+    return executar_requisicao(metodo, url, payload);
+}
+
+static void* tarefa_preaquecer(void* arg) {
+    char* url = (char*)arg;
+
+    CURL* handle = http_obter_handle_para(url);
+    if (handle) {
+        // HEAD: só o suficiente para DNS, TCP e TLS; o status da resposta não importa
+        curl_easy_setopt(handle, CURLOPT_URL, url);
+        curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT, HTTP_PREAQUECER_TIMEOUT);
+
+        CURLcode res = curl_easy_perform(handle);
+        if (res == CURLE_OK) {
+            registrar_conexao_nova(handle, "pré-aquecimento");
+        } else {
+            fprintf(stderr, "[AVISO HTTP] Pré-aquecimento de %s falhou: %s\n", url, curl_easy_strerror(res));
+        }
+        http_devolver_handle(handle);
+    }
+    free(url);
+
+    pthread_mutex_lock(&http_preaquecer_trava);
+    http_preaquecimentos--;
+    pthread_cond_broadcast(&http_preaquecer_cond);
+    pthread_mutex_unlock(&http_preaquecer_trava);
+    return NULL;
+}
+
+// Abre em segundo plano a conexão com o host da URL; ela fica guardada no
+// handle, que o pool entrega à primeira requisição de verdade para esse host
+int http_preaquecer(const char* url) {
+    if (!url || !http_inicializar()) return 0;
+
+    char* copia = strdup(url);
+    if (!copia) return 0;
+
+    pthread_mutex_lock(&http_preaquecer_trava);
+    http_preaquecimentos++;
+    pthread_mutex_unlock(&http_preaquecer_trava);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, tarefa_preaquecer, copia) != 0) {
+        free(copia);
+        pthread_mutex_lock(&http_preaquecer_trava);
+        http_preaquecimentos--;
+        pthread_cond_broadcast(&http_preaquecer_cond);
+        pthread_mutex_unlock(&http_preaquecer_trava);
+        return 0;
+    }
+    pthread_detach(thread);
+    return 1;
+}
+
+// ===== POLÍTICA DE RETRY =====
+//
+// Cada chamada tem um prazo total (HTTP_PRAZO_TOTAL_MS, ou um prazo absoluto
+// dividido com outras chamadas do mesmo pedido) que limita tentativas e esperas; só erros transitórios são repetidos, com espera de jitter
+// decorrelacionado (ou o Retry-After do servidor, se maior). Falhas seguidas de
+// um endpoint abrem o circuito dele e as próximas chamadas falham na hora.
+
+typedef enum {
+    FALHA_DEFINITIVA,               // 400, 401, 403, 404...: repetir não adianta
+    FALHA_TRANSITORIA,              // Timeout, conexão, 5xx: o endpoint pode estar fora
+    FALHA_LIMITE                    // 408/429: o servidor está de pé, só pediu calma
+} ClasseFalha;
+
+typedef enum {
+    CIRCUITO_FECHADO,
+    CIRCUITO_ABERTO,
+    CIRCUITO_MEIO_ABERTO            // Uma chamada de teste liberada depois do intervalo
+} EstadoCircuito;
+
+typedef struct {
+    char endpoint[160];             // URL sem a query string (a API key fica de fora)
+    EstadoCircuito estado;
+    int falhas_seguidas;
+    double reabrir_em;              // ABERTO: fim do intervalo; MEIO_ABERTO: prazo da chamada de teste (ms)
+} CircuitoEndpoint;
+
+static pthread_mutex_t http_circuitos_trava = PTHREAD_MUTEX_INITIALIZER;
+static CircuitoEndpoint http_circuitos[HTTP_CIRCUITO_MAX_ENDPOINTS];
+static int http_num_circuitos = 0;
+
+static double http_tempo_ms(void) {
+#ifdef _WIN32
+    return (double)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+static ClasseFalha classificar_falha(const ResultadoHttp* r) {
+    if (r->codigo_curl != CURLE_OK) {
+        switch (r->codigo_curl) {
+            case CURLE_COULDNT_RESOLVE_HOST:
+            case CURLE_COULDNT_CONNECT:
+            case CURLE_OPERATION_TIMEDOUT:
+            case CURLE_SEND_ERROR:
+            case CURLE_RECV_ERROR:
+            case CURLE_GOT_NOTHING:
+            case CURLE_PARTIAL_FILE:
+            case CURLE_SSL_CONNECT_ERROR:
+            case CURLE_HTTP2:
+            case CURLE_HTTP2_STREAM:
+                return FALHA_TRANSITORIA;
+            default:
+                return FALHA_DEFINITIVA;    // URL malformada, sem memória, protocolo...
         }
+    }
+    if (r->codigo_http == 408 || r->codigo_http == 429) return FALHA_LIMITE;
+    if (r->codigo_http >= 500 || r->codigo_http == 0) return FALHA_TRANSITORIA;
+    return FALHA_DEFINITIVA;
+}
+
+// Endpoint = URL até a query string (por modelo e método, no caso do Gemini)
+static void chave_endpoint(const char* url, char* chave, size_t tamanho) {
+    size_t len = strcspn(url, "?");
+    if (len >= tamanho) len = tamanho - 1;
+    memcpy(chave, url, len);
+    chave[len] = '\0';
+}
 
-        char* resposta = fazer_requisicao_http(url, payload);
+// Chamar com http_circuitos_trava; NULL se a tabela estiver cheia
+static CircuitoEndpoint* obter_circuito(const char* endpoint) {
+    for (int i = 0; i < http_num_circuitos; i++) {
+        if (strcmp(http_circuitos[i].endpoint, endpoint) == 0) return &http_circuitos[i];
+    }
+    if (http_num_circuitos >= HTTP_CIRCUITO_MAX_ENDPOINTS) return NULL;
+
+    CircuitoEndpoint* c = &http_circuitos[http_num_circuitos++];
+    memset(c, 0, sizeof(*c));
+    snprintf(c->endpoint, sizeof(c->endpoint), "%s", endpoint);
+    return c;
+}
+
+// Retorna 0 se o circuito está aberto (a chamada deve falhar na hora). Quem
+// recebe a chamada de teste precisa tentar e registrar o resultado
+static int circuito_permite(const char* endpoint) {
+    int permite = 1;
+    pthread_mutex_lock(&http_circuitos_trava);
+    CircuitoEndpoint* c = obter_circuito(endpoint);
+    double agora = http_tempo_ms();
+    if (c && c->estado == CIRCUITO_ABERTO) {
+        if (agora >= c->reabrir_em) {
+            c->estado = CIRCUITO_MEIO_ABERTO;
+            c->reabrir_em = agora + HTTP_CIRCUITO_ABERTO_MS;
+            fprintf(stderr, "[INFO HTTP] Circuito de %s meio-aberto: liberando uma chamada de teste\n", endpoint);
+        } else {
+            permite = 0;
+        }
+    } else if (c && c->estado == CIRCUITO_MEIO_ABERTO) {
+        permite = 0;                // A chamada de teste ainda não terminou
+        if (agora >= c->reabrir_em) {
+            // O teste nunca registrou resultado: volta a aberto em vez de travar o endpoint
+            c->estado = CIRCUITO_ABERTO;
+            c->reabrir_em = agora + HTTP_CIRCUITO_ABERTO_MS;
+            fprintf(stderr, "[AVISO HTTP] Chamada de teste de %s sem resultado: circuito aberto de novo\n", endpoint);
+        }
+    }
+    pthread_mutex_unlock(&http_circuitos_trava);
+    return permite;
+}
+
+// Só consulta, sem liberar a chamada de teste (para não dormir à toa antes de tentar)
+static int circuito_fechado(const char* endpoint) {
+    pthread_mutex_lock(&http_circuitos_trava);
+    CircuitoEndpoint* c = obter_circuito(endpoint);
+    int fechado = !c || c->estado == CIRCUITO_FECHADO;
+    pthread_mutex_unlock(&http_circuitos_trava);
+    return fechado;
+}
+
+static void circuito_registrar(const char* endpoint, int sucesso, ClasseFalha classe) {
+    pthread_mutex_lock(&http_circuitos_trava);
+    CircuitoEndpoint* c = obter_circuito(endpoint);
+    if (c) {
+        if (sucesso || classe != FALHA_TRANSITORIA) {
+            // Erro do cliente ou limite de taxa: o endpoint respondeu, então está de pé
+            if (c->estado != CIRCUITO_FECHADO) {
+                fprintf(stderr, "[INFO HTTP] Circuito de %s fechado\n", endpoint);
+            }
+            c->estado = CIRCUITO_FECHADO;
+            c->falhas_seguidas = 0;
+        } else {
+            c->falhas_seguidas++;
+            if (c->estado == CIRCUITO_MEIO_ABERTO || c->falhas_seguidas >= HTTP_CIRCUITO_FALHAS) {
+                c->estado = CIRCUITO_ABERTO;
+                c->reabrir_em = http_tempo_ms() + HTTP_CIRCUITO_ABERTO_MS;
+                fprintf(stderr, "[AVISO HTTP] Circuito de %s aberto por %d ms após %d falhas seguidas\n",
+                        endpoint, HTTP_CIRCUITO_ABERTO_MS, c->falhas_seguidas);
+            }
+        }
+    }
+    pthread_mutex_unlock(&http_circuitos_trava);
+}
+
+// Jitter decorrelacionado: espera sorteada entre a base e 3x a espera anterior
+static long proxima_espera(long anterior, unsigned int* semente) {
+    *semente = *semente * 1103515245u + 12345u;
+    long teto = anterior * 3;
+    if (teto > HTTP_RETRY_ESPERA_MAX_MS) teto = HTTP_RETRY_ESPERA_MAX_MS;
+    if (teto <= INITIAL_RETRY_DELAY) return INITIAL_RETRY_DELAY;
+    return INITIAL_RETRY_DELAY + (long)((*semente >> 8) % (unsigned int)(teto - INITIAL_RETRY_DELAY + 1));
+}
+
+double http_prazo_novo(long duracao_ms) {
+    return http_tempo_ms() + (double)duracao_ms;
+}
+
+long http_prazo_restante(double prazo) {
+    double restante = prazo - http_tempo_ms();
+    return restante > 0 ? (long)restante : 0;
+}
+
+// Depois de uma tentativa com falha: classifica, registra no circuito e dorme a
+// espera até a próxima. Retorna 0 se não vale tentar de novo; com 1, restante
+// recebe o tempo da próxima tentativa, que tem de ser feita (o circuito pode ter
+// liberado a chamada de teste para ela)
+static int preparar_nova_tentativa(const char* endpoint, const ResultadoHttp* resultado, int tentativa,
+                                   int max_retries, double prazo, long* espera, unsigned int* semente,
+                                   long* restante) {
+    ClasseFalha classe = classificar_falha(resultado);
+    circuito_registrar(endpoint, 0, classe);
+    if (classe == FALHA_DEFINITIVA) {
+        fprintf(stderr, "   ⛔ Erro definitivo; não vale repetir.\n");
+        return 0;
+    }
+    if (tentativa == max_retries - 1 || !circuito_fechado(endpoint)) return 0;
+
+    *espera = proxima_espera(*espera, semente);
+    if (resultado->retry_after_s > 0 && resultado->retry_after_s * 1000L > *espera) {
+        *espera = resultado->retry_after_s * 1000L;
+    }
+
+    if (*espera >= http_prazo_restante(prazo)) {
+        fprintf(stderr, "   ⌛ Próxima espera (%ld ms) passaria do prazo da chamada.\n", *espera);
+        return 0;
+    }
+
+    fprintf(stderr, "⏳ Tentativa %d de %d em %ld ms...\n", tentativa + 2, max_retries, *espera);
+    dormir(*espera);
+
+    *restante = http_prazo_restante(prazo);
+    return *restante > 0 && circuito_permite(endpoint);
+}
+
+// Requisição com a política de retry: no máximo max_retries tentativas até o
+// prazo absoluto (ver http_prazo_novo). Retorna NULL na hora se o circuito do
+// endpoint estiver aberto ou o prazo já tiver passado
+char* fazer_requisicao_http_com_prazo(const char* url, const char* payload, int max_retries, double prazo) {
+    char endpoint[160];
+    chave_endpoint(url, endpoint, sizeof(endpoint));
+
+    // Prazo e tentativas antes do circuito: a chamada de teste liberada por ele
+    // tem de ser feita (e registrada), senão o endpoint fica meio-aberto
+    long restante = http_prazo_restante(prazo);
+    if (restante <= 0 || max_retries <= 0) {
+        fprintf(stderr, "[AVISO HTTP] Prazo de %s esgotado antes da primeira tentativa\n", endpoint);
+        return NULL;
+    }
+    if (!circuito_permite(endpoint)) {
+        fprintf(stderr, "[AVISO HTTP] Circuito de %s aberto: falhando sem tentar\n", endpoint);
+        return NULL;
+    }
+
+    unsigned int semente = (unsigned int)http_tempo_ms() ^ (unsigned int)(size_t)&semente;
+    long espera = INITIAL_RETRY_DELAY;
+
+    for (int tentativa = 0; tentativa < max_retries; tentativa++) {
+        ResultadoHttp resultado;
+        char* resposta = executar_requisicao_com_prazo(NULL, url, payload, restante, &resultado);
 
         if (resposta != NULL) {
+            circuito_registrar(endpoint, 1, FALHA_DEFINITIVA);
             if (tentativa > 0) {
-                printf("✅ Sucesso na tentativa %d!\n", tentativa + 1);
+                fprintf(stderr, "✅ Sucesso na tentativa %d!\n", tentativa + 1);
             }
             return resposta;
         }
 
-        if (tentativa < max_retries - 1) {
-            fprintf(stderr, "   🔄 Tentando novamente...\n");
+        if (!preparar_nova_tentativa(endpoint, &resultado, tentativa, max_retries, prazo, &espera, &semente, &restante)) {
+            break;
         }
     }
 
-    fprintf(stderr, "\n❌ Todas as %d tentativas falharam.\n", max_retries);
+    fprintf(stderr, "\n❌ Requisição desistida (tentativas ou prazo esgotados).\n");
     return NULL;
 }
 
+char* fazer_requisicao_http_com_retry(const char* url, const char* payload, int max_retries) {
+    return fazer_requisicao_http_com_prazo(url, payload, max_retries, http_prazo_novo(HTTP_PRAZO_TOTAL_MS));
+}
+
+// Repassa ao callback do chamador só o corpo de respostas 200 (o corpo de um
+// erro não é SSE) e conta o que foi entregue
+typedef struct {
+    CURL* handle;
+    curl_write_callback callback;
+    void* userdata;
+    size_t entregues;
+} RepasseStream;
+
+static size_t repassar_stream(char* dados, size_t size, size_t nmemb, void* userp) {
+    RepasseStream* repasse = (RepasseStream*)userp;
+    long http_code = 0;
+    curl_easy_getinfo(repasse->handle, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code != 200) return size * nmemb;
+
+    size_t aceitos = repasse->callback(dados, size, nmemb, repasse->userdata);
+    repasse->entregues += aceitos;
+    return aceitos;
+}
+
+// Uma tentativa do stream; entregues recebe os bytes já repassados ao callback
+static int executar_stream(const char* url, const char* payload, curl_write_callback callback,
+                           void* userdata, long timeout_ms, ResultadoHttp* resultado, size_t* entregues) {
+    resultado->codigo_curl = CURLE_FAILED_INIT;
+    resultado->codigo_http = 0;
+    resultado->retry_after_s = -1;
+    *entregues = 0;
+
+    CURL *curl_handle = http_obter_handle_para(url);
+    if (!curl_handle) {
+        fprintf(stderr, "Erro ao iniciar o cURL\n");
+        return 0;
+    }
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(headers, "Accept: text/event-stream");
+
+    RepasseStream repasse = { curl_handle, callback, userdata, 0 };
+
+    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
+    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, payload);
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, repassar_stream);
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &repasse);
+    if (timeout_ms > 0 && timeout_ms < HTTP_TIMEOUT * 1000L) {
+        curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT_MS, timeout_ms);
+    }
+
+    CURLcode res = curl_easy_perform(curl_handle);
+    long http_code = 0;
+    curl_off_t retry_after = -1;
+    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
+    if (curl_easy_getinfo(curl_handle, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+        resultado->retry_after_s = (long)retry_after;
+    }
+    if (res == CURLE_OK) registrar_conexao_nova(curl_handle, "stream");
+
+    resultado->codigo_curl = res;
+    resultado->codigo_http = http_code;
+    *entregues = repasse.entregues;
+
+    curl_slist_free_all(headers);
+    http_devolver_handle(curl_handle);
+
+    if (res != CURLE_OK) {
+        fprintf(stderr, "\n❌ Requisição (stream) falhou: %s\n", curl_easy_strerror(res));
+        return 0;
+    }
+    if (http_code != 200) {
+        fprintf(stderr, "\n❌ Erro HTTP %ld (stream)\n", http_code);
+        return 0;
+    }
+    return 1;
+}
+
+// Stream com a mesma política das requisições comuns (circuito, classificação,
+// prazo absoluto). Só repete enquanto nada foi entregue ao callback: depois do
+// primeiro trecho o texto já foi exibido e uma nova tentativa o duplicaria
+int fazer_requisicao_http_stream(const char* url, const char* payload,
+                                 curl_write_callback callback, void* userdata, double prazo) {
+    char endpoint[160];
+    chave_endpoint(url, endpoint, sizeof(endpoint));
+
+    // Como em fazer_requisicao_http_com_prazo: prazo antes do circuito
+    long restante = http_prazo_restante(prazo);
+    if (restante <= 0) {
+        fprintf(stderr, "[AVISO HTTP] Prazo de %s esgotado antes do stream\n", endpoint);
+        return 0;
+    }
+    if (!circuito_permite(endpoint)) {
+        fprintf(stderr, "[AVISO HTTP] Circuito de %s aberto: stream falhando sem tentar\n", endpoint);
+        return 0;
+    }
+
+    unsigned int semente = (unsigned int)http_tempo_ms() ^ (unsigned int)(size_t)&semente;
+    long espera = INITIAL_RETRY_DELAY;
+
+    for (int tentativa = 0; tentativa < MAX_RETRIES; tentativa++) {
+        ResultadoHttp resultado;
+        size_t entregues = 0;
+        if (executar_stream(url, payload, callback, userdata, restante, &resultado, &entregues)) {
+            circuito_registrar(endpoint, 1, FALHA_DEFINITIVA);
+            return 1;
+        }
+
+        if (entregues > 0) {
+            // Falha no meio do stream ainda conta para o circuito, mas não é repetida
+            circuito_registrar(endpoint, 0, classificar_falha(&resultado));
+            return 0;
+        }
+        if (!preparar_nova_tentativa(endpoint, &resultado, tentativa, MAX_RETRIES, prazo, &espera, &semente, &restante)) {
+            break;
+        }
+    }
+    return 0;
+}
+
 // Função para codificar URL
 char* url_encode(const char* str) {
-    // Inicializa cURL
-    CURL *curl = curl_easy_init();
+    // Usa um handle do pool (evita criar/destruir um handle por chamada)
+    CURL *curl = http_obter_handle();
     if (!curl) return NULL;
 
     // Codifica string
     char *encoded = curl_easy_escape(curl, str, 0);
-    // Libera cURL
-    curl_easy_cleanup(curl);
+    // Devolve o handle ao pool
+    http_devolver_handle(curl);
     return encoded;
 }
@@ -13,9 +13,36 @@ struct MemoryStruct {
 // Callback para cURL (precisa ser declarado para uso em clima.c)
 size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
 
-// Funções HTTP
+// Ciclo de vida do cliente HTTP (libcurl inicializada uma única vez por processo)
+int http_inicializar(void);
+void http_finalizar(void);
+
+// Pool de handles reutilizáveis (compartilham DNS e sessões TLS; cada handle
+// guarda as próprias conexões, e com URL o pool prefere um handle do mesmo host)
+CURL* http_obter_handle(void);
+CURL* http_obter_handle_para(const char* url);
+void http_devolver_handle(CURL* handle);
+
+// Opções comuns (keep-alive, timeouts) para handles criados fora do pool
+void http_aplicar_opcoes_padrao(CURL* handle);
+
+// Prazo absoluto (relógio monotônico, ms) para dividir entre as chamadas de um
+// mesmo pedido, ex.: o stream do chat e o fallback bloqueante
+double http_prazo_novo(long duracao_ms);
+long http_prazo_restante(double prazo);
+
+// Funções HTTP (com_retry/com_prazo/stream passam pelo circuito do endpoint)
 char* fazer_requisicao_http_com_retry(const char* url, const char* payload, int max_retries);
+char* fazer_requisicao_http_com_prazo(const char* url, const char* payload, int max_retries, double prazo);
 char* fazer_requisicao_http(const char* url, const char* payload);
+char* http_get(const char* url);
+char* http_requisicao_metodo(const char* metodo, const char* url, const char* payload);
+// Retorna 1 se o stream terminou com HTTP 200; repete só falhas antes do primeiro byte
+int fazer_requisicao_http_stream(const char* url, const char* payload,
+                                 curl_write_callback callback, void* userdata, double prazo);
 char* url_encode(const char* str);
 
+// Abre em segundo plano (HEAD) uma conexão keep-alive com o host da URL
+int http_preaquecer(const char* url);
+
 #endif // HTTP_UTILS_H
@@ -0,0 +1,248 @@
+/* json_extrator.c - Extração do texto das respostas do Gemini sem montar a árvore JSON
+ * GenieC - Assistente Inteligente
+ */
+
+#include "json_extrator.h"
+#include <string.h>
+
+// Posição de leitura; a escrita do texto extraído fica sempre atrás dela
+typedef struct {
+    char* p;
+    char* fim;
+} CursorJson;
+
+static void pular_espacos(CursorJson* c) {
+    while (c->p < c->fim && (*c->p == ' ' || *c->p == '\n' || *c->p == '\r' || *c->p == '\t')) {
+        c->p++;
+    }
+}
+
+// p em '"': avança até depois das aspas de fechamento
+static int pular_string(CursorJson* c) {
+    c->p++;
+    while (c->p < c->fim) {
+        char ch = *c->p++;
+        if (ch == '"') return 1;
+        if (ch == '\\') {
+            if (c->p >= c->fim) return 0;
+            c->p++;
+        }
+    }
+    return 0;
+}
+
+// Pula qualquer valor (objetos e vetores só contam a profundidade)
+static int pular_valor(CursorJson* c) {
+    pular_espacos(c);
+    if (c->p >= c->fim) return 0;
+
+    if (*c->p == '"') return pular_string(c);
+
+    if (*c->p == '{' || *c->p == '[') {
+        int profundidade = 0;
+        while (c->p < c->fim) {
+            char ch = *c->p;
+            if (ch == '"') {
+                if (!pular_string(c)) return 0;
+                continue;
+            }
+            c->p++;
+            if (ch == '{' || ch == '[') {
+                profundidade++;
+            } else if ((ch == '}' || ch == ']') && --profundidade == 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Número, true, false ou null
+    while (c->p < c->fim && *c->p != ',' && *c->p != '}' && *c->p != ']' &&
+           *c->p != ' ' && *c->p != '\n' && *c->p != '\r' && *c->p != '\t') {
+        c->p++;
+    }
+    return 1;
+}
+
+// Lê uma chave e os dois-pontos; as chaves da API não usam escapes
+static int ler_chave(CursorJson* c, const char** chave, size_t* tamanho) {
+    pular_espacos(c);
+    if (c->p >= c->fim || *c->p != '"') return 0;
+
+    *chave = c->p + 1;
+    if (!pular_string(c)) return 0;
+    *tamanho = (size_t)(c->p - 1 - *chave);
+
+    pular_espacos(c);
+    if (c->p >= c->fim || *c->p != ':') return 0;
+    c->p++;
+    pular_espacos(c);
+    return 1;
+}
+
+// p em '{': posiciona no valor da chave pedida. Se a chave não existir,
+// retorna 0 com p no '}' de fechamento (ou onde o JSON deixou de ser válido)
+static int entrar_chave(CursorJson* c, const char* chave) {
+    pular_espacos(c);
+    if (c->p >= c->fim || *c->p != '{') return 0;
+    c->p++;
+
+    size_t tamanho_procurado = strlen(chave);
+    for (;;) {
+        pular_espacos(c);
+        if (c->p < c->fim && *c->p == ',') c->p++;
+
+        const char* nome;
+        size_t tamanho;
+        if (!ler_chave(c, &nome, &tamanho)) return 0;
+        if (tamanho == tamanho_procurado && memcmp(nome, chave, tamanho) == 0) return 1;
+        if (!pular_valor(c)) return 0;
+    }
+}
+
+// Depois de ler um valor dentro de um objeto, pula os membros restantes e o '}'
+static int sair_objeto(CursorJson* c) {
+    for (;;) {
+        pular_espacos(c);
+        if (c->p >= c->fim) return 0;
+        if (*c->p == '}') {
+            c->p++;
+            return 1;
+        }
+        if (*c->p != ',') return 0;
+        c->p++;
+
+        const char* nome;
+        size_t tamanho;
+        if (!ler_chave(c, &nome, &tamanho) || !pular_valor(c)) return 0;
+    }
+}
+
+// p em '[' ou depois de um elemento: retorna 1 se houver mais um elemento
+static int proximo_elemento(CursorJson* c) {
+    pular_espacos(c);
+    if (c->p < c->fim && (*c->p == '[' || *c->p == ',')) {
+        c->p++;
+        pular_espacos(c);
+    }
+    return c->p < c->fim && *c->p != ']';
+}
+
+static int valor_hex(const char* p, unsigned int* valor) {
+    *valor = 0;
+    for (int i = 0; i < 4; i++) {
+        char ch = p[i];
+        *valor <<= 4;
+        if (ch >= '0' && ch <= '9') *valor |= (unsigned int)(ch - '0');
+        else if (ch >= 'a' && ch <= 'f') *valor |= (unsigned int)(ch - 'a' + 10);
+        else if (ch >= 'A' && ch <= 'F') *valor |= (unsigned int)(ch - 'A' + 10);
+        else return 0;
+    }
+    return 1;
+}
+
+static size_t codificar_utf8(unsigned int codigo, char* destino) {
+    if (codigo < 0x80) {
+        destino[0] = (char)codigo;
+        return 1;
+    }
+    if (codigo < 0x800) {
+        destino[0] = (char)(0xC0 | (codigo >> 6));
+        destino[1] = (char)(0x80 | (codigo & 0x3F));
+        return 2;
+    }
+    if (codigo < 0x10000) {
+        destino[0] = (char)(0xE0 | (codigo >> 12));
+        destino[1] = (char)(0x80 | ((codigo >> 6) & 0x3F));
+        destino[2] = (char)(0x80 | (codigo & 0x3F));
+        return 3;
+    }
+    destino[0] = (char)(0xF0 | (codigo >> 18));
+    destino[1] = (char)(0x80 | ((codigo >> 12) & 0x3F));
+    destino[2] = (char)(0x80 | ((codigo >> 6) & 0x3F));
+    destino[3] = (char)(0x80 | (codigo & 0x3F));
+    return 4;
+}
+
+// p em '"': copia a string sem escapes para destino (que nunca passa de p,
+// pois cada escape ocupa mais bytes do que o caractere gerado)
+static size_t decodificar_string(CursorJson* c, char* destino) {
+    char* saida = destino;
+    c->p++;
+
+    while (c->p < c->fim) {
+        // Trecho sem escapes é movido de uma vez
+        char* inicio = c->p;
+        while (c->p < c->fim && *c->p != '"' && *c->p != '\\') c->p++;
+        size_t tamanho = (size_t)(c->p - inicio);
+        if (saida != inicio) memmove(saida, inicio, tamanho);
+        saida += tamanho;
+
+        if (c->p >= c->fim) break;
+        if (*c->p == '"') {
+            c->p++;
+            return (size_t)(saida - destino);
+        }
+
+        // Escape
+        if (c->p + 1 >= c->fim) break;
+        char ch = c->p[1];
+        c->p += 2;
+        switch (ch) {
+            case 'n': *saida++ = '\n'; break;
+            case 't': *saida++ = '\t'; break;
+            case 'r': *saida++ = '\r'; break;
+            case 'b': *saida++ = '\b'; break;
+            case 'f': *saida++ = '\f'; break;
+            case 'u': {
+                unsigned int codigo;
+                if (c->fim - c->p < 4 || !valor_hex(c->p, &codigo)) return JSON_TEXTO_AUSENTE;
+                c->p += 4;
+
+                // Par substituto (emojis chegam como \uD83D\uDE00)
+                unsigned int baixo;
+                if (codigo >= 0xD800 && codigo < 0xDC00 && c->fim - c->p >= 6 &&
+                    c->p[0] == '\\' && c->p[1] == 'u' && valor_hex(c->p + 2, &baixo) &&
+                    baixo >= 0xDC00 && baixo < 0xE000) {
+                    codigo = 0x10000 + ((codigo - 0xD800) << 10) + (baixo - 0xDC00);
+                    c->p += 6;
+                }
+                saida += codificar_utf8(codigo, saida);
+                break;
+            }
+            default: *saida++ = ch; break;     // \" \\ \/
+        }
+    }
+    return JSON_TEXTO_AUSENTE;
+}
+
+size_t json_extrair_texto_gemini(char* json, size_t tamanho) {
+    if (!json) return JSON_TEXTO_AUSENTE;
+
+    CursorJson c = {json, json + tamanho};
+    if (!entrar_chave(&c, "candidates") || !proximo_elemento(&c)) return JSON_TEXTO_AUSENTE;
+    if (!entrar_chave(&c, "content") || !entrar_chave(&c, "parts")) return JSON_TEXTO_AUSENTE;
+
+    char* saida = json;
+    int encontrou = 0;
+    while (proximo_elemento(&c)) {
+        if (entrar_chave(&c, "text")) {
+            if (c.p >= c.fim || *c.p != '"') return JSON_TEXTO_AUSENTE;
+
+            size_t escrito = decodificar_string(&c, saida);
+            if (escrito == JSON_TEXTO_AUSENTE) return JSON_TEXTO_AUSENTE;
+            saida += escrito;
+            encontrou = 1;
+
+            if (!sair_objeto(&c)) break;
+        } else if (c.p < c.fim && *c.p == '}') {
+            c.p++;                      // Parte sem texto (functionCall, inlineData...)
+        } else {
+            break;
+        }
+    }
+
+    if (!encontrou) return JSON_TEXTO_AUSENTE;
+    *saida = '\0';
+    return (size_t)(saida - json);
+}
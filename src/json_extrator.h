@@ -0,0 +1,19 @@
+/* json_extrator.h - Extração do texto das respostas do Gemini sem montar a árvore JSON
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef JSON_EXTRATOR_H
+#define JSON_EXTRATOR_H
+
+#include <stddef.h>
+
+// Retornado quando a resposta não tem candidates[0].content.parts[].text
+#define JSON_TEXTO_AUSENTE ((size_t)-1)
+
+// Percorre a resposta uma única vez e grava no início do próprio buffer o texto
+// de todas as partes de candidates[0] (concatenado, já sem escapes e terminado
+// em '\0'). Não aloca memória; o restante do buffer deixa de ser JSON válido.
+// Retorna o tamanho do texto ou JSON_TEXTO_AUSENTE
+size_t json_extrair_texto_gemini(char* json, size_t tamanho);
+
+#endif // JSON_EXTRATOR_H
@@ -0,0 +1,63 @@
+/* normalizacao.c - Normalização de nomes de cidades para comparação
+ * GenieC - Assistente Inteligente
+ */
+
+#include "normalizacao.h"
+#include <ctype.h>
+
+// Letra base de U+00C0..U+00FF (segundo byte 0x80..0xBF após 0xC3 em UTF-8)
+// '\0' indica caractere sem equivalente simples (Æ, ×, Þ, ß...), mantido como está
+static const char LATIN1_BASE[64] =
+    "aaaaaa\0ceeeeiiiidnooooo\0ouuuuy\0\0"
+    "aaaaaa\0ceeeeiiiidnooooo\0ouuuuy\0y";
+
+void normalizar_nome(const char* nome, char* saida, size_t tamanho) {
+    if (!saida || tamanho == 0) return;
+    saida[0] = '\0';
+    if (!nome) return;
+
+    const unsigned char* p = (const unsigned char*)nome;
+    size_t pos = 0;
+    int espaco_pendente = 0;
+
+    while (*p && pos + 1 < tamanho) {
+        unsigned char c = *p;
+
+        if (isspace(c)) {
+            // Colapsa espaços internos; descarta os do início
+            if (pos > 0) espaco_pendente = 1;
+            p++;
+            continue;
+        }
+
+        if (espaco_pendente) {
+            saida[pos++] = ' ';
+            espaco_pendente = 0;
+            if (pos + 1 >= tamanho) break;
+        }
+
+        if (c == 0xC3 && p[1] >= 0x80 && p[1] <= 0xBF && LATIN1_BASE[p[1] - 0x80]) {
+            // Letra acentuada de 2 bytes -> letra base
+            saida[pos++] = LATIN1_BASE[p[1] - 0x80];
+            p += 2;
+        } else if (c < 0x80) {
+            saida[pos++] = (char)tolower(c);
+            p++;
+        } else {
+            // Demais bytes UTF-8 são copiados sem alteração
+            saida[pos++] = (char)c;
+            p++;
+        }
+    }
+
+    saida[pos] = '\0';
+}
+
+unsigned int hash_nome(const char* chave) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)chave; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
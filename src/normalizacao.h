@@ -0,0 +1,17 @@
+/* normalizacao.h - Normalização de nomes de cidades para comparação
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef NORMALIZACAO_H
+#define NORMALIZACAO_H
+
+#include <stddef.h>
+
+// Gera a chave de comparação de um nome: minúsculas, sem acentos (UTF-8
+// Latin-1) e com espaços aparados/colapsados. "  São  Paulo " -> "sao paulo"
+void normalizar_nome(const char* nome, char* saida, size_t tamanho);
+
+// Hash FNV-1a de uma chave já normalizada
+unsigned int hash_nome(const char* chave);
+
+#endif // NORMALIZACAO_H
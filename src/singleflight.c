@@ -0,0 +1,146 @@
+/* singleflight.c - Unificação de chamadas idênticas em andamento
+ * GenieC - Assistente Inteligente
+ *
+ * Cliques repetidos em "Calcular rota" ou "atualizar clima" com a mesma cidade
+ * disparavam consultas duplicadas. Aqui a primeira chamada de uma chave executa
+ * o trabalho e as que chegam enquanto ela está em andamento só esperam. O último
+ * participante a sair fica com o resultado original; os outros recebem cópias.
+ */
+
+#include "singleflight.h"
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ChamadaEmAndamento {
+    char* chave;
+    void* resultado;
+    int concluida;
+    int participantes;              // Líder + quem está aguardando ou copiando
+    struct ChamadaEmAndamento* proxima;
+} ChamadaEmAndamento;
+
+typedef struct {
+    char nome[32];
+    long chamadas;
+    long deduplicadas;
+} ContadorCategoria;
+
+static pthread_mutex_t trava_singleflight = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_concluida = PTHREAD_COND_INITIALIZER;
+static ChamadaEmAndamento* em_andamento = NULL;
+static ContadorCategoria categorias[SINGLEFLIGHT_MAX_CATEGORIAS];
+static int num_categorias = 0;
+
+// Chamar com a trava; NULL se a tabela de categorias estiver cheia
+static ContadorCategoria* obter_categoria(const char* chave) {
+    size_t tamanho = strcspn(chave, "|");
+    if (tamanho >= sizeof(categorias[0].nome)) tamanho = sizeof(categorias[0].nome) - 1;
+
+    for (int i = 0; i < num_categorias; i++) {
+        if (strlen(categorias[i].nome) == tamanho && strncmp(categorias[i].nome, chave, tamanho) == 0) {
+            return &categorias[i];
+        }
+    }
+    if (num_categorias >= SINGLEFLIGHT_MAX_CATEGORIAS) return NULL;
+
+    ContadorCategoria* c = &categorias[num_categorias++];
+    memcpy(c->nome, chave, tamanho);
+    c->nome[tamanho] = '\0';
+    return c;
+}
+
+// Chamar com a trava: o último participante leva o original e libera a chamada
+static void* sair_da_chamada(ChamadaEmAndamento* chamada, SingleflightCopiar copiar) {
+    void* resultado = chamada->resultado;
+    if (--chamada->participantes == 0) {
+        free(chamada->chave);
+        free(chamada);
+        return resultado;
+    }
+    return (resultado && copiar) ? copiar(resultado) : resultado;
+}
+
+void* singleflight_executar(const char* chave, SingleflightFuncao funcao, void* arg,
+                            SingleflightCopiar copiar, int* compartilhado) {
+    if (compartilhado) *compartilhado = 0;
+    if (!chave || !funcao) return NULL;
+
+    pthread_mutex_lock(&trava_singleflight);
+    ContadorCategoria* categoria = obter_categoria(chave);
+    if (categoria) categoria->chamadas++;
+
+    ChamadaEmAndamento* chamada = em_andamento;
+    while (chamada && strcmp(chamada->chave, chave) != 0) {
+        chamada = chamada->proxima;
+    }
+
+    if (chamada) {
+        // Mesma consulta em andamento: espera e recebe o resultado dela
+        if (categoria) categoria->deduplicadas++;
+        chamada->participantes++;
+        fprintf(stderr, "[DEBUG SINGLEFLIGHT] %s já em andamento; aguardando o resultado\n", chave);
+
+        while (!chamada->concluida) {
+            pthread_cond_wait(&cond_concluida, &trava_singleflight);
+        }
+        void* resultado = sair_da_chamada(chamada, copiar);
+        pthread_mutex_unlock(&trava_singleflight);
+
+        if (compartilhado) *compartilhado = 1;
+        return resultado;
+    }
+
+    chamada = (ChamadaEmAndamento*)calloc(1, sizeof(ChamadaEmAndamento));
+    if (chamada) chamada->chave = strdup(chave);
+    if (!chamada || !chamada->chave) {
+        // Sem memória para registrar: executa sem unificar
+        free(chamada);
+        pthread_mutex_unlock(&trava_singleflight);
+        return funcao(arg);
+    }
+    chamada->participantes = 1;
+    chamada->proxima = em_andamento;
+    em_andamento = chamada;
+    pthread_mutex_unlock(&trava_singleflight);
+
+    void* resultado = funcao(arg);
+
+    pthread_mutex_lock(&trava_singleflight);
+    chamada->resultado = resultado;
+    chamada->concluida = 1;
+
+    // Sai da lista: quem chegar depois faz uma consulta nova
+    ChamadaEmAndamento** p = &em_andamento;
+    while (*p != chamada) p = &(*p)->proxima;
+    *p = chamada->proxima;
+
+    pthread_cond_broadcast(&cond_concluida);
+    resultado = sair_da_chamada(chamada, copiar);
+    pthread_mutex_unlock(&trava_singleflight);
+
+    return resultado;
+}
+
+void* singleflight_copiar_string(const void* resultado) {
+    return strdup((const char*)resultado);
+}
+
+void singleflight_registrar_estatisticas(void) {
+    pthread_mutex_lock(&trava_singleflight);
+    long chamadas = 0;
+    long deduplicadas = 0;
+    for (int i = 0; i < num_categorias; i++) {
+        chamadas += categorias[i].chamadas;
+        deduplicadas += categorias[i].deduplicadas;
+    }
+
+    fprintf(stderr, "[PERFORMANCE] Singleflight: %ld chamadas, %ld deduplicadas\n", chamadas, deduplicadas);
+    for (int i = 0; i < num_categorias; i++) {
+        fprintf(stderr, "[PERFORMANCE]   %s: %ld chamadas, %ld deduplicadas\n",
+                categorias[i].nome, categorias[i].chamadas, categorias[i].deduplicadas);
+    }
+    pthread_mutex_unlock(&trava_singleflight);
+}
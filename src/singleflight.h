@@ -0,0 +1,28 @@
+/* singleflight.h - Unificação de chamadas idênticas em andamento
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+// Trabalho executado uma única vez por chave; devolve o resultado (ou NULL)
+typedef void* (*SingleflightFuncao)(void* arg);
+
+// Duplica um resultado para os demais participantes; NULL compartilha o
+// ponteiro como está (para valores que não são alocados, ex: inteiros)
+typedef void* (*SingleflightCopiar)(const void* resultado);
+
+// Executa funcao(arg) se não houver chamada em andamento com a mesma chave;
+// caso contrário aguarda a que está em andamento e recebe uma cópia do resultado.
+// A chave deve ser canônica: "categoria|parâmetros normalizados" (ex: "clima|sao paulo").
+// compartilhado (opcional) recebe 1 quando o resultado veio da chamada de outra thread
+void* singleflight_executar(const char* chave, SingleflightFuncao funcao, void* arg,
+                            SingleflightCopiar copiar, int* compartilhado);
+
+// Cópias prontas para os tipos mais comuns
+void* singleflight_copiar_string(const void* resultado);
+
+// Contadores por categoria (prefixo da chave até o '|')
+void singleflight_registrar_estatisticas(void);
+
+#endif // SINGLEFLIGHT_H
@@ -0,0 +1,123 @@
+/* str_builder.c - Construtor de strings com crescimento automático
+ * GenieC - Assistente Inteligente
+ */
+
+#include "str_builder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+// Garante espaço para mais 'extra' bytes além do '\0'
+static int sb_reservar(StrBuilder* sb, size_t extra) {
+    if (sb->erro) return 0;
+
+    size_t necessario = sb->tamanho + extra + 1;
+    if (necessario <= sb->capacidade) return 1;
+
+    size_t nova_capacidade = sb->capacidade > 0 ? sb->capacidade : 256;
+    while (nova_capacidade < necessario) nova_capacidade *= 2;
+
+    char* novos = (char*)realloc(sb->dados, nova_capacidade);
+    if (!novos) {
+        fprintf(stderr, "[ERRO] Sem memória para montar texto (%zu bytes)\n", nova_capacidade);
+        sb->erro = 1;
+        return 0;
+    }
+    sb->dados = novos;
+    sb->capacidade = nova_capacidade;
+    return 1;
+}
+
+void sb_iniciar(StrBuilder* sb, size_t capacidade_inicial) {
+    sb->dados = NULL;
+    sb->tamanho = 0;
+    sb->capacidade = 0;
+    sb->erro = 0;
+    if (sb_reservar(sb, capacidade_inicial)) {
+        sb->dados[0] = '\0';
+    }
+}
+
+void sb_anexar_n(StrBuilder* sb, const char* texto, size_t n) {
+    if (!texto || !sb_reservar(sb, n)) return;
+    memcpy(sb->dados + sb->tamanho, texto, n);
+    sb->tamanho += n;
+    sb->dados[sb->tamanho] = '\0';
+}
+
+void sb_anexar(StrBuilder* sb, const char* texto) {
+    if (texto) sb_anexar_n(sb, texto, strlen(texto));
+}
+
+void sb_formatar(StrBuilder* sb, const char* formato, ...) {
+    if (sb->erro) return;
+
+    // Tenta no espaço livre; se não couber, reserva o tamanho exato e refaz
+    va_list args;
+    va_start(args, formato);
+    size_t livre = sb->capacidade - sb->tamanho;
+    int n = vsnprintf(sb->dados + sb->tamanho, livre, formato, args);
+    va_end(args);
+
+    if (n < 0) {
+        sb->dados[sb->tamanho] = '\0';
+        return;
+    }
+
+    if ((size_t)n >= livre) {
+        if (!sb_reservar(sb, (size_t)n)) {
+            sb->dados[sb->tamanho] = '\0';
+            return;
+        }
+        va_start(args, formato);
+        vsnprintf(sb->dados + sb->tamanho, sb->capacidade - sb->tamanho, formato, args);
+        va_end(args);
+    }
+    sb->tamanho += (size_t)n;
+}
+
+void sb_anexar_json_string(StrBuilder* sb, const char* texto) {
+    sb_anexar_n(sb, "\"", 1);
+    if (texto) {
+        const char* inicio = texto;
+        for (const char* p = texto; *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c != '"' && c != '\\' && c >= 0x20) continue;
+
+            // Copia o trecho sem escapes de uma vez
+            sb_anexar_n(sb, inicio, (size_t)(p - inicio));
+            if (c == '"') {
+                sb_anexar_n(sb, "\\\"", 2);
+            } else if (c == '\\') {
+                sb_anexar_n(sb, "\\\\", 2);
+            } else if (c == '\n') {
+                sb_anexar_n(sb, "\\n", 2);
+            } else {
+                sb_formatar(sb, "\\u%04x", c);
+            }
+            inicio = p + 1;
+        }
+        sb_anexar(sb, inicio);
+    }
+    sb_anexar_n(sb, "\"", 1);
+}
+
+char* sb_finalizar(StrBuilder* sb) {
+    if (sb->erro) {
+        sb_liberar(sb);
+        return NULL;
+    }
+    char* resultado = sb->dados;
+    sb->dados = NULL;
+    sb->tamanho = 0;
+    sb->capacidade = 0;
+    return resultado;
+}
+
+void sb_liberar(StrBuilder* sb) {
+    free(sb->dados);
+    sb->dados = NULL;
+    sb->tamanho = 0;
+    sb->capacidade = 0;
+}
@@ -0,0 +1,34 @@
+/* str_builder.h - Construtor de strings com crescimento automático
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef STR_BUILDER_H
+#define STR_BUILDER_H
+
+#include <stddef.h>
+
+// Buffer que cresce geometricamente: cada anexo custa O(tamanho do trecho)
+typedef struct {
+    char* dados;
+    size_t tamanho;                 // Bytes usados (sem contar o '\0')
+    size_t capacidade;
+    int erro;                       // 1 se alguma alocação falhou
+} StrBuilder;
+
+void sb_iniciar(StrBuilder* sb, size_t capacidade_inicial);
+void sb_anexar(StrBuilder* sb, const char* texto);
+void sb_anexar_n(StrBuilder* sb, const char* texto, size_t n);
+void sb_formatar(StrBuilder* sb, const char* formato, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+// Anexa o texto como string JSON (com aspas e escapes)
+void sb_anexar_json_string(StrBuilder* sb, const char* texto);
+
+// Entrega a string ao chamador (liberar com free); NULL se houve erro
+char* sb_finalizar(StrBuilder* sb);
+void sb_liberar(StrBuilder* sb);
+
+#endif // STR_BUILDER_H
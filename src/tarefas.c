@@ -0,0 +1,135 @@
+/* tarefas.c - Pool de threads de trabalho com fila de tarefas
+ * GenieC - Assistente Inteligente
+ *
+ * Usado para tirar o trabalho bloqueante (rede, Dijkstra, disco) da thread da
+ * interface: o callback do webview apenas enfileira e retorna imediatamente.
+ */
+
+#include "tarefas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define MAX_TRABALHADORES 16
+
+// Nó da fila de tarefas (FIFO)
+typedef struct Tarefa {
+    TarefaFuncao funcao;
+    void* arg;
+    struct Tarefa* proxima;
+} Tarefa;
+
+static pthread_mutex_t fila_trava = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fila_sinal = PTHREAD_COND_INITIALIZER;
+static Tarefa* fila_inicio = NULL;
+static Tarefa* fila_fim = NULL;
+static int pool_ativo = 0;
+static int pool_encerrando = 0;
+
+static pthread_t trabalhadores[MAX_TRABALHADORES];
+static int num_trabalhadores = 0;
+
+// Laço de cada thread de trabalho
+static void* trabalhador_executar(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&fila_trava);
+        while (!fila_inicio && !pool_encerrando) {
+            pthread_cond_wait(&fila_sinal, &fila_trava);
+        }
+
+        // Encerrando e sem tarefas pendentes
+        if (!fila_inicio) {
+            pthread_mutex_unlock(&fila_trava);
+            break;
+        }
+
+        Tarefa* tarefa = fila_inicio;
+        fila_inicio = tarefa->proxima;
+        if (!fila_inicio) fila_fim = NULL;
+        pthread_mutex_unlock(&fila_trava);
+
+        tarefa->funcao(tarefa->arg);
+        free(tarefa);
+    }
+
+    return NULL;
+}
+
+// Cria as threads de trabalho
+int tarefas_iniciar(int num_threads) {
+    pthread_mutex_lock(&fila_trava);
+    if (pool_ativo) {
+        pthread_mutex_unlock(&fila_trava);
+        return 1;
+    }
+
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_TRABALHADORES) num_threads = MAX_TRABALHADORES;
+
+    pool_encerrando = 0;
+    num_trabalhadores = 0;
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&trabalhadores[i], NULL, trabalhador_executar, NULL) != 0) {
+            fprintf(stderr, "[ERRO TAREFAS] Não foi possível criar a thread %d\n", i);
+            break;
+        }
+        num_trabalhadores++;
+    }
+    pool_ativo = num_trabalhadores > 0;
+    pthread_mutex_unlock(&fila_trava);
+
+    fprintf(stderr, "[INFO TAREFAS] %d threads de trabalho iniciadas\n", num_trabalhadores);
+    return pool_ativo;
+}
+
+// Enfileira uma tarefa para execução assíncrona
+int tarefas_submeter(TarefaFuncao funcao, void* arg) {
+    if (!funcao) return 0;
+
+    Tarefa* tarefa = (Tarefa*)malloc(sizeof(Tarefa));
+    if (!tarefa) return 0;
+    tarefa->funcao = funcao;
+    tarefa->arg = arg;
+    tarefa->proxima = NULL;
+
+    pthread_mutex_lock(&fila_trava);
+    if (!pool_ativo || pool_encerrando) {
+        pthread_mutex_unlock(&fila_trava);
+        free(tarefa);
+        return 0;
+    }
+
+    if (fila_fim) {
+        fila_fim->proxima = tarefa;
+    } else {
+        fila_inicio = tarefa;
+    }
+    fila_fim = tarefa;
+
+    pthread_cond_signal(&fila_sinal);
+    pthread_mutex_unlock(&fila_trava);
+    return 1;
+}
+
+// Processa o que já está na fila e encerra as threads
+void tarefas_finalizar(void) {
+    pthread_mutex_lock(&fila_trava);
+    if (!pool_ativo) {
+        pthread_mutex_unlock(&fila_trava);
+        return;
+    }
+    pool_encerrando = 1;
+    pthread_cond_broadcast(&fila_sinal);
+    pthread_mutex_unlock(&fila_trava);
+
+    for (int i = 0; i < num_trabalhadores; i++) {
+        pthread_join(trabalhadores[i], NULL);
+    }
+
+    pthread_mutex_lock(&fila_trava);
+    num_trabalhadores = 0;
+    pool_ativo = 0;
+    pthread_mutex_unlock(&fila_trava);
+}
@@ -0,0 +1,20 @@
+/* tarefas.h - Pool de threads de trabalho com fila de tarefas
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef TAREFAS_H
+#define TAREFAS_H
+
+// Função executada por uma thread de trabalho (é dona do argumento)
+typedef void (*TarefaFuncao)(void* arg);
+
+// Cria as threads de trabalho (idempotente)
+int tarefas_iniciar(int num_threads);
+
+// Enfileira uma tarefa; retorna 0 se o pool não estiver ativo
+int tarefas_submeter(TarefaFuncao funcao, void* arg);
+
+// Aguarda a fila esvaziar e encerra as threads
+void tarefas_finalizar(void);
+
+#endif // TAREFAS_H
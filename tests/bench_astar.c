@@ -0,0 +1,135 @@
+/* bench_astar.c - A* x Dijkstra: cidades fechadas e tempo por consulta
+ * GenieC - Assistente Inteligente
+ *
+ * Grade sintética de cidades com coordenadas reais (~20 km entre vizinhas) e
+ * estradas de 5% a 40% mais longas que a linha reta. Cada consulta roda nos
+ * dois algoritmos e as distâncias precisam bater. O segundo cenário desloca as
+ * coordenadas de algumas cidades, como as estimativas da IA: o A* tem de
+ * perceber que a estimativa deixou de ser admissível e cair para Dijkstra.
+ *
+ * Uso: bench_astar [lado da grade] [consultas]   (retorna 1 se alguma rota divergir)
+ */
+
+#include "config.h"
+#include "grafo.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int semente = 12345;
+
+static double aleatorio(void) {
+    semente = semente * 1103515245u + 12345u;
+    return (double)((semente >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static double linha_reta(const Cidade* a, const Cidade* b) {
+    double rad = M_PI / 180.0;
+    double dlat = (b->latitude - a->latitude) * rad;
+    double dlon = (b->longitude - a->longitude) * rad;
+    double h = sin(dlat / 2) * sin(dlat / 2) +
+               cos(a->latitude * rad) * cos(b->latitude * rad) * sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * RAIO_TERRA_KM * asin(sqrt(h));
+}
+
+// Grade lado x lado a partir de (-23, -47), com vizinhas na horizontal, vertical e uma diagonal
+static Grafo* montar_grade(int lado) {
+    Grafo* g = criar_grafo();
+    char nome[32];
+    for (int i = 0; i < lado * lado; i++) {
+        snprintf(nome, sizeof(nome), "C%d", i);
+        int idx = adicionar_cidade(g, nome);
+        grafo_definir_coordenadas(g, idx, -23.0 + 0.18 * (i / lado), -47.0 + 0.18 * (i % lado));
+    }
+
+    char outro[32];
+    for (int i = 0; i < lado * lado; i++) {
+        int linha = i / lado;
+        int coluna = i % lado;
+        int vizinhos[3] = {
+            coluna + 1 < lado ? i + 1 : -1,
+            linha + 1 < lado ? i + lado : -1,
+            coluna + 1 < lado && linha + 1 < lado && aleatorio() < 0.3 ? i + lado + 1 : -1
+        };
+        snprintf(nome, sizeof(nome), "C%d", i);
+        for (int k = 0; k < 3; k++) {
+            if (vizinhos[k] < 0) continue;
+            double reta = linha_reta(&g->cidades[i], &g->cidades[vizinhos[k]]);
+            snprintf(outro, sizeof(outro), "C%d", vizinhos[k]);
+            adicionar_aresta(g, nome, outro, (int)ceil(reta * (1.05 + 0.35 * aleatorio())));
+        }
+    }
+    grafo_compactar(g);
+    return g;
+}
+
+// Roda as mesmas consultas nos dois algoritmos; retorna o número de divergências
+static int comparar(Grafo* g, const char* cenario, int consultas) {
+    long fechadas_dijkstra = 0;
+    long fechadas_astar = 0;
+    double tempo_dijkstra = 0.0;
+    double tempo_astar = 0.0;
+    int divergencias = 0;
+    const char* algoritmo = "A*";
+
+    unsigned int semente_consultas = 777;
+    for (int q = 0; q < consultas; q++) {
+        semente_consultas = semente_consultas * 1103515245u + 12345u;
+        int origem = (int)((semente_consultas >> 8) % (unsigned int)g->num_cidades);
+        semente_consultas = semente_consultas * 1103515245u + 12345u;
+        int destino = (int)((semente_consultas >> 8) % (unsigned int)g->num_cidades);
+
+        ResultadoCaminho d, a;
+        grafo_menor_caminho(g, origem, destino, &d);
+        grafo_menor_caminho_astar(g, origem, destino, &a);
+
+        if (d.encontrado != a.encontrado || d.distancia_total != a.distancia_total) {
+            divergencias++;
+            fprintf(stderr, "[ERRO BENCH] %s: C%d -> C%d: Dijkstra %d km, %s %d km\n", cenario,
+                    origem, destino, d.distancia_total, a.algoritmo, a.distancia_total);
+        }
+        fechadas_dijkstra += d.nos_visitados;
+        fechadas_astar += a.nos_visitados;
+        tempo_dijkstra += d.tempo_ms;
+        tempo_astar += a.tempo_ms;
+        algoritmo = a.algoritmo;
+
+        liberar_resultado_caminho(&d);
+        liberar_resultado_caminho(&a);
+    }
+
+    printf("%-22s %8d %8s %14.0f %14.0f %8.1f%% %10.3f %10.3f %6d\n",
+           cenario, g->num_cidades, algoritmo,
+           (double)fechadas_dijkstra / consultas, (double)fechadas_astar / consultas,
+           fechadas_dijkstra > 0 ? 100.0 * fechadas_astar / fechadas_dijkstra : 0.0,
+           tempo_dijkstra / consultas, tempo_astar / consultas, divergencias);
+    return divergencias;
+}
+
+int main(int argc, char** argv) {
+    int lado = argc > 1 ? atoi(argv[1]) : 200;
+    int consultas = argc > 2 ? atoi(argv[2]) : 200;
+    if (lado < 2 || consultas < 1) {
+        fprintf(stderr, "Uso: %s [lado da grade] [consultas]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-22s %8s %8s %14s %14s %9s %10s %10s %6s\n", "cenario", "cidades", "motor",
+           "fechadas(Dijk)", "fechadas(A*)", "A*/Dijk", "ms(Dijk)", "ms(A*)", "erros");
+
+    Grafo* g = montar_grade(lado);
+    int divergencias = comparar(g, "coordenadas exatas", consultas);
+
+    // Coordenadas estimadas: 5% das cidades deslocadas em até ~40 km
+    for (int i = 0; i < g->num_cidades; i++) {
+        if (aleatorio() < 0.05) {
+            grafo_definir_coordenadas(g, i, g->cidades[i].latitude + 0.36 * (aleatorio() - 0.5),
+                                      g->cidades[i].longitude + 0.36 * (aleatorio() - 0.5));
+        }
+    }
+    divergencias += comparar(g, "coordenadas da IA", consultas);
+
+    liberar_grafo(g);
+    return divergencias > 0 ? 1 : 0;
+}
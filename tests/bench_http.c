@@ -0,0 +1,144 @@
+/* bench_http.c - Latência por requisição: libcurl por pedido x pool de handles
+ * GenieC - Assistente Inteligente
+ *
+ * O servidor stub faz o papel do Gemini (POST JSON, resposta de ~2 KB). O
+ * cenário "sem pool" repete o que fazer_requisicao_http fazia antes: global
+ * init, easy init, perform, cleanup e global cleanup a cada pedido, com uma
+ * conexão TCP nova por vez. O cenário "pool" usa fazer_requisicao_http, que
+ * reaproveita handle, DNS e conexão. O stub só fala HTTP: contra a API real o
+ * pool também evita um handshake TLS por pedido, que não aparece aqui.
+ *
+ * Uso: bench_http [requisições] [atraso do servidor em ms]   (retorna 1 se algum pedido falhar)
+ */
+
+#include "servidor_stub.h"
+#include "http_utils.h"
+#include <curl/curl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int atraso_servidor_ms = 0;
+
+static void tratar_gemini(const char* metodo, const char* caminho, const char* corpo,
+                          RespostaStub* resposta, void* userdata) {
+    size_t tamanho = 2048;
+    char* texto = (char*)malloc(tamanho);
+    if (texto) {
+        int n = snprintf(texto, tamanho, "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"");
+        while ((size_t)n + 64 < tamanho) n += snprintf(texto + n, tamanho - (size_t)n, "Resposta simulada. ");
+        snprintf(texto + n, tamanho - (size_t)n, "\"}],\"role\":\"model\"}}]}");
+    }
+    resposta->status = 200;
+    resposta->corpo = texto;
+    resposta->atraso_ms = atraso_servidor_ms;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int comparar_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Como fazer_requisicao_http era antes do pool: libcurl montada e desmontada a cada pedido
+static char* requisicao_sem_pool(const char* url, const char* payload) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        curl_global_cleanup();
+        return NULL;
+    }
+
+    struct MemoryStruct chunk = {malloc(1), 0};
+    struct curl_slist* headers = curl_slist_append(NULL, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&chunk);
+
+    long http_code = 0;
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    curl_global_cleanup();
+
+    if (res != CURLE_OK || http_code != 200) {
+        free(chunk.memory);
+        return NULL;
+    }
+    return chunk.memory;
+}
+
+// Mede cada pedido do cenário; retorna o número de falhas
+static int medir(const char* cenario, int pool, ServidorStub* servidor, const char* url,
+                 const char* payload, int requisicoes) {
+    double* tempos = (double*)malloc((size_t)requisicoes * sizeof(double));
+    if (!tempos) return requisicoes;
+
+    int conexoes_antes = servidor_stub_conexoes(servidor);
+    int falhas = 0;
+    double total = 0.0;
+    for (int i = 0; i < requisicoes; i++) {
+        double inicio = agora_ms();
+        char* resposta = pool ? fazer_requisicao_http(url, payload) : requisicao_sem_pool(url, payload);
+        tempos[i] = agora_ms() - inicio;
+        total += tempos[i];
+        if (!resposta) falhas++;
+        free(resposta);
+    }
+    int conexoes = servidor_stub_conexoes(servidor) - conexoes_antes;
+
+    qsort(tempos, (size_t)requisicoes, sizeof(double), comparar_double);
+    printf("%-10s %6d %10.3f %10.3f %10.3f %10.3f %10.3f %9d %6d\n", cenario, requisicoes,
+           total / requisicoes, tempos[requisicoes / 2], tempos[requisicoes * 95 / 100],
+           tempos[requisicoes * 99 / 100], tempos[requisicoes - 1], conexoes, falhas);
+    free(tempos);
+    return falhas;
+}
+
+int main(int argc, char** argv) {
+    int requisicoes = argc > 1 ? atoi(argv[1]) : 2000;
+    atraso_servidor_ms = argc > 2 ? atoi(argv[2]) : 0;
+    if (requisicoes < 1 || atraso_servidor_ms < 0) {
+        fprintf(stderr, "Uso: %s [requisições] [atraso do servidor em ms]\n", argv[0]);
+        return 2;
+    }
+
+    ServidorStub* servidor = servidor_stub_iniciar(tratar_gemini, NULL);
+    if (!servidor) {
+        fprintf(stderr, "[ERRO BENCH] Servidor stub não iniciou\n");
+        return 1;
+    }
+
+    char url[128];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/v1beta/models/gemini:generateContent?key=bench",
+             servidor_stub_porta(servidor));
+
+    // Pedido do tamanho de um turno de chat com histórico curto
+    char payload[4096];
+    int n = snprintf(payload, sizeof(payload), "{\"contents\":[{\"role\":\"user\",\"parts\":[{\"text\":\"");
+    while ((size_t)n + 64 < sizeof(payload)) n += snprintf(payload + n, sizeof(payload) - (size_t)n, "Pergunta de teste. ");
+    snprintf(payload + n, sizeof(payload) - (size_t)n, "\"}]}]}");
+
+    printf("%-10s %6s %10s %10s %10s %10s %10s %9s %6s\n", "cenario", "pedidos", "media(ms)",
+           "p50", "p95", "p99", "max", "conexoes", "falhas");
+
+    // O cenário antigo roda antes de http_inicializar: ele mesmo faz o global init/cleanup
+    int falhas = medir("sem pool", 0, servidor, url, payload, requisicoes);
+
+    http_inicializar();
+    falhas += medir("pool", 1, servidor, url, payload, requisicoes);
+    http_finalizar();
+
+    servidor_stub_parar(servidor);
+    return falhas > 0 ? 1 : 0;
+}
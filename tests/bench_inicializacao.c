@@ -0,0 +1,168 @@
+/* bench_inicializacao.c - Tempo de carga na inicialização: texto x snapshot (mmap)
+ * GenieC - Assistente Inteligente
+ *
+ * Escreve um coordenadas_grafo.txt sintético (grade de cidades, 100k conexões
+ * por padrão), gera o snapshot com grafo_snapshot_de_texto, como o conversor
+ * faz, e carrega cada formato várias vezes num grafo novo. Os dois carregamentos
+ * precisam produzir o mesmo grafo. carregar_coordenadas_grafo é o caminho da
+ * inicialização: com o snapshot mais novo que o texto, ele usa o snapshot.
+ *
+ * Uso: bench_inicializacao [conexões] [repetições]   (retorna 1 se os grafos divergirem)
+ */
+
+#include "grafo.h"
+#include "grafo_snapshot.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ARQUIVO_TEXTO "coordenadas_grafo.txt"
+#define ARQUIVO_SNAPSHOT "coordenadas_grafo.bin"
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int comparar_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Grade com vizinhas na horizontal e na vertical até completar as conexões pedidas
+static int escrever_texto(int conexoes, int* num_cidades) {
+    int lado = 2;
+    while (2 * lado * (lado - 1) < conexoes) lado++;
+
+    FILE* f = fopen(ARQUIVO_TEXTO, "w");
+    if (!f) return 0;
+
+    fprintf(f, "# Grafo GenieC - Coordenadas e Conexões\n\n# === CIDADES ===\n");
+    for (int i = 0; i < lado * lado; i++) {
+        fprintf(f, "Cidade %d|%.6f|%.6f\n", i, -30.0 + 0.02 * (i / lado), -55.0 + 0.02 * (i % lado));
+    }
+
+    fprintf(f, "\n# === CONEXÕES ===\n");
+    unsigned int semente = 31337;
+    int escritas = 0;
+    for (int i = 0; i < lado * lado && escritas < conexoes; i++) {
+        int vizinhos[2] = {i % lado + 1 < lado ? i + 1 : -1, i / lado + 1 < lado ? i + lado : -1};
+        for (int k = 0; k < 2 && escritas < conexoes; k++) {
+            if (vizinhos[k] < 0) continue;
+            semente = semente * 1103515245u + 12345u;
+            fprintf(f, "CONEXAO|Cidade %d|Cidade %d|%u\n", i, vizinhos[k], 2 + (semente >> 8) % 30);
+            escritas++;
+        }
+    }
+
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    *num_cidades = lado * lado;
+    return ok;
+}
+
+// Carrega o formato 0 (texto), 1 (snapshot) ou 2 (carregar_coordenadas_grafo) num grafo novo
+static Grafo* carregar(int formato, double* tempo_ms) {
+    Grafo* g = criar_grafo();
+    double inicio = agora_ms();
+    if (formato == 0) {
+        carregar_texto_grafo(g, ARQUIVO_TEXTO);
+    } else if (formato == 1) {
+        grafo_snapshot_carregar(g, ARQUIVO_SNAPSHOT);
+    } else {
+        carregar_coordenadas_grafo(g, ARQUIVO_TEXTO);
+    }
+    grafo_compactar(g);
+    *tempo_ms = agora_ms() - inicio;
+    return g;
+}
+
+// 1 se os dois grafos têm as mesmas cidades, coordenadas e conexões
+static int grafos_iguais(Grafo* a, Grafo* b) {
+    if (a->num_cidades != b->num_cidades || grafo_num_conexoes(a) != grafo_num_conexoes(b)) return 0;
+    for (int u = 0; u < a->num_cidades; u++) {
+        int v = encontrar_cidade(b, a->cidades[u].nome);
+        if (v < 0 || fabs(a->cidades[u].latitude - b->cidades[v].latitude) > 1e-6 ||
+            fabs(a->cidades[u].longitude - b->cidades[v].longitude) > 1e-6) {
+            return 0;
+        }
+        for (int e = a->csr_inicio[u]; e < a->csr_inicio[u + 1]; e++) {
+            int w = encontrar_cidade(b, a->cidades[a->csr_destino[e]].nome);
+            if (w < 0 || grafo_distancia(b, v, w) != a->csr_peso[e]) return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    int conexoes = argc > 1 ? atoi(argv[1]) : 100000;
+    int repeticoes = argc > 2 ? atoi(argv[2]) : 5;
+    if (conexoes < 1 || repeticoes < 1) {
+        fprintf(stderr, "Uso: %s [conexões] [repetições]\n", argv[0]);
+        return 2;
+    }
+
+    // Os arquivos do grafo ficam num diretório temporário
+    char diretorio[] = "/tmp/geniec_bench_XXXXXX";
+    if (!mkdtemp(diretorio) || chdir(diretorio) != 0) {
+        fprintf(stderr, "[ERRO BENCH] Não foi possível criar o diretório temporário\n");
+        return 1;
+    }
+
+    int num_cidades = 0;
+    double inicio = agora_ms();
+    int ok = escrever_texto(conexoes, &num_cidades);
+    double tempo_texto = agora_ms() - inicio;
+    inicio = agora_ms();
+    ok = ok && grafo_snapshot_de_texto(ARQUIVO_TEXTO, ARQUIVO_SNAPSHOT);
+    double tempo_conversao = agora_ms() - inicio;
+    if (!ok) {
+        fprintf(stderr, "[ERRO BENCH] Não foi possível gerar os arquivos do grafo\n");
+        return 1;
+    }
+    printf("Grafo: %d cidades, %d conexões (texto escrito em %.0f ms, snapshot convertido em %.0f ms)\n\n",
+           num_cidades, conexoes, tempo_texto, tempo_conversao);
+
+    static const char* nomes[] = {"texto", "snapshot (mmap)", "carregar_coordenadas"};
+    double* tempos = (double*)malloc((size_t)repeticoes * sizeof(double));
+    double medianas[3] = {0.0, 0.0, 0.0};
+    Grafo* referencia = NULL;
+    int divergencias = 0;
+
+    printf("%-22s %10s %10s %10s %10s\n", "formato", "cidades", "min(ms)", "mediana", "max(ms)");
+    for (int formato = 0; formato < 3 && tempos; formato++) {
+        int cidades = 0;
+        for (int r = 0; r < repeticoes; r++) {
+            Grafo* g = carregar(formato, &tempos[r]);
+            cidades = g->num_cidades;
+            if (!referencia) {
+                referencia = g;
+                continue;
+            }
+            if (r == 0 && !grafos_iguais(referencia, g)) {
+                divergencias++;
+                fprintf(stderr, "[ERRO BENCH] %s carregou um grafo diferente do texto\n", nomes[formato]);
+            }
+            liberar_grafo(g);
+        }
+        qsort(tempos, (size_t)repeticoes, sizeof(double), comparar_double);
+        medianas[formato] = tempos[repeticoes / 2];
+        printf("%-22s %10d %10.2f %10.2f %10.2f\n", nomes[formato], cidades, tempos[0],
+               medianas[formato], tempos[repeticoes - 1]);
+    }
+    if (medianas[1] > 0.0) {
+        printf("\nSnapshot %.1fx mais rápido que o texto (mediana)\n", medianas[0] / medianas[1]);
+    }
+
+    free(tempos);
+    liberar_grafo(referencia);
+    remover_arquivos_grafo(ARQUIVO_TEXTO);
+    chdir("/");
+    rmdir(diretorio);
+    return divergencias > 0 ? 1 : 0;
+}
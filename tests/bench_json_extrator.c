@@ -0,0 +1,267 @@
+/* bench_json_extrator.c - Texto da resposta do Gemini: extrator em uma passada x árvore do cJSON
+ * GenieC - Assistente Inteligente
+ *
+ * Monta uma resposta com grounding do tamanho das reais (várias partes, escapes,
+ * acentos crus e escapados, emojis como pares substitutos, uma parte sem texto
+ * com "text" dentro de functionCall, groundingMetadata bem maior que o texto e
+ * um segundo candidato que deve ser ignorado). O caminho antigo faz o parse
+ * completo com o cJSON e junta candidates[0].content.parts[*].text; o texto de
+ * json_extrair_texto_gemini precisa ser idêntico, byte a byte.
+ *
+ * As alocações do cJSON são contadas com cJSON_InitHooks; cada caminho soma as
+ * do buffer de texto que ele mesmo cria. O extrator decodifica dentro do próprio
+ * buffer: ele trabalha numa cópia da resposta reservada antes da medição, e a
+ * cópia (memcpy) entra no tempo dele.
+ *
+ * Uso: bench_json_extrator [partes] [repetições]   (retorna 1 se os textos divergirem)
+ */
+
+#include "json_extrator.h"
+#include "str_builder.h"
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNKS_POR_PARTE 4          // groundingChunks e groundingSupports por parte de texto
+
+static unsigned int semente = 2718;
+
+static unsigned int aleatorio(void) {
+    semente = semente * 1103515245u + 12345u;
+    return (semente >> 8) & 0xFFFFFF;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int comparar_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// ===== Contagem de alocações =====
+
+static size_t alocacoes = 0;
+static size_t bytes_alocados = 0;
+
+static void* malloc_contado(size_t tamanho) {
+    alocacoes++;
+    bytes_alocados += tamanho;
+    return malloc(tamanho);
+}
+
+// ===== Resposta sintética =====
+
+// Trechos já escritos como JSON: o que o Gemini manda dentro de "text"
+static const char* trechos[] = {
+    "Segundo as fontes consultadas, a rota mais curta passa pelo interior. ",
+    "São Paulo fica a 430 km do Rio de Janeiro pela Via Dutra. ",
+    "O guia chama o trecho de \\\"serra velha\\\" e usa a barra \\\\ nas siglas. ",
+    "Primeira etapa:\\n\\t- abastecer em Resende;\\n\\t- seguir até Taubaté.\\n",
+    "Cidades escapadas: S\\u00e3o Jos\\u00e9 dos Campos e Aparecida do Norte. ",
+    "Previsão \\u2600\\uFE0F 23\\u00b0C, chuva \\ud83c\\udf27 \\u00e0 tarde \\uD83D\\uDE00. ",
+    "Mapa \\uD83D\\uDDFA\\uFE0F em https:\\/\\/exemplo.com.br\\/rotas\\/sp-rj?via=dutra. ",
+    "Tempo estimado \\u2192 5h30 (\\u00b115 min) \\u2014 sem pedágio na volta. ",
+};
+
+static void anexar_trechos(StrBuilder* sb, int quantidade) {
+    for (int i = 0; i < quantidade; i++) {
+        sb_anexar(sb, trechos[aleatorio() % (sizeof(trechos) / sizeof(trechos[0]))]);
+    }
+}
+
+// Resposta de generateContent com grounding: partes de texto e metadados bem maiores que elas
+static char* montar_resposta(int partes, size_t* tamanho) {
+    StrBuilder sb;
+    sb_iniciar(&sb, 4096);
+
+    sb_anexar(&sb, "{\n  \"candidates\": [\n    {\n      \"content\": {\n        \"parts\": [\n");
+    for (int i = 0; i < partes; i++) {
+        if (i > 0) sb_anexar(&sb, ",\n");
+        if (i % 7 == 3) {
+            // Parte sem texto: o "text" dos argumentos não pode entrar na resposta
+            sb_formatar(&sb, "          {\"functionCall\": {\"name\": \"calcular_rota\", \"args\": "
+                             "{\"text\": \"ignorado %d\", \"origem\": \"Campinas\"}}}", i);
+            continue;
+        }
+        sb_anexar(&sb, "          {");
+        if (i % 5 == 1) sb_anexar(&sb, "\"thought\": false, ");
+        sb_anexar(&sb, "\"text\": \"");
+        anexar_trechos(&sb, 1 + (int)(aleatorio() % 4));
+        sb_anexar(&sb, "\"}");
+    }
+    sb_anexar(&sb, "\n        ],\n        \"role\": \"model\"\n      },\n");
+
+    // groundingMetadata do primeiro candidato
+    sb_anexar(&sb, "      \"groundingMetadata\": {\n        \"webSearchQueries\": "
+                   "[\"distância São Paulo Rio\", \"previsão do tempo Dutra\"],\n"
+                   "        \"searchEntryPoint\": {\"renderedContent\": \"<style>\\n.container {\\n");
+    for (int i = 0; i < partes * 4; i++) {
+        sb_formatar(&sb, "  .chip-%d { color: #%06x; content: \\\"\\u2192\\\"; }\\n", i, aleatorio());
+    }
+    sb_anexar(&sb, "}\\n</style>\"},\n        \"groundingChunks\": [\n");
+    int chunks = partes * CHUNKS_POR_PARTE;
+    for (int i = 0; i < chunks; i++) {
+        sb_formatar(&sb, "%s          {\"web\": {\"uri\": \"https:\\/\\/vertexaisearch.cloud.google.com\\/"
+                         "grounding-api-redirect\\/AUZIYQ%08x%08x\", \"title\": \"fonte%d.com.br\"}}",
+                    i > 0 ? ",\n" : "", aleatorio(), aleatorio(), i);
+    }
+    sb_anexar(&sb, "\n        ],\n        \"groundingSupports\": [\n");
+    for (int i = 0; i < chunks; i++) {
+        sb_formatar(&sb, "%s          {\"segment\": {\"startIndex\": %d, \"endIndex\": %d, \"text\": \"",
+                    i > 0 ? ",\n" : "", i * 40, i * 40 + 39);
+        anexar_trechos(&sb, 1);
+        sb_formatar(&sb, "\"}, \"groundingChunkIndices\": [%d, %d], \"confidenceScores\": [0.%u, 0.%u]}",
+                    i, (i + 1) % chunks, aleatorio() % 1000, aleatorio() % 1000);
+    }
+    sb_anexar(&sb, "\n        ]\n      },\n      \"finishReason\": \"STOP\",\n      \"index\": 0\n    },\n");
+
+    // Segundo candidato: fora do texto extraído
+    sb_anexar(&sb, "    {\"content\": {\"parts\": [{\"text\": \"Candidato alternativo\"}], \"role\": \"model\"}, "
+                   "\"index\": 1}\n  ],\n");
+    sb_formatar(&sb, "  \"usageMetadata\": {\"promptTokenCount\": %d, \"candidatesTokenCount\": %d, "
+                     "\"totalTokenCount\": %d},\n  \"modelVersion\": \"gemini-2.0-flash\"\n}\n",
+                120, partes * 30, 120 + partes * 30);
+
+    *tamanho = sb.tamanho;
+    return sb_finalizar(&sb);
+}
+
+// ===== Os dois caminhos =====
+
+// Caminho antigo: árvore inteira do cJSON e cópia do texto de cada parte
+static char* texto_por_cjson(const char* json, size_t* tamanho) {
+    cJSON* raiz = cJSON_Parse(json);
+    cJSON* candidato = cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(raiz, "candidates"), 0);
+    cJSON* parts = cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(candidato, "content"), "parts");
+
+    size_t total = 0;
+    int encontrou = 0;
+    cJSON* parte = NULL;
+    cJSON_ArrayForEach(parte, parts) {
+        cJSON* texto = cJSON_GetObjectItemCaseSensitive(parte, "text");
+        if (cJSON_IsString(texto)) {
+            total += strlen(texto->valuestring);
+            encontrou = 1;
+        }
+    }
+
+    char* resultado = encontrou ? (char*)malloc_contado(total + 1) : NULL;
+    if (resultado) {
+        size_t n = 0;
+        cJSON_ArrayForEach(parte, parts) {
+            cJSON* texto = cJSON_GetObjectItemCaseSensitive(parte, "text");
+            if (!cJSON_IsString(texto)) continue;
+            size_t len = strlen(texto->valuestring);
+            memcpy(resultado + n, texto->valuestring, len);
+            n += len;
+        }
+        resultado[n] = '\0';
+        *tamanho = n;
+    }
+    cJSON_Delete(raiz);
+    return resultado;
+}
+
+// Extrator: decodifica numa cópia da resposta, que ele destrói
+static size_t texto_por_extrator(const char* json, size_t tamanho_json, char* trabalho) {
+    memcpy(trabalho, json, tamanho_json + 1);
+    return json_extrair_texto_gemini(trabalho, tamanho_json);
+}
+
+// Mede uma resposta com o número de partes dado; retorna 1 se os textos divergirem
+static int medir(int partes, int repeticoes, double* tempos) {
+    size_t tamanho_json = 0;
+    char* json = montar_resposta(partes, &tamanho_json);
+    char* trabalho = json ? (char*)malloc(tamanho_json + 1) : NULL;
+    if (!trabalho) {
+        fprintf(stderr, "[ERRO BENCH] Sem memória para a resposta de %d partes\n", partes);
+        free(json);
+        return 1;
+    }
+
+    // Conferência e contagem numa execução de cada caminho
+    alocacoes = 0;
+    bytes_alocados = 0;
+    size_t tamanho_esperado = 0;
+    char* esperado = texto_por_cjson(json, &tamanho_esperado);
+    size_t alocacoes_cjson = alocacoes;
+    size_t bytes_cjson = bytes_alocados;
+
+    alocacoes = 0;
+    bytes_alocados = 0;
+    size_t tamanho_texto = texto_por_extrator(json, tamanho_json, trabalho);
+    size_t alocacoes_extrator = alocacoes;
+
+    int igual = esperado && tamanho_texto == tamanho_esperado &&
+                memcmp(trabalho, esperado, tamanho_esperado + 1) == 0;
+    if (!igual) {
+        size_t limite = tamanho_texto == JSON_TEXTO_AUSENTE ? 0 : tamanho_texto;
+        size_t i = 0;
+        while (esperado && i < limite && i < tamanho_esperado && trabalho[i] == esperado[i]) i++;
+        fprintf(stderr, "[ERRO BENCH] %d partes: extrator devolveu %ld bytes, cJSON %zu; primeira diferença no byte %zu\n",
+                partes, tamanho_texto == JSON_TEXTO_AUSENTE ? -1L : (long)tamanho_texto, tamanho_esperado, i);
+    }
+    free(esperado);
+
+    double medianas[2];
+    for (int caminho = 0; caminho < 2; caminho++) {
+        for (int r = 0; r < repeticoes; r++) {
+            double inicio = agora_ms();
+            if (caminho == 0) {
+                size_t n = 0;
+                free(texto_por_cjson(json, &n));
+            } else {
+                texto_por_extrator(json, tamanho_json, trabalho);
+            }
+            tempos[r] = agora_ms() - inicio;
+        }
+        qsort(tempos, (size_t)repeticoes, sizeof(double), comparar_double);
+        medianas[caminho] = tempos[repeticoes / 2];
+    }
+
+    printf("%7d %10.1f %10.1f %11.3f %10zu %10.1f %11.3f %10zu %8s\n", partes, tamanho_json / 1024.0,
+           tamanho_esperado / 1024.0, medianas[0], alocacoes_cjson, bytes_cjson / 1024.0, medianas[1],
+           alocacoes_extrator, igual ? "sim" : "NAO");
+
+    free(trabalho);
+    free(json);
+    return !igual;
+}
+
+int main(int argc, char** argv) {
+    int partes = argc > 1 ? atoi(argv[1]) : 1000;
+    int repeticoes = argc > 2 ? atoi(argv[2]) : 50;
+    if (partes < 1 || repeticoes < 1) {
+        fprintf(stderr, "Uso: %s [partes] [repetições]\n", argv[0]);
+        return 2;
+    }
+
+    cJSON_Hooks ganchos = {malloc_contado, free};
+    cJSON_InitHooks(&ganchos);
+
+    double* tempos = (double*)malloc((size_t)repeticoes * sizeof(double));
+    if (!tempos) return 1;
+
+    printf("%7s %10s %10s %11s %10s %10s %11s %10s %8s\n", "partes", "JSON(KB)", "texto(KB)",
+           "cJSON(ms)", "alocacoes", "aloc(KB)", "extrator", "alocacoes", "igual");
+
+    // Uma parte, um centésimo, um décimo e o tamanho pedido
+    int divergencias = 0;
+    int anterior = 0;
+    int tamanhos[] = {1, partes / 100, partes / 10, partes};
+    for (size_t i = 0; i < sizeof(tamanhos) / sizeof(tamanhos[0]); i++) {
+        if (tamanhos[i] <= anterior) continue;
+        divergencias += medir(tamanhos[i], repeticoes, tempos);
+        anterior = tamanhos[i];
+    }
+
+    free(tempos);
+    return divergencias > 0 ? 1 : 0;
+}
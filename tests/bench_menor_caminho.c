@@ -0,0 +1,165 @@
+/* bench_menor_caminho.c - Motor de menor caminho em grafos sintéticos de 1k a 1M cidades
+ * GenieC - Assistente Inteligente
+ *
+ * Grade de estradas (vizinhas na horizontal e vertical, algumas diagonais) com
+ * 10 a 100 km por trecho, sem coordenadas: só o Dijkstra com heap binário do
+ * grafo_menor_caminho. Nos tamanhos pequenos, as primeiras consultas também
+ * rodam na varredura linear O(V²) que as funções de rota usavam antes do motor,
+ * e as distâncias precisam bater. A primeira consulta de cada grafo aloca a
+ * memória de trabalho; as demais a reaproveitam.
+ *
+ * Uso: bench_menor_caminho [máximo de cidades] [consultas] [limite da varredura O(V²)]
+ *      (retorna 1 se alguma distância divergir)
+ */
+
+#include "grafo.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CONSULTAS_VARREDURA 5       // A varredura O(V²) é lenta: só as primeiras consultas
+
+static unsigned int semente = 4242;
+
+static unsigned int aleatorio(void) {
+    semente = semente * 1103515245u + 12345u;
+    return (semente >> 8) & 0xFFFFFF;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static Grafo* montar_grade(int lado) {
+    Grafo* g = criar_grafo();
+    char nome[32];
+    char outro[32];
+    for (int i = 0; i < lado * lado; i++) {
+        snprintf(nome, sizeof(nome), "N%d", i);
+        adicionar_cidade(g, nome);
+    }
+    for (int i = 0; i < lado * lado; i++) {
+        int linha = i / lado;
+        int coluna = i % lado;
+        int vizinhos[3] = {
+            coluna + 1 < lado ? i + 1 : -1,
+            linha + 1 < lado ? i + lado : -1,
+            coluna + 1 < lado && linha + 1 < lado && aleatorio() % 10 < 3 ? i + lado + 1 : -1
+        };
+        snprintf(nome, sizeof(nome), "N%d", i);
+        for (int k = 0; k < 3; k++) {
+            if (vizinhos[k] < 0) continue;
+            snprintf(outro, sizeof(outro), "N%d", vizinhos[k]);
+            adicionar_aresta(g, nome, outro, 10 + (int)(aleatorio() % 91));
+        }
+    }
+    grafo_compactar(g);
+    return g;
+}
+
+// Dijkstra como era antes do motor: procura a menor distância aberta por varredura linear
+static int dijkstra_varredura(Grafo* g, int origem, int destino, int* dist, char* fechado) {
+    int n = g->num_cidades;
+    for (int i = 0; i < n; i++) {
+        dist[i] = INT_MAX;
+        fechado[i] = 0;
+    }
+    dist[origem] = 0;
+
+    for (int passo = 0; passo < n; passo++) {
+        int u = -1;
+        for (int i = 0; i < n; i++) {
+            if (!fechado[i] && dist[i] != INT_MAX && (u < 0 || dist[i] < dist[u])) u = i;
+        }
+        if (u < 0 || u == destino) break;
+        fechado[u] = 1;
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            int v = g->csr_destino[e];
+            if (dist[u] + g->csr_peso[e] < dist[v]) dist[v] = dist[u] + g->csr_peso[e];
+        }
+    }
+    return dist[destino] == INT_MAX ? -1 : dist[destino];
+}
+
+// Roda as consultas num grafo com o lado dado; retorna o número de divergências
+static int medir(int lado, int consultas, int limite_varredura) {
+    double inicio = agora_ms();
+    Grafo* g = montar_grade(lado);
+    double tempo_montagem = agora_ms() - inicio;
+    int n = g->num_cidades;
+
+    int varrer = n <= limite_varredura;
+    int* dist = varrer ? (int*)malloc((size_t)n * sizeof(int)) : NULL;
+    char* fechado = varrer ? (char*)malloc((size_t)n) : NULL;
+    varrer = dist && fechado;
+
+    double primeira = 0.0;
+    double tempo_heap = 0.0;
+    double tempo_varredura = 0.0;
+    long fechadas = 0;
+    int varridas = 0;
+    int divergencias = 0;
+    for (int q = 0; q < consultas; q++) {
+        int origem = (int)(aleatorio() % (unsigned int)n);
+        int destino = (int)(aleatorio() % (unsigned int)n);
+
+        ResultadoCaminho r;
+        double t = agora_ms();
+        grafo_menor_caminho(g, origem, destino, &r);
+        t = agora_ms() - t;
+        if (q == 0) {
+            primeira = t;
+        } else {
+            tempo_heap += t;
+        }
+        fechadas += r.nos_visitados;
+
+        if (varrer && q < CONSULTAS_VARREDURA) {
+            t = agora_ms();
+            int esperado = dijkstra_varredura(g, origem, destino, dist, fechado);
+            tempo_varredura += agora_ms() - t;
+            varridas++;
+            if (esperado != (r.encontrado ? r.distancia_total : -1)) {
+                divergencias++;
+                fprintf(stderr, "[ERRO BENCH] N%d -> N%d: heap %d km, varredura %d km\n",
+                        origem, destino, r.distancia_total, esperado);
+            }
+        }
+        liberar_resultado_caminho(&r);
+    }
+
+    char coluna_varredura[32] = "-";
+    if (varridas > 0) snprintf(coluna_varredura, sizeof(coluna_varredura), "%.3f", tempo_varredura / varridas);
+    printf("%9d %10d %12.1f %12.3f %12.3f %12.0f %14s %6d\n", n, grafo_num_conexoes(g), tempo_montagem,
+           primeira, consultas > 1 ? tempo_heap / (consultas - 1) : primeira,
+           (double)fechadas / consultas, coluna_varredura, divergencias);
+
+    free(dist);
+    free(fechado);
+    liberar_grafo(g);
+    return divergencias;
+}
+
+int main(int argc, char** argv) {
+    int maximo = argc > 1 ? atoi(argv[1]) : 1000000;
+    int consultas = argc > 2 ? atoi(argv[2]) : 50;
+    int limite_varredura = argc > 3 ? atoi(argv[3]) : 10000;
+    if (maximo < 1000 || consultas < 1) {
+        fprintf(stderr, "Uso: %s [máximo de cidades >= 1000] [consultas] [limite da varredura O(V²)]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%9s %10s %12s %12s %12s %12s %14s %6s\n", "cidades", "conexoes", "montagem(ms)",
+           "1a consulta", "ms/consulta", "fechadas", "varredura(ms)", "erros");
+
+    int divergencias = 0;
+    for (int cidades = 1000; cidades <= maximo; cidades *= 10) {
+        divergencias += medir((int)ceil(sqrt((double)cidades)), consultas, limite_varredura);
+    }
+    return divergencias > 0 ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+/* bench_str_builder.c - Fuzz do StrBuilder e tempo do mapa do grafo até 10k cidades
+ * GenieC - Assistente Inteligente
+ *
+ * Fuzz: sequências aleatórias de sb_anexar, sb_anexar_n, sb_formatar e
+ * sb_anexar_json_string, com trechos que atravessam a capacidade do buffer,
+ * comparadas passo a passo com uma referência que aloca o tamanho exato de
+ * cada trecho. Qualquer byte a menos (truncamento) ou a mais é erro.
+ *
+ * Mapa: gerar_mapa_grafo em grades de 1k a 10k cidades com coordenadas. O
+ * HTML tem de trazer todos os marcadores e conexões e terminar inteiro; o
+ * tempo por KB gerado deve ficar estável (montagem linear, sem strcat).
+ *
+ * Uso: bench_str_builder [iterações do fuzz] [máximo de cidades do mapa]
+ *      (retorna 1 se o fuzz divergir ou o mapa sair truncado)
+ */
+
+#include "grafo.h"
+#include "str_builder.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OPERACOES_POR_ITERACAO 40
+#define FIM_DO_MAPA "💡 Clique nos marcadores para ver detalhes"
+
+static unsigned int semente = 9001;
+
+static unsigned int aleatorio(void) {
+    semente = semente * 1103515245u + 12345u;
+    return (semente >> 8) & 0xFFFFFF;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// ===== Fuzz =====
+
+// Referência: cresce com o tamanho exato de cada trecho
+typedef struct {
+    char* dados;
+    size_t tamanho;
+} Referencia;
+
+static void ref_anexar_n(Referencia* ref, const char* texto, size_t n) {
+    ref->dados = (char*)realloc(ref->dados, ref->tamanho + n + 1);
+    memcpy(ref->dados + ref->tamanho, texto, n);
+    ref->tamanho += n;
+    ref->dados[ref->tamanho] = '\0';
+}
+
+static void ref_anexar_json_string(Referencia* ref, const char* texto) {
+    ref_anexar_n(ref, "\"", 1);
+    for (const unsigned char* p = (const unsigned char*)texto; *p; p++) {
+        char escape[8];
+        if (*p == '"') {
+            ref_anexar_n(ref, "\\\"", 2);
+        } else if (*p == '\\') {
+            ref_anexar_n(ref, "\\\\", 2);
+        } else if (*p == '\n') {
+            ref_anexar_n(ref, "\\n", 2);
+        } else if (*p < 0x20) {
+            snprintf(escape, sizeof(escape), "\\u%04x", *p);
+            ref_anexar_n(ref, escape, 6);
+        } else {
+            ref_anexar_n(ref, (const char*)p, 1);
+        }
+    }
+    ref_anexar_n(ref, "\"", 1);
+}
+
+// Texto aleatório com aspas, barras, controles, '%' e UTF-8; às vezes maior que o buffer inteiro
+static char* texto_aleatorio(size_t* tamanho) {
+    static const char* pedacos[] = {"a", "Z", "9", " ", "\"", "\\", "\n", "\t", "\x01", "%", "%s",
+                                    "ã", "é", "→", "🗺️", "São Paulo", "|", "'"};
+    size_t maximo = aleatorio() % 8 == 0 ? 6000 : 300;
+    size_t alvo = aleatorio() % (maximo + 1);
+
+    char* texto = (char*)malloc(alvo + 32);
+    size_t n = 0;
+    while (n < alvo) {
+        const char* p = pedacos[aleatorio() % (sizeof(pedacos) / sizeof(pedacos[0]))];
+        size_t len = strlen(p);
+        memcpy(texto + n, p, len);
+        n += len;
+    }
+    texto[n] = '\0';
+    *tamanho = n;
+    return texto;
+}
+
+// Uma iteração: um builder com capacidade inicial aleatória contra a referência
+static int fuzz_iteracao(int iteracao) {
+    StrBuilder sb;
+    size_t capacidades[] = {0, 1, 2, 16, 255, 256, 4096};
+    sb_iniciar(&sb, capacidades[aleatorio() % (sizeof(capacidades) / sizeof(capacidades[0]))]);
+    Referencia ref = {NULL, 0};
+    ref_anexar_n(&ref, "", 0);
+
+    int divergencias = 0;
+    for (int op = 0; op < OPERACOES_POR_ITERACAO && divergencias == 0; op++) {
+        size_t tamanho = 0;
+        char* texto = texto_aleatorio(&tamanho);
+        int tipo = (int)(aleatorio() % 5);
+        const char* nome = "";
+
+        if (tipo == 0) {
+            nome = "sb_anexar";
+            sb_anexar(&sb, texto);
+            ref_anexar_n(&ref, texto, tamanho);
+        } else if (tipo == 1) {
+            nome = "sb_anexar_n";
+            size_t n = tamanho > 0 ? aleatorio() % (tamanho + 1) : 0;
+            sb_anexar_n(&sb, texto, n);
+            ref_anexar_n(&ref, texto, n);
+        } else if (tipo == 2) {
+            nome = "sb_formatar";
+            int numero = (int)aleatorio() - 0x800000;
+            double real = numero / 3.0;
+            sb_formatar(&sb, "%d|%.4f|%s|%%", numero, real, texto);
+            int n = snprintf(NULL, 0, "%d|%.4f|%s|%%", numero, real, texto);
+            char* esperado = (char*)malloc((size_t)n + 1);
+            snprintf(esperado, (size_t)n + 1, "%d|%.4f|%s|%%", numero, real, texto);
+            ref_anexar_n(&ref, esperado, (size_t)n);
+            free(esperado);
+        } else if (tipo == 3) {
+            // Largura maior que o espaço livre: força o caminho que reserva e refaz
+            nome = "sb_formatar (largura)";
+            int largura = (int)(aleatorio() % 9000);
+            sb_formatar(&sb, "[%*s]", largura, texto);
+            int n = snprintf(NULL, 0, "[%*s]", largura, texto);
+            char* esperado = (char*)malloc((size_t)n + 1);
+            snprintf(esperado, (size_t)n + 1, "[%*s]", largura, texto);
+            ref_anexar_n(&ref, esperado, (size_t)n);
+            free(esperado);
+        } else {
+            nome = "sb_anexar_json_string";
+            sb_anexar_json_string(&sb, texto);
+            ref_anexar_json_string(&ref, texto);
+        }
+        free(texto);
+
+        if (sb.erro || sb.tamanho != ref.tamanho || strlen(sb.dados) != sb.tamanho ||
+            memcmp(sb.dados, ref.dados, ref.tamanho + 1) != 0) {
+            divergencias++;
+            fprintf(stderr, "[ERRO BENCH] Iteração %d, operação %d (%s): %zu bytes, esperava %zu\n",
+                    iteracao, op, nome, sb.tamanho, ref.tamanho);
+        }
+    }
+
+    char* final = sb_finalizar(&sb);
+    if (!final || strcmp(final, ref.dados) != 0) divergencias += divergencias == 0;
+    free(final);
+    free(ref.dados);
+    return divergencias;
+}
+
+// ===== Mapa =====
+
+static Grafo* montar_grade(int lado) {
+    Grafo* g = criar_grafo();
+    char nome[32];
+    char outro[32];
+    for (int i = 0; i < lado * lado; i++) {
+        snprintf(nome, sizeof(nome), "Cidade %d", i);
+        int idx = adicionar_cidade(g, nome);
+        grafo_definir_coordenadas(g, idx, -23.0 + 0.05 * (i / lado), -47.0 + 0.05 * (i % lado));
+    }
+    for (int i = 0; i < lado * lado; i++) {
+        snprintf(nome, sizeof(nome), "Cidade %d", i);
+        if (i % lado + 1 < lado) {
+            snprintf(outro, sizeof(outro), "Cidade %d", i + 1);
+            adicionar_aresta(g, nome, outro, 5 + (int)(aleatorio() % 20));
+        }
+        if (i / lado + 1 < lado) {
+            snprintf(outro, sizeof(outro), "Cidade %d", i + lado);
+            adicionar_aresta(g, nome, outro, 5 + (int)(aleatorio() % 20));
+        }
+    }
+    return g;
+}
+
+static int contar(const char* texto, const char* trecho) {
+    int total = 0;
+    for (const char* p = strstr(texto, trecho); p; p = strstr(p + 1, trecho)) total++;
+    return total;
+}
+
+// Gera o mapa de uma grade; retorna 1 se o HTML saiu incompleto
+static int medir_mapa(int cidades) {
+    Grafo* g = montar_grade((int)ceil(sqrt((double)cidades)));
+    int conexoes = grafo_num_conexoes(g);
+
+    double inicio = agora_ms();
+    char* html = gerar_mapa_grafo(g);
+    double tempo = agora_ms() - inicio;
+
+    size_t bytes = html ? strlen(html) : 0;
+    int marcadores = html ? contar(html, "L.marker(") : 0;
+    int linhas = html ? contar(html, "L.polyline(") : 0;
+    size_t fim = strlen(FIM_DO_MAPA);
+    int inteiro = bytes >= fim && strcmp(html + bytes - fim, FIM_DO_MAPA) == 0;
+
+    printf("%8d %10d %12.1f %10.2f %12.2f %10d %8d %8s\n", g->num_cidades, conexoes, bytes / 1024.0,
+           tempo, bytes > 0 ? tempo * 1000.0 / (bytes / 1024.0) : 0.0, marcadores, linhas,
+           inteiro ? "sim" : "NAO");
+
+    int falhou = !inteiro || marcadores != g->num_cidades || linhas != conexoes;
+    if (falhou) {
+        fprintf(stderr, "[ERRO BENCH] Mapa de %d cidades: %d marcadores, %d de %d conexões, fim %s\n",
+                g->num_cidades, marcadores, linhas, conexoes, inteiro ? "presente" : "ausente");
+    }
+    free(html);
+    liberar_grafo(g);
+    return falhou;
+}
+
+int main(int argc, char** argv) {
+    int iteracoes = argc > 1 ? atoi(argv[1]) : 2000;
+    int maximo = argc > 2 ? atoi(argv[2]) : 10000;
+    if (iteracoes < 1 || maximo < 1000) {
+        fprintf(stderr, "Uso: %s [iterações do fuzz] [máximo de cidades do mapa >= 1000]\n", argv[0]);
+        return 2;
+    }
+
+    double inicio = agora_ms();
+    int divergencias = 0;
+    for (int i = 0; i < iteracoes; i++) divergencias += fuzz_iteracao(i);
+    printf("Fuzz do StrBuilder: %d iterações x %d operações em %.0f ms, %d divergências\n\n",
+           iteracoes, OPERACOES_POR_ITERACAO, agora_ms() - inicio, divergencias);
+
+    printf("%8s %10s %12s %10s %12s %10s %8s %8s\n", "cidades", "conexoes", "HTML(KB)", "ms",
+           "us/KB", "marcadores", "linhas", "inteiro");
+    int falhas = 0;
+    int tamanhos[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000};
+    for (size_t i = 0; i < sizeof(tamanhos) / sizeof(tamanhos[0]) && tamanhos[i] <= maximo; i++) {
+        falhas += medir_mapa(tamanhos[i]);
+    }
+    return divergencias > 0 || falhas > 0 ? 1 : 0;
+}
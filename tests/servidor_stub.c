@@ -0,0 +1,289 @@
+/* servidor_stub.c - Servidor HTTP/1.1 local para testes e benchmarks
+ * GenieC - Assistente Inteligente
+ *
+ * Só o necessário para falar com a libcurl: keep-alive, Content-Length no
+ * pedido e na resposta, uma thread por conexão. As respostas vêm de um
+ * tratador do teste, que faz o papel da API (Gemini, OpenWeather...).
+ */
+
+#include "servidor_stub.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STUB_MAX_CONEXOES 64
+
+struct ServidorStub {
+    int escuta;
+    int porta;
+    TratadorStub tratador;
+    void* userdata;
+    pthread_t thread_escuta;
+
+    pthread_mutex_t trava;
+    pthread_cond_t cond_conexoes;
+    int conexoes[STUB_MAX_CONEXOES];  // -1 = livre
+    int conexoes_ativas;
+    int conexoes_aceitas;           // Total desde o início (mede o reaproveitamento do cliente)
+    int parando;
+};
+
+typedef struct {
+    ServidorStub* servidor;
+    int slot;
+} Conexao;
+
+static const char* texto_status(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Status";
+    }
+}
+
+static int enviar_tudo(int fd, const char* dados, size_t tamanho) {
+    while (tamanho > 0) {
+        ssize_t enviados = send(fd, dados, tamanho, MSG_NOSIGNAL);
+        if (enviados <= 0) return 0;
+        dados += enviados;
+        tamanho -= (size_t)enviados;
+    }
+    return 1;
+}
+
+// Posição logo depois de "\r\n\r\n" (0 se o cabeçalho ainda não chegou inteiro)
+static size_t fim_do_cabecalho(const char* dados, size_t tamanho) {
+    for (size_t i = 0; i + 4 <= tamanho; i++) {
+        if (memcmp(dados + i, "\r\n\r\n", 4) == 0) return i + 4;
+    }
+    return 0;
+}
+
+// Lê um pedido completo (cabeçalho + corpo) para buffer; retorna 0 se a conexão fechou
+static int ler_pedido(int fd, char** buffer, size_t* capacidade, size_t* usados,
+                      size_t* fim_cabecalho, size_t* tamanho_corpo) {
+    *fim_cabecalho = 0;
+    for (;;) {
+        if (*fim_cabecalho == 0) {
+            size_t fim = fim_do_cabecalho(*buffer, *usados);
+            if (fim > 0) {
+                *fim_cabecalho = fim;
+                *tamanho_corpo = 0;
+                (*buffer)[*fim_cabecalho - 2] = '\0';
+
+                for (char* linha = strstr(*buffer, "\r\n"); linha; linha = strstr(linha + 2, "\r\n")) {
+                    if (strncasecmp(linha + 2, "Content-Length:", 15) == 0) {
+                        *tamanho_corpo = (size_t)strtoul(linha + 17, NULL, 10);
+                    }
+                }
+            }
+        }
+        if (*fim_cabecalho > 0 && *usados >= *fim_cabecalho + *tamanho_corpo) return 1;
+
+        if (*usados + 4096 + 1 > *capacidade) {
+            size_t nova = *capacidade * 2 + 4096;
+            char* novo = (char*)realloc(*buffer, nova);
+            if (!novo) return 0;
+            *buffer = novo;
+            *capacidade = nova;
+        }
+        ssize_t lidos = recv(fd, *buffer + *usados, *capacidade - *usados - 1, 0);
+        if (lidos <= 0) return 0;
+        *usados += (size_t)lidos;
+    }
+}
+
+static void* atender_conexao(void* arg) {
+    Conexao* conexao = (Conexao*)arg;
+    ServidorStub* servidor = conexao->servidor;
+    int fd = servidor->conexoes[conexao->slot];
+
+    size_t capacidade = 8192;
+    size_t usados = 0;
+    char* buffer = (char*)malloc(capacidade);
+
+    while (buffer) {
+        size_t fim_cabecalho = 0;
+        size_t tamanho_corpo = 0;
+        if (!ler_pedido(fd, &buffer, &capacidade, &usados, &fim_cabecalho, &tamanho_corpo)) break;
+
+        // "METODO /caminho HTTP/1.1"
+        char metodo[16] = "";
+        char caminho[2048] = "";
+        sscanf(buffer, "%15s %2047s", metodo, caminho);
+
+        char* corpo = (char*)malloc(tamanho_corpo + 1);
+        if (!corpo) break;
+        memcpy(corpo, buffer + fim_cabecalho, tamanho_corpo);
+        corpo[tamanho_corpo] = '\0';
+
+        RespostaStub resposta = {404, NULL, NULL, 0, 0};
+        servidor->tratador(metodo, caminho, corpo, &resposta, servidor->userdata);
+        free(corpo);
+
+        if (resposta.atraso_ms > 0) {
+            struct timespec espera = {resposta.atraso_ms / 1000, (long)(resposta.atraso_ms % 1000) * 1000000L};
+            nanosleep(&espera, NULL);
+        }
+
+        size_t tamanho_resposta = resposta.corpo ? strlen(resposta.corpo) : 0;
+        char cabecalho[256];
+        int n = snprintf(cabecalho, sizeof(cabecalho),
+                         "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+                         resposta.status, texto_status(resposta.status),
+                         resposta.tipo ? resposta.tipo : "application/json", tamanho_resposta);
+        int ok = enviar_tudo(fd, cabecalho, (size_t)n);
+        int cortar = resposta.cortar_apos > 0 && resposta.cortar_apos < tamanho_resposta;
+        if (cortar) tamanho_resposta = resposta.cortar_apos;
+        if (ok && strcmp(metodo, "HEAD") != 0 && tamanho_resposta > 0) {
+            ok = enviar_tudo(fd, resposta.corpo, tamanho_resposta);
+        }
+        free(resposta.corpo);
+        if (!ok || cortar) break;
+
+        // Pedidos seguintes que já chegaram ficam no início do buffer
+        size_t consumidos = fim_cabecalho + tamanho_corpo;
+        memmove(buffer, buffer + consumidos, usados - consumidos);
+        usados -= consumidos;
+    }
+    free(buffer);
+
+    pthread_mutex_lock(&servidor->trava);
+    close(fd);
+    servidor->conexoes[conexao->slot] = -1;
+    servidor->conexoes_ativas--;
+    pthread_cond_broadcast(&servidor->cond_conexoes);
+    pthread_mutex_unlock(&servidor->trava);
+    free(conexao);
+    return NULL;
+}
+
+static void* laco_escuta(void* arg) {
+    ServidorStub* servidor = (ServidorStub*)arg;
+
+    for (;;) {
+        int fd = accept(servidor->escuta, NULL, NULL);
+        if (fd < 0) break;
+
+        // Cabeçalho e corpo saem em dois send(): com Nagle, o corpo esperaria o ACK
+        // atrasado do cliente (~40 ms) em toda conexão reaproveitada
+        int sem_atraso = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &sem_atraso, sizeof(sem_atraso));
+
+        pthread_mutex_lock(&servidor->trava);
+        int slot = -1;
+        for (int i = 0; !servidor->parando && i < STUB_MAX_CONEXOES; i++) {
+            if (servidor->conexoes[i] == -1) {
+                slot = i;
+                break;
+            }
+        }
+        Conexao* conexao = slot >= 0 ? (Conexao*)malloc(sizeof(Conexao)) : NULL;
+        if (conexao) {
+            conexao->servidor = servidor;
+            conexao->slot = slot;
+            servidor->conexoes[slot] = fd;
+            servidor->conexoes_ativas++;
+            servidor->conexoes_aceitas++;
+        }
+        pthread_mutex_unlock(&servidor->trava);
+
+        pthread_t thread;
+        if (!conexao || pthread_create(&thread, NULL, atender_conexao, conexao) != 0) {
+            if (conexao) {
+                pthread_mutex_lock(&servidor->trava);
+                servidor->conexoes[slot] = -1;
+                servidor->conexoes_ativas--;
+                pthread_mutex_unlock(&servidor->trava);
+                free(conexao);
+            }
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+ServidorStub* servidor_stub_iniciar(TratadorStub tratador, void* userdata) {
+    ServidorStub* servidor = (ServidorStub*)calloc(1, sizeof(ServidorStub));
+    if (!servidor) return NULL;
+
+    servidor->tratador = tratador;
+    servidor->userdata = userdata;
+    pthread_mutex_init(&servidor->trava, NULL);
+    pthread_cond_init(&servidor->cond_conexoes, NULL);
+    for (int i = 0; i < STUB_MAX_CONEXOES; i++) servidor->conexoes[i] = -1;
+
+    servidor->escuta = socket(AF_INET, SOCK_STREAM, 0);
+    int reusar = 1;
+    setsockopt(servidor->escuta, SOL_SOCKET, SO_REUSEADDR, &reusar, sizeof(reusar));
+
+    struct sockaddr_in endereco;
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sin_family = AF_INET;
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    endereco.sin_port = 0;
+    socklen_t tamanho = sizeof(endereco);
+
+    if (servidor->escuta < 0 ||
+        bind(servidor->escuta, (struct sockaddr*)&endereco, sizeof(endereco)) != 0 ||
+        listen(servidor->escuta, 64) != 0 ||
+        getsockname(servidor->escuta, (struct sockaddr*)&endereco, &tamanho) != 0 ||
+        pthread_create(&servidor->thread_escuta, NULL, laco_escuta, servidor) != 0) {
+        if (servidor->escuta >= 0) close(servidor->escuta);
+        free(servidor);
+        return NULL;
+    }
+    servidor->porta = ntohs(endereco.sin_port);
+    return servidor;
+}
+
+int servidor_stub_porta(const ServidorStub* servidor) {
+    return servidor ? servidor->porta : 0;
+}
+
+int servidor_stub_conexoes(ServidorStub* servidor) {
+    if (!servidor) return 0;
+    pthread_mutex_lock(&servidor->trava);
+    int aceitas = servidor->conexoes_aceitas;
+    pthread_mutex_unlock(&servidor->trava);
+    return aceitas;
+}
+
+void servidor_stub_parar(ServidorStub* servidor) {
+    if (!servidor) return;
+
+    // shutdown acorda o accept; close sozinho não garante isso no Linux
+    pthread_mutex_lock(&servidor->trava);
+    servidor->parando = 1;
+    pthread_mutex_unlock(&servidor->trava);
+    shutdown(servidor->escuta, SHUT_RDWR);
+    pthread_join(servidor->thread_escuta, NULL);
+    close(servidor->escuta);
+
+    pthread_mutex_lock(&servidor->trava);
+    for (int i = 0; i < STUB_MAX_CONEXOES; i++) {
+        if (servidor->conexoes[i] != -1) shutdown(servidor->conexoes[i], SHUT_RDWR);
+    }
+    while (servidor->conexoes_ativas > 0) {
+        pthread_cond_wait(&servidor->cond_conexoes, &servidor->trava);
+    }
+    pthread_mutex_unlock(&servidor->trava);
+
+    pthread_mutex_destroy(&servidor->trava);
+    pthread_cond_destroy(&servidor->cond_conexoes);
+    free(servidor);
+}
@@ -0,0 +1,34 @@
+/* servidor_stub.h - Servidor HTTP/1.1 local para testes e benchmarks
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef SERVIDOR_STUB_H
+#define SERVIDOR_STUB_H
+
+#include <stddef.h>
+
+// Resposta preenchida pelo tratador (corpo alocado com malloc; o servidor libera)
+typedef struct {
+    int status;
+    const char* tipo;               // Content-Type (padrão: application/json)
+    char* corpo;
+    int atraso_ms;                  // Espera antes de responder (simula a API)
+    size_t cortar_apos;             // > 0: envia só esses bytes do corpo e fecha (queda no meio)
+} RespostaStub;
+
+// Chamado em uma thread por conexão; caminho inclui a query string
+typedef void (*TratadorStub)(const char* metodo, const char* caminho, const char* corpo,
+                             RespostaStub* resposta, void* userdata);
+
+typedef struct ServidorStub ServidorStub;
+
+// Escuta em 127.0.0.1 numa porta livre; retorna NULL em erro
+ServidorStub* servidor_stub_iniciar(TratadorStub tratador, void* userdata);
+int servidor_stub_porta(const ServidorStub* servidor);
+// Conexões TCP aceitas desde o início
+int servidor_stub_conexoes(ServidorStub* servidor);
+
+// Fecha as conexões abertas e espera as threads terminarem
+void servidor_stub_parar(ServidorStub* servidor);
+
+#endif // SERVIDOR_STUB_H
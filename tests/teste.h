@@ -0,0 +1,33 @@
+/* teste.h - Verificações simples para os executáveis de teste
+ * GenieC - Assistente Inteligente
+ */
+
+#ifndef TESTE_H
+#define TESTE_H
+
+#include <stdio.h>
+
+static int teste_falhas = 0;
+
+// Registra a falha e segue (o teste termina com código != 0 se houver alguma)
+#define VERIFICAR(condicao, ...)                                              \
+    do {                                                                      \
+        if (!(condicao)) {                                                    \
+            teste_falhas++;                                                   \
+            fprintf(stderr, "[FALHA] %s:%d: ", __FILE__, __LINE__);           \
+            fprintf(stderr, __VA_ARGS__);                                     \
+            fprintf(stderr, "\n");                                            \
+        }                                                                     \
+    } while (0)
+
+// Resumo no fim do main: return teste_resultado("nome");
+static int teste_resultado(const char* nome) {
+    if (teste_falhas > 0) {
+        fprintf(stderr, "[TESTE] %s: %d falha(s)\n", nome, teste_falhas);
+        return 1;
+    }
+    fprintf(stderr, "[TESTE] %s: ok\n", nome);
+    return 0;
+}
+
+#endif // TESTE_H
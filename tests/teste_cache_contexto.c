@@ -0,0 +1,157 @@
+/* teste_cache_contexto.c - Cache de contexto (cachedContents) contra um Gemini local
+ * GenieC - Assistente Inteligente
+ *
+ * O servidor stub faz o papel dos endpoints generateContent e cachedContents
+ * (POST/PATCH/DELETE). Uma conversa longa deve reaproveitar o cache por várias
+ * mensagens (o histórico descarta turnos em blocos), e a troca de cidade deve
+ * descartar o cache e removê-lo do servidor.
+ */
+
+#include "teste.h"
+#include "servidor_stub.h"
+#include "config.h"
+#include "gemini.h"
+#include "historico.h"
+#include "http_utils.h"
+#include "tarefas.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MENSAGENS 40
+
+typedef struct {
+    pthread_mutex_t trava;
+    int criacoes;
+    int renovacoes;
+    int remocoes;
+    int mensagens;
+    int mensagens_com_cache;
+    int cache_com_system_instruction;
+    size_t bytes_com_cache;
+    size_t bytes_sem_cache;
+} EstadoGemini;
+
+static void tratar_gemini(const char* metodo, const char* caminho, const char* corpo,
+                          RespostaStub* resposta, void* userdata) {
+    EstadoGemini* estado = (EstadoGemini*)userdata;
+    char buffer[256];
+
+    pthread_mutex_lock(&estado->trava);
+    resposta->status = 200;
+    if (strstr(caminho, ":generateContent")) {
+        estado->mensagens++;
+        if (strstr(corpo, "\"cachedContent\"")) {
+            estado->mensagens_com_cache++;
+            estado->bytes_com_cache += strlen(corpo);
+            if (strstr(corpo, "system_instruction")) estado->cache_com_system_instruction++;
+        } else {
+            estado->bytes_sem_cache += strlen(corpo);
+        }
+        resposta->corpo = strdup("{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"Resposta do modelo\"}],"
+                                 "\"role\":\"model\"}}]}");
+    } else if (strcmp(metodo, "POST") == 0 && strstr(caminho, "/cachedContents")) {
+        estado->criacoes++;
+        snprintf(buffer, sizeof(buffer), "{\"name\":\"cachedContents/c%d\"}", estado->criacoes);
+        resposta->corpo = strdup(buffer);
+    } else if (strcmp(metodo, "PATCH") == 0) {
+        estado->renovacoes++;
+        resposta->corpo = strdup("{}");
+    } else if (strcmp(metodo, "DELETE") == 0) {
+        estado->remocoes++;
+        resposta->corpo = strdup("{}");
+    } else {
+        resposta->status = 404;
+    }
+    pthread_mutex_unlock(&estado->trava);
+}
+
+static EstadoGemini ler_estado(EstadoGemini* estado) {
+    pthread_mutex_lock(&estado->trava);
+    EstadoGemini copia = *estado;
+    pthread_mutex_unlock(&estado->trava);
+    return copia;
+}
+
+// A criação e a remoção do cache rodam no pool de trabalho
+static void aguardar_tarefas(void) {
+    struct timespec espera = {0, 100 * 1000000L};
+    nanosleep(&espera, NULL);
+}
+
+static void conversar(HistoricoChat* historico, const char* cidade, int mensagens) {
+    char pergunta[700];
+    for (int i = 0; i < mensagens; i++) {
+        // Perguntas longas o bastante para passar de CACHE_CONTEXTO_MIN_TOKENS
+        snprintf(pergunta, sizeof(pergunta), "Pergunta %d: %0600d", i, i);
+        adicionar_turno(historico, "user", pergunta);
+        char* resposta = consultar_gemini(pergunta, historico, cidade);
+        adicionar_turno(historico, "model", resposta ? resposta : "");
+        free(resposta);
+        aguardar_tarefas();
+    }
+}
+
+int main(void) {
+    EstadoGemini estado;
+    memset(&estado, 0, sizeof(estado));
+    pthread_mutex_init(&estado.trava, NULL);
+
+    ServidorStub* servidor = servidor_stub_iniciar(tratar_gemini, &estado);
+    VERIFICAR(servidor != NULL, "servidor stub não iniciou");
+    if (!servidor) return teste_resultado("cache_contexto");
+
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", servidor_stub_porta(servidor));
+    setenv("GEMINI_API_BASE", base, 1);
+    setenv("GEMINI_API_KEY", "chave-de-teste", 1);
+
+    http_inicializar();
+    tarefas_iniciar(2);
+    HistoricoChat* historico = inicializar_chat_historico();
+
+    // Conversa longa: o histórico passa de MAX_HISTORY_TURNS várias vezes
+    conversar(historico, "Campinas", MENSAGENS);
+    EstadoGemini e = ler_estado(&estado);
+
+    // Cada descarte de bloco invalida o cache uma vez (não a cada mensagem)
+    int descartes = (2 * MENSAGENS - MAX_HISTORY_TURNS) / HISTORICO_DESCARTE_BLOCO + 1;
+    fprintf(stderr, "[TESTE] %d mensagens: %d com cache, %d criações, %d remoções\n",
+            e.mensagens, e.mensagens_com_cache, e.criacoes, e.remocoes);
+    VERIFICAR(e.mensagens == MENSAGENS, "esperava %d mensagens, recebeu %d", MENSAGENS, e.mensagens);
+    VERIFICAR(e.criacoes >= 1, "o cache nunca foi criado");
+    VERIFICAR(e.criacoes <= descartes + 1, "%d criações para %d descartes de bloco", e.criacoes, descartes);
+    VERIFICAR(e.mensagens_com_cache >= MENSAGENS / 2, "só %d mensagens usaram o cache", e.mensagens_com_cache);
+    VERIFICAR(e.cache_com_system_instruction == 0, "mensagem com cache reenviou o system_instruction");
+    VERIFICAR(e.remocoes == e.criacoes - 1, "%d remoções para %d criações", e.remocoes, e.criacoes);
+
+    if (e.mensagens_com_cache > 0 && e.mensagens > e.mensagens_com_cache) {
+        fprintf(stderr, "[TESTE] Bytes médios por mensagem: %zu com cache, %zu sem\n",
+                e.bytes_com_cache / e.mensagens_com_cache,
+                e.bytes_sem_cache / (e.mensagens - e.mensagens_com_cache));
+    }
+
+    // Troca de cidade: o cache cita a cidade antiga e deve sair do servidor
+    gemini_contexto_invalidar();
+    aguardar_tarefas();
+    EstadoGemini antes = ler_estado(&estado);
+    VERIFICAR(antes.remocoes == antes.criacoes, "cache não removido ao invalidar");
+
+    conversar(historico, "Santos", 1);
+    EstadoGemini depois = ler_estado(&estado);
+    VERIFICAR(depois.mensagens_com_cache == antes.mensagens_com_cache,
+              "mensagem depois da troca de cidade usou o cache antigo");
+
+    // Encerramento remove na hora o que tiver sido criado
+    tarefas_finalizar();
+    gemini_contexto_liberar();
+    e = ler_estado(&estado);
+    VERIFICAR(e.remocoes == e.criacoes, "%d caches deixados no servidor", e.criacoes - e.remocoes);
+
+    liberar_historico_chat(historico);
+    http_finalizar();
+    servidor_stub_parar(servidor);
+    pthread_mutex_destroy(&estado.trava);
+    return teste_resultado("cache_contexto");
+}
@@ -0,0 +1,116 @@
+/* teste_compactacao.c - Compactação do log do grafo em segundo plano
+ * GenieC - Assistente Inteligente
+ *
+ * Enche o log (.wal) até disparar a compactação e continua editando o grafo
+ * enquanto ela grava. A trava do grafo só pode ficar presa durante a cópia:
+ * a espera mais longa por ela tem de ser bem menor que a compactação inteira.
+ * Depois de recarregar do disco, nenhuma conexão pode ter se perdido, nem as
+ * feitas durante a gravação.
+ */
+
+#include "teste.h"
+#include "config.h"
+#include "grafo.h"
+#include "tarefas.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ARQUIVO "grafo.txt"
+#define CIDADES_BASE 50000
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void conectar(Grafo* g, const char* prefixo, int i, int distancia) {
+    char a[32];
+    char b[32];
+    snprintf(a, sizeof(a), "%s%d", prefixo, i);
+    snprintf(b, sizeof(b), "%s%d", prefixo, i + 1);
+    adicionar_aresta(g, a, b, distancia);
+}
+
+// Conexões de g que faltam (ou têm outra distância) em recarregado
+static int conexoes_perdidas(Grafo* g, Grafo* recarregado) {
+    grafo_compactar(g);
+    int perdidas = 0;
+    for (int u = 0; u < g->num_cidades; u++) {
+        int u2 = encontrar_cidade(recarregado, g->cidades[u].nome);
+        for (int e = g->csr_inicio[u]; e < g->csr_inicio[u + 1]; e++) {
+            int v2 = encontrar_cidade(recarregado, g->cidades[g->csr_destino[e]].nome);
+            if (u2 < 0 || v2 < 0 || grafo_distancia(recarregado, u2, v2) != g->csr_peso[e]) perdidas++;
+        }
+    }
+    return perdidas;
+}
+
+int main(void) {
+    char diretorio[] = "/tmp/geniec_teste_XXXXXX";
+    if (!mkdtemp(diretorio) || chdir(diretorio) != 0) {
+        VERIFICAR(0, "não foi possível criar o diretório temporário");
+        return teste_resultado("compactacao");
+    }
+    tarefas_iniciar(2);
+
+    // Grafo grande o bastante para a reescrita levar algum tempo
+    Grafo* g = criar_grafo();
+    for (int i = 0; i < CIDADES_BASE; i++) conectar(g, "Base", i, 10 + i % 90);
+    VERIFICAR(grafo_persistir_completo(g, ARQUIVO) > 0, "gravação inicial falhou");
+
+    // Enche o log até disparar a compactação
+    grafo_travar(g);
+    for (int i = 0; i < GRAFO_WAL_MAX_REGISTROS; i++) {
+        conectar(g, "Log", i, 5 + i % 50);
+        if (i % 500 == 499) salvar_coordenadas_grafo(g, ARQUIVO);
+    }
+    salvar_coordenadas_grafo(g, ARQUIVO);
+    VERIFICAR(g->compactando, "compactação não foi agendada");
+    grafo_destravar(g);
+
+    // Edita enquanto ela grava, medindo a espera pela trava
+    double inicio = agora_ms();
+    double espera_maxima = 0.0;
+    int edicoes = 0;
+    for (;;) {
+        double antes = agora_ms();
+        grafo_travar(g);
+        double espera = agora_ms() - antes;
+        if (espera > espera_maxima) espera_maxima = espera;
+
+        int compactando = g->compactando;
+        if (compactando) {
+            conectar(g, "Durante", edicoes++, 7);
+            salvar_coordenadas_grafo(g, ARQUIVO);
+        }
+        grafo_destravar(g);
+        if (!compactando) break;
+    }
+    double duracao = agora_ms() - inicio;
+    tarefas_finalizar();
+
+    fprintf(stderr, "[TESTE] Compactação: %.1f ms, espera máxima pela trava %.1f ms, %d edições durante\n",
+            duracao, espera_maxima, edicoes);
+    VERIFICAR(espera_maxima < duracao / 2, "trava presa por %.1f ms de uma compactação de %.1f ms",
+              espera_maxima, duracao);
+    VERIFICAR(edicoes > 0, "nenhuma edição durante a compactação");
+    VERIFICAR(access("grafo.wal.ant", F_OK) != 0, "log separado ficou no disco depois da compactação");
+
+    // Tudo volta do disco: base, log compactado e o que entrou durante a gravação
+    Grafo* recarregado = criar_grafo();
+    carregar_coordenadas_grafo(recarregado, ARQUIVO);
+    VERIFICAR(recarregado->num_cidades == g->num_cidades, "%d cidades recarregadas, esperava %d",
+              recarregado->num_cidades, g->num_cidades);
+    int perdidas = conexoes_perdidas(g, recarregado);
+    VERIFICAR(perdidas == 0, "%d conexões perdidas depois de recarregar", perdidas);
+
+    liberar_grafo(recarregado);
+    liberar_grafo(g);
+    remover_arquivos_grafo(ARQUIVO);
+    chdir("/");
+    rmdir(diretorio);
+    return teste_resultado("compactacao");
+}
@@ -0,0 +1,125 @@
+/* teste_distancias_lote.c - Cache de distâncias da consulta em lote
+ * GenieC - Assistente Inteligente
+ *
+ * Um bloco com dois pares recebe uma resposta com as rotas dos dois. Cada par
+ * deve ir para o cache só com os trechos das próprias rotas (a principal e as
+ * alternativas próximas), não com a resposta do bloco inteiro. Uma resposta que
+ * não é JSON não pode virar entrada de cache.
+ */
+
+#include "teste.h"
+#include "servidor_stub.h"
+#include "cache_distancias.h"
+#include "config.h"
+#include "gemini.h"
+#include "grafo.h"
+#include "http_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Alfa-Delta: principal por Bravo (200 km), alternativa por Charlie (270 km)
+// Xis-Zeta: principal por Ypsilon (170 km); Wuhan é um desvio de 600 km
+#define RESPOSTA_LOTE \
+    "{\\\"conexoes\\\":[" \
+    "{\\\"origem\\\":\\\"Alfa\\\",\\\"destino\\\":\\\"Bravo\\\",\\\"km\\\":100}," \
+    "{\\\"origem\\\":\\\"Bravo\\\",\\\"destino\\\":\\\"Delta\\\",\\\"km\\\":100}," \
+    "{\\\"origem\\\":\\\"Alfa\\\",\\\"destino\\\":\\\"Charlie\\\",\\\"km\\\":150}," \
+    "{\\\"origem\\\":\\\"Charlie\\\",\\\"destino\\\":\\\"Delta\\\",\\\"km\\\":120}," \
+    "{\\\"origem\\\":\\\"Xis\\\",\\\"destino\\\":\\\"Ypsilon\\\",\\\"km\\\":80}," \
+    "{\\\"origem\\\":\\\"Ypsilon\\\",\\\"destino\\\":\\\"Zeta\\\",\\\"km\\\":90}," \
+    "{\\\"origem\\\":\\\"Ypsilon\\\",\\\"destino\\\":\\\"Wuhan\\\",\\\"km\\\":300}," \
+    "{\\\"origem\\\":\\\"Wuhan\\\",\\\"destino\\\":\\\"Zeta\\\",\\\"km\\\":300}]}"
+
+static char* resposta_gemini(const char* texto) {
+    size_t tamanho = strlen(texto) + 128;
+    char* corpo = (char*)malloc(tamanho);
+    if (corpo) {
+        snprintf(corpo, tamanho, "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"%s\"}],"
+                                 "\"role\":\"model\"}}]}", texto);
+    }
+    return corpo;
+}
+
+static void tratar_gemini(const char* metodo, const char* caminho, const char* corpo,
+                          RespostaStub* resposta, void* userdata) {
+    resposta->status = 200;
+    if (!strstr(corpo, "conexoes")) {
+        resposta->corpo = resposta_gemini("{\\\"cidades\\\":[]}");    // Coordenadas: nenhuma
+    } else if (strstr(corpo, "Alfa")) {
+        resposta->corpo = resposta_gemini(RESPOSTA_LOTE);
+    } else {
+        resposta->corpo = resposta_gemini("Desculpe, não consegui listar as distâncias.");
+    }
+}
+
+static int contem_aresta(const ArestaCache* arestas, int num, const char* a, const char* b) {
+    for (int i = 0; i < num; i++) {
+        if ((strcmp(arestas[i].cidade1, a) == 0 && strcmp(arestas[i].cidade2, b) == 0) ||
+            (strcmp(arestas[i].cidade1, b) == 0 && strcmp(arestas[i].cidade2, a) == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    // O cache e o grafo gravam arquivos no diretório atual
+    char diretorio[] = "/tmp/geniec_teste_XXXXXX";
+    if (!mkdtemp(diretorio) || chdir(diretorio) != 0) {
+        VERIFICAR(0, "não foi possível criar o diretório temporário");
+        return teste_resultado("distancias_lote");
+    }
+
+    ServidorStub* servidor = servidor_stub_iniciar(tratar_gemini, NULL);
+    VERIFICAR(servidor != NULL, "servidor stub não iniciou");
+    if (!servidor) return teste_resultado("distancias_lote");
+
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", servidor_stub_porta(servidor));
+    setenv("GEMINI_API_BASE", base, 1);
+    setenv("GEMINI_API_KEY", "chave-de-teste", 1);
+    http_inicializar();
+
+    Grafo* grafo = criar_grafo();
+    ParCidades pares[2];
+    snprintf(pares[0].origem, sizeof(pares[0].origem), "Alfa");
+    snprintf(pares[0].destino, sizeof(pares[0].destino), "Delta");
+    snprintf(pares[1].origem, sizeof(pares[1].origem), "Xis");
+    snprintf(pares[1].destino, sizeof(pares[1].destino), "Zeta");
+
+    int conexoes = obter_distancias_lote_ia_e_preencher_grafo(pares, 2, grafo);
+    VERIFICAR(conexoes == 8, "grafo recebeu %d conexões, esperava as 8 do bloco", conexoes);
+
+    // Alfa-Delta: as duas rotas, nada do outro par
+    int num = 0;
+    ArestaCache* arestas = cache_distancias_buscar("Alfa", "Delta", MODELO_GEMINI_GRAFO, &num);
+    VERIFICAR(arestas && num == 4, "Alfa-Delta no cache com %d conexões, esperava 4", num);
+    if (arestas) {
+        VERIFICAR(contem_aresta(arestas, num, "Alfa", "Charlie") && contem_aresta(arestas, num, "Charlie", "Delta"),
+                  "rota alternativa de Alfa-Delta ficou de fora");
+        VERIFICAR(!contem_aresta(arestas, num, "Xis", "Ypsilon"), "trecho de Xis-Zeta no cache de Alfa-Delta");
+    }
+    free(arestas);
+
+    // Xis-Zeta: a rota principal, sem o desvio por Wuhan
+    arestas = cache_distancias_buscar("Zeta", "Xis", MODELO_GEMINI_GRAFO, &num);
+    VERIFICAR(arestas && num == 2, "Xis-Zeta no cache com %d conexões, esperava 2", num);
+    if (arestas) {
+        VERIFICAR(!contem_aresta(arestas, num, "Ypsilon", "Wuhan"), "desvio de 600 km no cache de Xis-Zeta");
+    }
+    free(arestas);
+
+    // Resposta que não é JSON: nenhuma conexão e nada no cache
+    conexoes = obter_distancias_ia_e_preencher_grafo("Pqr", "Stu", grafo);
+    VERIFICAR(conexoes == 0, "%d conexões de uma resposta inválida", conexoes);
+    arestas = cache_distancias_buscar("Pqr", "Stu", MODELO_GEMINI_GRAFO, &num);
+    VERIFICAR(arestas == NULL, "resposta inválida foi para o cache");
+    free(arestas);
+
+    liberar_grafo(grafo);
+    cache_distancias_liberar();
+    http_finalizar();
+    servidor_stub_parar(servidor);
+    return teste_resultado("distancias_lote");
+}
@@ -0,0 +1,171 @@
+/* teste_prazo_chat.c - Prazo único e circuito no streaming do chat
+ * GenieC - Assistente Inteligente
+ *
+ * Uma pergunta do chat tem um só prazo: se o stream trava, o fallback
+ * bloqueante usa apenas o que sobrou dele. Falhas do stream contam para o
+ * circuito do endpoint, e com o circuito aberto o stream falha sem tentar.
+ * Passado o intervalo, uma chamada que já chega sem prazo não pode ficar com a
+ * chamada de teste do circuito meio-aberto e travar o endpoint.
+ */
+
+#include "teste.h"
+#include "servidor_stub.h"
+#include "config.h"
+#include "gemini.h"
+#include "historico.h"
+#include "http_utils.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum {
+    STREAM_TRAVADO,                 // Não responde antes do prazo
+    STREAM_RECUSADO,                // 400: erro definitivo, vai direto ao fallback
+    STREAM_FORA                     // 503: transitório, abre o circuito
+} ModoStream;
+
+typedef struct {
+    pthread_mutex_t trava;
+    ModoStream modo;
+    int streams;
+    int bloqueantes;
+} EstadoGemini;
+
+static void tratar_gemini(const char* metodo, const char* caminho, const char* corpo,
+                          RespostaStub* resposta, void* userdata) {
+    EstadoGemini* estado = (EstadoGemini*)userdata;
+
+    pthread_mutex_lock(&estado->trava);
+    if (strstr(caminho, ":streamGenerateContent")) {
+        estado->streams++;
+        switch (estado->modo) {
+            case STREAM_TRAVADO:
+                resposta->status = 200;
+                resposta->atraso_ms = 3000;
+                break;
+            case STREAM_RECUSADO:
+                resposta->status = 400;
+                break;
+            case STREAM_FORA:
+                resposta->status = 503;
+                break;
+        }
+        resposta->corpo = strdup("{}");
+    } else if (strstr(caminho, ":generateContent")) {
+        estado->bloqueantes++;
+        resposta->status = 200;
+        resposta->corpo = strdup("{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"Resposta do fallback\"}],"
+                                 "\"role\":\"model\"}}]}");
+    }
+    pthread_mutex_unlock(&estado->trava);
+}
+
+static EstadoGemini ler_estado(EstadoGemini* estado) {
+    pthread_mutex_lock(&estado->trava);
+    EstadoGemini copia = *estado;
+    pthread_mutex_unlock(&estado->trava);
+    return copia;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Stream seguido do fallback, como o processar_rpc faz com uma pergunta
+static char* perguntar(HistoricoChat* historico, long prazo_ms, double* duracao_ms) {
+    double inicio = agora_ms();
+    double prazo = http_prazo_novo(prazo_ms);
+    int completo = 0;
+    char* resposta = consultar_gemini_stream("Oi", historico, "Campinas", NULL, NULL, prazo, &completo);
+    if (!completo) {
+        free(resposta);
+        resposta = consultar_gemini_com_prazo("Oi", historico, "Campinas", prazo);
+    }
+    *duracao_ms = agora_ms() - inicio;
+    return resposta;
+}
+
+int main(void) {
+    EstadoGemini estado;
+    memset(&estado, 0, sizeof(estado));
+    pthread_mutex_init(&estado.trava, NULL);
+
+    ServidorStub* servidor = servidor_stub_iniciar(tratar_gemini, &estado);
+    VERIFICAR(servidor != NULL, "servidor stub não iniciou");
+    if (!servidor) return teste_resultado("prazo_chat");
+
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", servidor_stub_porta(servidor));
+    setenv("GEMINI_API_BASE", base, 1);
+    setenv("GEMINI_API_KEY", "chave-de-teste", 1);
+
+    http_inicializar();
+    HistoricoChat* historico = inicializar_chat_historico();
+    adicionar_turno(historico, "user", "Oi");
+    double duracao = 0.0;
+
+    // Stream travado: o prazo da pergunta acaba nele e o fallback nem é enviado
+    estado.modo = STREAM_TRAVADO;
+    char* resposta = perguntar(historico, 1000, &duracao);
+    EstadoGemini e = ler_estado(&estado);
+    fprintf(stderr, "[TESTE] Stream travado: %.0f ms (prazo 1000 ms)\n", duracao);
+    VERIFICAR(resposta == NULL, "resposta inesperada com o stream travado");
+    VERIFICAR(duracao < 1800, "pergunta levou %.0f ms para um prazo de 1000 ms", duracao);
+    VERIFICAR(e.bloqueantes == 0, "fallback enviado depois do prazo esgotado");
+    free(resposta);
+
+    // Stream recusado (400): sem repetir, o fallback responde dentro do mesmo prazo
+    estado.modo = STREAM_RECUSADO;
+    int streams_antes = ler_estado(&estado).streams;
+    resposta = perguntar(historico, 5000, &duracao);
+    e = ler_estado(&estado);
+    VERIFICAR(resposta && strcmp(resposta, "Resposta do fallback") == 0, "fallback não respondeu");
+    VERIFICAR(e.streams - streams_antes == 1, "erro definitivo repetido %d vezes", e.streams - streams_antes);
+    VERIFICAR(duracao < 1000, "fallback levou %.0f ms", duracao);
+    free(resposta);
+
+    // Stream fora (503): as falhas abrem o circuito e o stream passa a falhar na hora
+    estado.modo = STREAM_FORA;
+    double prazo = 0.0;
+    for (int i = 0; i < HTTP_CIRCUITO_FALHAS; i++) {
+        // Prazo curto: a espera até a próxima tentativa não cabe, uma tentativa por chamada
+        prazo = http_prazo_novo(300);
+        int completo = 0;
+        free(consultar_gemini_stream("Oi", historico, "Campinas", NULL, NULL, prazo, &completo));
+    }
+    streams_antes = ler_estado(&estado).streams;
+    double inicio = agora_ms();
+    int completo = 1;
+    resposta = consultar_gemini_stream("Oi", historico, "Campinas", NULL, NULL, http_prazo_novo(5000), &completo);
+    duracao = agora_ms() - inicio;
+    e = ler_estado(&estado);
+    VERIFICAR(resposta == NULL && !completo, "stream respondeu com o endpoint fora");
+    VERIFICAR(e.streams == streams_antes, "circuito aberto ainda enviou o stream");
+    VERIFICAR(duracao < 100, "circuito aberto levou %.0f ms", duracao);
+    free(resposta);
+
+    // Intervalo do circuito passado: a chamada com o prazo esgotado falha sem tentar
+    // e sem ficar com a chamada de teste, então a próxima chega ao servidor
+    struct timespec espera = {(HTTP_CIRCUITO_ABERTO_MS + 100) / 1000, ((HTTP_CIRCUITO_ABERTO_MS + 100) % 1000) * 1000000L};
+    nanosleep(&espera, NULL);
+    estado.modo = STREAM_RECUSADO;
+    streams_antes = ler_estado(&estado).streams;
+    completo = 1;
+    free(consultar_gemini_stream("Oi", historico, "Campinas", NULL, NULL, http_prazo_novo(0), &completo));
+    VERIFICAR(!completo && ler_estado(&estado).streams == streams_antes, "stream enviado com o prazo esgotado");
+
+    resposta = perguntar(historico, 5000, &duracao);
+    e = ler_estado(&estado);
+    VERIFICAR(e.streams - streams_antes == 1, "circuito ficou meio-aberto: o stream seguinte não chegou ao servidor");
+    VERIFICAR(resposta && strcmp(resposta, "Resposta do fallback") == 0, "fallback não respondeu depois do circuito");
+    free(resposta);
+
+    liberar_historico_chat(historico);
+    http_finalizar();
+    servidor_stub_parar(servidor);
+    pthread_mutex_destroy(&estado.trava);
+    return teste_resultado("prazo_chat");
+}
@@ -0,0 +1,175 @@
+/* teste_sse.c - Replay de streams SSE gravados pelo parser e pelo stream do chat
+ * GenieC - Assistente Inteligente
+ *
+ * Os arquivos em fixtures/ são respostas do streamGenerateContent?alt=sse.
+ * Cada um passa pelo sse_parser_* em pedaços de vários tamanhos (linhas e
+ * eventos cortados ao meio) e o texto tem de sair igual. Pelo servidor stub,
+ * uma conexão que cai no meio deve devolver o texto parcial com completo = 0.
+ */
+
+#include "teste.h"
+#include "servidor_stub.h"
+#include "gemini.h"
+#include "historico.h"
+#include "http_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GENIEC_FIXTURES
+#define GENIEC_FIXTURES "fixtures"
+#endif
+
+typedef struct {
+    const char* arquivo;
+    const char* texto;              // Texto esperado ao fim do replay
+    int deltas;                     // Trechos entregues ao callback
+} CasoSse;
+
+static const CasoSse casos[] = {
+    // CRLF como a API envia; escapes \uXXXX (com par substituto) e \n no texto
+    {"sse_gemini_crlf.sse",
+     "Olá! Em Campinas faz 27 °C com céu limpo.\n\nDica: leve água \"gelada\" 🌞", 3},
+    // LF, comentários, event:/id:, data em duas linhas, evento sem texto e [DONE]
+    {"sse_gemini_lf.sse", "Rota: São Paulo → Rio (429 km), via Dutra.", 2},
+    // Conexão caiu no meio do terceiro evento: só os dois primeiros contam
+    {"sse_gemini_truncado.sse", "Primeira parte e segunda parte.", 2},
+};
+
+static const size_t pedacos[] = {0, 1, 2, 3, 7, 64};   // 0 = arquivo inteiro
+
+typedef struct {
+    char texto[512];
+    int deltas;
+} Deltas;
+
+static void ao_receber_delta(const char* delta, void* userdata) {
+    Deltas* d = (Deltas*)userdata;
+    strncat(d->texto, delta, sizeof(d->texto) - strlen(d->texto) - 1);
+    d->deltas++;
+}
+
+static char* ler_fixture(const char* nome, size_t* tamanho) {
+    char caminho[512];
+    snprintf(caminho, sizeof(caminho), "%s/%s", GENIEC_FIXTURES, nome);
+    FILE* f = fopen(caminho, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* dados = (char*)malloc((size_t)n + 1);
+    *tamanho = dados ? fread(dados, 1, (size_t)n, f) : 0;
+    if (dados) dados[*tamanho] = '\0';
+    fclose(f);
+    return dados;
+}
+
+static void testar_replay(const CasoSse* caso) {
+    size_t tamanho = 0;
+    char* dados = ler_fixture(caso->arquivo, &tamanho);
+    VERIFICAR(dados != NULL, "fixture %s não encontrada", caso->arquivo);
+    if (!dados) return;
+
+    for (size_t p = 0; p < sizeof(pedacos) / sizeof(pedacos[0]); p++) {
+        size_t pedaco = pedacos[p] ? pedacos[p] : tamanho;
+        Deltas d;
+        memset(&d, 0, sizeof(d));
+
+        GeminiSseParser parser;
+        sse_parser_iniciar(&parser, ao_receber_delta, &d);
+        for (size_t i = 0; i < tamanho; i += pedaco) {
+            sse_parser_alimentar(&parser, dados + i, i + pedaco <= tamanho ? pedaco : tamanho - i);
+        }
+        char* texto = sse_parser_finalizar(&parser);
+
+        VERIFICAR(texto && strcmp(texto, caso->texto) == 0, "%s (pedaços de %zu): texto \"%s\"",
+                  caso->arquivo, pedaco, texto ? texto : "(nulo)");
+        VERIFICAR(d.deltas == caso->deltas, "%s (pedaços de %zu): %d deltas, esperava %d",
+                  caso->arquivo, pedaco, d.deltas, caso->deltas);
+        VERIFICAR(texto && strcmp(d.texto, texto) == 0, "%s: deltas não somam o texto final", caso->arquivo);
+        free(texto);
+    }
+    free(dados);
+}
+
+// ===== Stream completo e interrompido pelo servidor stub =====
+
+typedef struct {
+    char* sse;
+    size_t tamanho;
+    size_t cortar_apos;
+    int streams;
+} EstadoStream;
+
+static void tratar_stream(const char* metodo, const char* caminho, const char* corpo,
+                          RespostaStub* resposta, void* userdata) {
+    EstadoStream* estado = (EstadoStream*)userdata;
+    estado->streams++;
+    resposta->status = 200;
+    resposta->tipo = "text/event-stream";
+    resposta->corpo = strdup(estado->sse);
+    resposta->cortar_apos = estado->cortar_apos;
+}
+
+static void testar_stream(void) {
+    EstadoStream estado;
+    memset(&estado, 0, sizeof(estado));
+    estado.sse = ler_fixture(casos[0].arquivo, &estado.tamanho);
+    VERIFICAR(estado.sse != NULL, "fixture %s não encontrada", casos[0].arquivo);
+    if (!estado.sse) return;
+
+    ServidorStub* servidor = servidor_stub_iniciar(tratar_stream, &estado);
+    VERIFICAR(servidor != NULL, "servidor stub não iniciou");
+    if (!servidor) {
+        free(estado.sse);
+        return;
+    }
+
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", servidor_stub_porta(servidor));
+    setenv("GEMINI_API_BASE", base, 1);
+    setenv("GEMINI_API_KEY", "chave-de-teste", 1);
+    http_inicializar();
+
+    HistoricoChat* historico = inicializar_chat_historico();
+    adicionar_turno(historico, "user", "Como está o tempo?");
+
+    // Transferência inteira: texto completo
+    Deltas d;
+    memset(&d, 0, sizeof(d));
+    int completo = 0;
+    char* texto = consultar_gemini_stream("Como está o tempo?", historico, "Campinas",
+                                          ao_receber_delta, &d, http_prazo_novo(5000), &completo);
+    VERIFICAR(completo == 1, "stream inteiro marcado como interrompido");
+    VERIFICAR(texto && strcmp(texto, casos[0].texto) == 0, "stream inteiro: \"%s\"", texto ? texto : "(nulo)");
+    free(texto);
+
+    // Conexão cai depois do segundo evento: texto parcial, completo = 0 e sem nova tentativa
+    const char* segundo = strstr(estado.sse + 1, "\r\n\r\ndata:");
+    segundo = segundo ? strstr(segundo + 4, "\r\n\r\n") : NULL;
+    estado.cortar_apos = segundo ? (size_t)(segundo - estado.sse) + 4 : 0;
+    int streams_antes = estado.streams;
+
+    memset(&d, 0, sizeof(d));
+    completo = 1;
+    texto = consultar_gemini_stream("Como está o tempo?", historico, "Campinas",
+                                    ao_receber_delta, &d, http_prazo_novo(5000), &completo);
+    VERIFICAR(completo == 0, "stream cortado marcado como completo");
+    VERIFICAR(texto && strcmp(texto, "Olá! Em Campinas faz 27 °C com céu limpo.\n\n") == 0,
+              "stream cortado: \"%s\"", texto ? texto : "(nulo)");
+    VERIFICAR(estado.streams - streams_antes == 1, "stream repetido depois de entregar texto");
+    free(texto);
+
+    liberar_historico_chat(historico);
+    http_finalizar();
+    servidor_stub_parar(servidor);
+    free(estado.sse);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(casos) / sizeof(casos[0]); i++) {
+        testar_replay(&casos[i]);
+    }
+    testar_stream();
+    return teste_resultado("sse");
+}
@@ -71,7 +71,7 @@ function calcularRotaGrafo() {
     // Mostra mensagem de processamento no chat
     adicionarMensagemHTML('Você', `🗺️ Calcular rota: <b>${origem}</b> → <b>${destino}</b>`, true);
 
-    window.rpc.call('grafo_calcular_rota', {_method: 'grafo_calcular_rota', origem: origem, destino: destino});
+    tratarRespostaRota(window.rpc.call('grafo_calcular_rota', {_method: 'grafo_calcular_rota', origem: origem, destino: destino}));
 }
 
 // Visualiza o mapa completo do grafo
@@ -247,6 +247,56 @@ function adicionarMensagem(sender, text, isUser) {
     container.parentElement.scrollTop = container.parentElement.scrollHeight;
 }
 
+// ===== STREAMING DE RESPOSTAS =====
+
+// Balões que estão recebendo texto incrementalmente (id -> elementos)
+const mensagensStream = {};
+
+// Cria um balão vazio que será preenchido conforme os trechos chegam
+function iniciarMensagemStream(id, sender) {
+    const container = document.getElementById('chat-messages');
+    const msgDiv = document.createElement('div');
+    msgDiv.className = 'message assistant';
+    const bubble = document.createElement('div');
+    bubble.className = 'message-bubble streaming';
+    const senderEl = document.createElement('div');
+    senderEl.className = 'message-sender';
+    senderEl.textContent = sender;
+    const textEl = document.createElement('div');
+    bubble.appendChild(senderEl);
+    bubble.appendChild(textEl);
+    msgDiv.appendChild(bubble);
+    container.appendChild(msgDiv);
+    mensagensStream[id] = {msgDiv: msgDiv, bubble: bubble, textEl: textEl};
+}
+
+// Acrescenta um trecho de texto ao balão em streaming
+function anexarMensagemStream(id, delta) {
+    const msg = mensagensStream[id];
+    if (!msg) return;
+    msg.textEl.textContent += delta;
+    const container = document.getElementById('chat-messages');
+    container.parentElement.scrollTop = container.parentElement.scrollHeight;
+}
+
+// Encerra o streaming (remove o balão se nada chegou; interrompida marca o
+// texto como parcial, a resposta completa chega em outro balão)
+function finalizarMensagemStream(id, interrompida) {
+    const msg = mensagensStream[id];
+    if (!msg) return;
+    msg.bubble.classList.remove('streaming');
+    if (msg.textEl.textContent.length === 0) {
+        msg.msgDiv.remove();
+    } else if (interrompida) {
+        msg.bubble.classList.add('interrompida');
+        const aviso = document.createElement('div');
+        aviso.className = 'message-aviso';
+        aviso.textContent = 'Resposta interrompida';
+        msg.bubble.appendChild(aviso);
+    }
+    delete mensagensStream[id];
+}
+
 function adicionarMensagemHTML(sender, html, isUser) {
     const container = document.getElementById('chat-messages');
     const msgDiv = document.createElement('div');
@@ -290,13 +340,104 @@ function adicionarMensagemHTML(sender, html, isUser) {
     });
 }
 
+// ===== ROTAS =====
+
+// Contador para ids únicos dos mapas de rota
+let contadorRotas = 0;
+
+// Escapa texto vindo do backend antes de inseri-lo como HTML
+function escaparHTML(texto) {
+    const div = document.createElement('div');
+    div.textContent = String(texto);
+    return div.innerHTML;
+}
+
+// Se a resposta de uma chamada RPC for uma rota, desenha no chat
+function tratarRespostaRota(promessa) {
+    if (!promessa || !promessa.then) return;
+    promessa.then(r => {
+        if (r && (r.caminho || r.erro)) renderizarRota(r);
+    }).catch(e => console.error('Erro na resposta da rota:', e));
+}
+
+// Desenha a rota recebida em JSON (resumo, mapa Leaflet e trechos)
+function renderizarRota(r) {
+    if (r.erro) {
+        adicionarMensagem('GenieC', '❌ ' + r.erro, false);
+        return;
+    }
+
+    const id = 'mapa-rota-' + (++contadorRotas);
+    const cidades = r.cidades.map(escaparHTML);
+    const trechos = r.trechos.map((km, i) =>
+        `  • ${cidades[i]} → ${cidades[i + 1]}: <b>${km} km</b><br>`).join('');
+
+    adicionarMensagemHTML('GenieC',
+        `🗺️ <b>Menor Caminho Encontrado (${escaparHTML(r.algoritmo)}):</b><br><br>` +
+        `📍 <b>Origem:</b> ${escaparHTML(r.origem)}<br>` +
+        `🎯 <b>Destino:</b> ${escaparHTML(r.destino)}<br>` +
+        `🏙️ <b>Cidades no percurso:</b> ${cidades.length}<br>` +
+        `📏 <b>Distância Total:</b> <span style='color: #4CAF50; font-size: 1.3em;'><b>${r.distanciaTotal} km</b></span><br><br>` +
+        `🗺️ <b>Mapa da Rota:</b><br>` +
+        `<div id='${id}' style='width: 100%; height: 500px; border: 2px solid #4CAF50; border-radius: 8px; margin: 10px 0;'></div><br>` +
+        `🛣️ <b>Rota Visual:</b><br>` +
+        `<div style='background: #f5f5f5; padding: 10px; border-radius: 5px; margin: 10px 0;'>${cidades.join(' → ')}</div><br>` +
+        `📊 <b>Detalhes dos Trechos:</b><br>` +
+        `<div style='background: #fff3cd; padding: 10px; border-radius: 5px; margin: 10px 0;'>${trechos}</div>` +
+        `💡 <i>Calculado com ${escaparHTML(r.algoritmo)} + Visualizado no OpenStreetMap</i>`,
+        false);
+
+    // Espera o balão entrar no DOM antes de criar o mapa
+    requestAnimationFrame(() => desenharMapaRota(id, r, cidades));
+}
+
+function desenharMapaRota(id, r, cidades) {
+    const elemento = document.getElementById(id);
+    if (!elemento) return;
+    if (typeof L === 'undefined') {
+        elemento.innerHTML = '<div style="padding: 20px; color: red; text-align: center;">❌ Erro: Biblioteca de mapas não carregada. Recarregue a página.</div>';
+        return;
+    }
+
+    // Coordenadas vêm como inteiros (graus * escala) codificados por diferença
+    const pontos = [];
+    let lat = 0, lng = 0;
+    for (let i = 0; i + 1 < r.coords.length; i += 2) {
+        lat += r.coords[i];
+        lng += r.coords[i + 1];
+        pontos.push([lat / r.escala, lng / r.escala]);
+    }
+
+    try {
+        const mapa = L.map(id).setView(pontos.length ? pontos[0] : [-15.7939, -47.8828], 6);
+        L.tileLayer('https://{s}.tile.openstreetmap.org/{z}/{x}/{y}.png', {
+            attribution: '© OpenStreetMap',
+            maxZoom: 18
+        }).addTo(mapa);
+
+        const ultimo = cidades.length - 1;
+        pontos.forEach((ponto, j) => {
+            const pos = r.comCoords[j];
+            const rotulo = pos === 0 ? '🚩 Origem' : (pos === ultimo ? '🎯 Destino' : '📍');
+            L.marker(ponto).addTo(mapa).bindPopup(`<b>${cidades[pos]}</b><br>${rotulo}`);
+        });
+
+        if (pontos.length > 0) {
+            const linha = L.polyline(pontos, {color: '#4CAF50', weight: 4, opacity: 0.8}).addTo(mapa);
+            mapa.fitBounds(linha.getBounds());
+        }
+    } catch (e) {
+        console.error('Erro ao criar mapa de rota:', e);
+    }
+}
+
 function enviarPergunta() {
     const input = document.getElementById('input-text');
     const text = input.value.trim();
     if (!text) return;
     console.log('Enviando pergunta:', text);
     adicionarMensagem('Você', text, true);
-    window.rpc.call('pergunta', {text: text});
+    tratarRespostaRota(window.rpc.call('pergunta', {text: text}));
     input.value = '';
 }
 